@@ -0,0 +1,602 @@
+// ==============================================================
+//	This file is part of MegaGlest (www.megaglest.org)
+//
+//	Copyright (C) 2013 MegaGlest team
+//
+//	You can redistribute this code and/or modify it under
+//	the terms of the GNU General Public License as published
+//	by the Free Software Foundation; either version 2 of the
+//	License, or (at your option) any later version
+// ==============================================================
+
+#include "cluster_map.h"
+
+#include <algorithm>
+#include <set>
+#include <queue>
+#include <functional>
+
+#include "map.h"
+#include "unit.h"
+#include "unit_type.h"
+#include "platform_util.h"
+#include "leak_dumper.h"
+
+using namespace std;
+using namespace Shared::Graphics;
+using namespace Shared::Util;
+using namespace Shared::PlatformCommon;
+
+namespace Glest{ namespace Game{
+
+// =====================================================
+// 	class ClusterMap
+// =====================================================
+
+const int ClusterMap::clusterSize		= 16;
+const float ClusterMap::diagonalCost	= 1.41421356f;
+
+static const float infiniteCost			= 1.0e30f;
+
+namespace {
+
+// open list entry for the abstract search, ties are broken on position so
+// the chosen route does not depend on the order nodes were allocated in
+class RouteEntry {
+public:
+	RouteEntry(float f, const Vec2i &pos, int node) {
+		this->f = f;
+		this->pos = pos;
+		this->node = node;
+	}
+	float f;
+	Vec2i pos;
+	int node;
+};
+
+class RouteEntryCompare {
+public:
+	bool operator()(const RouteEntry &a, const RouteEntry &b) const {
+		if(a.f != b.f) {
+			return a.f > b.f;
+		}
+		if(a.pos.y != b.pos.y) {
+			return a.pos.y > b.pos.y;
+		}
+		if(a.pos.x != b.pos.x) {
+			return a.pos.x > b.pos.x;
+		}
+		return a.node > b.node;
+	}
+};
+
+}
+
+ClusterMap::ClusterMap(Map *map) : mutexGraphs(new Mutex(CODE_AT_LINE)) {
+	this->map = map;
+	this->clusterW = (map->getW() + clusterSize - 1) / clusterSize;
+	this->clusterH = (map->getH() + clusterSize - 1) / clusterSize;
+
+	this->map->addStaticCellsCallback(this);
+}
+
+ClusterMap::~ClusterMap() {
+	if(map != NULL) {
+		map->removeStaticCellsCallback(this);
+		map = NULL;
+	}
+
+	for(std::map<int, ClusterGraph *>::iterator iterMap = graphs.begin();
+		iterMap != graphs.end(); ++iterMap) {
+		delete iterMap->second;
+	}
+	graphs.clear();
+
+	delete mutexGraphs;
+	mutexGraphs = NULL;
+}
+
+void ClusterMap::staticCellsChanged(const Vec2i &pos, int size) {
+	static string mutexOwnerId = string(__FILE__) + string("_") + intToStr(__LINE__);
+	MutexSafeWrapper safeMutex(mutexGraphs,mutexOwnerId);
+
+	for(std::map<int, ClusterGraph *>::iterator iterMap = graphs.begin();
+		iterMap != graphs.end(); ++iterMap) {
+		markDirty(iterMap->second, pos, size);
+	}
+}
+
+void ClusterMap::markDirty(ClusterGraph *graph, const Vec2i &pos, int size) {
+	// a multi cell unit standing up to unitSize-1 cells above or left of the
+	// change overlaps it, so those cells change passability as well
+	int x0 = max(0, pos.x - graph->unitSize);
+	int y0 = max(0, pos.y - graph->unitSize);
+	int x1 = min(map->getW() - 1, pos.x + size);
+	int y1 = min(map->getH() - 1, pos.y + size);
+
+	for(int cy = y0 / clusterSize; cy <= y1 / clusterSize; ++cy) {
+		for(int cx = x0 / clusterSize; cx <= x1 / clusterSize; ++cx) {
+			graph->dirtyClusters[cy * clusterW + cx] = true;
+			graph->anyDirty = true;
+		}
+	}
+}
+
+int ClusterMap::getNodeCount(Field field, int unitSize) {
+	static string mutexOwnerId = string(__FILE__) + string("_") + intToStr(__LINE__);
+	MutexSafeWrapper safeMutex(mutexGraphs,mutexOwnerId);
+
+	ClusterGraph *graph = getGraph(field, unitSize);
+	updateGraph(graph);
+	return (int)(graph->nodes.size() - graph->freeNodes.size());
+}
+
+ClusterMap::ClusterGraph * ClusterMap::getGraph(Field field, int unitSize) {
+	int key = unitSize * fieldCount + field;
+	std::map<int, ClusterGraph *>::iterator iterFind = graphs.find(key);
+	if(iterFind != graphs.end()) {
+		return iterFind->second;
+	}
+
+	ClusterGraph *graph = new ClusterGraph();
+	graph->field = field;
+	graph->unitSize = unitSize;
+	graph->clusterNodes.resize(clusterW * clusterH);
+	graph->borderNodes.resize(clusterW * clusterH * 2);
+	graph->dirtyClusters.resize(clusterW * clusterH, true);
+	graph->anyDirty = true;
+	graphs[key] = graph;
+
+	return graph;
+}
+
+bool ClusterMap::isStaticFree(const ClusterGraph *graph, int x, int y) const {
+	for(int i = 0; i < graph->unitSize; ++i) {
+		for(int j = 0; j < graph->unitSize; ++j) {
+			Vec2i cellPos(x + i, y + j);
+			if(map->isInside(cellPos) == false ||
+				map->isInsideSurface(Map::toSurfCoords(cellPos)) == false) {
+				return false;
+			}
+
+			Cell *cell = map->getCell(cellPos);
+			Unit *unit = cell->getUnit(graph->field);
+			if(unit != NULL && unit->getType()->isMobile() == false) {
+				return false;
+			}
+			if(graph->field == fLand) {
+				if(map->getSurfaceCell(Map::toSurfCoords(cellPos))->isFree() == false ||
+					map->getDeepSubmerged(cell) == true) {
+					return false;
+				}
+			}
+		}
+	}
+	return true;
+}
+
+bool ClusterMap::canStep(const ClusterGraph *graph, int x, int y, int dx, int dy) const {
+	if(isStaticFree(graph, x + dx, y + dy) == false) {
+		return false;
+	}
+	if(dx != 0 && dy != 0) {
+		if(isStaticFree(graph, x + dx, y) == false ||
+			isStaticFree(graph, x, y + dy) == false) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void ClusterMap::getClusterBounds(int cluster, int &x0, int &y0, int &x1, int &y1) const {
+	x0 = (cluster % clusterW) * clusterSize;
+	y0 = (cluster / clusterW) * clusterSize;
+	x1 = min(x0 + clusterSize, map->getW()) - 1;
+	y1 = min(y0 + clusterSize, map->getH()) - 1;
+}
+
+int ClusterMap::addNode(ClusterGraph *graph, const Vec2i &pos, int cluster) {
+	int nodeIndex = -1;
+	if(graph->freeNodes.empty() == false) {
+		nodeIndex = graph->freeNodes.back();
+		graph->freeNodes.pop_back();
+	}
+	else {
+		nodeIndex = (int)graph->nodes.size();
+		graph->nodes.push_back(TransitionNode());
+	}
+
+	TransitionNode &node = graph->nodes[nodeIndex];
+	node.pos = pos;
+	node.cluster = cluster;
+	node.valid = true;
+	node.edges.clear();
+
+	graph->clusterNodes[cluster].push_back(nodeIndex);
+	return nodeIndex;
+}
+
+void ClusterMap::removeNode(ClusterGraph *graph, int nodeIndex) {
+	TransitionNode &node = graph->nodes[nodeIndex];
+	vector<int> &clusterNodes = graph->clusterNodes[node.cluster];
+
+	// no edge may keep pointing at this slot once it is reused
+	for(unsigned int i = 0; i < (unsigned int)clusterNodes.size(); ++i) {
+		vector<Edge> &edges = graph->nodes[clusterNodes[i]].edges;
+		for(int j = (int)edges.size() - 1; j >= 0; --j) {
+			if(edges[j].target == nodeIndex) {
+				edges.erase(edges.begin() + j);
+			}
+		}
+	}
+
+	vector<int>::iterator iterFind = std::find(clusterNodes.begin(),clusterNodes.end(),nodeIndex);
+	if(iterFind != clusterNodes.end()) {
+		clusterNodes.erase(iterFind);
+	}
+
+	node.valid = false;
+	node.cluster = -1;
+	node.edges.clear();
+	graph->freeNodes.push_back(nodeIndex);
+}
+
+void ClusterMap::clearBorder(ClusterGraph *graph, int border) {
+	vector<int> &nodes = graph->borderNodes[border];
+	for(unsigned int i = 0; i < (unsigned int)nodes.size(); ++i) {
+		removeNode(graph, nodes[i]);
+	}
+	nodes.clear();
+}
+
+void ClusterMap::buildBorder(ClusterGraph *graph, int cluster, bool east) {
+	int cx = cluster % clusterW;
+	int cy = cluster / clusterW;
+	int border = cluster * 2 + (east == true ? 0 : 1);
+
+	clearBorder(graph, border);
+
+	int neighbour = -1;
+	if(east == true) {
+		if(cx + 1 >= clusterW) {
+			return;
+		}
+		neighbour = cluster + 1;
+	}
+	else {
+		if(cy + 1 >= clusterH) {
+			return;
+		}
+		neighbour = cluster + clusterW;
+	}
+
+	int x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+	getClusterBounds(cluster, x0, y0, x1, y1);
+
+	// walk along the border and create transitions for every run of cells
+	// that are free on both sides
+	int length = (east == true ? y1 - y0 + 1 : x1 - x0 + 1);
+	int runStart = -1;
+	for(int i = 0; i <= length; ++i) {
+		bool open = false;
+		if(i < length) {
+			if(east == true) {
+				open = (isStaticFree(graph, x1, y0 + i) == true &&
+						isStaticFree(graph, x1 + 1, y0 + i) == true);
+			}
+			else {
+				open = (isStaticFree(graph, x0 + i, y1) == true &&
+						isStaticFree(graph, x0 + i, y1 + 1) == true);
+			}
+		}
+
+		if(open == true && runStart < 0) {
+			runStart = i;
+		}
+		else if(open == false && runStart >= 0) {
+			int runEnd = i - 1;
+			vector<int> offsets;
+			if(runEnd - runStart + 1 > clusterSize / 2) {
+				offsets.push_back(runStart);
+				offsets.push_back(runEnd);
+			}
+			else {
+				offsets.push_back((runStart + runEnd) / 2);
+			}
+
+			for(unsigned int j = 0; j < (unsigned int)offsets.size(); ++j) {
+				Vec2i pos1 = (east == true ? Vec2i(x1, y0 + offsets[j]) : Vec2i(x0 + offsets[j], y1));
+				Vec2i pos2 = (east == true ? Vec2i(x1 + 1, y0 + offsets[j]) : Vec2i(x0 + offsets[j], y1 + 1));
+
+				int node1 = addNode(graph, pos1, cluster);
+				int node2 = addNode(graph, pos2, neighbour);
+				graph->nodes[node1].edges.push_back(Edge(node2, 1.0f));
+				graph->nodes[node2].edges.push_back(Edge(node1, 1.0f));
+
+				graph->borderNodes[border].push_back(node1);
+				graph->borderNodes[border].push_back(node2);
+			}
+			runStart = -1;
+		}
+	}
+}
+
+void ClusterMap::searchCluster(const ClusterGraph *graph, int cluster, const Vec2i &from,
+		const vector<Vec2i> &targets, vector<float> &costs) {
+	int x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+	getClusterBounds(cluster, x0, y0, x1, y1);
+	int width = x1 - x0 + 1;
+	int height = y1 - y0 + 1;
+
+	costs.assign(targets.size(), infiniteCost);
+	searchCost.assign(width * height, infiniteCost);
+
+	typedef std::pair<float, int> CostEntry;
+	std::priority_queue<CostEntry, vector<CostEntry>, std::greater<CostEntry> > open;
+
+	int startIndex = (from.y - y0) * width + (from.x - x0);
+	searchCost[startIndex] = 0.0f;
+	open.push(CostEntry(0.0f, startIndex));
+
+	while(open.empty() == false) {
+		CostEntry entry = open.top();
+		open.pop();
+		if(entry.first > searchCost[entry.second]) {
+			continue;
+		}
+
+		int x = x0 + entry.second % width;
+		int y = y0 + entry.second / width;
+		for(int dy = -1; dy <= 1; ++dy) {
+			for(int dx = -1; dx <= 1; ++dx) {
+				int nx = x + dx;
+				int ny = y + dy;
+				if((dx == 0 && dy == 0) || nx < x0 || ny < y0 || nx > x1 || ny > y1) {
+					continue;
+				}
+				if(canStep(graph, x, y, dx, dy) == false) {
+					continue;
+				}
+
+				float cost = entry.first + ((dx != 0 && dy != 0) ? diagonalCost : 1.0f);
+				int index = (ny - y0) * width + (nx - x0);
+				if(cost < searchCost[index]) {
+					searchCost[index] = cost;
+					open.push(CostEntry(cost, index));
+				}
+			}
+		}
+	}
+
+	for(unsigned int i = 0; i < (unsigned int)targets.size(); ++i) {
+		costs[i] = searchCost[(targets[i].y - y0) * width + (targets[i].x - x0)];
+	}
+}
+
+void ClusterMap::buildClusterEdges(ClusterGraph *graph, int cluster) {
+	vector<int> &nodes = graph->clusterNodes[cluster];
+
+	// drop old intra cluster edges, inter cluster edges always point
+	// to a node in the neighbouring cluster
+	for(unsigned int i = 0; i < (unsigned int)nodes.size(); ++i) {
+		vector<Edge> &edges = graph->nodes[nodes[i]].edges;
+		for(int j = (int)edges.size() - 1; j >= 0; --j) {
+			if(graph->nodes[edges[j].target].cluster == cluster) {
+				edges.erase(edges.begin() + j);
+			}
+		}
+	}
+
+	vector<Vec2i> targets;
+	for(unsigned int i = 0; i < (unsigned int)nodes.size(); ++i) {
+		targets.push_back(graph->nodes[nodes[i]].pos);
+	}
+
+	vector<float> costs;
+	for(unsigned int i = 0; i < (unsigned int)nodes.size(); ++i) {
+		searchCluster(graph, cluster, graph->nodes[nodes[i]].pos, targets, costs);
+		for(unsigned int j = 0; j < (unsigned int)nodes.size(); ++j) {
+			if(i != j && costs[j] < infiniteCost) {
+				graph->nodes[nodes[i]].edges.push_back(Edge(nodes[j], costs[j]));
+			}
+		}
+	}
+}
+
+void ClusterMap::updateGraph(ClusterGraph *graph) {
+	if(graph->anyDirty == false) {
+		return;
+	}
+
+	std::set<int> borders;
+	std::set<int> clusters;
+	for(int cluster = 0; cluster < clusterW * clusterH; ++cluster) {
+		if(graph->dirtyClusters[cluster] == false) {
+			continue;
+		}
+		graph->dirtyClusters[cluster] = false;
+
+		int cx = cluster % clusterW;
+		int cy = cluster / clusterW;
+
+		borders.insert(cluster * 2);
+		borders.insert(cluster * 2 + 1);
+		clusters.insert(cluster);
+		if(cx > 0) {
+			borders.insert((cluster - 1) * 2);
+			clusters.insert(cluster - 1);
+		}
+		if(cy > 0) {
+			borders.insert((cluster - clusterW) * 2 + 1);
+			clusters.insert(cluster - clusterW);
+		}
+		if(cx + 1 < clusterW) {
+			clusters.insert(cluster + 1);
+		}
+		if(cy + 1 < clusterH) {
+			clusters.insert(cluster + clusterW);
+		}
+	}
+	graph->anyDirty = false;
+
+	for(std::set<int>::iterator iterBorder = borders.begin(); iterBorder != borders.end(); ++iterBorder) {
+		buildBorder(graph, *iterBorder / 2, (*iterBorder % 2) == 0);
+	}
+	for(std::set<int>::iterator iterCluster = clusters.begin(); iterCluster != clusters.end(); ++iterCluster) {
+		buildClusterEdges(graph, *iterCluster);
+	}
+}
+
+bool ClusterMap::findRoute(Field field, int unitSize, const Vec2i &startPos,
+		const Vec2i &goalPos, vector<Vec2i> &route) {
+	static string mutexOwnerId = string(__FILE__) + string("_") + intToStr(__LINE__);
+	MutexSafeWrapper safeMutex(mutexGraphs,mutexOwnerId);
+
+	route.clear();
+	if(map->isInside(startPos) == false || map->isInside(goalPos) == false) {
+		return false;
+	}
+
+	int startCluster = getClusterIndex(startPos);
+	int goalCluster = getClusterIndex(goalPos);
+	if(startCluster == goalCluster) {
+		return false;
+	}
+
+	ClusterGraph *graph = getGraph(field, unitSize);
+	updateGraph(graph);
+
+	// connect the start and goal positions to the transitions of their clusters
+	const vector<int> &startNodes = graph->clusterNodes[startCluster];
+	const vector<int> &goalNodes = graph->clusterNodes[goalCluster];
+	if(startNodes.empty() == true || goalNodes.empty() == true) {
+		return false;
+	}
+
+	vector<Vec2i> targets;
+	vector<float> startCosts;
+	for(unsigned int i = 0; i < (unsigned int)startNodes.size(); ++i) {
+		targets.push_back(graph->nodes[startNodes[i]].pos);
+	}
+	searchCluster(graph, startCluster, startPos, targets, startCosts);
+
+	targets.clear();
+	vector<float> goalCosts;
+	for(unsigned int i = 0; i < (unsigned int)goalNodes.size(); ++i) {
+		targets.push_back(graph->nodes[goalNodes[i]].pos);
+	}
+	searchCluster(graph, goalCluster, goalPos, targets, goalCosts);
+
+	std::map<int,float> goalCostLookup;
+	for(unsigned int i = 0; i < (unsigned int)goalNodes.size(); ++i) {
+		if(goalCosts[i] < infiniteCost) {
+			goalCostLookup[goalNodes[i]] = goalCosts[i];
+		}
+	}
+	if(goalCostLookup.empty() == true) {
+		return false;
+	}
+
+	int nodeCount = (int)graph->nodes.size();
+	int goalNode = nodeCount;
+	vector<float> gCost(nodeCount + 1, infiniteCost);
+	vector<int> parent(nodeCount + 1, -1);
+	vector<bool> closed(nodeCount + 1, false);
+
+	std::priority_queue<RouteEntry, vector<RouteEntry>, RouteEntryCompare> open;
+	for(unsigned int i = 0; i < (unsigned int)startNodes.size(); ++i) {
+		if(startCosts[i] < infiniteCost) {
+			int node = startNodes[i];
+			gCost[node] = startCosts[i];
+			open.push(RouteEntry(gCost[node] + octileDistance(graph->nodes[node].pos, goalPos),
+					graph->nodes[node].pos, node));
+		}
+	}
+
+	bool found = false;
+	while(open.empty() == false) {
+		RouteEntry entry = open.top();
+		open.pop();
+
+		if(entry.node == goalNode) {
+			found = true;
+			break;
+		}
+		if(closed[entry.node] == true) {
+			continue;
+		}
+		closed[entry.node] = true;
+
+		std::map<int,float>::iterator iterGoal = goalCostLookup.find(entry.node);
+		if(iterGoal != goalCostLookup.end()) {
+			float cost = gCost[entry.node] + iterGoal->second;
+			if(cost < gCost[goalNode]) {
+				gCost[goalNode] = cost;
+				parent[goalNode] = entry.node;
+				open.push(RouteEntry(cost, goalPos, goalNode));
+			}
+		}
+
+		const vector<Edge> &edges = graph->nodes[entry.node].edges;
+		for(unsigned int i = 0; i < (unsigned int)edges.size(); ++i) {
+			int target = edges[i].target;
+			if(closed[target] == true) {
+				continue;
+			}
+			float cost = gCost[entry.node] + edges[i].cost;
+			if(cost < gCost[target]) {
+				gCost[target] = cost;
+				parent[target] = entry.node;
+				open.push(RouteEntry(cost + octileDistance(graph->nodes[target].pos, goalPos),
+						graph->nodes[target].pos, target));
+			}
+		}
+	}
+
+	if(found == false) {
+		return false;
+	}
+
+	route.push_back(goalPos);
+	for(int node = parent[goalNode]; node >= 0; node = parent[node]) {
+		route.push_back(graph->nodes[node].pos);
+	}
+	std::reverse(route.begin(),route.end());
+
+	return true;
+}
+
+bool ClusterMap::getRouteWaypoint(Field field, int unitSize, const Vec2i &startPos,
+		const Vec2i &goalPos, Vec2i &waypoint) {
+	// close targets are left to the regular search
+	float maxWaypointDistance = (float)(clusterSize * 2);
+	if(octileDistance(startPos, goalPos) <= maxWaypointDistance) {
+		return false;
+	}
+
+	vector<Vec2i> route;
+	if(findRoute(field, unitSize, startPos, goalPos, route) == false) {
+		return false;
+	}
+
+	// pick the furthest waypoint the local search can comfortably reach,
+	// but always at least the first one outside of the start cluster
+	int startCluster = getClusterIndex(startPos);
+	bool foundWaypoint = false;
+	for(unsigned int i = 0; i < (unsigned int)route.size(); ++i) {
+		const Vec2i &pos = route[i];
+		bool leftStartCluster = (getClusterIndex(pos) != startCluster);
+
+		if(foundWaypoint == true && octileDistance(startPos, pos) > maxWaypointDistance) {
+			break;
+		}
+		if(leftStartCluster == true) {
+			waypoint = pos;
+			foundWaypoint = true;
+		}
+	}
+
+	return foundWaypoint;
+}
+
+}} //end namespace
@@ -0,0 +1,156 @@
+// ==============================================================
+//	This file is part of MegaGlest (www.megaglest.org)
+//
+//	Copyright (C) 2013 MegaGlest team
+//
+//	You can redistribute this code and/or modify it under
+//	the terms of the GNU General Public License as published
+//	by the Free Software Foundation; either version 2 of the
+//	License, or (at your option) any later version
+// ==============================================================
+
+#ifndef _GLEST_GAME_CLUSTERMAP_H_
+#define _GLEST_GAME_CLUSTERMAP_H_
+
+#ifdef WIN32
+    #include <winsock2.h>
+    #include <winsock.h>
+#endif
+
+#include "vec.h"
+#include <cstdlib>
+#include <vector>
+#include <map>
+#include "game_constants.h"
+#include "map.h"
+#include "platform_common.h"
+
+#include "leak_dumper.h"
+
+using std::vector;
+using Shared::Graphics::Vec2i;
+using Shared::Platform::Mutex;
+
+namespace Glest { namespace Game {
+
+// =====================================================
+// 	class ClusterMap
+//
+///	Abstract graph of map clusters used for hierarchical
+///	pathfinding (HPA*). Each cluster border holds transition
+///	nodes and each cluster caches the travel cost between
+///	its own transitions. Only static obstacles (terrain,
+///	objects, buildings) are considered, mobile units are
+///	left to the local A* refinement.
+// =====================================================
+
+class ClusterMap : public MapStaticCellsCallbackInterface {
+public:
+	static const int clusterSize;
+	static const float diagonalCost;
+
+private:
+	class Edge {
+	public:
+		Edge() {
+			target = -1;
+			cost = 0.0f;
+		}
+		Edge(int target, float cost) {
+			this->target = target;
+			this->cost = cost;
+		}
+		int target;
+		float cost;
+	};
+
+	class TransitionNode {
+	public:
+		TransitionNode() {
+			cluster = -1;
+			valid = false;
+		}
+		Vec2i pos;
+		int cluster;
+		bool valid;
+		vector<Edge> edges;
+	};
+
+	// one abstract graph per movement field and unit size
+	class ClusterGraph {
+	public:
+		ClusterGraph() {
+			field = fLand;
+			unitSize = 1;
+		}
+		Field field;
+		int unitSize;
+		vector<TransitionNode> nodes;
+		vector<int> freeNodes;
+		vector<vector<int> > clusterNodes;
+		// two borders per cluster: east (index * 2) and south (index * 2 + 1)
+		vector<vector<int> > borderNodes;
+		vector<bool> dirtyClusters;
+		bool anyDirty;
+	};
+
+	Map *map;
+	int clusterW;
+	int clusterH;
+	Mutex *mutexGraphs;
+	std::map<int, ClusterGraph *> graphs;
+
+	// scratch buffer for intra-cluster searches
+	vector<float> searchCost;
+
+public:
+	ClusterMap(Map *map);
+	virtual ~ClusterMap();
+
+	virtual void staticCellsChanged(const Vec2i &pos, int size);
+
+	// Returns the waypoint of the coarse route from startPos to goalPos that
+	// the local search should head for, or false if no coarse route applies
+	bool getRouteWaypoint(Field field, int unitSize, const Vec2i &startPos,
+			const Vec2i &goalPos, Vec2i &waypoint);
+	bool findRoute(Field field, int unitSize, const Vec2i &startPos,
+			const Vec2i &goalPos, vector<Vec2i> &route);
+
+	int getClusterIndex(const Vec2i &pos) const {
+		return (pos.y / clusterSize) * clusterW + (pos.x / clusterSize);
+	}
+	int getNodeCount(Field field, int unitSize);
+
+private:
+	ClusterMap(const ClusterMap &obj);
+	ClusterMap & operator=(const ClusterMap &obj);
+
+	ClusterGraph * getGraph(Field field, int unitSize);
+	void updateGraph(ClusterGraph *graph);
+	void markDirty(ClusterGraph *graph, const Vec2i &pos, int size);
+
+	bool isStaticFree(const ClusterGraph *graph, int x, int y) const;
+	bool canStep(const ClusterGraph *graph, int x, int y, int dx, int dy) const;
+
+	void getClusterBounds(int cluster, int &x0, int &y0, int &x1, int &y1) const;
+	int addNode(ClusterGraph *graph, const Vec2i &pos, int cluster);
+	void removeNode(ClusterGraph *graph, int nodeIndex);
+	void clearBorder(ClusterGraph *graph, int border);
+	void buildBorder(ClusterGraph *graph, int cluster, bool east);
+	void buildClusterEdges(ClusterGraph *graph, int cluster);
+
+	void searchCluster(const ClusterGraph *graph, int cluster, const Vec2i &from,
+			const vector<Vec2i> &targets, vector<float> &costs);
+
+	inline static float octileDistance(const Vec2i &pos1, const Vec2i &pos2) {
+		int dx = abs(pos1.x - pos2.x);
+		int dy = abs(pos1.y - pos2.y);
+		int diag = (dx < dy ? dx : dy);
+		int straight = (dx < dy ? dy - dx : dx - dy);
+		return (float)straight + diagonalCost * (float)diag;
+	}
+};
+
+}}//end namespace
+
+#endif
@@ -20,6 +20,7 @@
 #include "command.h"
 #include "faction.h"
 #include "randomgen.h"
+#include "cluster_map.h"
 #include "leak_dumper.h"
 
 using namespace std;
@@ -47,6 +48,10 @@ const int PathFinder::pathFindExtendRefreshNodeCountMax	= 40;
 
 PathFinder::PathFinder() {
 	minorDebugPathfinder = false;
+	useHeapSearch = false;
+	useMoveCellCache = false;
+	clusterMap = NULL;
+	requestPool = NULL;
 	map=NULL;
 }
 
@@ -57,6 +62,10 @@ int PathFinder::getPathFindExtendRefreshNodeCount(FactionState &faction) {
 
 PathFinder::PathFinder(const Map *map) {
 	minorDebugPathfinder = false;
+	useHeapSearch = false;
+	useMoveCellCache = false;
+	clusterMap = NULL;
+	requestPool = NULL;
 
 	map=NULL;
 	init(map);
@@ -68,15 +77,179 @@ void PathFinder::init(const Map *map) {
 
 		faction.nodePool.resize(pathFindNodesAbsoluteMax);
 		faction.useMaxNodeCount = PathFinder::pathFindNodesMax;
+		faction.openHeap.reserve(pathFindNodesAbsoluteMax);
 	}
 	this->map= map;
+	// Both search engines expand nodes in the same order and produce
+	// identical paths, this only selects the open/closed list storage
+	useHeapSearch = Config::getInstance().getBool("PathFinderUseHeapSearch","false");
+	// Remembers the cell checks of each search, the results are unchanged
+	useMoveCellCache = Config::getInstance().getBool("PathFinderUseMoveCellCache","true");
 }
 
 void PathFinder::init() {
 	minorDebugPathfinder = false;
+	useHeapSearch = false;
+	useMoveCellCache = false;
+	clusterMap = NULL;
+	requestPool = NULL;
 	map=NULL;
 }
 
+void PathFinder::enableHierarchicalPath(Map *map) {
+	if(clusterMap == NULL) {
+		clusterMap = new ClusterMap(map);
+	}
+}
+
+void PathFinder::enablePathRequestQueue(int threadCount) {
+	if(requestPool != NULL) {
+		return;
+	}
+	if(threadCount < 0) {
+		threadCount = 0;
+	}
+
+	requestPool = new WorkerThreadPool(threadCount,"PathRequestThread");
+	// every worker (plus the calling thread) searches with its own node pool
+	for(int index = 0; index < requestPool->getWorkerCount(); ++index) {
+		FactionState *searchState = new FactionState();
+		searchState->nodePool.resize(pathFindNodesAbsoluteMax);
+		searchState->useMaxNodeCount = PathFinder::pathFindNodesMax;
+		searchState->openHeap.reserve(pathFindNodesAbsoluteMax);
+		requestSearchStates.push_back(searchState);
+	}
+
+	if(SystemFlags::getSystemSettingType(SystemFlags::debugPathFinder).enabled == true) SystemFlags::OutputDebug(SystemFlags::debugPathFinder,"In [%s::%s Line: %d] path request queue using %d workers\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,requestPool->getWorkerCount());
+}
+
+void PathFinder::queuePathRequest(Unit *unit, const Vec2i &finalPos, int frameIndex, FactionState &faction) {
+	PathRequest &request = faction.pathRequests[unit->getId()];
+	if(request.frameIndex != frameIndex) {
+		request.finalPosList.clear();
+	}
+	request.unit = unit;
+	request.unitId = unit->getId();
+	request.frameIndex = frameIndex;
+	request.finalPosList.push_back(finalPos);
+}
+
+void PathFinder::processPathRequests(int frameIndex) {
+	if(requestPool == NULL) {
+		return;
+	}
+
+	activeRequests.clear();
+	for(int factionIndex = 0; factionIndex < factions.size(); ++factionIndex) {
+		FactionState &faction = factions.getFactionState(factionIndex);
+		for(std::map<int,PathRequest>::iterator iterMap = faction.pathRequests.begin();
+				iterMap != faction.pathRequests.end(); ++iterMap) {
+			if(iterMap->second.frameIndex == frameIndex) {
+				activeRequests.push_back(&iterMap->second);
+			}
+		}
+	}
+	// Unit ids are unique across factions so this gives the one commit
+	// order every peer agrees on, no matter which worker solved what
+	std::sort(activeRequests.begin(),activeRequests.end(),PathRequestCompare());
+
+	Chrono chrono;
+	if(SystemFlags::getSystemSettingType(SystemFlags::debugPerformance).enabled) chrono.start();
+
+	if(SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynch).enabled == true) {
+		// the threaded synch log lists are per faction and not thread safe
+		for(int index = 0; index < (int)activeRequests.size(); ++index) {
+			workerTask(index, requestPool->getWorkerCount() - 1);
+		}
+	}
+	else {
+		requestPool->runTasks(this, (int)activeRequests.size());
+	}
+
+	for(unsigned int index = 0; index < activeRequests.size(); ++index) {
+		PathRequest *request = activeRequests[index];
+		FactionState &faction = factions.getFactionState(request->unit->getFactionIndex());
+
+		faction.precachedTravelState[request->unitId] = request->travelState;
+		faction.precachedPath[request->unitId].swap(request->path);
+	}
+
+	if(SystemFlags::getSystemSettingType(SystemFlags::debugPerformance).enabled && chrono.getMillis() > 4) SystemFlags::OutputDebug(SystemFlags::debugPerformance,"In [%s::%s Line: %d] solved %d path requests, %d stolen, took msecs: %lld\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,(int)activeRequests.size(),requestPool->getLastTasksStolen(),(long long int)chrono.getMillis());
+
+	activeRequests.clear();
+	for(int factionIndex = 0; factionIndex < factions.size(); ++factionIndex) {
+		factions.getFactionState(factionIndex).pathRequests.clear();
+	}
+}
+
+void PathFinder::workerTask(int taskIndex, int workerIndex) {
+	PathRequest *request = activeRequests[taskIndex];
+	FactionState &searchState = *requestSearchStates[workerIndex];
+	Unit *unit = request->unit;
+
+	// Random choices made during the search must not depend on which
+	// worker ran the request or in which order, so reseed per request
+	uint32 seed = (uint32)request->frameIndex * 7919u + (uint32)request->unitId;
+	searchState.random.init((int)(seed % 714025u));
+
+	request->travelState = tsImpossible;
+	request->path.clear();
+	for(unsigned int index = 0; index < request->finalPosList.size(); ++index) {
+		searchState.precachedTravelState.clear();
+		searchState.precachedPath.clear();
+
+		searchPath(unit, request->finalPosList[index], NULL, request->frameIndex, searchState);
+	}
+
+	std::map<int,TravelState>::iterator iterFindState = searchState.precachedTravelState.find(request->unitId);
+	if(iterFindState != searchState.precachedTravelState.end()) {
+		request->travelState = iterFindState->second;
+	}
+	std::map<int,std::vector<Vec2i> >::iterator iterFindPath = searchState.precachedPath.find(request->unitId);
+	if(iterFindPath != searchState.precachedPath.end()) {
+		request->path.swap(iterFindPath->second);
+	}
+	searchState.precachedTravelState.clear();
+	searchState.precachedPath.clear();
+}
+
+void PathFinder::beginSearch(FactionState &faction) {
+	faction.nodePoolCount= 0;
+	faction.openNodesList.clear();
+	faction.openPosList.clear();
+	faction.closedNodesList.clear();
+
+	if(useHeapSearch == true) {
+		faction.openHeap.clear();
+		faction.openSequence = 0;
+		faction.closedBestNode = NULL;
+
+		// The grid stamps every open or closed cell with the current search
+		// generation so it never needs to be cleared between searches
+		int gridSize = map->getW() * map->getH();
+		if(faction.openPosGridWidth != map->getW() ||
+			(int)faction.openPosGrid.size() != gridSize) {
+			faction.openPosGrid.assign(gridSize,0);
+			faction.openPosGridWidth = map->getW();
+			faction.openPosGeneration = 0;
+		}
+
+		faction.openPosGeneration++;
+		if(faction.openPosGeneration == 0) {
+			std::fill(faction.openPosGrid.begin(),faction.openPosGrid.end(),0);
+			faction.openPosGeneration = 1;
+		}
+	}
+}
+
+void PathFinder::endSearch(FactionState &faction) {
+	faction.openNodesList.clear();
+	faction.openPosList.clear();
+	faction.closedNodesList.clear();
+	faction.openHeap.clear();
+	faction.closedBestNode = NULL;
+}
+
 PathFinder::~PathFinder() {
 	for(int factionIndex = 0; factionIndex < GameConstants::maxPlayers; ++factionIndex) {
 		FactionState &faction = factions.getFactionState(factionIndex);
@@ -84,6 +257,17 @@ PathFinder::~PathFinder() {
 		faction.nodePool.clear();
 	}
 	factions.clear();
+
+	delete requestPool;
+	requestPool = NULL;
+	for(unsigned int index = 0; index < requestSearchStates.size(); ++index) {
+		delete requestSearchStates[index];
+	}
+	requestSearchStates.clear();
+
+	delete clusterMap;
+	clusterMap = NULL;
+
 	map=NULL;
 }
 
@@ -246,6 +430,40 @@ TravelState PathFinder::findPath(Unit *unit, const Vec2i &finalPos, bool *wasStu
 	}
 
 	//route cache miss
+	if(frameIndex >= 0 && requestPool != NULL) {
+		// the search itself runs later on the request pool, see processPathRequests()
+		queuePathRequest(unit, finalPos, frameIndex, faction);
+		return tsMoving;
+	}
+
+	ts = searchPath(unit, finalPos, wasStuck, frameIndex, faction);
+
+	}
+	catch(const exception &ex) {
+		//setRunningStatus(false);
+
+		SystemFlags::OutputDebug(SystemFlags::debugError,"In [%s::%s Line: %d] Error [%s]\n",__FILE__,__FUNCTION__,__LINE__,ex.what());
+		if(SystemFlags::getSystemSettingType(SystemFlags::debugSystem).enabled) SystemFlags::OutputDebug(SystemFlags::debugSystem,"In [%s::%s Line: %d]\n",__FILE__,__FUNCTION__,__LINE__);
+
+		throw megaglest_runtime_error(ex.what());
+	}
+	catch(...) {
+		char szBuf[8096]="";
+		snprintf(szBuf,8096,"In [%s::%s %d] UNKNOWN error\n",__FILE__,__FUNCTION__,__LINE__);
+		SystemFlags::OutputDebug(SystemFlags::debugError,szBuf);
+		throw megaglest_runtime_error(szBuf);
+	}
+
+	return ts;
+}
+
+// ==================== PRIVATE ==================== 
+
+TravelState PathFinder::searchPath(Unit *unit, const Vec2i &finalPos, bool *wasStuck,
+		int frameIndex, FactionState &faction) {
+	TravelState ts = tsImpossible;
+	UnitPathInterface *path= unit->getPath();
+
 	int maxNodeCount=-1;
 	if(unit->getUsePathfinderExtendedMaxNodes() == true) {
 
@@ -272,7 +490,7 @@ TravelState PathFinder::findPath(Unit *unit, const Vec2i &finalPos, bool *wasStu
 		unit->logSynchData(extractFileFromDirectoryPath(__FILE__).c_str(),__LINE__,szBuf);
 	}
 
-	ts = aStar(unit, finalPos, false, frameIndex, maxNodeCount,&searched_node_count);
+	ts = aStar(faction, unit, finalPos, false, frameIndex, maxNodeCount,&searched_node_count);
 	//post actions
 	switch(ts) {
 		case tsBlocked:
@@ -317,10 +535,6 @@ TravelState PathFinder::findPath(Unit *unit, const Vec2i &finalPos, bool *wasStu
 				}
 				unitImmediatelyBlocked = (failureCount == cellCount);
 				if(unitImmediatelyBlocked == false) {
-
-					int factionIndex = unit->getFactionIndex();
-					FactionState &faction = factions.getFactionState(factionIndex);
-
 					int tryRadius = faction.random.randRange(0,1);
 
 					// Try to bail out up to PathFinder::pathFindBailoutRadius cells away
@@ -347,7 +561,7 @@ TravelState PathFinder::findPath(Unit *unit, const Vec2i &finalPos, bool *wasStu
 										unit->logSynchData(extractFileFromDirectoryPath(__FILE__).c_str(),__LINE__,szBuf);
 									}
 
-									ts= aStar(unit, newFinalPos, true, frameIndex, maxBailoutNodeCount,&searched_node_count);
+									ts= aStar(faction, unit, newFinalPos, true, frameIndex, maxBailoutNodeCount,&searched_node_count);
 								}
 							}
 						}
@@ -374,7 +588,7 @@ TravelState PathFinder::findPath(Unit *unit, const Vec2i &finalPos, bool *wasStu
 										unit->logSynchData(extractFileFromDirectoryPath(__FILE__).c_str(),__LINE__,szBuf);
 									}
 
-									ts= aStar(unit, newFinalPos, true, frameIndex, maxBailoutNodeCount,&searched_node_count);
+									ts= aStar(faction, unit, newFinalPos, true, frameIndex, maxBailoutNodeCount,&searched_node_count);
 								}
 							}
 						}
@@ -463,37 +677,17 @@ TravelState PathFinder::findPath(Unit *unit, const Vec2i &finalPos, bool *wasStu
 	}
 	if(minorDebugPathfinderPerformance && chrono.getMillis() >= 1) printf("Unit [%d - %s] astar took [%lld] msecs, ts = %d searched_node_count = %d.\n",unit->getId(),unit->getType()->getName(false).c_str(),(long long int)chrono.getMillis(),ts,searched_node_count);
 
-	}
-	catch(const exception &ex) {
-		//setRunningStatus(false);
-
-		SystemFlags::OutputDebug(SystemFlags::debugError,"In [%s::%s Line: %d] Error [%s]\n",__FILE__,__FUNCTION__,__LINE__,ex.what());
-		if(SystemFlags::getSystemSettingType(SystemFlags::debugSystem).enabled) SystemFlags::OutputDebug(SystemFlags::debugSystem,"In [%s::%s Line: %d]\n",__FILE__,__FUNCTION__,__LINE__);
-
-		throw megaglest_runtime_error(ex.what());
-	}
-	catch(...) {
-		char szBuf[8096]="";
-		snprintf(szBuf,8096,"In [%s::%s %d] UNKNOWN error\n",__FILE__,__FUNCTION__,__LINE__);
-		SystemFlags::OutputDebug(SystemFlags::debugError,szBuf);
-		throw megaglest_runtime_error(szBuf);
-	}
-
 	return ts;
 }
 
-// ==================== PRIVATE ==================== 
-
 //route a unit using A* algorithm
-TravelState PathFinder::aStar(Unit *unit, const Vec2i &targetPos, bool inBailout,
+TravelState PathFinder::aStar(FactionState &faction, Unit *unit, const Vec2i &targetPos, bool inBailout,
 		int frameIndex, int maxNodeCount, uint32 *searched_node_count) {
 	TravelState ts = tsImpossible;
 
 	try {
 
 	int unitFactionIndex = unit->getFactionIndex();
-	int factionIndex = unit->getFactionIndex();
-	FactionState &faction = factions.getFactionState(factionIndex);
 
 	if(SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynch).enabled == true && frameIndex >= 0) {
 		char szBuf[8096]="";
@@ -510,10 +704,6 @@ TravelState PathFinder::aStar(Unit *unit, const Vec2i &targetPos, bool inBailout
 
 
 	if(maxNodeCount < 0) {
-
-		int factionIndex = unit->getFactionIndex();
-		FactionState &faction = factions.getFactionState(factionIndex);
-
 		maxNodeCount = faction.useMaxNodeCount;
 	}
 
@@ -523,10 +713,10 @@ TravelState PathFinder::aStar(Unit *unit, const Vec2i &targetPos, bool inBailout
 
 	UnitPathInterface *path= unit->getPath();
 
-	faction.nodePoolCount= 0;
-	faction.openNodesList.clear();
-	faction.openPosList.clear();
-	faction.closedNodesList.clear();
+	beginSearch(faction);
+	if(useMoveCellCache == true) {
+		faction.moveCache.begin(map, unit);
+	}
 
 	// check the pre-cache to see if we can re-use a cached path
 	if(frameIndex < 0) {
@@ -560,7 +750,7 @@ TravelState PathFinder::aStar(Unit *unit, const Vec2i &targetPos, bool inBailout
 						(unitPrecachePathSize >= pathFindExtendRefreshForNodeCount &&
 						 i < getPathFindExtendRefreshNodeCount(faction))) {
 
-						if(canUnitMoveSoon(unit, lastPos, nodePos) == false) {
+						if(canUnitMoveSoon(faction, unit, lastPos, nodePos) == false) {
 							canMoveToCells = false;
 							break;
 						}
@@ -636,7 +826,22 @@ TravelState PathFinder::aStar(Unit *unit, const Vec2i &targetPos, bool inBailout
 	}
 
 	const Vec2i unitPos = unit->getPos();
-	const Vec2i finalPos= computeNearestFreePos(unit, targetPos);
+	Vec2i finalPos= computeNearestFreePos(unit, targetPos);
+
+	// For long distances search only up to the next waypoint of the coarse
+	// cluster route, the path is refreshed as the unit moves along anyway
+	if(clusterMap != NULL) {
+		Vec2i waypoint;
+		if(clusterMap->getRouteWaypoint(unit->getCurrField(),unit->getType()->getSize(),
+				unitPos, finalPos, waypoint) == true) {
+			if(SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynch).enabled == true && frameIndex < 0) {
+				char szBuf[8096]="";
+				snprintf(szBuf,8096,"hierarchical waypoint [%s] for finalPos [%s]",waypoint.getString().c_str(),finalPos.getString().c_str());
+				unit->logSynchData(extractFileFromDirectoryPath(__FILE__).c_str(),__LINE__,szBuf);
+			}
+			finalPos = waypoint;
+		}
+	}
 
 	float dist= unitPos.dist(finalPos);
 
@@ -657,11 +862,7 @@ TravelState PathFinder::aStar(Unit *unit, const Vec2i &targetPos, bool inBailout
 	firstNode->pos= unitPos;
 	firstNode->heuristic= heuristic(unitPos, finalPos);
 	firstNode->exploredCell= true;
-	if(faction.openNodesList.find(firstNode->heuristic) == faction.openNodesList.end()) {
-		faction.openNodesList[firstNode->heuristic].clear();
-	}
-	faction.openNodesList[firstNode->heuristic].push_back(firstNode);
-	faction.openPosList[firstNode->pos] = true;
+	addOpenNode(firstNode, faction);
 
 	//b) loop
 	bool pathFound			= true;
@@ -679,7 +880,7 @@ TravelState PathFinder::aStar(Unit *unit, const Vec2i &targetPos, bool inBailout
 			for(int j = -1; j <= 1; ++j) {
 				Vec2i pos = unitPos + Vec2i(i, j);
 				if(pos != unitPos) {
-					bool canUnitMoveToCell = canUnitMoveSoon(unit, unitPos, pos);
+					bool canUnitMoveToCell = canUnitMoveSoon(faction, unit, unitPos, pos);
 					if(canUnitMoveToCell == false) {
 						failureCount++;
 					}
@@ -707,7 +908,7 @@ TravelState PathFinder::aStar(Unit *unit, const Vec2i &targetPos, bool inBailout
 				for(int j = -1; j <= 1; ++j) {
 					Vec2i pos = finalPos + Vec2i(i, j);
 					if(pos != finalPos) {
-						bool canUnitMoveToCell = canUnitMoveSoon(unit, pos, finalPos);
+						bool canUnitMoveToCell = canUnitMoveSoon(faction, unit, pos, finalPos);
 						if(canUnitMoveToCell == false) {
 							failureCount++;
 						}
@@ -753,7 +954,7 @@ TravelState PathFinder::aStar(Unit *unit, const Vec2i &targetPos, bool inBailout
 			unit->logSynchData(extractFileFromDirectoryPath(__FILE__).c_str(),__LINE__,szBuf);
 		}
 
-		doAStarPathSearch(nodeLimitReached, whileLoopCount, unitFactionIndex,
+		doAStarPathSearch(faction, nodeLimitReached, whileLoopCount,
 							pathFound, node, finalPos,
 							closedNodes, cameFrom, canAddNode, unit, maxNodeCount,frameIndex);
 
@@ -789,7 +990,7 @@ TravelState PathFinder::aStar(Unit *unit, const Vec2i &targetPos, bool inBailout
 					unit->logSynchData(extractFileFromDirectoryPath(__FILE__).c_str(),__LINE__,szBuf);
 				}
 
-				return aStar(unit, targetPos, false, frameIndex, pathFindNodesAbsoluteMax);
+				return aStar(faction, unit, targetPos, false, frameIndex, pathFindNodesAbsoluteMax);
 			}
 		}
 	}
@@ -807,10 +1008,11 @@ TravelState PathFinder::aStar(Unit *unit, const Vec2i &targetPos, bool inBailout
 	//if consumed all nodes find best node (to avoid strange behaviour)
 	if(nodeLimitReached == true) {
 
-		if(faction.closedNodesList.empty() == false) {
-			float bestHeuristic = faction.closedNodesList.begin()->first;
+		Node *bestClosedNode = getBestClosedNode(faction);
+		if(bestClosedNode != NULL) {
+			float bestHeuristic = bestClosedNode->heuristic;
 			if(lastNode != NULL && bestHeuristic < lastNode->heuristic) {
-				lastNode= faction.closedNodesList.begin()->second[0];
+				lastNode= bestClosedNode;
 			}
 		}
 	}
@@ -934,15 +1136,11 @@ TravelState PathFinder::aStar(Unit *unit, const Vec2i &targetPos, bool inBailout
 	}
 
 
-	faction.openNodesList.clear();
-	faction.openPosList.clear();
-	faction.closedNodesList.clear();
+	endSearch(faction);
 
 	if(SystemFlags::getSystemSettingType(SystemFlags::debugPerformance).enabled == true && chrono.getMillis() > 4) SystemFlags::OutputDebug(SystemFlags::debugPerformance,"In [%s::%s] Line: %d took msecs: %lld --------------------------- [END OF METHOD] ---------------------------\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,chrono.getMillis());
 
 	if(frameIndex >= 0) {
-
-		FactionState &faction = factions.getFactionState(factionIndex);
 		faction.precachedTravelState[unit->getId()] = ts;
 	}
 	else {
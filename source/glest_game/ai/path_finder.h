@@ -20,25 +20,31 @@
 #include "vec.h"
 #include <vector>
 #include <map>
+#include <algorithm>
 #include "game_constants.h"
 #include "skill_type.h"
 #include "map.h"
 #include "unit.h"
+#include "simple_threads.h"
 
 #include "leak_dumper.h"
 
 using std::vector;
 using Shared::Graphics::Vec2i;
+using Shared::PlatformCommon::WorkerThreadPool;
+using Shared::PlatformCommon::WorkerTaskCallbackInterface;
 
 namespace Glest { namespace Game {
 
+class ClusterMap;
+
 // =====================================================
 // 	class PathFinder
 //
 ///	Finds paths for units using a modification of the A* algorithm
 // =====================================================
 
-class PathFinder {
+class PathFinder : public WorkerTaskCallbackInterface {
 public:
 	class BadUnitNodeList {
 	public:
@@ -77,15 +83,56 @@ public:
 			prev=NULL;
 			heuristic=0.0;
 			exploredCell=false;
+			openSequence=0;
 		}
 		Vec2i pos;
 		Node *next;
 		Node *prev;
 		float heuristic;
 		bool exploredCell;
+		// insertion order, used to break heuristic ties the same way as
+		// the FIFO vectors in openNodesList
+		uint32 openSequence;
 	};
 	typedef vector<Node*> Nodes;
 
+	// Orders the open heap by lowest heuristic first, then by insertion
+	// order so the pop sequence matches openNodesList exactly
+	class NodeHeapCompare {
+	public:
+		inline bool operator()(const Node *a, const Node *b) const {
+			if(a->heuristic != b->heuristic) {
+				return a->heuristic > b->heuristic;
+			}
+			return a->openSequence > b->openSequence;
+		}
+	};
+
+	// Precache searches a faction thread queued for one unit during a frame,
+	// solved on the request pool and committed in unit id order
+	class PathRequest {
+	public:
+		PathRequest() {
+			unit = NULL;
+			unitId = -1;
+			frameIndex = -1;
+			travelState = tsImpossible;
+		}
+		Unit *unit;
+		int unitId;
+		int frameIndex;
+		vector<Vec2i> finalPosList;
+		TravelState travelState;
+		vector<Vec2i> path;
+	};
+
+	class PathRequestCompare {
+	public:
+		inline bool operator()(const PathRequest *a, const PathRequest *b) const {
+			return a->unitId < b->unitId;
+		}
+	};
+
 	class FactionState {
 	protected:
 		Mutex *factionMutexPrecache;
@@ -101,6 +148,13 @@ public:
 			nodePoolCount = 0;
 			useMaxNodeCount = 0;
 
+			openHeap.clear();
+			openPosGrid.clear();
+			openPosGridWidth = 0;
+			openPosGeneration = 0;
+			openSequence = 0;
+			closedBestNode = NULL;
+
 			precachedTravelState.clear();
 			precachedPath.clear();
 		}
@@ -118,12 +172,26 @@ public:
 		std::map<float, Nodes> closedNodesList;
 		std::vector<Node> nodePool;
 
+		// flat binary heap search state (used when useHeapSearch is enabled)
+		std::vector<Node *> openHeap;
+		std::vector<uint32> openPosGrid;
+		int openPosGridWidth;
+		uint32 openPosGeneration;
+		uint32 openSequence;
+		Node *closedBestNode;
+
 		int nodePoolCount;
 		RandomGen random;
 		int useMaxNodeCount;
 
 		std::map<int,TravelState> precachedTravelState;
 		std::map<int,std::vector<Vec2i> > precachedPath;
+
+		// written only by the owning faction thread while it precaches
+		std::map<int,PathRequest> pathRequests;
+
+		// cell results of the running search
+		MoveCellCache moveCache;
 	};
 
 	class FactionStateManager {
@@ -178,6 +246,13 @@ private:
 	FactionStateManager factions;
 	const Map *map;
 	bool minorDebugPathfinder;
+	bool useHeapSearch;
+	bool useMoveCellCache;
+	ClusterMap *clusterMap;
+
+	WorkerThreadPool *requestPool;
+	vector<FactionState *> requestSearchStates;
+	vector<PathRequest *> activeRequests;
 
 public:
 	PathFinder();
@@ -194,6 +269,10 @@ public:
 	}
 
 	void init(const Map *map);
+	void enableHierarchicalPath(Map *map);
+	void enablePathRequestQueue(int threadCount);
+	void processPathRequests(int frameIndex);
+	virtual void workerTask(int taskIndex, int workerIndex);
 	TravelState findPath(Unit *unit, const Vec2i &finalPos, bool *wasStuck=NULL,int frameIndex=-1);
 	void clearUnitPrecache(Unit *unit);
 	void removeUnitPrecache(Unit *unit);
@@ -210,7 +289,10 @@ public:
 private:
 	void init();
 
-	TravelState aStar(Unit *unit, const Vec2i &finalPos, bool inBailout,
+	void queuePathRequest(Unit *unit, const Vec2i &finalPos, int frameIndex, FactionState &faction);
+	TravelState searchPath(Unit *unit, const Vec2i &finalPos, bool *wasStuck,
+			int frameIndex, FactionState &faction);
+	TravelState aStar(FactionState &faction, Unit *unit, const Vec2i &finalPos, bool inBailout,
 			int frameIndex, int maxNodeCount=-1,uint32 *searched_node_count=NULL);
 	inline static Node *newNode(FactionState &faction, int maxNodeCount) {
 		if( faction.nodePoolCount < (int)faction.nodePool.size() &&
@@ -248,16 +330,98 @@ private:
 		return result;
 	}
 
-	inline bool processNode(Unit *unit, Node *node,const Vec2i finalPos,
+	void beginSearch(FactionState &faction);
+	void endSearch(FactionState &faction);
+
+	inline bool isOpenPos(const Vec2i &sucPos, FactionState &faction) const {
+		if(useHeapSearch == true) {
+			if(map->isInside(sucPos) == false) {
+				return false;
+			}
+			return faction.openPosGrid[sucPos.y * faction.openPosGridWidth + sucPos.x] == faction.openPosGeneration;
+		}
+		return openPos(sucPos, faction);
+	}
+
+	inline void markOpenPos(const Vec2i &pos, FactionState &faction) {
+		if(useHeapSearch == true) {
+			faction.openPosGrid[pos.y * faction.openPosGridWidth + pos.x] = faction.openPosGeneration;
+		}
+		else {
+			faction.openPosList[pos] = true;
+		}
+	}
+
+	inline bool isOpenListEmpty(FactionState &faction) const {
+		if(useHeapSearch == true) {
+			return faction.openHeap.empty();
+		}
+		return faction.openNodesList.empty();
+	}
+
+	inline void addOpenNode(Node *node, FactionState &faction) {
+		if(useHeapSearch == true) {
+			node->openSequence = faction.openSequence++;
+			faction.openHeap.push_back(node);
+			std::push_heap(faction.openHeap.begin(),faction.openHeap.end(),NodeHeapCompare());
+		}
+		else {
+			if(faction.openNodesList.find(node->heuristic) == faction.openNodesList.end()) {
+				faction.openNodesList[node->heuristic].clear();
+			}
+			faction.openNodesList[node->heuristic].push_back(node);
+		}
+		markOpenPos(node->pos, faction);
+	}
+
+	inline Node * popOpenNode(FactionState &faction) {
+		if(useHeapSearch == true) {
+			if(faction.openHeap.empty() == true) {
+				throw megaglest_runtime_error("openHeap.empty() == true");
+			}
+			std::pop_heap(faction.openHeap.begin(),faction.openHeap.end(),NodeHeapCompare());
+			Node *result = faction.openHeap.back();
+			faction.openHeap.pop_back();
+			return result;
+		}
+		return minHeuristicFastLookup(faction);
+	}
+
+	inline void addClosedNode(Node *node, FactionState &faction) {
+		if(useHeapSearch == true) {
+			// keep the first node seen with the lowest heuristic, which is
+			// what closedNodesList.begin()->second[0] returns
+			if(faction.closedBestNode == NULL ||
+				node->heuristic < faction.closedBestNode->heuristic) {
+				faction.closedBestNode = node;
+			}
+		}
+		else {
+			if(faction.closedNodesList.find(node->heuristic) == faction.closedNodesList.end()) {
+				faction.closedNodesList[node->heuristic].clear();
+			}
+			faction.closedNodesList[node->heuristic].push_back(node);
+		}
+		markOpenPos(node->pos, faction);
+	}
+
+	inline Node * getBestClosedNode(FactionState &faction) const {
+		if(useHeapSearch == true) {
+			return faction.closedBestNode;
+		}
+		if(faction.closedNodesList.empty() == true) {
+			return NULL;
+		}
+		return faction.closedNodesList.begin()->second[0];
+	}
+
+	inline bool processNode(FactionState &faction, Unit *unit, Node *node,const Vec2i finalPos,
 			int i, int j, bool &nodeLimitReached,int maxNodeCount) {
 		bool result = false;
 		Vec2i sucPos= node->pos + Vec2i(i, j);
 
-		int unitFactionIndex = unit->getFactionIndex();
-		FactionState &faction = factions.getFactionState(unitFactionIndex);
-
-		if(openPos(sucPos, faction) == false &&
-				canUnitMoveSoon(unit, node->pos, sucPos) == true) {
+		if(isOpenPos(sucPos, faction) == false &&
+				canUnitMoveSoon(faction, unit, node->pos, sucPos) == true) {
 			//if node is not open and canMove then generate another node
 			Node *sucNode= newNode(faction,maxNodeCount);
 			if(sucNode != NULL) {
@@ -265,13 +429,9 @@ private:
 				sucNode->heuristic= heuristic(sucNode->pos, finalPos);
 				sucNode->prev= node;
 				sucNode->next= NULL;
-				sucNode->exploredCell = map->getSurfaceCell(
-						Map::toSurfCoords(sucPos))->isExplored(unit->getTeam());
-				if(faction.openNodesList.find(sucNode->heuristic) == faction.openNodesList.end()) {
-					faction.openNodesList[sucNode->heuristic].clear();
-				}
-				faction.openNodesList[sucNode->heuristic].push_back(sucNode);
-				faction.openPosList[sucNode->pos] = true;
+				sucNode->exploredCell = map->isSurfaceExplored(unit->getTeam(),
+						Map::toSurfCoords(sucPos));
+				addOpenNode(sucNode, faction);
 
 				result = true;
 			}
@@ -287,36 +447,31 @@ private:
 			Field field, int teamIndex,Vec2i unitPos, Vec2i &nearestPos, float &nearestDist);
 	int getPathFindExtendRefreshNodeCount(FactionState &faction);
 
-	inline bool canUnitMoveSoon(const Unit *unit, const Vec2i &pos1, const Vec2i &pos2) {
-		bool result = map->aproxCanMoveSoon(unit, pos1, pos2);
+	inline bool canUnitMoveSoon(FactionState &faction, const Unit *unit, const Vec2i &pos1, const Vec2i &pos2) {
+		bool result = map->aproxCanMoveSoon(unit, pos1, pos2,
+				(useMoveCellCache == true ? &faction.moveCache : NULL));
 		return result;
 	}
 
-	inline void doAStarPathSearch(bool & nodeLimitReached, int & whileLoopCount,
-			int & unitFactionIndex, bool & pathFound, Node *& node, const Vec2i & finalPos,
+	inline void doAStarPathSearch(FactionState &faction, bool & nodeLimitReached, int & whileLoopCount,
+			bool & pathFound, Node *& node, const Vec2i & finalPos,
 			std::map<Vec2i,bool> closedNodes,
 			std::map<Vec2i,Vec2i> cameFrom, std::map<std::pair<Vec2i,Vec2i> ,
 			bool> canAddNode, Unit *& unit, int & maxNodeCount, int curFrameIndex)  {
 
-		FactionState &faction = factions.getFactionState(unitFactionIndex);
-
 		while(nodeLimitReached == false) {
 			whileLoopCount++;
-			if(faction.openNodesList.empty() == true) {
+			if(isOpenListEmpty(faction) == true) {
 				pathFound = false;
 				break;
 			}
-			node = minHeuristicFastLookup(faction);
+			node = popOpenNode(faction);
 			if(node->pos == finalPos || node->exploredCell == false) {
 				pathFound = true;
 				break;
 			}
 
-			if(faction.closedNodesList.find(node->heuristic) == faction.closedNodesList.end()) {
-				faction.closedNodesList[node->heuristic].clear();
-			}
-			faction.closedNodesList[node->heuristic].push_back(node);
-			faction.openPosList[node->pos] = true;
+			addClosedNode(node, faction);
 
 			int failureCount 	= 0;
 			int cellCount 		= 0;
@@ -325,7 +480,7 @@ private:
 			if(tryDirection == 3) {
 				for(int i = 1;i >= -1 && nodeLimitReached == false;--i) {
 					for(int j = -1;j <= 1 && nodeLimitReached == false;++j) {
-						if(processNode(unit, node, finalPos, i, j, nodeLimitReached, maxNodeCount) == false) {
+						if(processNode(faction, unit, node, finalPos, i, j, nodeLimitReached, maxNodeCount) == false) {
 							failureCount++;
 						}
 						cellCount++;
@@ -335,7 +490,7 @@ private:
 			else if(tryDirection == 2) {
 				for(int i = -1;i <= 1 && nodeLimitReached == false;++i) {
 					for(int j = 1;j >= -1 && nodeLimitReached == false;--j) {
-						if(processNode(unit, node, finalPos, i, j, nodeLimitReached, maxNodeCount) == false) {
+						if(processNode(faction, unit, node, finalPos, i, j, nodeLimitReached, maxNodeCount) == false) {
 							failureCount++;
 						}
 						cellCount++;
@@ -345,7 +500,7 @@ private:
 			else if(tryDirection == 1) {
 				for(int i = -1;i <= 1 && nodeLimitReached == false;++i) {
 					for(int j = -1;j <= 1 && nodeLimitReached == false;++j) {
-						if(processNode(unit, node, finalPos, i, j, nodeLimitReached, maxNodeCount) == false) {
+						if(processNode(faction, unit, node, finalPos, i, j, nodeLimitReached, maxNodeCount) == false) {
 							failureCount++;
 						}
 						cellCount++;
@@ -355,7 +510,7 @@ private:
 			else {
 				for(int i = 1;i >= -1 && nodeLimitReached == false;--i) {
 					for(int j = 1;j >= -1 && nodeLimitReached == false;--j) {
-						if(processNode(unit, node, finalPos, i, j, nodeLimitReached, maxNodeCount) == false) {
+						if(processNode(faction, unit, node, finalPos, i, j, nodeLimitReached, maxNodeCount) == false) {
 							failureCount++;
 						}
 						cellCount++;
@@ -453,7 +453,8 @@ std::pair<CommandResult,string> Commander::pushNetworkCommand(const NetworkComma
 		networkCommand->getNetworkCommandType() != nctSwitchTeamVote &&
 		networkCommand->getNetworkCommandType() != nctPauseResume &&
 		networkCommand->getNetworkCommandType() != nctPlayerStatusChange &&
-		networkCommand->getNetworkCommandType() != nctDisconnectNetworkPlayer) {
+		networkCommand->getNetworkCommandType() != nctDisconnectNetworkPlayer &&
+		networkCommand->getNetworkCommandType() != nctNetworkFramePeriod) {
 		unit= world->findUnitById(networkCommand->getUnitId());
 		if(unit == NULL) {
 			char szBuf[8096]="";
@@ -805,6 +806,26 @@ void Commander::giveNetworkCommand(NetworkCommand* networkCommand) const {
         	}
             break;
 
+        case nctNetworkFramePeriod:
+        	{
+        	if(SystemFlags::getSystemSettingType(SystemFlags::debugSystem).enabled) SystemFlags::OutputDebug(SystemFlags::debugSystem,"In [%s::%s Line: %d] found nctNetworkFramePeriod\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__);
+
+        	commandWasHandled = true;
+
+        	// given on the same keyframe by all peers, the next keyframe is the
+        	// next frame that is a multiple of the new period
+        	int networkFramePeriod = networkCommand->getUnitId();
+        	if(networkFramePeriod > 0 && networkFramePeriod <= 255) {
+        		world->getGameSettingsPtr()->setNetworkFramePeriod(networkFramePeriod);
+
+        		GameNetworkInterface *gameNetworkInterface= NetworkManager::getInstance().getGameNetworkInterface();
+        		if(gameNetworkInterface != NULL) {
+        			gameNetworkInterface->getGameSettingsPtr()->setNetworkFramePeriod(networkFramePeriod);
+        		}
+        	}
+        	}
+            break;
+
         case nctPlayerStatusChange:
 			{
 			if(SystemFlags::getSystemSettingType(SystemFlags::debugSystem).enabled) SystemFlags::OutputDebug(SystemFlags::debugSystem,"In [%s::%s Line: %d] found nctPlayerStatusChange\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__);
@@ -5312,7 +5312,7 @@ string Game::getDebugStats(std::map<int,string> &factionDebugInfo) {
 	}
 
 	str+= "UnitRangeCellsLookupItemCache: " + world.getUnitUpdater()->getUnitRangeCellsLookupItemCacheStats()+"\n";
-	str+= "ExploredCellsLookupItemCache: " 	+ world.getExploredCellsLookupItemCacheStats()+"\n";
+	str+= "SightDiscTable: " 				+ world.getSightDiscTableStats()+"\n";
 	str+= "FowAlphaCellsLookupItemCache: "  + world.getFowAlphaCellsLookupItemCacheStats()+"\n";
 
 	const string selectionType = toLower(Config::getInstance().getString("SelectionType",Config::colorPicking));
@@ -66,9 +66,10 @@ enum FlagTypes1 {
     ft1_allow_team_switching  			= 0x02,
     ft1_allow_in_game_joining 			= 0x04,
     ft1_network_synch_checks_verbose 	= 0x08,
-    ft1_network_synch_checks 			= 0x10
-    //ft1_xx                  = 0x20,
-    //ft1_xx                  = 0x40,
+    ft1_network_synch_checks 			= 0x10,
+    ft1_hierarchical_pathfinding 		= 0x20,
+    ft1_parallel_pathfinding 			= 0x40
+    //ft1_xx                  = 0x80,
 };
 
 inline static bool isFlagType1BitEnabled(uint32 flagValue,FlagTypes1 type) {
@@ -1542,6 +1542,22 @@ bool CoreData::loadGameSettingsFromFile(std::string fileName, GameSettings *game
         gameSettings->setFlagTypes1(valueFlags1);
 
 	}
+	if(Config::getInstance().getBool("EnableHierarchicalPathfinding","false") == true) {
+        valueFlags1 |= ft1_hierarchical_pathfinding;
+        gameSettings->setFlagTypes1(valueFlags1);
+	}
+	else {
+        valueFlags1 &= ~ft1_hierarchical_pathfinding;
+        gameSettings->setFlagTypes1(valueFlags1);
+	}
+	if(Config::getInstance().getBool("EnableParallelPathfinding","false") == true) {
+        valueFlags1 |= ft1_parallel_pathfinding;
+        gameSettings->setFlagTypes1(valueFlags1);
+	}
+	else {
+        valueFlags1 &= ~ft1_parallel_pathfinding;
+        gameSettings->setFlagTypes1(valueFlags1);
+	}
 
 
 	gameSettings->setEnableObserverModeAtEndGame(properties.getBool("EnableObserverModeAtEndGame"));
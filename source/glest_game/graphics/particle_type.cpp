@@ -288,7 +288,7 @@ void ParticleSystemType::load(const XmlNode *particleSystemNode, const string &d
 void ParticleSystemType::setValues(AttackParticleSystem *ats){
 	// add instances of all children; some settings will cascade to all children
 	for(Children::iterator i=children.begin(); i!=children.end(); ++i){
-		UnitParticleSystem *child = new UnitParticleSystem();
+		UnitParticleSystem *child = UnitParticleSystem::create();
 		child->setParticleOwner(ats->getParticleOwner());
 		(*i)->setValues(child);
 		ats->addChild(child);
@@ -478,7 +478,7 @@ void ParticleSystemTypeProjectile::load(const XmlNode* particleFileNode, const s
 }
 
 ProjectileParticleSystem *ParticleSystemTypeProjectile::create(ParticleOwner *owner) {
-	ProjectileParticleSystem *ps=  new ProjectileParticleSystem();
+	ProjectileParticleSystem *ps=  ProjectileParticleSystem::create();
 	ps->setParticleOwner(owner);
 	ParticleSystemType::setValues(ps);
 
@@ -564,7 +564,7 @@ void ParticleSystemTypeSplash::load(const XmlNode* particleFileNode, const strin
 }
 
 SplashParticleSystem *ParticleSystemTypeSplash::create(ParticleOwner *owner) {
-	SplashParticleSystem *ps=  new SplashParticleSystem();
+	SplashParticleSystem *ps=  SplashParticleSystem::create();
 	ps->setParticleOwner(owner);
 	ParticleSystemType::setValues(ps);
 
@@ -244,6 +244,8 @@ Renderer::Renderer() : BaseRenderer(), saveScreenShotThreadAccessor(new Mutex(CO
 		textRenderer3D = graphicsFactory->newTextRenderer3D();
 		particleRenderer= graphicsFactory->newParticleRenderer();
 	}
+	// one draw per particle texture and blend mode instead of per system
+	ParticleRendererGl::setEnableBatching(config.getBool("ParticleRenderBatched","true"));
 
 	//resources
 	for(int i=0; i< rsCount; ++i) {
@@ -256,6 +258,19 @@ Renderer::Renderer() : BaseRenderer(), saveScreenShotThreadAccessor(new Mutex(CO
 		particleManager[i]= graphicsFactory->newParticleManager();
 	}
 
+	// battles create most particle systems, their self contained ones can
+	// be updated on worker threads, a headless server draws none
+	if(GlobalStaticFlags::getIsNonGraphicalModeEnabled() == false &&
+		config.getBool("ParticleUpdateThreaded","true") == true) {
+		int threadCount = config.getInt("ParticleUpdateThreads","0");
+		if(threadCount <= 0) {
+			threadCount = getCPUCoreCount() - 1;
+		}
+		particleManager[rsGame]->setUpdateThreadCount(threadCount);
+	}
+	// released effect systems kept for reuse by each particle system pool
+	ParticleSystemPool::setMaxFreeSystems(config.getInt("ParticleSystemPoolSize","64"));
+
 	if(GlobalStaticFlags::getIsNonGraphicalModeEnabled() == false) {
 		static string mutexOwnerId = string(extractFileFromDirectoryPath(__FILE__).c_str()) + string("_") + intToStr(__LINE__);
 		saveScreenShotThread = new SimpleTaskThread(this,0,25);
@@ -2247,6 +2262,14 @@ void Renderer::renderPerformanceStats() {
 	if(gamePerfStats != "") {
 		str += gamePerfStats + "\n";
 	}
+	str += ParticleSystemPool::getStatsString() + "\n";
+	if(particleRenderer != NULL) {
+		snprintf(szBuf,200,"Particle draws: %d systems: %d",particleRenderer->getLastDrawCallCount(),particleRenderer->getLastSystemCount());
+		str += string(szBuf) + string("\n");
+	}
+	const InterpolationCache &interpolationCache = InterpolationCache::getInstance();
+	snprintf(szBuf,200,"Interpolation cache hit/miss: %lld/%lld",(long long int)interpolationCache.getHitCount(),(long long int)interpolationCache.getMissCount());
+	str += string(szBuf) + string("\n");
 
 	if(renderText3DEnabled == true) {
 		renderTextShadow3D(
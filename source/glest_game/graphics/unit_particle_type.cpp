@@ -216,7 +216,7 @@ const void UnitParticleSystemType::setValues(UnitParticleSystem *ups){
 	// whilst we extend ParticleSystemType we don't use ParticleSystemType::setValues()
 	// add instances of all children; some settings will cascade to all children
 	for(Children::iterator i=children.begin(); i!=children.end(); ++i){
-		UnitParticleSystem *child = new UnitParticleSystem();
+		UnitParticleSystem *child = UnitParticleSystem::create();
 		child->setParticleOwner(ups->getParticleOwner());
 		(*i)->setValues(child);
 		ups->addChild(child);
@@ -79,6 +79,7 @@
 #include <stdlib.h>
 #include "network_message.h"
 #include "network_protocol.h"
+#include "network_benchmark.h"
 #include "conversion.h"
 #include "gen_uuid.h"
 #include "leak_dumper.h"
@@ -211,6 +212,9 @@ static void cleanupProcessObjects() {
     if(SystemFlags::VERBOSE_MODE_ENABLED) printf("#4 IRCCLient Cache SHUTDOWN\n");
 
     cleanupCRCThread();
+    // the precache is done with the index, keep the sums found since the last save
+    Checksum::closeFileSumIndex();
+    Checksum::releaseFileSumThreads();
     if(SystemFlags::VERBOSE_MODE_ENABLED) printf("In [%s::%s Line: %d]\n",__FILE__,__FUNCTION__,__LINE__);
 
     if(Renderer::isEnded() == false) {
@@ -3913,6 +3917,95 @@ int handleListDataCommand(int argc, char** argv) {
 	return return_value;
 }
 
+int handleServerBenchmarkCommand(int argc, char** argv) {
+	int clientCount = GameConstants::maxPlayers - 1;
+	int frameCount = 2400;
+	string replayFile = "";
+
+	int foundParamIndIndex = -1;
+	hasCommandArgument(argc, argv,string(GAME_ARGS[GAME_ARG_MASTERSERVER_BENCHMARK]) + string("="),&foundParamIndIndex);
+	if(foundParamIndIndex >= 0) {
+		string paramValue = argv[foundParamIndIndex];
+		vector<string> paramPartTokens;
+		Tokenize(paramValue,paramPartTokens,"=");
+		if(paramPartTokens.size() >= 2 && paramPartTokens[1].length() > 0) {
+			vector<string> paramBenchmarkTokens;
+			Tokenize(paramPartTokens[1],paramBenchmarkTokens,",");
+			if(paramBenchmarkTokens.size() >= 1 && paramBenchmarkTokens[0] != "") {
+				clientCount = strToInt(paramBenchmarkTokens[0]);
+			}
+			if(paramBenchmarkTokens.size() >= 2 && paramBenchmarkTokens[1] != "") {
+				frameCount = strToInt(paramBenchmarkTokens[1]);
+			}
+			if(paramBenchmarkTokens.size() >= 3) {
+				replayFile = paramBenchmarkTokens[2];
+			}
+		}
+	}
+
+	if(clientCount < 1 || clientCount >= GameConstants::maxPlayers || frameCount < 1) {
+		printf("\nInvalid benchmark values specified on commandline [%s], clients must be 1 to %d\n\n",(foundParamIndIndex >= 0 ? argv[foundParamIndIndex] : ""),GameConstants::maxPlayers - 1);
+		return 1;
+	}
+
+	NetworkBenchmark benchmark(clientCount,frameCount,replayFile);
+	return benchmark.run();
+}
+
+int handleCRCBenchmarkCommand(int argc, char** argv) {
+	int megaBytes = 64;
+
+	int foundParamIndIndex = -1;
+	hasCommandArgument(argc, argv,string(GAME_ARGS[GAME_ARG_CRC_BENCHMARK]) + string("="),&foundParamIndIndex);
+	if(foundParamIndIndex >= 0) {
+		string paramValue = argv[foundParamIndIndex];
+		vector<string> paramPartTokens;
+		Tokenize(paramValue,paramPartTokens,"=");
+		if(paramPartTokens.size() >= 2 && paramPartTokens[1].length() > 0) {
+			megaBytes = strToInt(paramPartTokens[1]);
+		}
+	}
+
+	if(megaBytes < 1) {
+		printf("\nInvalid benchmark size specified on commandline [%s]\n\n",(foundParamIndIndex >= 0 ? argv[foundParamIndIndex] : ""));
+		return 1;
+	}
+
+	// hash a 16MB block over and over so the data stays the same for both kernels
+	const size_t totalSize = (size_t)megaBytes * 1024 * 1024;
+	const size_t blockSize = min(totalSize,(size_t)16 * 1024 * 1024);
+	const int passes = (int)(totalSize / blockSize);
+	std::vector<unsigned char> data(blockSize);
+	uint32 seed = 12345;
+	for(size_t i = 0; i < data.size(); ++i) {
+		seed = seed * 1103515245 + 12345;
+		data[i] = (unsigned char)(seed >> 16);
+	}
+
+	Chrono chrono;
+	chrono.start();
+	uint32 byteSum = 0;
+	for(int pass = 0; pass < passes; ++pass) {
+		byteSum = Checksum::crc32ByteTable(byteSum, &data[0], data.size());
+	}
+	int64 byteMillis = chrono.getMillis();
+
+	chrono.start();
+	uint32 sliceSum = 0;
+	for(int pass = 0; pass < passes; ++pass) {
+		sliceSum = Checksum::crc32SliceBy8(sliceSum, &data[0], data.size());
+	}
+	int64 sliceMillis = chrono.getMillis();
+
+	double hashedMegaBytes = (double)(data.size() * passes) / (1024.0 * 1024.0);
+	printf("\nCRC32 over %.1f MB, byte table: %.1f MB/s, slice by 8: %.1f MB/s%s\n",
+			hashedMegaBytes,
+			hashedMegaBytes * 1000.0 / (byteMillis > 0 ? byteMillis : 1),
+			hashedMegaBytes * 1000.0 / (sliceMillis > 0 ? sliceMillis : 1),
+			(byteSum == sliceSum ? "" : " ****WARNING SUMS DIFFER****"));
+	return (byteSum == sliceSum ? 0 : 1);
+}
+
 int glestMain(int argc, char** argv) {
 #ifdef SL_LEAK_DUMP
 	//AllocInfo::set_application_binary(executable_path(argv[0],true));
@@ -3972,6 +4065,9 @@ int glestMain(int argc, char** argv) {
 			}
 		}
     }
+    if( hasCommandArgument(argc, argv,string(GAME_ARGS[GAME_ARG_MASTERSERVER_BENCHMARK])) == true) {
+    	GlobalStaticFlags::setIsNonGraphicalModeEnabled(true);
+    }
 
 	PlatformExceptionHandler::application_binary= executable_path(argv[0],true);
 	mg_app_name = GameConstants::application_name;
@@ -4228,6 +4324,10 @@ int glestMain(int argc, char** argv) {
 		return 0;
 	}
 
+	if(hasCommandArgument(argc, argv,string(GAME_ARGS[GAME_ARG_CRC_BENCHMARK])) == true) {
+		return handleCRCBenchmarkCommand(argc, argv);
+	}
+
 	if(hasCommandArgument(argc, argv,string(GAME_ARGS[GAME_ARG_MOD])) == true) {
 
 		int foundParamIndIndex = -1;
@@ -4432,7 +4532,8 @@ int glestMain(int argc, char** argv) {
         }
 
 	    if( hasCommandArgument(argc, argv,GAME_ARGS[GAME_ARG_DISABLE_SOUND]) == true ||
-	    	hasCommandArgument(argc, argv,string(GAME_ARGS[GAME_ARG_MASTERSERVER_MODE])) == true) {
+	    	hasCommandArgument(argc, argv,string(GAME_ARGS[GAME_ARG_MASTERSERVER_MODE])) == true ||
+	    	hasCommandArgument(argc, argv,string(GAME_ARGS[GAME_ARG_MASTERSERVER_BENCHMARK])) == true) {
 	    	config.setString("FactorySound","None",true);
 	    	if(hasCommandArgument(argc, argv,string(GAME_ARGS[GAME_ARG_MASTERSERVER_MODE])) == true) {
 	    		//Logger::getInstance().setMasterserverMode(true);
@@ -4682,6 +4783,8 @@ int glestMain(int argc, char** argv) {
 		InterpolationData::setEnableInterpolation(false);
 		if(SystemFlags::VERBOSE_MODE_ENABLED) printf("**INFO** Disabling Interpolation\n");
 	}
+	// units of a type in the same pose share one interpolated mesh
+	InterpolationCache::getInstance().setLimits(config.getInt("InterpolationCacheSteps","32"),config.getInt("InterpolationCacheSizeMB","32"));
 
 
         if(config.getBool("EnableVSynch","false") == true) {
@@ -4871,6 +4974,10 @@ int glestMain(int argc, char** argv) {
 
     	}
 
+    	if(hasCommandArgument(argc, argv,string(GAME_ARGS[GAME_ARG_MASTERSERVER_BENCHMARK])) == true) {
+    		return handleServerBenchmarkCommand(argc, argv);
+    	}
+
 		program= new Program();
 		mainProgram = program;
 		renderer.setProgram(program);
@@ -5291,6 +5398,13 @@ int glestMain(int argc, char** argv) {
         //printf("%d\n", *foo);       // causes segfault
         // END
 
+        // threads hashing the files of a CRC file list, -1 uses all but one core
+        Checksum::setFileSumThreadCount(config.getInt("FileCRCThreadCount","-1"));
+        // remember each file's sum between runs, keyed by its size, time and inode
+        if(config.getBool("PersistentFileCRCIndex","true") == true) {
+        	Checksum::openFileSumIndex(getCRCCacheFilePath() + "file_crc_index.bin");
+        }
+
         bool startCRCPrecacheThread = config.getBool("PreCacheCRCThread","true");
         //printf("### In [%s::%s Line: %d] precache thread enabled = %d SystemFlags::VERBOSE_MODE_ENABLED = %d\n",__FILE__,__FUNCTION__,__LINE__,startCRCPrecacheThread,SystemFlags::VERBOSE_MODE_ENABLED);
         if(SystemFlags::VERBOSE_MODE_ENABLED) printf("In [%s::%s Line: %d] precache thread enabled = %d\n",__FILE__,__FUNCTION__,__LINE__,startCRCPrecacheThread);
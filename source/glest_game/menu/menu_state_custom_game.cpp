@@ -3489,6 +3489,22 @@ void MenuStateCustomGame::loadGameSettings(GameSettings *gameSettings,bool force
         valueFlags1 &= ~ft1_network_synch_checks;
         gameSettings->setFlagTypes1(valueFlags1);
 
+	}
+	if(Config::getInstance().getBool("EnableHierarchicalPathfinding","false") == true) {
+        valueFlags1 |= ft1_hierarchical_pathfinding;
+        gameSettings->setFlagTypes1(valueFlags1);
+	}
+	else {
+        valueFlags1 &= ~ft1_hierarchical_pathfinding;
+        gameSettings->setFlagTypes1(valueFlags1);
+	}
+	if(Config::getInstance().getBool("EnableParallelPathfinding","false") == true) {
+        valueFlags1 |= ft1_parallel_pathfinding;
+        gameSettings->setFlagTypes1(valueFlags1);
+	}
+	else {
+        valueFlags1 &= ~ft1_parallel_pathfinding;
+        gameSettings->setFlagTypes1(valueFlags1);
 	}
 
 	gameSettings->setNetworkAllowNativeLanguageTechtree(checkBoxAllowNativeLanguageTechtree.getValue());
@@ -598,7 +598,8 @@ void ClientInterface::updateLobby() {
                 if(networkMessageIntro.getGameState() == nmgstOk) {
                 	if(SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled) SystemFlags::OutputDebug(SystemFlags::debugNetwork,"In [%s::%s Line: %d]\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__);
 
-					//send intro message
+					//send intro message, offering only the features the server offered too
+                	uint32 features = getSupportedNetworkFeatures() & networkMessageIntro.getFeatures();
                 	Lang &lang= Lang::getInstance();
 					NetworkMessageIntro sendNetworkMessageIntro(
 							sessionKey,getNetworkVersionGITString(),
@@ -610,8 +611,10 @@ void ClientInterface::updateLobby() {
 							lang.getLanguage(),
 							networkMessageIntro.getGameInProgress(),
 							Config::getInstance().getString("PlayerId",""),
-							getPlatformNameString());
+							getPlatformNameString(),
+							features);
 					sendMessage(&sendNetworkMessageIntro);
+					setCompactCommandList((features & nmftCompactCommandList) != 0);
 
 					//printf("Got intro sending client details to server\n");
 
@@ -664,6 +667,9 @@ void ClientInterface::updateLobby() {
 			if(receiveMessage(&networkMessagePing)) {
 				if(SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled) SystemFlags::OutputDebug(SystemFlags::debugNetwork,"In [%s::%s Line: %d]\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__);
 				this->setLastPingInfo(networkMessagePing);
+				if(networkMessagePing.getPingFrequency() == NetworkMessagePing::roundTripPingFrequency) {
+					sendMessage(&networkMessagePing);
+				}
 			}
 		}
 		break;
@@ -761,6 +767,10 @@ void ClientInterface::updateLobby() {
             if(receiveMessage(&networkMessageSynchNetworkGameDataFileCRCCheck)) {
             	this->setLastPingInfoToNow();
 
+                if(networkMessageSynchNetworkGameDataFileCRCCheck.getFileIndex() <= 1) {
+                	missingFileNames.clear();
+                }
+
                 Checksum checksum;
                 string file = networkMessageSynchNetworkGameDataFileCRCCheck.getFileName();
                 checksum.addFile(file);
@@ -777,11 +787,22 @@ void ClientInterface::updateLobby() {
                     NetworkMessageSynchNetworkGameDataFileGet sendNetworkMessageSynchNetworkGameDataFileGet(networkMessageSynchNetworkGameDataFileCRCCheck.getFileName());
                     sendMessage(&sendNetworkMessageSynchNetworkGameDataFileGet);
 
+                    missingFileNames.push_back(networkMessageSynchNetworkGameDataFileCRCCheck.getFileName());
+                }
+
+                // after the last file an empty name tells the server to serve
+                // everything requested over one connection
+                if(networkMessageSynchNetworkGameDataFileCRCCheck.getFileIndex() >= networkMessageSynchNetworkGameDataFileCRCCheck.getTotalFileCount() &&
+                	missingFileNames.empty() == false) {
+                    NetworkMessageSynchNetworkGameDataFileGet sendNetworkMessageSynchNetworkGameDataFileGet("");
+                    sendMessage(&sendNetworkMessageSynchNetworkGameDataFileGet);
+
                     FileTransferInfo fileInfo;
                     fileInfo.hostType   = eClient;
                     fileInfo.serverIP   = this->ip.getString();
                     fileInfo.serverPort = this->port;
-                    fileInfo.fileName   = networkMessageSynchNetworkGameDataFileCRCCheck.getFileName();
+                    fileInfo.fileNames  = missingFileNames;
+                    missingFileNames.clear();
 
                     FileTransferSocketThread *fileXferThread = new FileTransferSocketThread(fileInfo);
                     fileXferThread->start();
@@ -1130,6 +1151,10 @@ void ClientInterface::updateFrame(int *checkFrame) {
 					if(receiveMessage(&networkMessagePing)) {
 						if(SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled) SystemFlags::OutputDebug(SystemFlags::debugNetwork,"In [%s::%s Line: %d]\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__);
 						this->setLastPingInfo(networkMessagePing);
+						// the server measures its round trip time to us
+						if(networkMessagePing.getPingFrequency() == NetworkMessagePing::roundTripPingFrequency) {
+							sendMessage(&networkMessagePing);
+						}
 					}
 				}
 				break;
@@ -84,6 +84,9 @@ private:
 	string serverUUID;
 	string serverPlatform;
 
+	// mismatched files of the running CRC check, fetched over one transfer
+	std::vector<string> missingFileNames;
+
 	ClientInterfaceThread *networkCommandListThread;
 
 	Mutex *networkCommandListThreadAccessor;
@@ -26,6 +26,10 @@ using namespace Shared::Util;
 
 namespace Glest{ namespace Game{
 
+// ring sizes of the per slot inbound queues, more only spills to a locked list
+const int PENDING_NETWORK_COMMAND_QUEUE_SIZE	= 1024;
+const int PENDING_MESSAGE_QUEUE_SIZE			= 64;
+
 // =====================================================
 //	class ConnectionSlotThread
 // =====================================================
@@ -41,6 +45,8 @@ ConnectionSlotThread::ConnectionSlotThread(int slotIndex) : BaseThread() {
 
 	triggerGameStarted 		= new Mutex(CODE_AT_LINE);
 	gameStarted 			= false;
+
+	socketReactor 			= new SocketReactor(Config::getInstance().getBool("EnableSocketReactorEpoll","true"));
 }
 
 ConnectionSlotThread::ConnectionSlotThread(ConnectionSlotCallbackInterface *slotInterface,int slotIndex) : BaseThread() {
@@ -53,6 +59,8 @@ ConnectionSlotThread::ConnectionSlotThread(ConnectionSlotCallbackInterface *slot
 
 	triggerGameStarted 		= new Mutex(CODE_AT_LINE);
 	gameStarted 			= false;
+
+	socketReactor 			= new SocketReactor(Config::getInstance().getBool("EnableSocketReactorEpoll","true"));
 }
 
 ConnectionSlotThread::~ConnectionSlotThread() {
@@ -61,6 +69,16 @@ ConnectionSlotThread::~ConnectionSlotThread() {
 
 	delete triggerGameStarted;
 	triggerGameStarted = NULL;
+
+	delete socketReactor;
+	socketReactor = NULL;
+}
+
+bool ConnectionSlotThread::waitForSocketData(uint32 socketSerial, PLATFORM_SOCKET socketId, int waitMicroseconds) {
+	// A new socket object may reuse the descriptor number and the address
+	// of a closed one, only its serial is new
+	socketReactor->setSocket(0,socketId,socketSerial);
+	return (socketReactor->waitForReadable(socketReadyList,waitMicroseconds) > 0);
 }
 
 void ConnectionSlotThread::setQuitStatus(bool value) {
@@ -244,11 +262,12 @@ void ConnectionSlotThread::execute() {
 					}
 
 					PLATFORM_SOCKET socketId = socket->getSocketId();
+					uint32 socketSerial = socket->getSerial();
 					safeMutex.ReleaseLock();
 
 					// Avoid mutex locking
 					//bool socketHasReadData = Socket::hasDataToRead(socket->getSocketId());
-					bool socketHasReadData = Socket::hasDataToReadWithWait(socketId,150000);
+					bool socketHasReadData = waitForSocketData(socketSerial,socketId,150000);
 
 					ConnectionSlotEvent eventCopy;
 					eventCopy.eventType 		= eReceiveSocketData;
@@ -354,7 +373,11 @@ ConnectionSlot::ConnectionSlot(ServerInterface* serverInterface, int playerIndex
 	this->mutexSocket 						= new Mutex(CODE_AT_LINE);
 	this->socket 							= NULL;
 	this->mutexCloseConnection 				= new Mutex(CODE_AT_LINE);
-	this->mutexPendingNetworkCommandList 	= new Mutex(CODE_AT_LINE);
+	this->pendingNetworkCommandQueue		= new SPSCQueue<NetworkCommand>(PENDING_NETWORK_COMMAND_QUEUE_SIZE);
+	this->pendingChatQueue					= new SPSCQueue<ChatMsgInfo>(PENDING_MESSAGE_QUEUE_SIZE);
+	this->pendingMarkedCellQueue			= new SPSCQueue<MarkedCell>(PENDING_MESSAGE_QUEUE_SIZE);
+	this->pendingUnMarkedCellQueue			= new SPSCQueue<UnMarkedCell>(PENDING_MESSAGE_QUEUE_SIZE);
+	this->pendingHighlightedCellQueue		= new SPSCQueue<MarkedCell>(PENDING_MESSAGE_QUEUE_SIZE);
 	this->socketSynchAccessor 				= new Mutex(CODE_AT_LINE);
     this->connectedRemoteIPAddress 			= 0;
 	this->sessionKey 						= 0;
@@ -368,6 +391,7 @@ ConnectionSlot::ConnectionSlot(ServerInterface* serverInterface, int playerIndex
 	this->currentLagCount					= 0;
 	this->gotLagCountWarning 				= false;
 	this->lastReceiveCommandListTime		= 0;
+	this->roundTripMilliseconds				= -1;
 	this->receivedNetworkGameStatus 		= false;
 
 	this->autoPauseGameCountForLag			= 0;
@@ -446,8 +470,16 @@ ConnectionSlot::~ConnectionSlot() {
 	delete socketSynchAccessor;
 	socketSynchAccessor = NULL;
 
-	delete mutexPendingNetworkCommandList;
-	mutexPendingNetworkCommandList = NULL;
+	delete pendingNetworkCommandQueue;
+	pendingNetworkCommandQueue = NULL;
+	delete pendingChatQueue;
+	pendingChatQueue = NULL;
+	delete pendingMarkedCellQueue;
+	pendingMarkedCellQueue = NULL;
+	delete pendingUnMarkedCellQueue;
+	pendingUnMarkedCellQueue = NULL;
+	delete pendingHighlightedCellQueue;
+	pendingHighlightedCellQueue = NULL;
 
 	delete mutexCloseConnection;
 	mutexCloseConnection = NULL;
@@ -559,6 +591,7 @@ void ConnectionSlot::update(bool checkForNewClients,int lockedSlotIndex) {
 
 						this->connectedTime = time(NULL);
 						this->clearChatInfo();
+						this->clearPendingMessages();
 						this->name = "";
 						this->playerStatus = npst_PickSettings;
 						this->playerLanguage = "";
@@ -566,16 +599,16 @@ void ConnectionSlot::update(bool checkForNewClients,int lockedSlotIndex) {
 						this->platform		 = "";
 						this->ready = false;
 						this->vctFileList.clear();
+						this->requestedFileNames.clear();
 						this->receivedNetworkGameStatus = false;
 						this->gotIntro = false;
 
-						MutexSafeWrapper safeMutexSlot1(mutexPendingNetworkCommandList,CODE_AT_LINE);
-						this->vctPendingNetworkCommandList.clear();
-						safeMutexSlot1.ReleaseLock();
+						this->clearPendingNetworkCommandList();
 
 						this->currentFrameCount = 0;
 						this->currentLagCount = 0;
 						this->lastReceiveCommandListTime = 0;
+						this->roundTripMilliseconds = -1;
 						this->gotLagCountWarning = false;
 						this->versionString = "";
 
@@ -610,7 +643,8 @@ void ConnectionSlot::update(bool checkForNewClients,int lockedSlotIndex) {
 								"",
 								serverInterface->getGameHasBeenInitiated(),
 								Config::getInstance().getString("PlayerId",""),
-								getPlatformNameString());
+								getPlatformNameString(),
+								getSupportedNetworkFeatures());
 						sendMessage(&networkMessageIntro);
 
 						if(this->serverInterface->getGameHasBeenInitiated() == true) {
@@ -624,8 +658,6 @@ void ConnectionSlot::update(bool checkForNewClients,int lockedSlotIndex) {
 			if(SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled) SystemFlags::OutputDebug(SystemFlags::debugNetwork,"In [%s::%s Line: %d]\n",__FILE__,__FUNCTION__,__LINE__);
 
 			if(socketInfo.first == true) {
-				this->clearChatInfo();
-
 				bool gotTextMsg = true;
 				bool gotCellMarkerMsg = true;
 				bool waitForLaggingClient = false;
@@ -665,6 +697,13 @@ void ConnectionSlot::update(bool checkForNewClients,int lockedSlotIndex) {
 							if(receiveMessage(&networkMessagePing)) {
 								if(SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled) SystemFlags::OutputDebug(SystemFlags::debugNetwork,"In [%s::%s Line: %d]\n",__FILE__,__FUNCTION__,__LINE__);
 								lastPingInfo = networkMessagePing;
+
+								if(networkMessagePing.getPingFrequency() == NetworkMessagePing::roundTripPingFrequency) {
+									int roundTrip = (int)(Chrono::getCurMillis() - networkMessagePing.getPingTime());
+									if(roundTrip >= 0) {
+										roundTripMilliseconds = (roundTripMilliseconds < 0 ? roundTrip : (roundTripMilliseconds * 3 + roundTrip) / 4);
+									}
+								}
 							}
 							else {
 								if(SystemFlags::getSystemSettingType(SystemFlags::debugError).enabled) SystemFlags::OutputDebug(SystemFlags::debugError,"In [%s::%s Line: %d]\nInvalid message type before intro handshake [%d]\nDisconnecting socket for slot: %d [%s].\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,networkMessageType,this->playerIndex,this->getIpAddress().c_str());
@@ -683,7 +722,7 @@ void ConnectionSlot::update(bool checkForNewClients,int lockedSlotIndex) {
 								NetworkMessageText networkMessageText;
 								if(receiveMessage(&networkMessageText)) {
 									ChatMsgInfo msg(networkMessageText.getText().c_str(),networkMessageText.getTeamIndex(),networkMessageText.getPlayerIndex(),networkMessageText.getTargetLanguage());
-									this->addChatInfo(msg);
+									pendingChatQueue->push(msg);
 									gotTextMsg = true;
 								}
 								else {
@@ -714,7 +753,7 @@ void ConnectionSlot::update(bool checkForNewClients,int lockedSlotIndex) {
 					            			       networkMessageMarkCell.getText().c_str(),
 					            			       networkMessageMarkCell.getPlayerIndex());
 
-					            	this->addMarkedCell(msg);
+					            	pendingMarkedCellQueue->push(msg);
 					            	gotCellMarkerMsg = true;
 								}
 								else {
@@ -743,7 +782,7 @@ void ConnectionSlot::update(bool checkForNewClients,int lockedSlotIndex) {
 					            	UnMarkedCell msg(networkMessageMarkCell.getTarget(),
 					            			       networkMessageMarkCell.getFactionIndex());
 
-					            	this->addUnMarkedCell(msg);
+					            	pendingUnMarkedCellQueue->push(msg);
 					            	gotCellMarkerMsg = true;
 								}
 								else {
@@ -772,7 +811,7 @@ void ConnectionSlot::update(bool checkForNewClients,int lockedSlotIndex) {
 					            	MarkedCell msg(networkMessageHighlightCell.getTarget(),
 					            			networkMessageHighlightCell.getFactionIndex(),"none",-1);
 
-					            	this->setHighlightedCell(msg);
+					            	pendingHighlightedCellQueue->push(msg);
 					            	gotCellMarkerMsg = true;
 								}
 								else {
@@ -804,11 +843,9 @@ void ConnectionSlot::update(bool checkForNewClients,int lockedSlotIndex) {
 
 									if(SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled) SystemFlags::OutputDebug(SystemFlags::debugNetwork,"In [%s::%s Line: %d] currentFrameCount = %d\n",__FILE__,__FUNCTION__,__LINE__,currentFrameCount);
 
-									MutexSafeWrapper safeMutexSlot(mutexPendingNetworkCommandList,CODE_AT_LINE);
 									for(int i = 0; i < networkMessageCommandList.getCommandCount(); ++i) {
-										vctPendingNetworkCommandList.push_back(*networkMessageCommandList.getCommand(i));
+										pendingNetworkCommandQueue->push(*networkMessageCommandList.getCommand(i));
 									}
-									//printf("Got commands from client frame: %d count: %d\n",currentFrameCount,vctPendingNetworkCommandList.size());
 
 									//printf("#2 Server slot got currentFrameCount = %d\n",currentFrameCount);
 								}
@@ -843,6 +880,9 @@ void ConnectionSlot::update(bool checkForNewClients,int lockedSlotIndex) {
 								this->playerUUID	  = networkMessageIntro.getPlayerUUID();
 								this->platform		  = networkMessageIntro.getPlayerPlatform();
 
+								// the client answers with the features both sides support
+								setCompactCommandList((networkMessageIntro.getFeatures() & nmftCompactCommandList) != 0);
+
 								//printf("Got uuid from client [%s]\n",this->playerUUID.c_str());
 								if(SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled) SystemFlags::OutputDebug(SystemFlags::debugNetwork,"In [%s::%s] got name [%s] versionString [%s], msgSessionId = %d\n",__FILE__,__FUNCTION__,name.c_str(),versionString.c_str(),msgSessionId);
 
@@ -1125,6 +1165,7 @@ void ConnectionSlot::update(bool checkForNewClients,int lockedSlotIndex) {
 										if(allowDownloadDataSynch == true) {
 											// Now get all filenames with their CRC values and send to the client
 											vctFileList.clear();
+											requestedFileNames.clear();
 
 											Config &config = Config::getInstance();
 											string scenarioDir = "";
@@ -1231,14 +1272,21 @@ void ConnectionSlot::update(bool checkForNewClients,int lockedSlotIndex) {
 							if(gotIntro == true) {
 								NetworkMessageSynchNetworkGameDataFileGet networkMessageSynchNetworkGameDataFileGet;
 								if(receiveMessage(&networkMessageSynchNetworkGameDataFileGet)) {
-									FileTransferInfo fileInfo;
-									fileInfo.hostType   = eServer;
-									//fileInfo.serverIP   = this->ip.getString();
-									fileInfo.serverPort = Config::getInstance().getInt("PortServer",intToStr(GameConstants::serverPort).c_str());
-									fileInfo.fileName   = networkMessageSynchNetworkGameDataFileGet.getFileName();
-
-									FileTransferSocketThread *fileXferThread = new FileTransferSocketThread(fileInfo);
-									fileXferThread->start();
+									string fileName = networkMessageSynchNetworkGameDataFileGet.getFileName();
+									if(fileName != "") {
+										requestedFileNames.push_back(fileName);
+									}
+									else if(requestedFileNames.empty() == false) {
+										FileTransferInfo fileInfo;
+										fileInfo.hostType   = eServer;
+										//fileInfo.serverIP   = this->ip.getString();
+										fileInfo.serverPort = Config::getInstance().getInt("PortServer",intToStr(GameConstants::serverPort).c_str());
+										fileInfo.fileNames  = requestedFileNames;
+										requestedFileNames.clear();
+
+										FileTransferSocketThread *fileXferThread = new FileTransferSocketThread(fileInfo);
+										fileXferThread->start();
+									}
 								}
 								else {
 									if(SystemFlags::getSystemSettingType(SystemFlags::debugError).enabled) SystemFlags::OutputDebug(SystemFlags::debugError,"In [%s::%s Line: %d]\nInvalid message type before intro handshake [%d]\nDisconnecting socket for slot: %d [%s].\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,networkMessageType,this->playerIndex,this->getIpAddress().c_str());
@@ -1547,24 +1595,18 @@ string ConnectionSlot::getHumanPlayerName(int index) {
 	return serverInterface->getHumanPlayerName(index);
 }
 
-vector<NetworkCommand> ConnectionSlot::getPendingNetworkCommandList(bool clearList) {
-	vector<NetworkCommand> ret;
-	MutexSafeWrapper safeMutexSlot(mutexPendingNetworkCommandList,CODE_AT_LINE);
-    if(vctPendingNetworkCommandList.empty() == false) {
-    	ret = vctPendingNetworkCommandList;
-		if(clearList == true) {
-			vctPendingNetworkCommandList.clear();
-		}
-    }
-
-    return ret;
+void ConnectionSlot::clearPendingNetworkCommandList() {
+	// runs on the slot thread when a new client takes the slot, the server
+	// thread may be popping at the same time and relies on discardAll never
+	// handing it the old client's commands once the discard is done
+	pendingNetworkCommandQueue->discardAll();
 }
 
-void ConnectionSlot::clearPendingNetworkCommandList() {
-	MutexSafeWrapper safeMutexSlot(mutexPendingNetworkCommandList,CODE_AT_LINE);
-	if(vctPendingNetworkCommandList.empty() == false) {
-		vctPendingNetworkCommandList.clear();
-	}
+void ConnectionSlot::clearPendingMessages() {
+	pendingChatQueue->discardAll();
+	pendingMarkedCellQueue->discardAll();
+	pendingUnMarkedCellQueue->discardAll();
+	pendingHighlightedCellQueue->discardAll();
 }
 
 bool ConnectionSlot::hasValidSocketId() {
@@ -13,8 +13,10 @@
 #define _GLEST_GAME_CONNECTIONSLOT_H_
 
 #include "socket.h"
+#include "socket_reactor.h"
 #include "network_interface.h"
 #include "base_thread.h"
+#include "spsc_queue.h"
 #include <time.h>
 #include <vector>
 
@@ -22,6 +24,7 @@
 
 using Shared::Platform::ServerSocket;
 using Shared::Platform::Socket;
+using Shared::Platform::SocketReactor;
 using std::vector;
 
 namespace Glest{ namespace Game{
@@ -90,6 +93,11 @@ protected:
 	Mutex *triggerGameStarted;
 	bool gameStarted;
 
+	// keeps the slot socket registered while the game runs
+	SocketReactor *socketReactor;
+	vector<int> socketReadyList;
+
+	bool waitForSocketData(uint32 socketSerial, PLATFORM_SOCKET socketId, int waitMicroseconds);
 	virtual void setQuitStatus(bool value);
 	virtual void setTaskCompleted(int eventId);
 
@@ -134,18 +142,26 @@ private:
 	string name;
 	bool ready;
 	vector<std::pair<string,uint32> > vctFileList;
+	// files the client asked for, served together once it sends an empty name
+	vector<string> requestedFileNames;
 	bool receivedNetworkGameStatus;
 	time_t connectedTime;
 	bool gotIntro;
 
 	Mutex *mutexCloseConnection;
 
-	Mutex *mutexPendingNetworkCommandList;
-	vector<NetworkCommand> vctPendingNetworkCommandList;
+	// filled by whoever updates the slot, drained by the game thread
+	// without locking
+	SPSCQueue<NetworkCommand> *pendingNetworkCommandQueue;
+	SPSCQueue<ChatMsgInfo> *pendingChatQueue;
+	SPSCQueue<MarkedCell> *pendingMarkedCellQueue;
+	SPSCQueue<UnMarkedCell> *pendingUnMarkedCellQueue;
+	SPSCQueue<MarkedCell> *pendingHighlightedCellQueue;
 	ConnectionSlotThread* slotThreadWorker;
 	int currentFrameCount;
 	int currentLagCount;
 	time_t lastReceiveCommandListTime;
+	int roundTripMilliseconds;
 	bool gotLagCountWarning;
 	string versionString;
 	int sessionKey;
@@ -215,11 +231,17 @@ public:
 	void setReceivedNetworkGameStatus(bool value) { receivedNetworkGameStatus = value; }
 
 	bool hasValidSocketId();
+	void clearPendingMessages();
 	virtual bool getConnectHasHandshaked() const { return gotIntro; }
 	std::vector<std::string> getThreadErrorList() const { return threadErrorList; }
 	void clearThreadErrorList() { threadErrorList.clear(); }
 
-	vector<NetworkCommand> getPendingNetworkCommandList(bool clearList=false);
+	// game thread side of the slot's message queues
+	void takePendingNetworkCommands(vector<NetworkCommand> &commands)	{ pendingNetworkCommandQueue->popAll(commands); }
+	void takePendingChatMessages(vector<ChatMsgInfo> &messages)			{ pendingChatQueue->popAll(messages); }
+	void takePendingMarkedCells(vector<MarkedCell> &cells)				{ pendingMarkedCellQueue->popAll(cells); }
+	void takePendingUnMarkedCells(vector<UnMarkedCell> &cells)			{ pendingUnMarkedCellQueue->popAll(cells); }
+	void takePendingHighlightedCells(vector<MarkedCell> &cells)			{ pendingHighlightedCellQueue->popAll(cells); }
 	void clearPendingNetworkCommandList();
 
 	void signalUpdate(ConnectionSlotEvent *event);
@@ -232,6 +254,8 @@ public:
 	void setCurrentLagCount(int value) { currentLagCount = value; }
 
 	time_t getLastReceiveCommandListTime() const { return lastReceiveCommandListTime; }
+	// smoothed round trip time of the server's in game pings, -1 until measured
+	int getRoundTripMilliseconds() const { return roundTripMilliseconds; }
 
 	bool getLagCountWarning() const { return gotLagCountWarning; }
 	void setLagCountWarning(bool value) { gotLagCountWarning = value; }
@@ -0,0 +1,574 @@
+// ==============================================================
+//	This file is part of MegaGlest (www.megaglest.org)
+//
+//	Copyright (C) 2013 MegaGlest team
+//
+//	You can redistribute this code and/or modify it under
+//	the terms of the GNU General Public License as published
+//	by the Free Software Foundation; either version 2 of the
+//	License, or (at your option) any later version
+// ==============================================================
+
+#include "network_benchmark.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include "config.h"
+#include "lang.h"
+#include "conversion.h"
+#include "platform_util.h"
+#include "checksum.h"
+#include "randomgen.h"
+#include "map_preview.h"
+#include "xml_parser.h"
+#include "properties.h"
+#include "leak_dumper.h"
+
+using namespace std;
+using namespace Shared::Platform;
+using namespace Shared::Util;
+using namespace Shared::Xml;
+using namespace Shared::Map;
+
+namespace Glest{ namespace Game{
+
+static const int benchmarkConnectTimeoutMillis	= 30000;
+static const int benchmarkReadyTimeoutMillis	= 30000;
+static const int benchmarkShutdownWaitMillis	= 5000;
+
+static uint32 getBenchmarkChecksum() {
+	Checksum checksum;
+	checksum.addString("megaglest-network-benchmark");
+	return checksum.getSum();
+}
+
+static bool compareCommandFrames(const std::pair<int,NetworkCommand> &left,
+								 const std::pair<int,NetworkCommand> &right) {
+	return left.first < right.first;
+}
+
+// nearest rank percentile of sorted values
+static int64 getPercentile(const vector<int64> &sortedValues, int percent) {
+	if(sortedValues.empty() == true) {
+		return 0;
+	}
+	size_t rank = (sortedValues.size() * percent + 99) / 100;
+	if(rank > 0) {
+		rank--;
+	}
+	if(rank >= sortedValues.size()) {
+		rank = sortedValues.size() - 1;
+	}
+	return sortedValues[rank];
+}
+
+static double getAverage(const vector<int64> &values) {
+	if(values.empty() == true) {
+		return 0;
+	}
+	int64 total = 0;
+	for(unsigned int index = 0; index < values.size(); ++index) {
+		total += values[index];
+	}
+	return (double)total / (double)values.size();
+}
+
+static void printDistribution(const char *title, vector<int64> values) {
+	std::sort(values.begin(),values.end());
+	printf("  %s: avg %.3f, p50 " MG_I64_SPECIFIER ", p95 " MG_I64_SPECIFIER ", p99 " MG_I64_SPECIFIER ", max " MG_I64_SPECIFIER " (" MG_SIZE_T_SPECIFIER " samples)\n",
+			title,getAverage(values),getPercentile(values,50),getPercentile(values,95),
+			getPercentile(values,99),(values.empty() == true ? 0 : values.back()),values.size());
+}
+
+// =====================================================
+//	class BenchmarkClientInterface
+// =====================================================
+
+BenchmarkClientInterface::BenchmarkClientInterface() : ClientInterface() {
+}
+
+uint32 BenchmarkClientInterface::waitUntilServerReady(uint32 checksum, int timeoutMillis) {
+	NetworkMessageReady networkMessageReady(checksum);
+	sendMessage(&networkMessageReady);
+
+	Chrono chrono(true);
+	for(;;) {
+		if(isConnected() == false) {
+			throw megaglest_runtime_error("Server disconnected while waiting for the game to start");
+		}
+
+		NetworkMessageType networkMessageType = getNextMessageType();
+		if(shouldDiscardNetworkMessage(networkMessageType) == true) {
+			continue;
+		}
+
+		if(networkMessageType == nmtReady) {
+			if(receiveMessage(&networkMessageReady)) {
+				break;
+			}
+		}
+		else if(networkMessageType == nmtLoadingStatusMessage) {
+			NetworkMessageLoadingStatus networkMessageLoadingStatus(nmls_NONE);
+			receiveMessage(&networkMessageLoadingStatus);
+		}
+		else if(networkMessageType == nmtInvalid) {
+			if(chrono.getMillis() > timeoutMillis) {
+				throw megaglest_runtime_error("Timeout waiting for the server to start the game");
+			}
+			sleep(1);
+		}
+		else {
+			throw megaglest_runtime_error("Unexpected network message while waiting for the server: " + intToStr(networkMessageType));
+		}
+	}
+	return networkMessageReady.getChecksum();
+}
+
+// =====================================================
+//	class NetworkBenchmarkClient
+// =====================================================
+
+NetworkBenchmarkClient::NetworkBenchmarkClient(NetworkBenchmark *benchmark, int clientIndex,
+											   const vector<std::pair<int,NetworkCommand> > &commands,
+											   int commandSpan) : BaseThread() {
+	this->benchmark		= benchmark;
+	this->clientIndex	= clientIndex;
+	this->commands		= commands;
+	this->commandSpan	= commandSpan;
+
+	statusAccessor		= new Mutex(CODE_AT_LINE);
+	ready				= false;
+	errorText			= "";
+	commandsSent		= 0;
+}
+
+NetworkBenchmarkClient::~NetworkBenchmarkClient() {
+	delete statusAccessor;
+	statusAccessor = NULL;
+}
+
+bool NetworkBenchmarkClient::getReady() {
+	MutexSafeWrapper safeMutex(statusAccessor,CODE_AT_LINE);
+	return ready;
+}
+
+string NetworkBenchmarkClient::getErrorText() {
+	MutexSafeWrapper safeMutex(statusAccessor,CODE_AT_LINE);
+	return errorText;
+}
+
+void NetworkBenchmarkClient::setErrorText(const string &value) {
+	MutexSafeWrapper safeMutex(statusAccessor,CODE_AT_LINE);
+	errorText = value;
+}
+
+void NetworkBenchmarkClient::requestCommands(BenchmarkClientInterface *clientInterface, int factionIndex,
+											 unsigned int &commandCursor, int &commandOffset,
+											 int fromFrame, int toFrame) {
+	if(commands.empty() == true) {
+		return;
+	}
+
+	for(;;) {
+		if(commandCursor >= commands.size()) {
+			// play the stream again when the run is longer than the recording
+			commandCursor = 0;
+			commandOffset += commandSpan;
+		}
+		int frame = commands[commandCursor].first + commandOffset;
+		if(frame >= toFrame) {
+			break;
+		}
+		if(frame >= fromFrame) {
+			NetworkCommand networkCommand = commands[commandCursor].second;
+			networkCommand.fromFactionIndex = factionIndex;
+			clientInterface->requestCommand(&networkCommand);
+			commandsSent++;
+		}
+		commandCursor++;
+	}
+}
+
+void NetworkBenchmarkClient::execute() {
+	RunningStatusSafeWrapper runningStatus(this);
+
+	BenchmarkClientInterface *clientInterface = NULL;
+	try {
+		clientInterface = new BenchmarkClientInterface();
+		clientInterface->connect(Ip("127.0.0.1"),benchmark->getPort());
+
+		Chrono chrono(true);
+		while(getQuitStatus() == false &&
+			  clientInterface->getLaunchGame() == false) {
+			if(clientInterface->isConnected() == false) {
+				throw megaglest_runtime_error("Lost the connection to the server in the lobby");
+			}
+			if(chrono.getMillis() > benchmarkConnectTimeoutMillis) {
+				throw megaglest_runtime_error("Timeout waiting for the server to launch the game");
+			}
+			clientInterface->updateLobby();
+			sleep(10);
+		}
+
+		if(getQuitStatus() == false) {
+			uint32 serverChecksum = clientInterface->waitUntilServerReady(getBenchmarkChecksum(),benchmarkReadyTimeoutMillis);
+			if(serverChecksum != getBenchmarkChecksum()) {
+				throw megaglest_runtime_error("Server sent checksum " + uIntToStr(serverChecksum));
+			}
+
+			MutexSafeWrapper safeMutex(statusAccessor,CODE_AT_LINE);
+			ready = true;
+			safeMutex.ReleaseLock();
+		}
+
+		int factionIndex		= clientInterface->getGameSettings()->getThisFactionIndex();
+		int networkFramePeriod	= benchmark->getNetworkFramePeriod();
+		unsigned int commandCursor	= 0;
+		int commandOffset		= 0;
+
+		requestCommands(clientInterface,factionIndex,commandCursor,commandOffset,0,networkFramePeriod);
+		clientInterface->update();
+
+		for(int frame = networkFramePeriod;
+			getQuitStatus() == false && frame <= benchmark->getFrameCount();
+			frame += networkFramePeriod) {
+
+			// updateKeyframe busy waits for the command list, only call it
+			// once the server sent it so the client threads do not take cpu
+			// time away from the server being measured
+			while(getQuitStatus() == false &&
+				  benchmark->getLastKeyframeSent() < frame) {
+				sleep(1);
+			}
+			if(getQuitStatus() == true) {
+				break;
+			}
+
+			clientInterface->updateKeyframe(frame);
+			keyframeLatencies.push_back(Chrono::getCurMillis() - benchmark->getKeyframeSendMillis(frame));
+			clientInterface->clearPendingCommands();
+
+			if(clientInterface->isConnected() == false) {
+				throw megaglest_runtime_error("Lost the connection to the server in frame " + intToStr(frame));
+			}
+
+			requestCommands(clientInterface,factionIndex,commandCursor,commandOffset,frame,frame + networkFramePeriod);
+			clientInterface->update();
+		}
+	}
+	catch(const exception &ex) {
+		SystemFlags::OutputDebug(SystemFlags::debugError,"In [%s::%s Line: %d] Error [%s]\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,ex.what());
+		setErrorText("client " + intToStr(clientIndex) + ": " + ex.what());
+	}
+
+	if(clientInterface != NULL) {
+		clientInterface->close();
+		delete clientInterface;
+		clientInterface = NULL;
+	}
+}
+
+// =====================================================
+//	class NetworkBenchmark
+// =====================================================
+
+NetworkBenchmark::NetworkBenchmark(int clientCount, int frameCount, const string &replayFile) {
+	Config &config = Config::getInstance();
+
+	this->clientCount	= clientCount;
+	this->frameCount	= frameCount;
+	this->replayFile	= replayFile;
+
+	networkFramePeriod	= config.getInt("NetworkSendFrameCount",intToStr(GameConstants::networkFramePeriod).c_str());
+	if(networkFramePeriod <= 0) {
+		networkFramePeriod = GameConstants::networkFramePeriod;
+	}
+	port				= config.getInt("PortServer",intToStr(GameConstants::serverPort).c_str());
+
+	keyframeAccessor	= new Mutex(CODE_AT_LINE);
+	keyframeSendMillis.resize(frameCount / networkFramePeriod + 1,0);
+	lastKeyframeSent	= 0;
+}
+
+NetworkBenchmark::~NetworkBenchmark() {
+	delete keyframeAccessor;
+	keyframeAccessor = NULL;
+}
+
+int NetworkBenchmark::getLastKeyframeSent() {
+	MutexSafeWrapper safeMutex(keyframeAccessor,CODE_AT_LINE);
+	return lastKeyframeSent;
+}
+
+int64 NetworkBenchmark::getKeyframeSendMillis(int frame) {
+	MutexSafeWrapper safeMutex(keyframeAccessor,CODE_AT_LINE);
+	return keyframeSendMillis[frame / networkFramePeriod];
+}
+
+void NetworkBenchmark::setKeyframeSent(int frame, int64 sendMillis) {
+	MutexSafeWrapper safeMutex(keyframeAccessor,CODE_AT_LINE);
+	keyframeSendMillis[frame / networkFramePeriod] = sendMillis;
+	lastKeyframeSent = frame;
+}
+
+bool NetworkBenchmark::loadReplayCommands(vector<vector<std::pair<int,NetworkCommand> > > &clientCommands,
+										  int &commandSpan) {
+	if(fileExists(replayFile) == false) {
+		printf("Replay file [%s] not found.\n",replayFile.c_str());
+		return false;
+	}
+
+	XmlTree	xmlTree(XML_RAPIDXML_ENGINE);
+	std::map<string,string> mapExtraTagReplacementValues;
+	xmlTree.load(replayFile, Properties::getTagReplacementValues(&mapExtraTagReplacementValues),true);
+
+	const XmlNode *rootNode = xmlTree.getRootNode();
+	if(rootNode->hasChild("megaglest-saved-game") == true) {
+		rootNode = rootNode->getChild("megaglest-saved-game");
+	}
+	const XmlNode *gameNode = rootNode->getChild("Game");
+
+	// the factions of the recording are spread over the synthetic clients
+	int lastFrame = 0;
+	vector<XmlNode *> commandNodes = gameNode->getChildList("NetworkCommand");
+	for(unsigned int index = 0; index < commandNodes.size(); ++index) {
+		NetworkCommand networkCommand;
+		networkCommand.loadGame(commandNodes[index]);
+		int frame = commandNodes[index]->getAttribute("worldFrameCount")->getIntValue();
+
+		int clientIndex = abs((int)networkCommand.fromFactionIndex) % clientCount;
+		clientCommands[clientIndex].push_back(make_pair(frame,networkCommand));
+		lastFrame = max(lastFrame,frame);
+	}
+
+	for(unsigned int index = 0; index < clientCommands.size(); ++index) {
+		std::stable_sort(clientCommands[index].begin(),clientCommands[index].end(),compareCommandFrames);
+	}
+	commandSpan = lastFrame + networkFramePeriod;
+
+	printf("Loaded " MG_SIZE_T_SPECIFIER " recorded commands spanning %d frames from [%s].\n",commandNodes.size(),lastFrame,replayFile.c_str());
+	return true;
+}
+
+void NetworkBenchmark::makeSyntheticCommands(vector<vector<std::pair<int,NetworkCommand> > > &clientCommands,
+											 int &commandSpan) {
+	int commandsPerMinute = Config::getInstance().getInt("NetworkBenchmarkCommandsPerMinute","120");
+	if(commandsPerMinute <= 0) {
+		commandsPerMinute = 1;
+	}
+	int commandInterval = max(1,GameConstants::updateFps * 60 / commandsPerMinute);
+
+	RandomGen random;
+	random.init(clientCount);
+	for(int clientIndex = 0; clientIndex < clientCount; ++clientIndex) {
+		int unitCount = 0;
+		for(int frame = 1 + clientIndex * commandInterval / clientCount;
+			frame <= frameCount; frame += commandInterval) {
+			NetworkCommand networkCommand;
+			networkCommand.networkCommandType	= nctGiveCommand;
+			networkCommand.unitId				= (clientIndex + 1) * 1000 + (unitCount++ % 40);
+			networkCommand.unitTypeId			= -1;
+			networkCommand.commandTypeId		= random.randRange(0,3);
+			networkCommand.positionX			= random.randRange(0,255);
+			networkCommand.positionY			= random.randRange(0,255);
+			networkCommand.targetId				= -1;
+			networkCommand.unitCommandGroupId	= -1;
+
+			clientCommands[clientIndex].push_back(make_pair(frame,networkCommand));
+		}
+	}
+	commandSpan = frameCount + networkFramePeriod;
+
+	printf("Using synthetic commands, %d per minute for each client.\n",commandsPerMinute);
+}
+
+void NetworkBenchmark::setupGameSettings(GameSettings &gameSettings) {
+	Config &config = Config::getInstance();
+
+	// the data is never loaded, names that exist keep the server from
+	// reverting them when the settings are applied
+	vector<string> results;
+	findDirs(config.getPathListForType(ptTechs), results);
+	if(results.empty() == false) {
+		gameSettings.setTech(results[0]);
+	}
+	results.clear();
+	findDirs(config.getPathListForType(ptTilesets), results);
+	if(results.empty() == false) {
+		gameSettings.setTileset(results[0]);
+	}
+	vector<string> invalidMapList;
+	results = MapPreview::findAllValidMaps(config.getPathListForType(ptMaps,""),"",false,true,&invalidMapList);
+	if(results.empty() == false) {
+		gameSettings.setMap(results[0]);
+	}
+
+	gameSettings.setFactionCount(clientCount + 1);
+	gameSettings.setNetworkFramePeriod(networkFramePeriod);
+	for(int factionIndex = 0; factionIndex <= clientCount; ++factionIndex) {
+		gameSettings.setFactionControl(factionIndex,(factionIndex == 0 ? ctHuman : ctNetwork));
+		gameSettings.setStartLocationIndex(factionIndex,factionIndex);
+		gameSettings.setTeam(factionIndex,factionIndex);
+		gameSettings.setFactionTypeName(factionIndex,"benchmark");
+		gameSettings.setNetworkPlayerName(factionIndex,"benchmark_" + intToStr(factionIndex));
+		gameSettings.setNetworkPlayerLanguages(factionIndex,Lang::getInstance().getLanguage());
+	}
+	gameSettings.setThisFactionIndex(0);
+}
+
+int NetworkBenchmark::run() {
+	Config &config = Config::getInstance();
+	config.setBool("EnableFTPServer",false,true);
+
+	vector<vector<std::pair<int,NetworkCommand> > > clientCommands(clientCount);
+	int commandSpan = 0;
+	if(replayFile != "") {
+		if(loadReplayCommands(clientCommands,commandSpan) == false) {
+			return 1;
+		}
+	}
+	else {
+		makeSyntheticCommands(clientCommands,commandSpan);
+	}
+
+	printf("Server benchmark: %d clients, %d frames at %d fps, network frame period %d, port %d\n",
+			clientCount,frameCount,GameConstants::updateFps,networkFramePeriod,port);
+
+	int result = 0;
+	ServerInterface *serverInterface = new ServerInterface(false,NULL);
+	vector<NetworkBenchmarkClient *> clients;
+	try {
+		for(int playerIndex = 1; playerIndex <= clientCount; ++playerIndex) {
+			serverInterface->addSlot(playerIndex);
+		}
+
+		static string mutexOwnerId = string(extractFileFromDirectoryPath(__FILE__).c_str()) + string("_") + intToStr(__LINE__);
+		for(int clientIndex = 0; clientIndex < clientCount; ++clientIndex) {
+			NetworkBenchmarkClient *client = new NetworkBenchmarkClient(this,clientIndex,clientCommands[clientIndex],commandSpan);
+			client->setUniqueID(mutexOwnerId);
+			clients.push_back(client);
+			client->start();
+		}
+
+		Chrono chrono(true);
+		while(serverInterface->getConnectedSlotCount(true) < clientCount) {
+			if(chrono.getMillis() > benchmarkConnectTimeoutMillis) {
+				throw megaglest_runtime_error("Timeout waiting for the clients to connect, connected: " + intToStr(serverInterface->getConnectedSlotCount(true)));
+			}
+			for(unsigned int index = 0; index < clients.size(); ++index) {
+				if(clients[index]->getErrorText() != "") {
+					throw megaglest_runtime_error(clients[index]->getErrorText());
+				}
+			}
+			serverInterface->update();
+			sleep(10);
+		}
+
+		GameSettings gameSettings;
+		setupGameSettings(gameSettings);
+		serverInterface->setGameSettings(&gameSettings,false);
+		if(serverInterface->launchGame(&gameSettings) == false) {
+			throw megaglest_runtime_error("The server could not launch the game");
+		}
+
+		Checksum checksum;
+		checksum.addString("megaglest-network-benchmark");
+		serverInterface->waitUntilReady(&checksum);
+
+		const int64 frameMillis	= 1000 / GameConstants::updateFps;
+		vector<int64> serverFrameMillis;
+		vector<int64> serverFrameBytes;
+		serverFrameMillis.reserve(frameCount);
+		serverFrameBytes.reserve(frameCount);
+		int64 commandsBroadcast	= 0;
+		int64 lastSentByteCount	= serverInterface->getSentByteCount();
+		int64 startSentByteCount	= lastSentByteCount;
+
+		Chrono runChrono(true);
+		int64 nextFrameStart = Chrono::getCurMillis();
+		for(int frame = 1; frame <= frameCount; ++frame) {
+			int64 frameStart = Chrono::getCurMillis();
+
+			serverInterface->update();
+			if(frame % networkFramePeriod == 0) {
+				int64 sendMillis = Chrono::getCurMillis();
+				serverInterface->updateKeyframe(frame);
+				commandsBroadcast += serverInterface->getPendingCommandCount();
+				serverInterface->clearPendingCommands();
+				setKeyframeSent(frame,sendMillis);
+			}
+
+			serverFrameMillis.push_back(Chrono::getCurMillis() - frameStart);
+			int64 sentByteCount = serverInterface->getSentByteCount();
+			serverFrameBytes.push_back(sentByteCount - lastSentByteCount);
+			lastSentByteCount = sentByteCount;
+
+			for(unsigned int index = 0; index < clients.size(); ++index) {
+				if(clients[index]->getErrorText() != "") {
+					throw megaglest_runtime_error(clients[index]->getErrorText());
+				}
+			}
+
+			nextFrameStart += frameMillis;
+			int64 waitMillis = nextFrameStart - Chrono::getCurMillis();
+			if(waitMillis > 0) {
+				sleep((int)waitMillis);
+			}
+		}
+		int64 runMillis = runChrono.getMillis();
+
+		// give the clients time to take the last keyframe
+		chrono.start();
+		for(unsigned int index = 0; index < clients.size(); ++index) {
+			while(clients[index]->getRunningStatus() == true &&
+				  chrono.getMillis() < benchmarkShutdownWaitMillis) {
+				sleep(10);
+			}
+		}
+
+		vector<int64> keyframeLatencies;
+		int64 commandsSent = 0;
+		for(unsigned int index = 0; index < clients.size(); ++index) {
+			if(clients[index]->shutdownAndWait() == true) {
+				const vector<int64> &latencies = clients[index]->getKeyframeLatencies();
+				keyframeLatencies.insert(keyframeLatencies.end(),latencies.begin(),latencies.end());
+				commandsSent += clients[index]->getCommandsSent();
+			}
+		}
+
+		int64 sentBytes = lastSentByteCount - startSentByteCount;
+		printf("\nServer benchmark results, %d frames in " MG_I64_SPECIFIER " ms:\n",frameCount,runMillis);
+		printDistribution("server time per frame (ms)",serverFrameMillis);
+		printDistribution("bytes sent per frame",serverFrameBytes);
+		printf("  bytes sent: " MG_I64_SPECIFIER " total, %.1f per second\n",
+				sentBytes,(runMillis > 0 ? sentBytes * 1000.0 / runMillis : 0.0));
+		printf("  commands: " MG_I64_SPECIFIER " sent by clients, " MG_I64_SPECIFIER " broadcast by the server\n",
+				commandsSent,commandsBroadcast);
+		printf("  lag checks: " MG_I64_SPECIFIER ", warnings: " MG_I64_SPECIFIER ", exceeded: " MG_I64_SPECIFIER "\n",
+				serverInterface->getLagCheckCount(),serverInterface->getLagWarningCount(),serverInterface->getLagExceededCount());
+		printDistribution("keyframe latency (ms)",keyframeLatencies);
+	}
+	catch(const exception &ex) {
+		SystemFlags::OutputDebug(SystemFlags::debugError,"In [%s::%s Line: %d] Error [%s]\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,ex.what());
+		printf("Server benchmark failed: %s\n",ex.what());
+		result = 1;
+	}
+
+	for(unsigned int index = 0; index < clients.size(); ++index) {
+		// a client that did not begin yet would not see the quit signal
+		for(int wait = 0; clients[index]->getHasBeginExecution() == false && wait < 100; ++wait) {
+			sleep(10);
+		}
+		if(clients[index]->shutdownAndWait() == true) {
+			delete clients[index];
+		}
+	}
+	clients.clear();
+
+	delete serverInterface;
+	serverInterface = NULL;
+
+	return result;
+}
+
+}}//end namespace
@@ -0,0 +1,128 @@
+// ==============================================================
+//	This file is part of MegaGlest (www.megaglest.org)
+//
+//	Copyright (C) 2013 MegaGlest team
+//
+//	You can redistribute this code and/or modify it under
+//	the terms of the GNU General Public License as published
+//	by the Free Software Foundation; either version 2 of the
+//	License, or (at your option) any later version
+// ==============================================================
+
+#ifndef _GLEST_GAME_NETWORKBENCHMARK_H_
+#define _GLEST_GAME_NETWORKBENCHMARK_H_
+
+#include <string>
+#include <vector>
+#include "base_thread.h"
+#include "client_interface.h"
+#include "server_interface.h"
+#include "leak_dumper.h"
+
+using std::string;
+using std::vector;
+using Shared::PlatformCommon::BaseThread;
+
+namespace Glest{ namespace Game{
+
+class NetworkBenchmark;
+
+// =====================================================
+//	class BenchmarkClientInterface
+//
+/// Client interface used by the server benchmark, it only replaces the
+/// ready handshake which normally reports through the loading screen
+// =====================================================
+
+class BenchmarkClientInterface : public ClientInterface {
+public:
+	BenchmarkClientInterface();
+
+	// Sends the ready message and waits for the one of the server, returns
+	// the checksum the server sent or throws on disconnect and timeout
+	uint32 waitUntilServerReady(uint32 checksum, int timeoutMillis);
+};
+
+// =====================================================
+//	class NetworkBenchmarkClient
+//
+/// One synthetic client, connects over localhost, joins the game and then
+/// follows the keyframes of the server while sending its command stream
+// =====================================================
+
+class NetworkBenchmarkClient : public BaseThread {
+private:
+	NetworkBenchmark *benchmark;
+	int clientIndex;
+	vector<std::pair<int,NetworkCommand> > commands;
+	int commandSpan;
+
+	Mutex *statusAccessor;
+	bool ready;
+	string errorText;
+	vector<int64> keyframeLatencies;
+	int64 commandsSent;
+
+	void setErrorText(const string &value);
+	void requestCommands(BenchmarkClientInterface *clientInterface, int factionIndex,
+						 unsigned int &commandCursor, int &commandOffset,
+						 int fromFrame, int toFrame);
+
+public:
+	NetworkBenchmarkClient(NetworkBenchmark *benchmark, int clientIndex,
+						   const vector<std::pair<int,NetworkCommand> > &commands,
+						   int commandSpan);
+	virtual ~NetworkBenchmarkClient();
+
+	virtual void execute();
+
+	bool getReady();
+	string getErrorText();
+	const vector<int64> &getKeyframeLatencies() const { return keyframeLatencies; }
+	int64 getCommandsSent() const { return commandsSent; }
+};
+
+// =====================================================
+//	class NetworkBenchmark
+//
+/// Headless server benchmark, runs a ServerInterface against synthetic
+/// clients in the same process and reports what the network layer costs
+// =====================================================
+
+class NetworkBenchmark {
+private:
+	int clientCount;
+	int frameCount;
+	int networkFramePeriod;
+	int port;
+	string replayFile;
+
+	Mutex *keyframeAccessor;
+	vector<int64> keyframeSendMillis;
+	int lastKeyframeSent;
+
+	bool loadReplayCommands(vector<vector<std::pair<int,NetworkCommand> > > &clientCommands,
+							int &commandSpan);
+	void makeSyntheticCommands(vector<vector<std::pair<int,NetworkCommand> > > &clientCommands,
+							   int &commandSpan);
+	void setupGameSettings(GameSettings &gameSettings);
+	void setKeyframeSent(int frame, int64 sendMillis);
+
+public:
+	NetworkBenchmark(int clientCount, int frameCount, const string &replayFile);
+	~NetworkBenchmark();
+
+	// Runs the benchmark and prints the report, returns a process exit code
+	int run();
+
+	int getFrameCount() const			{ return frameCount; }
+	int getNetworkFramePeriod() const	{ return networkFramePeriod; }
+	int getPort() const					{ return port; }
+
+	int getLastKeyframeSent();
+	int64 getKeyframeSendMillis(int frame);
+};
+
+}}//end namespace
+
+#endif
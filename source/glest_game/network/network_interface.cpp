@@ -20,10 +20,14 @@
 #include <fstream>
 #include "util.h"
 #include "network_protocol.h"
+#include "compression_utils.h"
+#include "config.h"
+#include <algorithm>
 #include "leak_dumper.h"
 
 using namespace Shared::Platform;
 using namespace Shared::Util;
+using namespace Shared::CompressionUtil;
 using namespace std;
 
 namespace Glest{ namespace Game{
@@ -52,6 +56,9 @@ NetworkInterface::NetworkInterface() {
 	for(unsigned int index = 0; index < (unsigned int)GameConstants::maxPlayers; ++index) {
 		networkPlayerFactionCRC[index] = 0;
 	}
+
+	compactCommandList = false;
+	sendBufferMutex = new Mutex(CODE_AT_LINE);
 }
 
 void NetworkInterface::init() {
@@ -68,6 +75,11 @@ void NetworkInterface::init() {
 	for(unsigned int index = 0; index < (unsigned int)GameConstants::maxPlayers; ++index) {
 		networkPlayerFactionCRC[index] = 0;
 	}
+
+	sendBufferMutex = NULL;
+	compactCommandList = false;
+	commandListSendState.reset();
+	commandListReceiveState.reset();
 }
 
 NetworkInterface::~NetworkInterface() {
@@ -76,6 +88,9 @@ NetworkInterface::~NetworkInterface() {
 
 	delete networkPlayerFactionCRCMutex;
 	networkPlayerFactionCRCMutex = NULL;
+
+	delete sendBufferMutex;
+	sendBufferMutex = NULL;
 }
 
 uint32 NetworkInterface::getNetworkPlayerFactionCRC(int index) {
@@ -111,10 +126,40 @@ void NetworkInterface::addUnMarkedCell(const UnMarkedCell &msg) {
 	unmarkedCellList.push_back(msg);
 }
 
+uint32 NetworkInterface::getSupportedNetworkFeatures() {
+	uint32 features = 0;
+	if(Config::getInstance().getBool("EnableCompactCommandList","true") == true) {
+		features |= nmftCompactCommandList;
+	}
+	return features;
+}
+
+void NetworkInterface::setCompactCommandList(bool value) {
+	compactCommandList = value;
+	commandListSendState.reset();
+	commandListReceiveState.reset();
+}
+
 void NetworkInterface::sendMessage(NetworkMessage* networkMessage){
 	Socket* socket= getSocket(false);
 
-	networkMessage->send(socket);
+	if(compactCommandList == true) {
+		NetworkMessageCommandList *commandListMsg = dynamic_cast<NetworkMessageCommandList *>(networkMessage);
+		if(commandListMsg != NULL) {
+			commandListMsg->sendCompact(socket, commandListSendState);
+			return;
+		}
+	}
+	// a broadcast packs the message once for all connections, other
+	// messages are packed into this connection's reusable buffer
+	if(networkMessage->getSharedPacking() == true) {
+		networkMessage->sendPacked(socket, networkMessage->getSharedPackedBuffer());
+	}
+	else {
+		MutexSafeWrapper safeMutex(sendBufferMutex,CODE_AT_LINE);
+		networkMessage->packInto(sendBuffer);
+		networkMessage->sendPacked(socket, sendBuffer);
+	}
 }
 
 NetworkMessageType NetworkInterface::getNextMessageType(int waitMilliseconds)
@@ -138,6 +183,11 @@ NetworkMessageType NetworkInterface::getNextMessageType(int waitMilliseconds)
 			if(SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled) SystemFlags::OutputDebug(SystemFlags::debugNetwork,"In [%s::%s Line: %d] PEEK WARNING, socket->getDataToRead() messageType = %d [size = %d], dataSize = %d\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,messageType,sizeof(messageType),dataSize);
 		}
 
+        // compact command lists are decoded by the command list message
+        if(messageType == nmtCommandListCompact) {
+        	messageType = nmtCommandList;
+        }
+
         //sanity check new message type
         if(messageType < 0 || messageType >= nmtCount) {
         	if(getConnectHasHandshaked() == true) {
@@ -158,6 +208,10 @@ bool NetworkInterface::receiveMessage(NetworkMessage* networkMessage){
 
 	Socket* socket= getSocket(false);
 
+	NetworkMessageCommandList *commandListMsg = dynamic_cast<NetworkMessageCommandList *>(networkMessage);
+	if(commandListMsg != NULL) {
+		return commandListMsg->receive(socket, commandListReceiveState);
+	}
 	return networkMessage->receive(socket);
 }
 
@@ -372,11 +426,136 @@ void GameNetworkInterface::requestCommand(const NetworkCommand *networkCommand,
 //	class FileTransferSocketThread
 // =====================================================
 
-const int32 SEND_FILE = 0x20;
-const int32 ACK       = 0x47;
+// Chunked transfer: the client asks for a list of files with the offset of
+// what it already has, the server interleaves chunks of up to
+// FILE_TRANSFER_FILES_IN_FLIGHT files, each chunk carries the CRC of its
+// uncompressed data so a broken transfer resumes from the last good chunk.
+// The client ends each connection with the status of every file it asked
+// for, the server keeps accepting until all of them arrived intact
+const uint32 FILE_TRANSFER_MAGIC				= 0x5446474D;	// "MGFT"
+const uint32 FILE_TRANSFER_VERSION				= 2;
+const uint32 FILE_TRANSFER_CHUNK_SIZE			= 64 * 1024;
+const uint32 FILE_TRANSFER_MAX_FILES			= 4096;
+const uint32 FILE_TRANSFER_MAX_NAME_LENGTH		= 4096;
+const int FILE_TRANSFER_FILES_IN_FLIGHT			= 4;
+const int FILE_TRANSFER_MAX_ATTEMPTS			= 5;
+const int FILE_TRANSFER_RETRY_MILLISECONDS		= 1000;
+const int FILE_TRANSFER_ACCEPT_TIMEOUT_MILLISECONDS = 30000;
+
+enum FileTransferMessageType {
+	ftmFileInfo = 1,
+	ftmChunk,
+	ftmFileDone,
+	ftmEnd,
+	ftmFileStatus
+};
+
+struct FileTransferOutgoingFile {
+	uint32 index;
+	FILE *fp;
+	int64 size;
+	int64 offset;
+};
+
+struct FileTransferIncomingFile {
+	FILE *fp;
+	int64 offset;
+	uint32 fileSum;
+	bool finished;
+};
+
+static string getFileTransferPartName(const string &fileName) {
+	return fileName + ".part";
+}
+
+// sizes and offsets go over the wire as 64 bit, a long is 32 bit on Win32
+static bool seekFileTransferFile(FILE *fp, int64 offset, int origin) {
+#ifdef WIN32
+	return (_fseeki64(fp, offset, origin) == 0);
+#else
+	return (fseeko(fp, (off_t)offset, origin) == 0);
+#endif
+}
+
+static int64 tellFileTransferFile(FILE *fp) {
+#ifdef WIN32
+	return _ftelli64(fp);
+#else
+	return (int64)ftello(fp);
+#endif
+}
+
+static int64 getFileTransferFileSize(const string &fileName) {
+#ifdef WIN32
+	FILE *fp = _wfopen(utf8_decode(fileName).c_str(), L"rb");
+#else
+	FILE *fp = fopen(fileName.c_str(), "rb");
+#endif
+	if(fp == NULL) {
+		return 0;
+	}
+	int64 size = 0;
+	if(seekFileTransferFile(fp, 0, SEEK_END) == true) {
+		size = max((int64)0, tellFileTransferFile(fp));
+	}
+	fclose(fp);
+	return size;
+}
+
+template<typename T>
+static void appendFileTransferValue(vector<unsigned char> &buffer, T value) {
+	value = Shared::PlatformByteOrder::toCommonEndian(value);
+	const unsigned char *bytes = reinterpret_cast<const unsigned char *>(&value);
+	buffer.insert(buffer.end(), bytes, bytes + sizeof(value));
+}
+
+static void appendFileTransferString(vector<unsigned char> &buffer, const string &value) {
+	appendFileTransferValue<uint32>(buffer, (uint32)value.size());
+	buffer.insert(buffer.end(), value.begin(), value.end());
+}
+
+static bool sendFileTransferBuffer(Socket *socket, const vector<unsigned char> &buffer) {
+	if(buffer.empty() == true) {
+		return true;
+	}
+	return (socket->send(&buffer[0], (int)buffer.size()) == (int)buffer.size());
+}
+
+static bool receiveFileTransferData(Socket *socket, void *data, uint32 size) {
+	if(size == 0) {
+		return true;
+	}
+	return (socket->receive(data, (int)size, true) == (int)size);
+}
+
+template<typename T>
+static bool receiveFileTransferValue(Socket *socket, T &value) {
+	if(receiveFileTransferData(socket, &value, sizeof(value)) == false) {
+		return false;
+	}
+	value = Shared::PlatformByteOrder::fromCommonEndian(value);
+	return true;
+}
+
+static bool receiveFileTransferString(Socket *socket, string &value) {
+	uint32 length = 0;
+	if(receiveFileTransferValue(socket, length) == false || length > FILE_TRANSFER_MAX_NAME_LENGTH) {
+		return false;
+	}
+	vector<char> data(length + 1, 0);
+	if(receiveFileTransferData(socket, &data[0], length) == false) {
+		return false;
+	}
+	value.assign(&data[0], length);
+	return true;
+}
 
 FileTransferSocketThread::FileTransferSocketThread(FileTransferInfo fileInfo) : info(fileInfo) {
     this->info.serverPort += 100;
+    if(this->info.fileNames.empty() == true && this->info.fileName != "") {
+    	this->info.fileNames.push_back(this->info.fileName);
+    }
+    this->compressionLevel = Config::getInstance().getInt("FileTransferCompressionLevel","5");
 }
 
 void FileTransferSocketThread::execute()
@@ -386,163 +565,393 @@ void FileTransferSocketThread::execute()
         ServerSocket serverSocket;
         serverSocket.bind(this->info.serverPort);
         serverSocket.listen(1);
-        Socket *clientSocket = serverSocket.accept();
-
-        char data[513]="";
-        memset(data, 0, 256);
-
-        clientSocket->receive(data,256, true);
-        if(*data == SEND_FILE)
-        {
-            FileInfo file;
-
-            memcpy(&file, data+1, sizeof(file));
-
-            *data=ACK;
-            clientSocket->send(data,256);
-
-            Checksum checksum;
-            checksum.addFile(file.fileName);
-            file.filecrc  = checksum.getSum();
-
-            ifstream infile(file.fileName.c_str(), ios::in | ios::binary | ios::ate);
-            if(infile.is_open() == true)
-            {
-                file.filesize = infile.tellg();
-                infile.seekg (0, ios::beg);
-
-                memset(data, 0, 256);
-                *data=SEND_FILE;
-                memcpy(data+1,&file,sizeof(file));
-
-                clientSocket->send(data,256);
-                clientSocket->receive(data,256, true);
-                if(*data != ACK) {
-                   //transfer error
-                }
-
-                int remain=file.filesize % 512 ;
-                int packs=(file.filesize-remain)/512;
-
-                while(packs--)
-                {
-                    infile.read(data,512);
-                    //if(!ReadFile(file,data,512,&read,NULL))
-                    //    ; //read error
-                    //if(written!=pack)
-                    //    ; //read error
-                    clientSocket->send(data,512);
-                    clientSocket->receive(data,256, true);
-                    if(*data!=ACK) {
-                           //transfer error
-                    }
-                }
-
-                infile.read(data,remain);
-                //if(!ReadFile(file,data,remain,&read,NULL))
-                //   ; //read error
-                //if(written!=pack)
-                //   ; //read error
-
-                clientSocket->send(data,remain);
-                clientSocket->receive(data,256, true);
-                if(*data!=ACK) {
-                   //transfer error
-                }
-
-                infile.close();
-            }
+
+        // a client whose transfer broke reconnects to resume
+        std::vector<string> pendingFiles = this->info.fileNames;
+        for(int attempt = 0; attempt < FILE_TRANSFER_MAX_ATTEMPTS && pendingFiles.empty() == false; ++attempt) {
+        	Chrono chrono;
+        	chrono.start();
+        	while(serverSocket.isReadable() == false &&
+        		chrono.getMillis() < FILE_TRANSFER_ACCEPT_TIMEOUT_MILLISECONDS) {
+        		sleep(10);
+        	}
+        	if(serverSocket.isReadable() == false) {
+        		break;
+        	}
+
+        	Socket *clientSocket = serverSocket.accept(false);
+        	if(clientSocket == NULL) {
+        		continue;
+        	}
+        	serveFiles(clientSocket, pendingFiles);
+        	delete clientSocket;
         }
 
-        delete clientSocket;
+        if(pendingFiles.empty() == false) {
+        	if(SystemFlags::getSystemSettingType(SystemFlags::debugError).enabled) SystemFlags::OutputDebug(SystemFlags::debugError,"In [%s::%s Line: %d] %d file(s) not confirmed by the client\n",__FILE__,__FUNCTION__,__LINE__,(int)pendingFiles.size());
+        }
     }
     else
     {
-        Ip ip(this->info.serverIP);
-        ClientSocket clientSocket;
-        clientSocket.connect(this->info.serverIP, this->info.serverPort);
-
-        if(clientSocket.isConnected() == true)
-        {
-            FileInfo file;
-            file.fileName = this->info.fileName;
-            //file.filesize =
-            //file.filecrc  = this->info.
-
-            string path = extractDirectoryPathFromFile(file.fileName);
-            createDirectoryPaths(path);
-            ofstream outFile(file.fileName.c_str(), ios_base::binary | ios_base::out);
-            if(outFile.is_open() == true)
-            {
-                char data[513]="";
-                memset(data, 0, 256);
-                *data=SEND_FILE;
-                memcpy(data+1,&file,sizeof(file));
-
-                clientSocket.send(data,256);
-                clientSocket.receive(data,256, true);
-                if(*data!=ACK) {
-                  //transfer error
-                }
-
-                clientSocket.receive(data,256,true);
-                if(*data == SEND_FILE)
-                {
-                   memcpy(&file, data+1, sizeof(file));
-                   *data=ACK;
-                   clientSocket.send(data,256);
-
-                   int remain = file.filesize % 512 ;
-                   int packs  = (file.filesize-remain) / 512;
-
-                   while(packs--)
-                   {
-                      clientSocket.receive(data,512,true);
-
-                      outFile.write(data, 512);
-                      if(outFile.bad())
-                      {
-                          //int ii = 0;
-                      }
-                      //if(!WriteFile(file,data,512,&written,NULL))
-                      //   ; //write error
-                      //if(written != pack)
-                      //   ; //write error
-                      *data=ACK;
-                      clientSocket.send(data,256);
-                    }
-                    clientSocket.receive(data,remain,true);
-
-                    outFile.write(data, remain);
-                    if(outFile.bad())
-                    {
-                        //int ii = 0;
-                    }
-
-                    //if(!WriteFile(file,data,remain,&written,NULL))
-                    //    ; //write error
-                    //if(written!=pack)
-                    //    ; //write error
-                    *data=ACK;
-                    clientSocket.send(data,256);
-
-                    Checksum checksum;
-                    checksum.addFile(file.fileName);
-                    uint32 crc = checksum.getSum();
-                    if(file.filecrc != crc)
-                    {
-                        //int ii = 0;
-                    }
-
-                    //if(calc_crc(file)!=info.crc)
-                    //   ; //transfeer error
-                }
-
-                outFile.close();
-            }
+    	std::vector<string> remainingFiles = this->info.fileNames;
+        for(int attempt = 0; attempt < FILE_TRANSFER_MAX_ATTEMPTS && remainingFiles.empty() == false; ++attempt) {
+        	if(attempt > 0) {
+        		sleep(FILE_TRANSFER_RETRY_MILLISECONDS);
+        	}
+
+        	ClientSocket clientSocket;
+        	try {
+        		clientSocket.connect(Ip(this->info.serverIP), this->info.serverPort);
+        	}
+        	catch(const exception &ex) {
+        		if(SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled) SystemFlags::OutputDebug(SystemFlags::debugNetwork,"In [%s::%s Line: %d] attempt %d connect failed: %s\n",__FILE__,__FUNCTION__,__LINE__,attempt,ex.what());
+        		continue;
+        	}
+
+        	if(clientSocket.isConnected() == true) {
+        		receiveFiles(&clientSocket, remainingFiles);
+        	}
+        }
+
+        if(remainingFiles.empty() == false) {
+        	if(SystemFlags::getSystemSettingType(SystemFlags::debugError).enabled) SystemFlags::OutputDebug(SystemFlags::debugError,"In [%s::%s Line: %d] %d file(s) not transferred from [%s]\n",__FILE__,__FUNCTION__,__LINE__,(int)remainingFiles.size(),this->info.serverIP.c_str());
         }
     }
 }
 
+bool FileTransferSocketThread::serveFiles(Socket *socket, std::vector<string> &pendingFiles) {
+	uint32 magic = 0;
+	uint32 version = 0;
+	uint32 fileCount = 0;
+	if(receiveFileTransferValue(socket, magic) == false ||
+		receiveFileTransferValue(socket, version) == false ||
+		receiveFileTransferValue(socket, fileCount) == false ||
+		magic != FILE_TRANSFER_MAGIC || version != FILE_TRANSFER_VERSION ||
+		fileCount > FILE_TRANSFER_MAX_FILES) {
+		if(SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled) SystemFlags::OutputDebug(SystemFlags::debugNetwork,"In [%s::%s Line: %d] invalid request magic = %u version = %u fileCount = %u\n",__FILE__,__FUNCTION__,__LINE__,magic,version,fileCount);
+		return false;
+	}
+
+	std::vector<string> fileNames(fileCount);
+	std::vector<int64> resumeOffsets(fileCount, 0);
+	for(uint32 index = 0; index < fileCount; ++index) {
+		if(receiveFileTransferString(socket, fileNames[index]) == false ||
+			receiveFileTransferValue(socket, resumeOffsets[index]) == false) {
+			return false;
+		}
+	}
+
+	std::vector<FileTransferOutgoingFile> activeFiles;
+	uint32 nextFile = 0;
+	vector<unsigned char> buffer;
+	vector<unsigned char> chunk(FILE_TRANSFER_CHUNK_SIZE);
+	vector<unsigned char> compressed;
+	bool result = true;
+
+	while(result == true && (activeFiles.empty() == false || nextFile < fileCount)) {
+		// keep several files in flight so small files do not wait on large ones
+		while((int)activeFiles.size() < FILE_TRANSFER_FILES_IN_FLIGHT && nextFile < fileCount) {
+			uint32 index = nextFile++;
+			const string &fileName = fileNames[index];
+
+			FileTransferOutgoingFile file;
+			file.index = index;
+			file.fp = NULL;
+			file.size = 0;
+			file.offset = 0;
+			// only the files this transfer was started for
+			if(fileName.find("..") == string::npos &&
+				std::find(this->info.fileNames.begin(),this->info.fileNames.end(),fileName) != this->info.fileNames.end()) {
+#ifdef WIN32
+				file.fp = _wfopen(utf8_decode(fileName).c_str(), L"rb");
+#else
+				file.fp = fopen(fileName.c_str(), "rb");
+#endif
+			}
+			uint32 fileSum = 0;
+			if(file.fp != NULL) {
+				seekFileTransferFile(file.fp, 0, SEEK_END);
+				file.size = max((int64)0, tellFileTransferFile(file.fp));
+				file.offset = (resumeOffsets[index] >= 0 && resumeOffsets[index] <= file.size ? resumeOffsets[index] : 0);
+				if(seekFileTransferFile(file.fp, file.offset, SEEK_SET) == false) {
+					file.offset = 0;
+					seekFileTransferFile(file.fp, 0, SEEK_SET);
+				}
+				fileSum = Checksum::computeFileSum(fileName);
+			}
+
+			buffer.clear();
+			appendFileTransferValue<uint8>(buffer, ftmFileInfo);
+			appendFileTransferValue<uint32>(buffer, index);
+			appendFileTransferValue<uint8>(buffer, (file.fp != NULL ? 1 : 0));
+			appendFileTransferValue<int64>(buffer, file.size);
+			appendFileTransferValue<int64>(buffer, file.offset);
+			appendFileTransferValue<uint32>(buffer, fileSum);
+			if(sendFileTransferBuffer(socket, buffer) == false) {
+				result = false;
+			}
+			if(file.fp != NULL) {
+				activeFiles.push_back(file);
+			}
+		}
+
+		for(unsigned int active = 0; result == true && active < activeFiles.size();) {
+			FileTransferOutgoingFile &file = activeFiles[active];
+			buffer.clear();
+
+			uint32 rawSize = (uint32)min((int64)FILE_TRANSFER_CHUNK_SIZE, file.size - file.offset);
+			if(rawSize > 0) {
+				if(fread(&chunk[0], 1, rawSize, file.fp) != rawSize) {
+					rawSize = 0;
+					file.size = file.offset;
+				}
+			}
+			if(rawSize > 0) {
+				const unsigned char *payload = &chunk[0];
+				uint32 payloadSize = rawSize;
+				uint8 isCompressed = 0;
+				if(compressionLevel > 0 &&
+					compressBuffer(&chunk[0], rawSize, compressed, compressionLevel) == true &&
+					compressed.size() < rawSize) {
+					payload = &compressed[0];
+					payloadSize = (uint32)compressed.size();
+					isCompressed = 1;
+				}
+
+				appendFileTransferValue<uint8>(buffer, ftmChunk);
+				appendFileTransferValue<uint32>(buffer, file.index);
+				appendFileTransferValue<int64>(buffer, file.offset);
+				appendFileTransferValue<uint32>(buffer, rawSize);
+				appendFileTransferValue<uint32>(buffer, Checksum::crc32SliceBy8(0, &chunk[0], rawSize));
+				appendFileTransferValue<uint8>(buffer, isCompressed);
+				appendFileTransferValue<uint32>(buffer, payloadSize);
+				buffer.insert(buffer.end(), payload, payload + payloadSize);
+				file.offset += rawSize;
+			}
+
+			bool fileDone = (file.offset >= file.size);
+			if(fileDone == true) {
+				appendFileTransferValue<uint8>(buffer, ftmFileDone);
+				appendFileTransferValue<uint32>(buffer, file.index);
+			}
+			if(sendFileTransferBuffer(socket, buffer) == false) {
+				result = false;
+			}
+
+			if(fileDone == true) {
+				fclose(file.fp);
+				activeFiles.erase(activeFiles.begin() + active);
+			}
+			else {
+				++active;
+			}
+		}
+	}
+
+	for(unsigned int active = 0; active < activeFiles.size(); ++active) {
+		fclose(activeFiles[active].fp);
+	}
+
+	if(result == true) {
+		buffer.clear();
+		appendFileTransferValue<uint8>(buffer, ftmEnd);
+		result = sendFileTransferBuffer(socket, buffer);
+	}
+
+	// a file the client could not verify is asked for again when it reconnects,
+	// the status follows once the client worked through the buffered chunks
+	Chrono chrono;
+	chrono.start();
+	while(result == true && socket->isConnected() == true && socket->isReadable() == false &&
+		chrono.getMillis() < FILE_TRANSFER_ACCEPT_TIMEOUT_MILLISECONDS) {
+		sleep(10);
+	}
+	uint8 messageType = 0;
+	if(result == true &&
+		(receiveFileTransferValue(socket, messageType) == false || messageType != ftmFileStatus)) {
+		result = false;
+	}
+	for(uint32 index = 0; result == true && index < fileCount; ++index) {
+		uint8 received = 0;
+		if(receiveFileTransferValue(socket, received) == false) {
+			result = false;
+		}
+		else if(received != 0) {
+			pendingFiles.erase(std::remove(pendingFiles.begin(), pendingFiles.end(), fileNames[index]), pendingFiles.end());
+		}
+	}
+	return result;
+}
+
+bool FileTransferSocketThread::receiveFiles(Socket *socket, std::vector<string> &fileNames) {
+	vector<unsigned char> buffer;
+	appendFileTransferValue<uint32>(buffer, FILE_TRANSFER_MAGIC);
+	appendFileTransferValue<uint32>(buffer, FILE_TRANSFER_VERSION);
+	appendFileTransferValue<uint32>(buffer, (uint32)fileNames.size());
+	for(unsigned int index = 0; index < fileNames.size(); ++index) {
+		// whatever a previous attempt left behind passed its chunk CRCs
+		string partName = getFileTransferPartName(fileNames[index]);
+		int64 resumeOffset = (fileExists(partName) == true ? getFileTransferFileSize(partName) : 0);
+		appendFileTransferString(buffer, fileNames[index]);
+		appendFileTransferValue<int64>(buffer, resumeOffset);
+	}
+	if(sendFileTransferBuffer(socket, buffer) == false) {
+		return false;
+	}
+
+	std::vector<FileTransferIncomingFile> files(fileNames.size());
+	for(unsigned int index = 0; index < files.size(); ++index) {
+		files[index].fp = NULL;
+		files[index].offset = 0;
+		files[index].fileSum = 0;
+		files[index].finished = false;
+	}
+
+	vector<unsigned char> payload;
+	vector<unsigned char> chunk;
+	bool result = false;
+	for(;;) {
+		uint8 messageType = 0;
+		if(receiveFileTransferValue(socket, messageType) == false) {
+			break;
+		}
+
+		if(messageType == ftmEnd) {
+			buffer.clear();
+			appendFileTransferValue<uint8>(buffer, ftmFileStatus);
+			for(unsigned int index = 0; index < files.size(); ++index) {
+				appendFileTransferValue<uint8>(buffer, (files[index].finished == true && files[index].fp == NULL ? 1 : 0));
+			}
+			result = sendFileTransferBuffer(socket, buffer);
+			break;
+		}
+		else if(messageType == ftmFileInfo) {
+			uint32 index = 0;
+			uint8 exists = 0;
+			int64 size = 0;
+			int64 startOffset = 0;
+			uint32 fileSum = 0;
+			if(receiveFileTransferValue(socket, index) == false ||
+				receiveFileTransferValue(socket, exists) == false ||
+				receiveFileTransferValue(socket, size) == false ||
+				receiveFileTransferValue(socket, startOffset) == false ||
+				receiveFileTransferValue(socket, fileSum) == false ||
+				index >= files.size() || files[index].fp != NULL) {
+				break;
+			}
+			if(exists == 0) {
+				if(SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled) SystemFlags::OutputDebug(SystemFlags::debugNetwork,"In [%s::%s Line: %d] server does not have [%s]\n",__FILE__,__FUNCTION__,__LINE__,fileNames[index].c_str());
+				files[index].finished = true;
+				continue;
+			}
+
+			string partName = getFileTransferPartName(fileNames[index]);
+			createDirectoryPaths(extractDirectoryPathFromFile(fileNames[index]));
+#ifdef WIN32
+			FILE *fp = _wfopen(utf8_decode(partName).c_str(), (startOffset > 0 ? L"r+b" : L"wb"));
+#else
+			FILE *fp = fopen(partName.c_str(), (startOffset > 0 ? "r+b" : "wb"));
+#endif
+			if(fp == NULL) {
+				break;
+			}
+			if(seekFileTransferFile(fp, startOffset, SEEK_SET) == false) {
+				fclose(fp);
+				break;
+			}
+			files[index].fp = fp;
+			files[index].offset = startOffset;
+			files[index].fileSum = fileSum;
+		}
+		else if(messageType == ftmChunk) {
+			uint32 index = 0;
+			int64 offset = 0;
+			uint32 rawSize = 0;
+			uint32 chunkSum = 0;
+			uint8 isCompressed = 0;
+			uint32 payloadSize = 0;
+			if(receiveFileTransferValue(socket, index) == false ||
+				receiveFileTransferValue(socket, offset) == false ||
+				receiveFileTransferValue(socket, rawSize) == false ||
+				receiveFileTransferValue(socket, chunkSum) == false ||
+				receiveFileTransferValue(socket, isCompressed) == false ||
+				receiveFileTransferValue(socket, payloadSize) == false ||
+				index >= files.size() || files[index].fp == NULL ||
+				offset != files[index].offset ||
+				rawSize > FILE_TRANSFER_CHUNK_SIZE || payloadSize > FILE_TRANSFER_CHUNK_SIZE) {
+				break;
+			}
+
+			payload.resize(payloadSize);
+			if(payloadSize > 0 && receiveFileTransferData(socket, &payload[0], payloadSize) == false) {
+				break;
+			}
+			const unsigned char *data = (payloadSize > 0 ? &payload[0] : NULL);
+			if(isCompressed != 0) {
+				if(uncompressBuffer(&payload[0], payloadSize, chunk, rawSize) == false) {
+					break;
+				}
+				data = (rawSize > 0 ? &chunk[0] : NULL);
+			}
+			else if(payloadSize != rawSize) {
+				break;
+			}
+
+			// a bad chunk ends this attempt, the next one resumes before it
+			if(Checksum::crc32SliceBy8(0, data, rawSize) != chunkSum) {
+				if(SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled) SystemFlags::OutputDebug(SystemFlags::debugNetwork,"In [%s::%s Line: %d] bad chunk CRC for [%s] at offset %lld\n",__FILE__,__FUNCTION__,__LINE__,fileNames[index].c_str(),(long long)offset);
+				break;
+			}
+			if(fwrite(data, 1, rawSize, files[index].fp) != rawSize || fflush(files[index].fp) != 0) {
+				break;
+			}
+			files[index].offset += rawSize;
+		}
+		else if(messageType == ftmFileDone) {
+			uint32 index = 0;
+			if(receiveFileTransferValue(socket, index) == false ||
+				index >= files.size() || files[index].fp == NULL) {
+				break;
+			}
+			fclose(files[index].fp);
+			files[index].fp = NULL;
+			files[index].finished = true;
+
+			const string &fileName = fileNames[index];
+			string partName = getFileTransferPartName(fileName);
+			removeFile(fileName);
+			renameFile(partName, fileName);
+			Checksum::removeFileFromCache(fileName);
+
+			uint32 fileSum = Checksum::computeFileSum(fileName);
+			if(fileSum != files[index].fileSum) {
+				// the part came from an older version of the file, start over
+				if(SystemFlags::getSystemSettingType(SystemFlags::debugError).enabled) SystemFlags::OutputDebug(SystemFlags::debugError,"In [%s::%s Line: %d] CRC mismatch for [%s] local = %u remote = %u\n",__FILE__,__FUNCTION__,__LINE__,fileName.c_str(),fileSum,files[index].fileSum);
+				removeFile(fileName);
+				files[index].finished = false;
+			}
+		}
+		else {
+			break;
+		}
+	}
+
+	for(unsigned int index = 0; index < files.size(); ++index) {
+		if(files[index].fp != NULL) {
+			fclose(files[index].fp);
+		}
+	}
+
+	std::vector<string> remainingFiles;
+	for(unsigned int index = 0; index < files.size(); ++index) {
+		if(files[index].finished == false) {
+			remainingFiles.push_back(fileNames[index]);
+		}
+	}
+	fileNames = remainingFiles;
+
+	return result;
+}
+
 
 }}//end namespace
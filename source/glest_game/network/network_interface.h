@@ -202,6 +202,14 @@ protected:
 	Mutex *networkPlayerFactionCRCMutex;
 	uint32 networkPlayerFactionCRC[GameConstants::maxPlayers];
 
+	// reused for packing every message sent on this connection
+	Mutex *sendBufferMutex;
+	std::vector<unsigned char> sendBuffer;
+
+	bool compactCommandList;
+	CommandListWireState commandListSendState;
+	CommandListWireState commandListReceiveState;
+
 public:
 	static const int readyWaitTimeout;
 	GameSettings gameSettings;
@@ -237,6 +245,13 @@ public:
 	NetworkMessageType getNextMessageType(int waitMilliseconds=0);
 	bool receiveMessage(NetworkMessage* networkMessage);
 
+	// Command lists are sent in the compact format once both sides agreed on
+	// it in the intro, enabling it restarts the delta encoding
+	bool getCompactCommandList() const	{ return compactCommandList; }
+	void setCompactCommandList(bool value);
+	// Bitmask of NetworkMessageFeatureType this side offers in its intro
+	static uint32 getSupportedNetworkFeatures();
+
 	virtual bool isConnected();
 
 	const virtual GameSettings * getGameSettings() { return &gameSettings; }
@@ -368,6 +383,7 @@ private:
         serverPort  = obj.serverPort;
         opType      = obj.opType;
         fileName    = obj.fileName;
+        fileNames   = obj.fileNames;
     }
 
 public:
@@ -394,20 +410,20 @@ public:
     int32  serverPort;
     FileTransferOperationType opType;
     string fileName;
-};
-
-class FileInfo
-{
-public:
-    string fileName;
-    int64 filesize;
-    uint32 filecrc;
+    // all files moved over one connection, fileName alone if empty
+    std::vector<string> fileNames;
 };
 
 class FileTransferSocketThread : public Thread
 {
 private:
     FileTransferInfo info;
+    int compressionLevel;
+
+    // removes the files the client confirmed from pendingFiles
+    bool serveFiles(Socket *socket, std::vector<string> &pendingFiles);
+    // removes the files that arrived intact from fileNames
+    bool receiveFiles(Socket *socket, std::vector<string> &fileNames);
 
 public:
     FileTransferSocketThread(FileTransferInfo fileInfo);
@@ -38,11 +38,107 @@ Chrono NetworkMessage::statsTimer;
 Chrono NetworkMessage::lastSend;
 Chrono NetworkMessage::lastRecv;
 std::map<NetworkMessageStatisticType,int64> NetworkMessage::mapMessageStats;
+int64 NetworkMessage::messageTypeSendCount[nmtCount];
+int64 NetworkMessage::messageTypeSendBytes[nmtCount];
+int64 NetworkMessage::messageTypePackAllocations[nmtCount];
 
 // =====================================================
 //	class NetworkMessage
 // =====================================================
 
+NetworkMessage::NetworkMessage() {
+	packTarget 				= NULL;
+	packTargetOffset 		= 0;
+	packScratchBufferGrew 	= false;
+	sharedPacking 			= false;
+	sharedPackedBufferValid = false;
+}
+
+void NetworkMessage::packInto(std::vector<unsigned char> &buf) {
+	size_t capacity = buf.capacity();
+	buf.clear();
+
+	// send() writes into buf instead of the socket while packTarget is set
+	packTarget = &buf;
+	try {
+		send(NULL);
+	}
+	catch(...) {
+		packTarget = NULL;
+		throw;
+	}
+	packTarget = NULL;
+
+	if(buf.empty() == false) {
+		addPackStats(buf[0], buf.capacity() != capacity);
+	}
+}
+
+unsigned char * NetworkMessage::getPackBuffer(size_t size) {
+	if(packTarget != NULL) {
+		packTargetOffset = packTarget->size();
+		packTarget->resize(packTargetOffset + size);
+		return &(*packTarget)[packTargetOffset];
+	}
+
+	if(packScratchBuffer.size() < size) {
+		size_t capacity = packScratchBuffer.capacity();
+		packScratchBuffer.resize(size);
+		packScratchBufferGrew = (packScratchBuffer.capacity() != capacity);
+	}
+	return &packScratchBuffer[0];
+}
+
+void NetworkMessage::sendPackBuffer(Socket* socket, unsigned char *buf, int dataSize) {
+	if(packTarget != NULL) {
+		// already in place, drop the slack getPackBuffer was asked for
+		packTarget->resize(packTargetOffset + dataSize);
+		return;
+	}
+
+	if(packScratchBufferGrew == true) {
+		packScratchBufferGrew = false;
+		addPackStats(buf[0], true);
+	}
+	NetworkMessage::send(socket, buf, dataSize);
+}
+
+void NetworkMessage::setSharedPacking(bool value) {
+	sharedPacking 			= value;
+	sharedPackedBufferValid = false;
+}
+
+const std::vector<unsigned char> & NetworkMessage::getSharedPackedBuffer() {
+	if(sharedPackedBufferValid == false) {
+		packInto(sharedPackedBuffer);
+		sharedPackedBufferValid = true;
+	}
+	return sharedPackedBuffer;
+}
+
+void NetworkMessage::sendPacked(Socket* socket, const std::vector<unsigned char> &buf) {
+	if(buf.empty() == true) {
+		return;
+	}
+	addSendStats(buf[0], (int)buf.size());
+	NetworkMessage::send(socket, &buf[0], (int)buf.size());
+}
+
+void NetworkMessage::addPackStats(int8 messageType, bool allocated) {
+	if(allocated == true && messageType >= 0 && messageType < nmtCount) {
+		MutexSafeWrapper safeMutex(NetworkMessage::mutexMessageStats.get());
+		messageTypePackAllocations[messageType]++;
+	}
+}
+
+void NetworkMessage::addSendStats(int8 messageType, int dataSize) {
+	if(messageType >= 0 && messageType < nmtCount) {
+		MutexSafeWrapper safeMutex(NetworkMessage::mutexMessageStats.get());
+		messageTypeSendCount[messageType]++;
+		messageTypeSendBytes[messageType] += dataSize;
+	}
+}
+
 bool NetworkMessage::receive(Socket* socket, void* data, int dataSize, bool tryReceiveUntilDataSizeMet) {
 	if(socket != NULL) {
 		int dataReceived = socket->receive(data, dataSize, tryReceiveUntilDataSizeMet);
@@ -69,6 +165,12 @@ bool NetworkMessage::receive(Socket* socket, void* data, int dataSize, bool tryR
 }
 
 void NetworkMessage::send(Socket* socket, const void* data, int dataSize) {
+	if(packTarget != NULL) {
+		const unsigned char *bytes = static_cast<const unsigned char *>(data);
+		packTarget->insert(packTarget->end(), bytes, bytes + dataSize);
+		return;
+	}
+
 	if(SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled) SystemFlags::OutputDebug(SystemFlags::debugNetwork,"In [%s::%s Line: %d] socket = %p, data = %p, dataSize = %d\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,socket,data,dataSize);
 
 	if(socket != NULL) {
@@ -92,6 +194,13 @@ void NetworkMessage::resetNetworkPacketStats() {
 	NetworkMessage::lastSend.stop();
 	NetworkMessage::lastRecv.stop();
 	NetworkMessage::mapMessageStats.clear();
+
+	MutexSafeWrapper safeMutex(NetworkMessage::mutexMessageStats.get());
+	for(int index = 0; index < nmtCount; ++index) {
+		messageTypeSendCount[index] 		= 0;
+		messageTypeSendBytes[index] 		= 0;
+		messageTypePackAllocations[index] 	= 0;
+	}
 }
 
 string  NetworkMessage::getNetworkPacketStats() {
@@ -122,6 +231,16 @@ string  NetworkMessage::getNetworkPacketStats() {
 
 		}
 	}
+
+	MutexSafeWrapper safeMutex(NetworkMessage::mutexMessageStats.get());
+	for(int index = 0; index < nmtCount; ++index) {
+		if(messageTypeSendCount[index] > 0 || messageTypePackAllocations[index] > 0) {
+			result += "message type " + intToStr(index) +
+					  " sent: " + intToStr(messageTypeSendCount[index]) +
+					  " bytes: " + intToStr(messageTypeSendBytes[index]) +
+					  " pack allocations: " + intToStr(messageTypePackAllocations[index]) + "\n";
+		}
+	}
 	return result;
 }
 
@@ -255,6 +374,7 @@ NetworkMessageIntro::NetworkMessageIntro() {
 	data.externalIp = 0;
 	data.ftpPort = 0;
 	data.gameInProgress = 0;
+	data.features = 0;
 }
 
 NetworkMessageIntro::NetworkMessageIntro(int32 sessionId,const string &versionString,
@@ -264,7 +384,7 @@ NetworkMessageIntro::NetworkMessageIntro(int32 sessionId,const string &versionSt
 										uint32 ftpPort,
 										const string &playerLanguage,
 										int gameInProgress, const string &playerUUID,
-										const string &platform) {
+										const string &platform, uint32 features) {
 	data.messageType	= nmtIntro;
 	data.sessionId		= sessionId;
 	data.versionString	= versionString;
@@ -277,10 +397,11 @@ NetworkMessageIntro::NetworkMessageIntro(int32 sessionId,const string &versionSt
 	data.gameInProgress = gameInProgress;
 	data.playerUUID		= playerUUID;
 	data.platform		= platform;
+	data.features		= features;
 }
 
 const char * NetworkMessageIntro::getPackedMessageFormat() const {
-	return "cl128s32shcLL60sc60s60s";
+	return "cl128s32shcLL60sc60s60sL";
 }
 
 unsigned int NetworkMessageIntro::getPackedSize() {
@@ -294,6 +415,7 @@ unsigned int NetworkMessageIntro::getPackedSize() {
 		packedData.messageType = nmtIntro;
 		packedData.playerIndex = 0;
 		packedData.sessionId = 0;
+		packedData.features = 0;
 
 		unsigned char *buf = new unsigned char[sizeof(packedData)*3];
 		result = pack(buf, getPackedMessageFormat(),
@@ -308,7 +430,8 @@ unsigned int NetworkMessageIntro::getPackedSize() {
 				packedData.language.getBuffer(),
 				data.gameInProgress,
 				packedData.playerUUID.getBuffer(),
-				packedData.platform.getBuffer());
+				packedData.platform.getBuffer(),
+				packedData.features);
 		delete [] buf;
 	}
 	return result;
@@ -327,12 +450,13 @@ void NetworkMessageIntro::unpackMessage(unsigned char *buf) {
 			data.language.getBuffer(),
 			&data.gameInProgress,
 			data.playerUUID.getBuffer(),
-			data.platform.getBuffer());
+			data.platform.getBuffer(),
+			&data.features);
 	if(SystemFlags::VERBOSE_MODE_ENABLED) printf("In [%s] unpacked data:\n%s\n",__FUNCTION__,this->toString().c_str());
 }
 
 unsigned char * NetworkMessageIntro::packMessage() {
-	unsigned char *buf = new unsigned char[getPackedSize()+1];
+	unsigned char *buf = getPackBuffer(getPackedSize()+1);
 
 	if(SystemFlags::VERBOSE_MODE_ENABLED) printf("\nIn [%s] about to pack...\n",__FUNCTION__);
 	pack(buf, getPackedMessageFormat(),
@@ -347,7 +471,8 @@ unsigned char * NetworkMessageIntro::packMessage() {
 			data.language.getBuffer(),
 			data.gameInProgress,
 			data.playerUUID.getBuffer(),
-			data.platform.getBuffer());
+			data.platform.getBuffer(),
+			data.features);
 	return buf;
 }
 
@@ -364,6 +489,7 @@ string NetworkMessageIntro::toString() const {
 	result += " gameInProgress = " + uIntToStr(data.gameInProgress);
 	result += " playerUUID = " + data.playerUUID.getString();
 	result += " platform = " + data.platform.getString();
+	result += " features = " + uIntToStr(data.features);
 
 	return result;
 }
@@ -404,8 +530,7 @@ void NetworkMessageIntro::send(Socket* socket) {
 		unsigned char *buf = packMessage();
 		//printf("Send packet size = %u data.messageType = %d\n[%s]\n",getPackedSize(),data.messageType,buf);
 		//NetworkMessage::send(socket, &data, sizeof(data));
-		NetworkMessage::send(socket, buf, getPackedSize());
-		delete [] buf;
+		sendPackBuffer(socket, buf, getPackedSize());
 	}
 }
 
@@ -420,6 +545,7 @@ void NetworkMessageIntro::toEndian() {
 		data.ftpPort = Shared::PlatformByteOrder::toCommonEndian(data.ftpPort);
 
 		data.gameInProgress = Shared::PlatformByteOrder::toCommonEndian(data.gameInProgress);
+		data.features = Shared::PlatformByteOrder::toCommonEndian(data.features);
 	}
 }
 void NetworkMessageIntro::fromEndian() {
@@ -433,6 +559,7 @@ void NetworkMessageIntro::fromEndian() {
 		data.ftpPort = Shared::PlatformByteOrder::fromCommonEndian(data.ftpPort);
 
 		data.gameInProgress = Shared::PlatformByteOrder::fromCommonEndian(data.gameInProgress);
+		data.features = Shared::PlatformByteOrder::fromCommonEndian(data.features);
 	}
 }
 
@@ -482,7 +609,7 @@ void NetworkMessagePing::unpackMessage(unsigned char *buf) {
 }
 
 unsigned char * NetworkMessagePing::packMessage() {
-	unsigned char *buf = new unsigned char[getPackedSize()+1];
+	unsigned char *buf = getPackBuffer(getPackedSize()+1);
 	pack(buf, getPackedMessageFormat(),
 			data.messageType,
 			data.pingFrequency,
@@ -520,8 +647,7 @@ void NetworkMessagePing::send(Socket* socket) {
 		unsigned char *buf = packMessage();
 		//printf("Send packet size = %u data.messageType = %d\n[%s]\n",getPackedSize(),data.messageType,buf);
 		//NetworkMessage::send(socket, &data, sizeof(data));
-		NetworkMessage::send(socket, buf, getPackedSize());
-		delete [] buf;
+		sendPackBuffer(socket, buf, getPackedSize());
 	}
 }
 
@@ -581,7 +707,7 @@ void NetworkMessageReady::unpackMessage(unsigned char *buf) {
 }
 
 unsigned char * NetworkMessageReady::packMessage() {
-	unsigned char *buf = new unsigned char[getPackedSize()+1];
+	unsigned char *buf = getPackBuffer(getPackedSize()+1);
 	pack(buf, getPackedMessageFormat(),
 			data.messageType,
 			data.checksum);
@@ -616,8 +742,7 @@ void NetworkMessageReady::send(Socket* socket) {
 	else {
 		unsigned char *buf = packMessage();
 		//printf("Send packet size = %u data.messageType = %d\n[%s]\n",getPackedSize(),data.messageType,buf);
-		NetworkMessage::send(socket, buf, getPackedSize());
-		delete [] buf;
+		sendPackBuffer(socket, buf, getPackedSize());
 	}
 }
 
@@ -1137,7 +1262,7 @@ void NetworkMessageLaunch::unpackMessage(unsigned char *buf) {
 }
 
 unsigned char * NetworkMessageLaunch::packMessage() {
-	unsigned char *buf = new unsigned char[getPackedSize()+1];
+	unsigned char *buf = getPackBuffer(getPackedSize()+1);
 	pack(buf, getPackedMessageFormat(),
 			data.messageType,
 			data.description.getBuffer(),
@@ -1354,8 +1479,7 @@ void NetworkMessageLaunch::send(Socket* socket) {
 	else {
 		unsigned char *buf = packMessage();
 		//printf("Send packet size = %u data.messageType = %d\n[%s]\n",getPackedSize(),data.messageType,buf);
-		NetworkMessage::send(socket, buf, getPackedSize());
-		delete [] buf;
+		sendPackBuffer(socket, buf, getPackedSize());
 	}
 }
 
@@ -1498,7 +1622,7 @@ void NetworkMessageCommandList::unpackMessageHeader(unsigned char *buf) {
 }
 
 unsigned char * NetworkMessageCommandList::packMessageHeader() {
-	unsigned char *buf = new unsigned char[getPackedSizeHeader()+1];
+	unsigned char *buf = getPackBuffer(getPackedSizeHeader()+1);
 	pack(buf, getPackedMessageFormatHeader(),
 			data.header.messageType,
 			data.header.commandCount,
@@ -1573,7 +1697,7 @@ void NetworkMessageCommandList::unpackMessageDetail(unsigned char *buf,int count
 
 unsigned char * NetworkMessageCommandList::packMessageDetail(uint16 totalCommand) {
 	int packetSize = getPackedSizeDetail(totalCommand) +1;
-	unsigned char *buf = new unsigned char[packetSize];
+	unsigned char *buf = getPackBuffer(packetSize);
 	unsigned char *bufMove = buf;
 	//unsigned int bytes_processed_total = 0;
 	for(unsigned int i = 0; i < totalCommand; ++i) {
@@ -1689,8 +1813,7 @@ void NetworkMessageCommandList::send(Socket* socket) {
 		//NetworkMessage::send(socket, &data.header, commandListHeaderSize);
 		buf = packMessageHeader();
 		//if(totalCommand) printf("\n\nSend packet size = %u data.messageType = %d\n%s\ncommandcount [%u] framecount [%d]\n",getPackedSizeHeader(),data.header.messageType,buf,totalCommand,data.header.frameCount);
-		NetworkMessage::send(socket, buf, getPackedSizeHeader());
-		delete [] buf;
+		sendPackBuffer(socket, buf, getPackedSizeHeader());
 	}
 
 	if(totalCommand > 0) {
@@ -1709,9 +1832,8 @@ void NetworkMessageCommandList::send(Socket* socket) {
 			buf = packMessageDetail(totalCommand);
 			//printf("\n#4 Send packet commandcount [%u] framecount [%d]\n",totalCommand,data.header.frameCount);
 			//printf("Send packet size = %u data.messageType = %d\n[%s]\n",getPackedSize(),data.messageType,buf);
-			NetworkMessage::send(socket, buf, getPackedSizeDetail(totalCommand));
+			sendPackBuffer(socket, buf, getPackedSizeDetail(totalCommand));
 			//printf("\n#5 Send packet commandcount [%u] framecount [%d]\n",totalCommand,data.header.frameCount);
-			delete [] buf;
 			//printf("\n#6 Send packet commandcount [%u] framecount [%d]\n",totalCommand,data.header.frameCount);
 
 	//        for(int idx = 0 ; idx < totalCommand; ++idx) {
@@ -1785,6 +1907,274 @@ void NetworkMessageCommandList::fromEndianDetail() {
 	}
 }
 
+// Compact command lists are a 5 byte header (message type and payload size)
+// followed by a payload of zigzag varints. The frame count is relative to the
+// previous message, faction CRCs are only sent when they changed and each
+// command only carries the fields that differ from the command before it.
+static const int compactCommandListHeaderSize = 5;
+static const uint32 compactCommandListMaxPayloadSize = 1024 * 1024;
+static const int8 compactCommandListHasCRCs = 0x01;
+static const int compactCommandFieldCount = 14;
+
+static void appendVarInt(std::vector<unsigned char> &buf, uint64 value) {
+	while(value >= 0x80) {
+		buf.push_back((unsigned char)(value | 0x80));
+		value >>= 7;
+	}
+	buf.push_back((unsigned char)value);
+}
+
+static void appendZigZag(std::vector<unsigned char> &buf, int64 value) {
+	appendVarInt(buf, ((uint64)value << 1) ^ (uint64)(value >> 63));
+}
+
+static void appendUInt32(std::vector<unsigned char> &buf, uint32 value) {
+	for(int shift = 0; shift < 32; shift += 8) {
+		buf.push_back((unsigned char)(value >> shift));
+	}
+}
+
+static bool readVarInt(const std::vector<unsigned char> &buf, unsigned int &offset, uint64 &value) {
+	value = 0;
+	for(int shift = 0; shift < 64 && offset < buf.size(); shift += 7) {
+		unsigned char byte = buf[offset++];
+		value |= (uint64)(byte & 0x7F) << shift;
+		if((byte & 0x80) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static bool readZigZag(const std::vector<unsigned char> &buf, unsigned int &offset, int64 &value) {
+	uint64 encoded = 0;
+	if(readVarInt(buf, offset, encoded) == false) {
+		return false;
+	}
+	value = (int64)(encoded >> 1) ^ -(int64)(encoded & 1);
+	return true;
+}
+
+static bool readUInt32(const std::vector<unsigned char> &buf, unsigned int &offset, uint32 &value) {
+	if(offset + 4 > buf.size()) {
+		return false;
+	}
+	value = 0;
+	for(int shift = 0; shift < 32; shift += 8) {
+		value |= (uint32)buf[offset++] << shift;
+	}
+	return true;
+}
+
+static void getCommandFields(const NetworkCommand &cmd, int64 fields[compactCommandFieldCount]) {
+	fields[0]  = cmd.networkCommandType;
+	fields[1]  = cmd.unitId;
+	fields[2]  = cmd.unitTypeId;
+	fields[3]  = cmd.commandTypeId;
+	fields[4]  = cmd.positionX;
+	fields[5]  = cmd.positionY;
+	fields[6]  = cmd.targetId;
+	fields[7]  = cmd.wantQueue;
+	fields[8]  = cmd.fromFactionIndex;
+	fields[9]  = cmd.unitFactionUnitCount;
+	fields[10] = cmd.unitFactionIndex;
+	fields[11] = cmd.commandStateType;
+	fields[12] = cmd.commandStateValue;
+	fields[13] = cmd.unitCommandGroupId;
+}
+
+static void setCommandFields(NetworkCommand &cmd, const int64 fields[compactCommandFieldCount]) {
+	cmd.networkCommandType 		= (int16)fields[0];
+	cmd.unitId 					= (int32)fields[1];
+	cmd.unitTypeId 				= (int16)fields[2];
+	cmd.commandTypeId 			= (int16)fields[3];
+	cmd.positionX 				= (int16)fields[4];
+	cmd.positionY 				= (int16)fields[5];
+	cmd.targetId 				= (int32)fields[6];
+	cmd.wantQueue 				= (int8)fields[7];
+	cmd.fromFactionIndex 		= (int8)fields[8];
+	cmd.unitFactionUnitCount 	= (uint16)fields[9];
+	cmd.unitFactionIndex 		= (int8)fields[10];
+	cmd.commandStateType 		= (int8)fields[11];
+	cmd.commandStateValue 		= (int32)fields[12];
+	cmd.unitCommandGroupId 		= (int32)fields[13];
+}
+
+void NetworkMessageCommandList::encodeCompact(std::vector<unsigned char> &buf, CommandListWireState &state) const {
+	buf.clear();
+	buf.resize(compactCommandListHeaderSize);
+
+	int crcChangedMask = 0;
+	for(int index = 0; index < GameConstants::maxPlayers; ++index) {
+		if(data.header.networkPlayerFactionCRC[index] != state.networkPlayerFactionCRC[index]) {
+			crcChangedMask |= (1 << index);
+		}
+	}
+
+	buf.push_back(crcChangedMask != 0 ? compactCommandListHasCRCs : 0);
+	appendZigZag(buf, (int64)data.header.frameCount - state.frameCount);
+	state.frameCount = data.header.frameCount;
+
+	if(crcChangedMask != 0) {
+		appendVarInt(buf, crcChangedMask);
+		for(int index = 0; index < GameConstants::maxPlayers; ++index) {
+			if((crcChangedMask & (1 << index)) != 0) {
+				appendUInt32(buf, data.header.networkPlayerFactionCRC[index]);
+				state.networkPlayerFactionCRC[index] = data.header.networkPlayerFactionCRC[index];
+			}
+		}
+	}
+
+	appendVarInt(buf, data.header.commandCount);
+	int64 lastFields[compactCommandFieldCount];
+	int64 fields[compactCommandFieldCount];
+	getCommandFields(state.lastCommand, lastFields);
+	for(int idx = 0; idx < data.header.commandCount; ++idx) {
+		const NetworkCommand &cmd = data.commands[idx];
+		getCommandFields(cmd, fields);
+
+		int changedMask = 0;
+		for(int field = 0; field < compactCommandFieldCount; ++field) {
+			if(fields[field] != lastFields[field]) {
+				changedMask |= (1 << field);
+			}
+		}
+		appendVarInt(buf, changedMask);
+		for(int field = 0; field < compactCommandFieldCount; ++field) {
+			if((changedMask & (1 << field)) != 0) {
+				appendZigZag(buf, fields[field] - lastFields[field]);
+				lastFields[field] = fields[field];
+			}
+		}
+		state.lastCommand = cmd;
+	}
+
+	uint32 payloadSize = (uint32)buf.size() - compactCommandListHeaderSize;
+	buf[0] = nmtCommandListCompact;
+	for(int index = 0; index < 4; ++index) {
+		buf[1 + index] = (unsigned char)(payloadSize >> (index * 8));
+	}
+}
+
+bool NetworkMessageCommandList::decodeCompact(const std::vector<unsigned char> &buf, CommandListWireState &state) {
+	unsigned int offset = 0;
+	if(offset >= buf.size()) {
+		return false;
+	}
+	int8 flags = buf[offset++];
+
+	int64 frameDelta = 0;
+	if(readZigZag(buf, offset, frameDelta) == false) {
+		return false;
+	}
+	state.frameCount = (int32)(state.frameCount + frameDelta);
+
+	if((flags & compactCommandListHasCRCs) != 0) {
+		uint64 crcChangedMask = 0;
+		if(readVarInt(buf, offset, crcChangedMask) == false) {
+			return false;
+		}
+		for(int index = 0; index < GameConstants::maxPlayers; ++index) {
+			if((crcChangedMask & ((uint64)1 << index)) != 0) {
+				if(readUInt32(buf, offset, state.networkPlayerFactionCRC[index]) == false) {
+					return false;
+				}
+			}
+		}
+	}
+
+	uint64 commandCount = 0;
+	if(readVarInt(buf, offset, commandCount) == false || commandCount > 0xFFFF) {
+		return false;
+	}
+
+	data.header.messageType = nmtCommandList;
+	data.header.frameCount = state.frameCount;
+	data.header.commandCount = (uint16)commandCount;
+	for(int index = 0; index < GameConstants::maxPlayers; ++index) {
+		data.header.networkPlayerFactionCRC[index] = state.networkPlayerFactionCRC[index];
+	}
+
+	data.commands.clear();
+	data.commands.resize(data.header.commandCount);
+	int64 fields[compactCommandFieldCount];
+	getCommandFields(state.lastCommand, fields);
+	for(int idx = 0; idx < data.header.commandCount; ++idx) {
+		uint64 changedMask = 0;
+		if(readVarInt(buf, offset, changedMask) == false) {
+			return false;
+		}
+		for(int field = 0; field < compactCommandFieldCount; ++field) {
+			if((changedMask & ((uint64)1 << field)) != 0) {
+				int64 delta = 0;
+				if(readZigZag(buf, offset, delta) == false) {
+					return false;
+				}
+				fields[field] += delta;
+			}
+		}
+		setCommandFields(data.commands[idx], fields);
+		state.lastCommand = data.commands[idx];
+	}
+	return (offset == buf.size());
+}
+
+bool NetworkMessageCommandList::receiveCompact(Socket* socket, CommandListWireState &state) {
+	unsigned char header[compactCommandListHeaderSize];
+	bool result = NetworkMessage::receive(socket, header, compactCommandListHeaderSize, true);
+	if(result == false) {
+		return false;
+	}
+
+	uint32 payloadSize = 0;
+	for(int index = 0; index < 4; ++index) {
+		payloadSize |= (uint32)header[1 + index] << (index * 8);
+	}
+	if(header[0] != nmtCommandListCompact || payloadSize == 0 ||
+		payloadSize > compactCommandListMaxPayloadSize) {
+		throw megaglest_runtime_error("Invalid compact command list header, payloadSize = " + uIntToStr(payloadSize));
+	}
+
+	std::vector<unsigned char> payload(payloadSize);
+	result = NetworkMessage::receive(socket, &payload[0], payloadSize, true);
+	if(result == true) {
+		if(decodeCompact(payload, state) == false) {
+			throw megaglest_runtime_error("Invalid compact command list, payloadSize = " + uIntToStr(payloadSize));
+		}
+
+		if(SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled == true) {
+			for(int idx = 0 ; idx < data.header.commandCount; ++idx) {
+				const NetworkCommand &cmd = data.commands[idx];
+
+				SystemFlags::OutputDebug(SystemFlags::debugNetwork,"In [%s::%s Line: %d] index = %d, received networkCommand [%s]\n",
+						extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,idx, cmd.toString().c_str());
+			}
+		}
+	}
+	return result;
+}
+
+bool NetworkMessageCommandList::receive(Socket* socket, CommandListWireState &state) {
+	int8 messageType = nmtInvalid;
+	if(socket != NULL) {
+		socket->peek(&messageType, sizeof(messageType));
+	}
+	if(messageType == nmtCommandListCompact) {
+		return receiveCompact(socket, state);
+	}
+	return receive(socket);
+}
+
+void NetworkMessageCommandList::sendCompact(Socket* socket, CommandListWireState &state) {
+	if(SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled) SystemFlags::OutputDebug(SystemFlags::debugNetwork,"In [%s::%s Line: %d] nmtCommandListCompact, frameCount = %d, data.header.commandCount = %d\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,data.header.frameCount,data.header.commandCount);
+
+	assert(data.header.messageType==nmtCommandList);
+	std::vector<unsigned char> buf;
+	encodeCompact(buf, state);
+	// header and commands go out in a single send
+	sendPacked(socket, buf);
+}
+
 // =====================================================
 //	class NetworkMessageText
 // =====================================================
@@ -1840,7 +2230,7 @@ void NetworkMessageText::unpackMessage(unsigned char *buf) {
 }
 
 unsigned char * NetworkMessageText::packMessage() {
-	unsigned char *buf = new unsigned char[getPackedSize()+1];
+	unsigned char *buf = getPackBuffer(getPackedSize()+1);
 	pack(buf, getPackedMessageFormat(),
 			data.messageType,
 			data.text.getBuffer(),
@@ -1882,8 +2272,7 @@ void NetworkMessageText::send(Socket* socket) {
 	else {
 		unsigned char *buf = packMessage();
 		//printf("Send packet size = %u data.messageType = %d\n[%s]\n",getPackedSize(),data.messageType,buf);
-		NetworkMessage::send(socket, buf, getPackedSize());
-		delete [] buf;
+		sendPackBuffer(socket, buf, getPackedSize());
 	}
 }
 
@@ -1934,7 +2323,7 @@ void NetworkMessageQuit::unpackMessage(unsigned char *buf) {
 }
 
 unsigned char * NetworkMessageQuit::packMessage() {
-	unsigned char *buf = new unsigned char[getPackedSize()+1];
+	unsigned char *buf = getPackBuffer(getPackedSize()+1);
 	pack(buf, getPackedMessageFormat(),
 			data.messageType);
 	return buf;
@@ -1970,8 +2359,7 @@ void NetworkMessageQuit::send(Socket* socket) {
 	else {
 		unsigned char *buf = packMessage();
 		//printf("Send packet size = %u data.messageType = %d\n[%s]\n",getPackedSize(),data.messageType,buf);
-		NetworkMessage::send(socket, buf, getPackedSize());
-		delete [] buf;
+		sendPackBuffer(socket, buf, getPackedSize());
 	}
 }
 
@@ -2138,7 +2526,7 @@ void NetworkMessageSynchNetworkGameData::unpackMessageHeader(unsigned char *buf)
 }
 
 unsigned char * NetworkMessageSynchNetworkGameData::packMessageHeader() {
-	unsigned char *buf = new unsigned char[getPackedSizeHeader()+1];
+	unsigned char *buf = getPackBuffer(getPackedSizeHeader()+1);
 	pack(buf, getPackedMessageFormatHeader(),
 			data.header.messageType,
 			data.header.map.getBuffer(),
@@ -2190,7 +2578,7 @@ void NetworkMessageSynchNetworkGameData::unpackMessageDetail(unsigned char *buf)
 }
 
 unsigned char * NetworkMessageSynchNetworkGameData::packMessageDetail() {
-	unsigned char *buf = new unsigned char[sizeof(DataDetail)*3 +1];
+	unsigned char *buf = getPackBuffer(sizeof(DataDetail)*3 +1);
 	unsigned char *bufMove = buf;
 	for(unsigned int i = 0; i < (unsigned int)maxFileCRCCount; ++i) {
 		unsigned int bytes_processed = pack(bufMove, "255s",
@@ -2573,7 +2961,7 @@ void NetworkMessageSynchNetworkGameDataFileCRCCheck::unpackMessage(unsigned char
 }
 
 unsigned char * NetworkMessageSynchNetworkGameDataFileCRCCheck::packMessage() {
-	unsigned char *buf = new unsigned char[getPackedSize()+1];
+	unsigned char *buf = getPackBuffer(getPackedSize()+1);
 	pack(buf, getPackedMessageFormat(),
 			data.messageType,
 			data.totalFileCount,
@@ -2613,8 +3001,7 @@ void NetworkMessageSynchNetworkGameDataFileCRCCheck::send(Socket* socket) {
 	else {
 		unsigned char *buf = packMessage();
 		//printf("Send packet size = %u data.messageType = %d\n[%s]\n",getPackedSize(),data.messageType,buf);
-		NetworkMessage::send(socket, buf, getPackedSize());
-		delete [] buf;
+		sendPackBuffer(socket, buf, getPackedSize());
 	}
 }
 
@@ -2670,7 +3057,7 @@ void NetworkMessageSynchNetworkGameDataFileGet::unpackMessage(unsigned char *buf
 }
 
 unsigned char * NetworkMessageSynchNetworkGameDataFileGet::packMessage() {
-	unsigned char *buf = new unsigned char[getPackedSize()+1];
+	unsigned char *buf = getPackBuffer(getPackedSize()+1);
 	pack(buf, getPackedMessageFormat(),
 			data.messageType,
 			data.fileName.getBuffer());
@@ -2706,8 +3093,7 @@ void NetworkMessageSynchNetworkGameDataFileGet::send(Socket* socket) {
 	else {
 		unsigned char *buf = packMessage();
 		//printf("Send packet size = %u data.messageType = %d\n[%s]\n",getPackedSize(),data.messageType,buf);
-		NetworkMessage::send(socket, buf, getPackedSize());
-		delete [] buf;
+		sendPackBuffer(socket, buf, getPackedSize());
 	}
 }
 
@@ -2800,7 +3186,7 @@ void SwitchSetupRequest::unpackMessage(unsigned char *buf) {
 }
 
 unsigned char * SwitchSetupRequest::packMessage() {
-	unsigned char *buf = new unsigned char[getPackedSize()+1];
+	unsigned char *buf = getPackBuffer(getPackedSize()+1);
 	pack(buf, getPackedMessageFormat(),
 			data.messageType,
 			data.selectedFactionName.getBuffer(),
@@ -2850,8 +3236,7 @@ void SwitchSetupRequest::send(Socket* socket) {
 	else {
 		unsigned char *buf = packMessage();
 		//printf("Send packet size = %u data.messageType = %d\n%s\nTeam = %d faction [%s] currentFactionIndex = %d toFactionIndex = %d\n",getPackedSize(),data.messageType,buf,data.toTeam,data.selectedFactionName.getBuffer(),data.currentFactionIndex,data.toFactionIndex);
-		NetworkMessage::send(socket, buf, getPackedSize());
-		delete [] buf;
+		sendPackBuffer(socket, buf, getPackedSize());
 	}
 }
 
@@ -2911,7 +3296,7 @@ void PlayerIndexMessage::unpackMessage(unsigned char *buf) {
 }
 
 unsigned char * PlayerIndexMessage::packMessage() {
-	unsigned char *buf = new unsigned char[getPackedSize()+1];
+	unsigned char *buf = getPackBuffer(getPackedSize()+1);
 	pack(buf, getPackedMessageFormat(),
 			data.messageType,
 			data.playerIndex);
@@ -2947,8 +3332,7 @@ void PlayerIndexMessage::send(Socket* socket) {
 		unsigned char *buf = packMessage();
 		//printf("Send packet size = %u data.messageType = %d\n[%s]\n",getPackedSize(),data.messageType,buf);
 		//NetworkMessage::send(socket, &data, sizeof(data));
-		NetworkMessage::send(socket, buf, getPackedSize());
-		delete [] buf;
+		sendPackBuffer(socket, buf, getPackedSize());
 	}
 }
 
@@ -3001,7 +3385,7 @@ void NetworkMessageLoadingStatus::unpackMessage(unsigned char *buf) {
 }
 
 unsigned char * NetworkMessageLoadingStatus::packMessage() {
-	unsigned char *buf = new unsigned char[getPackedSize()+1];
+	unsigned char *buf = getPackBuffer(getPackedSize()+1);
 	pack(buf, getPackedMessageFormat(),
 			data.messageType,
 			data.status);
@@ -3036,8 +3420,7 @@ void NetworkMessageLoadingStatus::send(Socket* socket) {
 	else {
 		unsigned char *buf = packMessage();
 		//printf("Send packet size = %u data.messageType = %d\n[%s]\n",getPackedSize(),data.messageType,buf);
-		NetworkMessage::send(socket, buf, getPackedSize());
-		delete [] buf;
+		sendPackBuffer(socket, buf, getPackedSize());
 	}
 }
 
@@ -3117,7 +3500,7 @@ void NetworkMessageMarkCell::unpackMessage(unsigned char *buf) {
 }
 
 unsigned char * NetworkMessageMarkCell::packMessage() {
-	unsigned char *buf = new unsigned char[getPackedSize()+1];
+	unsigned char *buf = getPackBuffer(getPackedSize()+1);
 	pack(buf, getPackedMessageFormat(),
 			data.messageType,
 			data.targetX,
@@ -3159,8 +3542,7 @@ void NetworkMessageMarkCell::send(Socket* socket) {
 	else {
 		unsigned char *buf = packMessage();
 		//printf("Send packet size = %u data.messageType = %d\n[%s]\n",getPackedSize(),data.messageType,buf);
-		NetworkMessage::send(socket, buf, getPackedSize());
-		delete [] buf;
+		sendPackBuffer(socket, buf, getPackedSize());
 	}
 }
 
@@ -3241,7 +3623,7 @@ void NetworkMessageUnMarkCell::unpackMessage(unsigned char *buf) {
 }
 
 unsigned char * NetworkMessageUnMarkCell::packMessage() {
-	unsigned char *buf = new unsigned char[getPackedSize()+1];
+	unsigned char *buf = getPackBuffer(getPackedSize()+1);
 	pack(buf, getPackedMessageFormat(),
 			data.messageType,
 			data.targetX,
@@ -3280,8 +3662,7 @@ void NetworkMessageUnMarkCell::send(Socket* socket) {
 	else {
 		unsigned char *buf = packMessage();
 		//printf("Send packet size = %u data.messageType = %d\n[%s]\n",getPackedSize(),data.messageType,buf);
-		NetworkMessage::send(socket, buf, getPackedSize());
-		delete [] buf;
+		sendPackBuffer(socket, buf, getPackedSize());
 	}
 }
 
@@ -3354,7 +3735,7 @@ void NetworkMessageHighlightCell::unpackMessage(unsigned char *buf) {
 }
 
 unsigned char * NetworkMessageHighlightCell::packMessage() {
-	unsigned char *buf = new unsigned char[getPackedSize()+1];
+	unsigned char *buf = getPackBuffer(getPackedSize()+1);
 	pack(buf, getPackedMessageFormat(),
 			data.messageType,
 			data.targetX,
@@ -3392,8 +3773,7 @@ void NetworkMessageHighlightCell::send(Socket* socket) {
 	else {
 		unsigned char *buf = packMessage();
 		//printf("Send packet size = %u data.messageType = %d\n[%s]\n",getPackedSize(),data.messageType,buf);
-		NetworkMessage::send(socket, buf, getPackedSize());
-		delete [] buf;
+		sendPackBuffer(socket, buf, getPackedSize());
 	}
 }
 
@@ -49,10 +49,16 @@ enum NetworkMessageType {
 	nmtMarkCell,
 	nmtUnMarkCell,
 	nmtHighlightCell,
+	nmtCommandListCompact,
 
 	nmtCount
 };
 
+// Optional wire formats a peer supports, exchanged in NetworkMessageIntro
+enum NetworkMessageFeatureType {
+	nmftCompactCommandList	= 0x01
+};
+
 enum NetworkGameStateType {
 	nmgstInvalid,
 	nmgstOk,
@@ -101,12 +107,27 @@ private:
 	static Chrono lastSend;
 	static Chrono lastRecv;
 	static std::map<NetworkMessageStatisticType,int64> mapMessageStats;
+	static int64 messageTypeSendCount[nmtCount];
+	static int64 messageTypeSendBytes[nmtCount];
+	static int64 messageTypePackAllocations[nmtCount];
+
+	std::vector<unsigned char> *packTarget;
+	size_t packTargetOffset;
+	std::vector<unsigned char> packScratchBuffer;
+	bool packScratchBufferGrew;
+	std::vector<unsigned char> sharedPackedBuffer;
+	bool sharedPacking;
+	bool sharedPackedBufferValid;
+
+	static void addPackStats(int8 messageType, bool allocated);
+	static void addSendStats(int8 messageType, int dataSize);
 
 public:
 	static void resetNetworkPacketStats();
 	static string getNetworkPacketStats();
 
 	static bool useOldProtocol;
+	NetworkMessage();
 	virtual ~NetworkMessage(){}
 	virtual bool receive(Socket* socket)= 0;
 	virtual void send(Socket* socket) = 0;
@@ -114,14 +135,31 @@ public:
 
 	void dump_packet(string label, const void* data, int dataSize, bool isSend);
 
+	// Serializes the message into buf, replacing its contents, with the
+	// exact bytes send() writes to the socket
+	void packInto(std::vector<unsigned char> &buf);
+	// While shared the message is packed once and the same bytes are sent
+	// to every connection (e.g. a broadcast), it must not change meanwhile
+	void setSharedPacking(bool value);
+	bool getSharedPacking() const { return sharedPacking; }
+	const std::vector<unsigned char> & getSharedPackedBuffer();
+	// Writes packed message bytes to the socket with a single send
+	void sendPacked(Socket* socket, const std::vector<unsigned char> &buf);
+
 protected:
 	//bool peek(Socket* socket, void* data, int dataSize);
 	bool receive(Socket* socket, void* data, int dataSize,bool tryReceiveUntilDataSizeMet);
 	void send(Socket* socket, const void* data, int dataSize);
+	// Room for a packed message owned by this message, the end of the
+	// packInto target while packing so nothing is copied afterwards
+	unsigned char * getPackBuffer(size_t size);
+	// Sends the first dataSize bytes of the last getPackBuffer
+	void sendPackBuffer(Socket* socket, unsigned char *buf, int dataSize);
 
 	virtual const char * getPackedMessageFormat() const = 0;
 	virtual unsigned int getPackedSize() = 0;
 	virtual void unpackMessage(unsigned char *buf) = 0;
+	// Packs into getPackBuffer, the caller must not delete the result
 	virtual unsigned char * packMessage() = 0;
 };
 
@@ -153,6 +191,7 @@ private:
 		int8 gameInProgress;
 		NetworkString<maxSmallStringSize> playerUUID;
 		NetworkString<maxSmallStringSize> platform;
+		uint32 features;
 	};
 	void toEndian();
 	void fromEndian();
@@ -167,7 +206,8 @@ public:
 	NetworkMessageIntro(int32 sessionId, const string &versionString,
 			const string &name, int playerIndex, NetworkGameStateType gameState,
 			uint32 externalIp, uint32 ftpPort, const string &playerLanguage,
-			int gameInProgress, const string &playerUUID, const string &platform);
+			int gameInProgress, const string &playerUUID, const string &platform,
+			uint32 features=0);
 
 
 	virtual const char * getPackedMessageFormat() const;
@@ -190,6 +230,7 @@ public:
 
 	string getPlayerUUID() const				{ return data.playerUUID.getString();}
 	string getPlayerPlatform() const			{ return data.platform.getString();}
+	uint32 getFeatures() const					{ return data.features;}
 
 	virtual bool receive(Socket* socket);
 	virtual void send(Socket* socket);
@@ -206,6 +247,11 @@ public:
 
 #pragma pack(push, 1)
 class NetworkMessagePing: public NetworkMessage{
+public:
+	// Pings with this frequency are sent by the server during the game and
+	// echoed back unchanged by the client to measure the round trip time
+	static const int32 roundTripPingFrequency = -1;
+
 private:
 	struct Data{
 		int8 messageType;
@@ -375,6 +421,32 @@ public:
 };
 #pragma pack(pop)
 
+// =====================================================
+//	class CommandListWireState
+//
+///	What one side of a connection last sent or received in
+///	compact command lists, the next message is encoded as a
+///	difference to it
+// =====================================================
+
+class CommandListWireState {
+public:
+	int32 frameCount;
+	uint32 networkPlayerFactionCRC[GameConstants::maxPlayers];
+	NetworkCommand lastCommand;
+
+	CommandListWireState() {
+		reset();
+	}
+	void reset() {
+		frameCount = 0;
+		for(int index = 0; index < GameConstants::maxPlayers; ++index) {
+			networkPlayerFactionCRC[index] = 0;
+		}
+		lastCommand = NetworkCommand();
+	}
+};
+
 // =====================================================
 //	class CommandList
 //
@@ -430,6 +502,10 @@ protected:
 	void unpackMessageDetail(unsigned char *buf,int count);
 	unsigned char * packMessageDetail(uint16 totalCommand);
 
+	void encodeCompact(std::vector<unsigned char> &buf, CommandListWireState &state) const;
+	bool decodeCompact(const std::vector<unsigned char> &buf, CommandListWireState &state);
+	bool receiveCompact(Socket* socket, CommandListWireState &state);
+
 public:
 	NetworkMessageCommandList(int32 frameCount= -1);
 
@@ -447,6 +523,11 @@ public:
 
 	virtual bool receive(Socket* socket);
 	virtual void send(Socket* socket);
+
+	// Receives either wire format, compact messages are decoded against state
+	bool receive(Socket* socket, CommandListWireState &state);
+	// Sends header and commands as one compact message encoded against state
+	void sendCompact(Socket* socket, CommandListWireState &state);
 };
 #pragma pack(pop)
 
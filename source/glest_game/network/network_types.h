@@ -78,7 +78,8 @@ enum NetworkCommandType {
 	nctSwitchTeamVote,
 	nctPauseResume,
 	nctPlayerStatusChange,
-	nctDisconnectNetworkPlayer
+	nctDisconnectNetworkPlayer,
+	nctNetworkFramePeriod
 	//nctNetworkCommand
 };
 
@@ -55,6 +55,11 @@ const int MASTERSERVER_HEARTBEAT_GAME_STATUS_SECONDS 		= 30;
 
 const int MAX_EMPTY_NETWORK_COMMAND_LIST_BROADCAST_INTERVAL_MILLISECONDS = 4000;
 
+const int ROUND_TRIP_PING_INTERVAL_MILLISECONDS					= 1000;
+const int ADAPTIVE_NETWORK_FRAME_PERIOD_INTERVAL_MILLISECONDS	= 1000;
+const int ADAPTIVE_NETWORK_FRAME_PERIOD_MARGIN_MILLISECONDS		= 25;
+const int ADAPTIVE_NETWORK_FRAME_PERIOD_SHRINK_DELAY			= 3;
+
 ServerInterface::ServerInterface(bool publishEnabled, ClientLagCallbackInterface *clientLagCallbackInterface) : GameNetworkInterface() {
 	if(SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled) SystemFlags::OutputDebug(SystemFlags::debugNetwork,"In [%s::%s Line: %d]\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__);
 
@@ -69,7 +74,9 @@ ServerInterface::ServerInterface(bool publishEnabled, ClientLagCallbackInterface
 
 	for(int index = 0; index < GameConstants::maxPlayers; ++index) {
 		slotAccessorMutexes[index] 		= new Mutex(CODE_AT_LINE);
+		slotSocketTriggered[index]		= false;
 	}
+	slotSocketReactor 					= new SocketReactor(Config::getInstance().getBool("EnableSocketReactorEpoll","true"));
 	masterServerThreadAccessor 			= new Mutex(CODE_AT_LINE);
 	textMessageQueueThreadAccessor 		= new Mutex(CODE_AT_LINE);
 	broadcastMessageQueueThreadAccessor = new Mutex(CODE_AT_LINE);
@@ -92,6 +99,14 @@ ServerInterface::ServerInterface(bool publishEnabled, ClientLagCallbackInterface
 	masterserverAdminRequestLaunch	= false;
 	lastListenerSlotCheckTime		= 0;
 
+	lastRoundTripPingMillis				= 0;
+	lastNetworkFramePeriodUpdateMillis	= 0;
+	networkFramePeriodShrinkCount		= 0;
+
+	lagCheckCount						= 0;
+	lagWarningCount						= 0;
+	lagExceededCount					= 0;
+
 	// This is an admin port listening only on the localhost intended to
 	// give current connection status info
 #ifndef __APPLE__
@@ -292,6 +307,9 @@ ServerInterface::~ServerInterface() {
 		slotAccessorMutexes[index] = NULL;
 	}
 
+	delete slotSocketReactor;
+	slotSocketReactor = NULL;
+
 	delete textMessageQueueThreadAccessor;
 	textMessageQueueThreadAccessor = NULL;
 
@@ -704,6 +722,7 @@ std::pair<bool,bool> ServerInterface::clientLagCheck(ConnectionSlot *connectionS
 				double clientLag 		= this->getCurrentFrameCount() - connectionSlot->getCurrentFrameCount();
 				double clientLagCount 	= (gameSettings.getNetworkFramePeriod() > 0 ? (clientLag / gameSettings.getNetworkFramePeriod()) : 0);
 				connectionSlot->setCurrentLagCount(clientLagCount);
+				lagCheckCount++;
 
 				double clientLagTime 	= difftime((long int)time(NULL),connectionSlot->getLastReceiveCommandListTime());
 
@@ -740,6 +759,7 @@ std::pair<bool,bool> ServerInterface::clientLagCheck(ConnectionSlot *connectionS
 					( maxClientLagTimeAllowedEver > 0 && clientLagTime > maxClientLagTimeAllowedEver)) {
 
 					clientLagExceededOrWarned.first = true;
+					lagExceededCount++;
 					//printf("#1 Client Warned\n");
 
 			    	Lang &lang= Lang::getInstance();
@@ -789,6 +809,7 @@ std::pair<bool,bool> ServerInterface::clientLagCheck(ConnectionSlot *connectionS
 						 clientLagTime > (maxClientLagTimeAllowed * warnFrameCountLagPercent)) ) {
 
 					clientLagExceededOrWarned.second = true;
+					lagWarningCount++;
 					//printf("#2 Client Warned\n");
 
 					if(connectionSlot->getLagCountWarning() == false) {
@@ -837,17 +858,44 @@ std::pair<bool,bool> ServerInterface::clientLagCheck(ConnectionSlot *connectionS
 	return clientLagExceededOrWarned;
 }
 
-void ServerInterface::updateSocketTriggeredList(std::map<PLATFORM_SOCKET,bool> & socketTriggeredList) {
+// Keeps the reactor registrations in step with the slot sockets and returns
+// the number of slots with a valid socket
+int ServerInterface::updateSlotSocketReactor() {
+	int validSocketCount = 0;
 	for(int index = 0; exitServer == false && index < GameConstants::maxPlayers; ++index) {
 		MutexSafeWrapper safeMutexSlot(slotAccessorMutexes[index],CODE_AT_LINE_X(index));
 		ConnectionSlot *connectionSlot = slots[index];
+
+		Socket *socket = NULL;
+		PLATFORM_SOCKET clientSocket = slotSocketReactor->getSocket(index);
 		if(connectionSlot != NULL) {
-			PLATFORM_SOCKET clientSocket = connectionSlot->getSocketId();
-			if(Socket::isSocketValid(&clientSocket) == true) {
-				socketTriggeredList[clientSocket] = false;
-			}
+			socket = connectionSlot->getSocket(false);
+			clientSocket = connectionSlot->getSocketId();
+		}
+		if(Socket::isSocketValid(&clientSocket) == false) {
+			socket = NULL;
 		}
+
+		// A new connection may reuse the descriptor number and even the
+		// address of a closed socket, only its serial is new
+		if(socket != NULL) {
+			slotSocketReactor->setSocket(index,clientSocket,socket->getSerial());
+			validSocketCount++;
+		}
+		else {
+			slotSocketReactor->removeSocket(index);
+		}
+		slotSocketTriggered[index] = false;
 	}
+	return validSocketCount;
+}
+
+bool ServerInterface::pollSlotSocketReactor() {
+	slotSocketReactor->waitForReadable(slotSocketReadyList,0);
+	for(unsigned int index = 0; index < slotSocketReadyList.size(); ++index) {
+		slotSocketTriggered[slotSocketReadyList[index]] = true;
+	}
+	return (slotSocketReadyList.empty() == false);
 }
 
 void ServerInterface::validateConnectedClients() {
@@ -880,8 +928,7 @@ bool ServerInterface::signalClientReceiveCommands(ConnectionSlot *connectionSlot
 	return slotSignalled;
 }
 
-void ServerInterface::signalClientsToRecieveData(std::map<PLATFORM_SOCKET,bool> &socketTriggeredList,
-												 std::map<int,ConnectionSlotEvent> &eventList,
+void ServerInterface::signalClientsToRecieveData(std::map<int,ConnectionSlotEvent> &eventList,
 												 std::map<int,bool> & mapSlotSignalledList) {
 	//printf("====================================In [%s::%s Line: %d]\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__);
 
@@ -899,12 +946,11 @@ void ServerInterface::signalClientsToRecieveData(std::map<PLATFORM_SOCKET,bool>
 			if(connectionSlot != NULL) {
 				PLATFORM_SOCKET clientSocket = connectionSlot->getSocketId();
 				if(Socket::isSocketValid(&clientSocket)) {
-					socketTriggered = socketTriggeredList[clientSocket];
+					socketTriggered = slotSocketTriggered[i];
 				}
 				else if(this->getGameHasBeenInitiated() == true &&
 						this->getAllowInGameConnections() == true) {
-					socketTriggeredList[clientSocket] = true;
-					socketTriggered = socketTriggeredList[clientSocket];
+					socketTriggered = true;
 				}
 			}
 			ConnectionSlotEvent &event = eventList[i];
@@ -936,7 +982,7 @@ void ServerInterface::signalClientsToRecieveData(std::map<PLATFORM_SOCKET,bool>
 				bool socketTriggered = false;
 				PLATFORM_SOCKET clientSocket = connectionSlot->getSocketId();
 				if(Socket::isSocketValid(&clientSocket)) {
-					socketTriggered = socketTriggeredList[clientSocket];
+					socketTriggered = slotSocketTriggered[index];
 				}
 
 				ConnectionSlotEvent &event = eventList[index];
@@ -1101,7 +1147,6 @@ void ServerInterface::checkForAutoPauseForLaggingClient(int index,ConnectionSlot
 
 void ServerInterface::checkForLaggingClients(std::map<int,bool> &mapSlotSignalledList,
 											std::map<int,ConnectionSlotEvent> &eventList,
-											std::map<PLATFORM_SOCKET,bool> &socketTriggeredList,
 											std::vector <string> &errorMsgList) {
 	bool lastGlobalLagCheckTimeUpdate = false;
 	if(gameHasBeenInitiated == true) {
@@ -1250,7 +1295,8 @@ void ServerInterface::executeNetworkCommandsFromClients() {
 			MutexSafeWrapper safeMutexSlot(slotAccessorMutexes[index],CODE_AT_LINE_X(index));
 			ConnectionSlot* connectionSlot= slots[index];
 			if(connectionSlot != NULL && connectionSlot->isConnected() == true) {
-				vector<NetworkCommand> pendingList = connectionSlot->getPendingNetworkCommandList(true);
+				vector<NetworkCommand> pendingList;
+				connectionSlot->takePendingNetworkCommands(pendingList);
 				if(pendingList.empty() == false) {
 					for(int idx = 0; exitServer == false && idx < (int)pendingList.size(); ++idx) {
 						NetworkCommand &cmd = pendingList[idx];
@@ -1269,10 +1315,12 @@ void ServerInterface::dispatchPendingChatMessages(std::vector <string> &errorMsg
 		MutexSafeWrapper safeMutexSlot(slotAccessorMutexes[index],CODE_AT_LINE_X(index));
 		ConnectionSlot *connectionSlot = slots[index];
 
-		if(connectionSlot != NULL &&
-		   connectionSlot->getChatTextList(false).empty() == false) {
+		std::vector<ChatMsgInfo> chatText;
+		if(connectionSlot != NULL) {
+			connectionSlot->takePendingChatMessages(chatText);
+		}
+		if(chatText.empty() == false) {
 			try {
-				std::vector<ChatMsgInfo> chatText = connectionSlot->getChatTextList(true);
 				for(int chatIdx = 0;
 					exitServer == false && slots[index] != NULL &&
 					chatIdx < (int)chatText.size(); chatIdx++) {
@@ -1301,11 +1349,6 @@ void ServerInterface::dispatchPendingChatMessages(std::vector <string> &errorMsg
 				}
 
 				if(SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled) SystemFlags::OutputDebug(SystemFlags::debugNetwork,"In [%s::%s Line: %d] index = %d\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,index);
-				// Its possible that the slot is disconnected here
-				// so check the original pointer again
-				if(slots[index] != NULL) {
-					slots[index]->clearChatInfo();
-				}
 			}
 			catch(const exception &ex) {
 				SystemFlags::OutputDebug(SystemFlags::debugError,"In [%s::%s Line: %d] Error [%s]\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,ex.what());
@@ -1322,11 +1365,13 @@ void ServerInterface::dispatchPendingMarkCellMessages(std::vector <string> &erro
 		MutexSafeWrapper safeMutexSlot(slotAccessorMutexes[index],CODE_AT_LINE_X(index));
 		ConnectionSlot* connectionSlot= slots[index];
 
-		if(connectionSlot != NULL &&
-		   connectionSlot->getMarkedCellList(false).empty() == false) {
+		std::vector<MarkedCell> chatText;
+		if(connectionSlot != NULL) {
+			connectionSlot->takePendingMarkedCells(chatText);
+		}
+		if(chatText.empty() == false) {
 
 			try {
-				std::vector<MarkedCell> chatText = connectionSlot->getMarkedCellList(true);
 				for(int chatIdx = 0;
 					exitServer == false && slots[index] != NULL &&
 					chatIdx < (int)chatText.size(); chatIdx++) {
@@ -1343,11 +1388,6 @@ void ServerInterface::dispatchPendingMarkCellMessages(std::vector <string> &erro
 				}
 
 				if(SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled) SystemFlags::OutputDebug(SystemFlags::debugNetwork,"In [%s::%s Line: %d] i = %d\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,index);
-				// Its possible that the slot is disconnected here
-				// so check the original pointer again
-				if(slots[index] != NULL) {
-					slots[index]->clearMarkedCellList();
-				}
 			}
 			catch(const exception &ex) {
 				SystemFlags::OutputDebug(SystemFlags::debugError,"In [%s::%s Line: %d] Error [%s]\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,ex.what());
@@ -1362,11 +1402,13 @@ void ServerInterface::dispatchPendingHighlightCellMessages(std::vector <string>
 
 		MutexSafeWrapper safeMutexSlot(slotAccessorMutexes[index],CODE_AT_LINE_X(index));
 		ConnectionSlot* connectionSlot= slots[index];
-		if(connectionSlot != NULL &&
-		   connectionSlot->getHighlightedCellList(false).empty() == false) {
+		std::vector<MarkedCell> highlightedCells;
+		if(connectionSlot != NULL) {
+			connectionSlot->takePendingHighlightedCells(highlightedCells);
+		}
+		if(highlightedCells.empty() == false) {
 
 			try {
-				std::vector<MarkedCell> highlightedCells = connectionSlot->getHighlightedCellList(true);
 				for(int chatIdx = 0;
 					exitServer == false && slots[index] != NULL &&
 					chatIdx < (int)highlightedCells.size(); chatIdx++) {
@@ -1382,11 +1424,6 @@ void ServerInterface::dispatchPendingHighlightCellMessages(std::vector <string>
 				}
 
 				if(SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled) SystemFlags::OutputDebug(SystemFlags::debugNetwork,"In [%s::%s Line: %d] index = %d\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,index);
-				// Its possible that the slot is disconnected here
-				// so check the original pointer again
-				if(slots[index] != NULL) {
-					slots[index]->clearHighlightedCellList();
-				}
 			}
 			catch(const exception &ex) {
 				SystemFlags::OutputDebug(SystemFlags::debugError,"In [%s::%s Line: %d] Error [%s]\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,ex.what());
@@ -1402,11 +1439,13 @@ void ServerInterface::dispatchPendingUnMarkCellMessages(std::vector <string> &er
 
 		MutexSafeWrapper safeMutexSlot(slotAccessorMutexes[index],CODE_AT_LINE_X(index));
 		ConnectionSlot* connectionSlot= slots[index];
-		if(connectionSlot != NULL &&
-		   connectionSlot->getUnMarkedCellList(false).empty() == false) {
+		std::vector<UnMarkedCell> chatText;
+		if(connectionSlot != NULL) {
+			connectionSlot->takePendingUnMarkedCells(chatText);
+		}
+		if(chatText.empty() == false) {
 
 			try {
-				std::vector<UnMarkedCell> chatText = connectionSlot->getUnMarkedCellList(true);
 				for(int chatIdx = 0;
 					exitServer == false && slots[index] != NULL &&
 					chatIdx < (int)chatText.size(); chatIdx++) {
@@ -1423,11 +1462,6 @@ void ServerInterface::dispatchPendingUnMarkCellMessages(std::vector <string> &er
 				}
 
 				if(SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled) SystemFlags::OutputDebug(SystemFlags::debugNetwork,"In [%s::%s Line: %d] i = %d\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,index);
-				// Its possible that the slot is disconnected here
-				// so check the original pointer again
-				if(slots[index] != NULL) {
-					slots[index]->clearUnMarkedCellList();
-				}
 			}
 			catch(const exception &ex) {
 				SystemFlags::OutputDebug(SystemFlags::debugError,"In [%s::%s Line: %d] Error [%s]\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,ex.what());
@@ -1474,21 +1508,20 @@ void ServerInterface::update() {
 
 		//printf("\nServerInterface::update -- C\n");
 
-		std::map<PLATFORM_SOCKET,bool> socketTriggeredList;
 		//update all slots
-		updateSocketTriggeredList(socketTriggeredList);
+		int slotSocketCount = updateSlotSocketReactor();
 
 		//printf("\nServerInterface::update -- D\n");
 
 		if(gameHasBeenInitiated == false ||
-			socketTriggeredList.empty() == false) {
+			slotSocketCount > 0) {
 			//printf("\nServerInterface::update -- E\n");
 
 			std::map<int,ConnectionSlotEvent> eventList;
 
 			bool hasData = false;
 			if(gameHasBeenInitiated == false) {
-				hasData = Socket::hasDataToRead(socketTriggeredList);
+				hasData = pollSlotSocketReactor();
 			}
 			else {
 				hasData = true;
@@ -1502,7 +1535,7 @@ void ServerInterface::update() {
 
 				// Step #1 tell all connection slot worker threads to receive socket data
 				if(gameHasBeenInitiated == false) {
-					signalClientsToRecieveData(socketTriggeredList, eventList, mapSlotSignalledList);
+					signalClientsToRecieveData(eventList, mapSlotSignalledList);
 				}
 				if(SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled) SystemFlags::OutputDebug(SystemFlags::debugNetwork,"In [%s::%s Line: %d] ============ Step #2\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__);
 
@@ -1521,7 +1554,7 @@ void ServerInterface::update() {
 
 					// Step #3 check clients for any lagging scenarios and try to deal with them
 					if(gameHasBeenInitiated == false) {
-						checkForLaggingClients(mapSlotSignalledList, eventList, socketTriggeredList,errorMsgList);
+						checkForLaggingClients(mapSlotSignalledList, eventList, errorMsgList);
 					}
 					if(SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled) SystemFlags::OutputDebug(SystemFlags::debugNetwork,"In [%s::%s Line: %d] ============ Step #4\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__);
 
@@ -1547,7 +1580,7 @@ void ServerInterface::update() {
 						difftime((long int)time(NULL),lastGlobalLagCheckTime) >= LAG_CHECK_INTERVAL_PERIOD) {
 
 						std::map<int,bool> mapSlotSignalledList;
-						checkForLaggingClients(mapSlotSignalledList, eventList, socketTriggeredList,errorMsgList);
+						checkForLaggingClients(mapSlotSignalledList, eventList, errorMsgList);
 					}
 					//printf("START Server update #7\n");
 				}
@@ -1559,7 +1592,7 @@ void ServerInterface::update() {
 					//printf("START Server update #8\n");
 
 					std::map<int,bool> mapSlotSignalledList;
-					checkForLaggingClients(mapSlotSignalledList, eventList, socketTriggeredList,errorMsgList);
+					checkForLaggingClients(mapSlotSignalledList, eventList, errorMsgList);
 				}
 				//printf("START Server update #9\n");
 			}
@@ -1571,7 +1604,7 @@ void ServerInterface::update() {
 				//printf("START Server update #10\n");
 
 				std::map<int,bool> mapSlotSignalledList;
-				checkForLaggingClients(mapSlotSignalledList, eventList, socketTriggeredList,errorMsgList);
+				checkForLaggingClients(mapSlotSignalledList, eventList, errorMsgList);
 			}
 			//printf("START Server update #11\n");
 		}
@@ -1585,7 +1618,7 @@ void ServerInterface::update() {
 			std::map<int,ConnectionSlotEvent> eventList;
 			std::map<int,bool> mapSlotSignalledList;
 
-			checkForLaggingClients(mapSlotSignalledList, eventList, socketTriggeredList,errorMsgList);
+			checkForLaggingClients(mapSlotSignalledList, eventList, errorMsgList);
 		}
 		//printf("START Server update #13\n");
 
@@ -1649,8 +1682,89 @@ void ServerInterface::update() {
 	}
 }
 
+void ServerInterface::sendRoundTripPings() {
+	int64 now = Chrono::getCurMillis();
+	if(now - lastRoundTripPingMillis < ROUND_TRIP_PING_INTERVAL_MILLISECONDS) {
+		return;
+	}
+	lastRoundTripPingMillis = now;
+
+	NetworkMessagePing networkMessagePing(NetworkMessagePing::roundTripPingFrequency,now);
+	broadcastMessageToConnectedClients(&networkMessagePing);
+}
+
+int ServerInterface::getMaxClientRoundTripMilliseconds() {
+	int result = -1;
+	for(int index = 0; exitServer == false && index < GameConstants::maxPlayers; ++index) {
+		MutexSafeWrapper safeMutexSlot(slotAccessorMutexes[index],CODE_AT_LINE_X(index));
+		ConnectionSlot *connectionSlot= slots[index];
+		if(connectionSlot != NULL && connectionSlot->isConnected() == true) {
+			result = max(result,connectionSlot->getRoundTripMilliseconds());
+		}
+	}
+	return result;
+}
+
+void ServerInterface::updateAdaptiveNetworkFramePeriod() {
+	int64 now = Chrono::getCurMillis();
+	if(now - lastNetworkFramePeriodUpdateMillis < ADAPTIVE_NETWORK_FRAME_PERIOD_INTERVAL_MILLISECONDS) {
+		return;
+	}
+	lastNetworkFramePeriodUpdateMillis = now;
+
+	int maxRoundTrip = getMaxClientRoundTripMilliseconds();
+	if(maxRoundTrip < 0) {
+		return;
+	}
+
+	Config &config = Config::getInstance();
+	int minPeriod = max(1,config.getInt("AdaptiveNetworkFramePeriodMin","2"));
+	int maxPeriod = max(minPeriod,min(255,config.getInt("AdaptiveNetworkFramePeriodMax","80")));
+
+	// A client's command reaches us and its keyframe comes back within one
+	// round trip, the period has to cover the slowest client's round trip
+	// or that client stalls waiting for every keyframe
+	int frameMillis 	= max(1,1000 / GameConstants::updateFps);
+	int targetPeriod 	= (maxRoundTrip + ADAPTIVE_NETWORK_FRAME_PERIOD_MARGIN_MILLISECONDS + frameMillis - 1) / frameMillis;
+	targetPeriod 		= max(minPeriod,min(maxPeriod,targetPeriod));
+
+	int currentPeriod 	= gameSettings.getNetworkFramePeriod();
+	int newPeriod 		= currentPeriod;
+	if(targetPeriod > currentPeriod) {
+		newPeriod = targetPeriod;
+		networkFramePeriodShrinkCount = 0;
+	}
+	else if(targetPeriod < currentPeriod) {
+		// shrink in steps and only after the latency stayed low for a while
+		if(++networkFramePeriodShrinkCount >= ADAPTIVE_NETWORK_FRAME_PERIOD_SHRINK_DELAY) {
+			newPeriod = currentPeriod - (currentPeriod - targetPeriod + 1) / 2;
+			networkFramePeriodShrinkCount = 0;
+		}
+	}
+	else {
+		networkFramePeriodShrinkCount = 0;
+	}
+
+	if(newPeriod != currentPeriod) {
+		if(SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled) SystemFlags::OutputDebug(SystemFlags::debugNetwork,"In [%s::%s Line: %d] maxRoundTrip = %d, networkFramePeriod %d -> %d\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,maxRoundTrip,currentPeriod,newPeriod);
+
+		// Every peer switches when it gives this command on the current
+		// keyframe, so they all agree on the following keyframes
+		NetworkCommand networkCommand;
+		networkCommand.networkCommandType 	= nctNetworkFramePeriod;
+		networkCommand.unitId 				= newPeriod;
+		networkCommand.fromFactionIndex 	= gameSettings.getThisFactionIndex();
+		requestCommand(&networkCommand);
+	}
+}
+
 void ServerInterface::updateKeyframe(int frameCount) {
 	currentFrameCount = frameCount;
+
+	if(Config::getInstance().getBool("AdaptiveNetworkFramePeriod","false") == true) {
+		sendRoundTripPings();
+		updateAdaptiveNetworkFramePeriod();
+	}
 	if(SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled) SystemFlags::OutputDebug(SystemFlags::debugNetwork,"In [%s::%s Line: %d] currentFrameCount = %d, requestedCommands.size() = %d\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,currentFrameCount,requestedCommands.size());
 
 	NetworkMessageCommandList networkMessageCommandList(frameCount);
@@ -2264,7 +2378,7 @@ void ServerInterface::quitGame(bool userManuallyQuit) {
 
 string ServerInterface::getNetworkStatus() {
 	Lang &lang = Lang::getInstance();
-	string str = "";
+	string str = "network frame period = " + intToStr(gameSettings.getNetworkFramePeriod()) + "\n";
 	for(int index = 0; exitServer == false && index < GameConstants::maxPlayers; ++index) {
 		MutexSafeWrapper safeMutexSlot(slotAccessorMutexes[index],CODE_AT_LINE_X(index));
 		ConnectionSlot *connectionSlot= slots[index];
@@ -2277,7 +2391,7 @@ string ServerInterface::getNetworkStatus() {
 				double lastClientCommandListTimeLag = difftime((long int)time(NULL),connectionSlot->getLastReceiveCommandListTime());
 				//float pingTime = connectionSlot->getThreadedPingMS(connectionSlot->getIpAddress().c_str());
 				char szBuf[8096]="";
-				snprintf(szBuf,8096,", lag = %d [%.2f]",clientLagCount,lastClientCommandListTimeLag);
+				snprintf(szBuf,8096,", lag = %d [%.2f], rtt = %d ms",clientLagCount,lastClientCommandListTimeLag,connectionSlot->getRoundTripMilliseconds());
 				str += connectionSlot->getName() + " [" + connectionSlot->getUUID() + "] " + string(szBuf);
 			}
 		}
@@ -2518,6 +2632,9 @@ void ServerInterface::broadcastMessage(NetworkMessage *networkMessage, int exclu
 			safeMutexSlotBroadCastAccessor.ReleaseLock(true);
 	    }
 
+	    // pack once, every slot sends the same bytes
+	    networkMessage->setSharedPacking(true);
+
 		for(int slotIndex = 0; exitServer == false && slotIndex < GameConstants::maxPlayers; ++slotIndex) {
 			MutexSafeWrapper safeMutexSlot(NULL,CODE_AT_LINE_X(slotIndex));
 			if(slotIndex != lockedSlotIndex) {
@@ -2556,6 +2673,8 @@ void ServerInterface::broadcastMessage(NetworkMessage *networkMessage, int exclu
 			}
 		}
 
+		networkMessage->setSharedPacking(false);
+
 		safeMutexSlotBroadCastAccessor.Lock();
 
 	    inBroadcastMessage = false;
@@ -2566,6 +2685,8 @@ void ServerInterface::broadcastMessage(NetworkMessage *networkMessage, int exclu
 		SystemFlags::OutputDebug(SystemFlags::debugError,"In [%s::%s Line: %d] Error [%s]\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,ex.what());
 		if(SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled) SystemFlags::OutputDebug(SystemFlags::debugNetwork,"In [%s::%s Line: %d] ERROR [%s]\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,ex.what());
 
+		networkMessage->setSharedPacking(false);
+
 		MutexSafeWrapper safeMutexSlotBroadCastAccessor(inBroadcastMessageThreadAccessor,CODE_AT_LINE);
 	    inBroadcastMessage = false;
 	    safeMutexSlotBroadCastAccessor.ReleaseLock();
@@ -2578,6 +2699,7 @@ void ServerInterface::broadcastMessage(NetworkMessage *networkMessage, int exclu
 void ServerInterface::broadcastMessageToConnectedClients(NetworkMessage *networkMessage, int excludeSlot) {
 	if(SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled) SystemFlags::OutputDebug(SystemFlags::debugNetwork,"In [%s::%s] Line: %d\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__);
 	try {
+		networkMessage->setSharedPacking(true);
 		for(int slotIndex = 0; exitServer == false && slotIndex < GameConstants::maxPlayers; ++slotIndex) {
 			MutexSafeWrapper safeMutexSlot(slotAccessorMutexes[slotIndex],CODE_AT_LINE_X(slotIndex));
 			ConnectionSlot *connectionSlot= slots[slotIndex];
@@ -2588,8 +2710,11 @@ void ServerInterface::broadcastMessageToConnectedClients(NetworkMessage *network
 				}
 			}
 		}
+		networkMessage->setSharedPacking(false);
 	}
 	catch(const exception &ex) {
+		networkMessage->setSharedPacking(false);
+
 		SystemFlags::OutputDebug(SystemFlags::debugError,"In [%s::%s Line: %d] Error [%s]\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,ex.what());
 		if(SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled) SystemFlags::OutputDebug(SystemFlags::debugNetwork,"In [%s::%s Line: %d] ERROR [%s]\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,ex.what());
 		DisplayErrorMessage(ex.what());
@@ -2615,6 +2740,17 @@ void ServerInterface::updateListen() {
 	serverSocket.listen(openSlotCount);
 }
 
+int64 ServerInterface::getSentByteCount() {
+	int64 result = 0;
+	for(int index = 0; index < GameConstants::maxPlayers; ++index) {
+		MutexSafeWrapper safeMutexSlot(slotAccessorMutexes[index],CODE_AT_LINE_X(index));
+		if(slots[index] != NULL && slots[index]->getSocket() != NULL) {
+			result += slots[index]->getSocket()->getSentByteCount();
+		}
+	}
+	return result;
+}
+
 int ServerInterface::getOpenSlotCount() {
 	int openSlotCount = 0;
 	for(int slotIndex = 0; exitServer == false && slotIndex < GameConstants::maxPlayers; ++slotIndex)	{
@@ -22,10 +22,12 @@
 #include "network_interface.h"
 #include "connection_slot.h"
 #include "socket.h"
+#include "socket_reactor.h"
 #include "leak_dumper.h"
 
 using std::vector;
 using Shared::Platform::ServerSocket;
+using Shared::Platform::SocketReactor;
 
 namespace Shared {  namespace PlatformCommon {  class FTPServerThread;  }}
 
@@ -112,6 +114,21 @@ private:
 	Chrono lastBroadcastCommandsTimer;
 	ClientLagCallbackInterface *clientLagCallbackInterface;
 
+	// slot sockets stay registered between updates, keyed by slot index
+	SocketReactor *slotSocketReactor;
+	bool slotSocketTriggered[GameConstants::maxPlayers];
+	vector<int> slotSocketReadyList;
+
+	// adaptive network frame period
+	int64 lastRoundTripPingMillis;
+	int64 lastNetworkFramePeriodUpdateMillis;
+	int networkFramePeriodShrinkCount;
+
+	// lag check counters, read by the server benchmark
+	int64 lagCheckCount;
+	int64 lagWarningCount;
+	int64 lagExceededCount;
+
 public:
 	ServerInterface(bool publishEnabled, ClientLagCallbackInterface *clientLagCallbackInterface);
 	virtual ~ServerInterface();
@@ -199,7 +216,8 @@ public:
 
     std::pair<bool,bool> clientLagCheck(ConnectionSlot *connectionSlot, bool skipNetworkBroadCast = false);
     bool signalClientReceiveCommands(ConnectionSlot *connectionSlot, int slotIndex, bool socketTriggered, ConnectionSlotEvent & event);
-    void updateSocketTriggeredList(std::map<PLATFORM_SOCKET,bool> & socketTriggeredList);
+    int updateSlotSocketReactor();
+    bool pollSlotSocketReactor();
     bool isPortBound() const {
         return serverSocket.isPortBound();
     }
@@ -229,6 +247,11 @@ public:
     	return gameHasBeenInitiated;
     }
 
+    int64 getLagCheckCount() const		{ return lagCheckCount; }
+    int64 getLagWarningCount() const	{ return lagWarningCount; }
+    int64 getLagExceededCount() const	{ return lagExceededCount; }
+    int64 getSentByteCount();
+
 public:
     Mutex *getServerSynchAccessor() {
         return serverSynchAccessor;
@@ -273,10 +296,14 @@ private:
 			ConnectionSlot* connectionSlot);
 	void checkForAutoResumeForLaggingClients();
 
+	void sendRoundTripPings();
+	int getMaxClientRoundTripMilliseconds();
+	void updateAdaptiveNetworkFramePeriod();
+
 protected:
-    void signalClientsToRecieveData(std::map<PLATFORM_SOCKET,bool> & socketTriggeredList, std::map<int,ConnectionSlotEvent> & eventList, std::map<int,bool> & mapSlotSignalledList);
+    void signalClientsToRecieveData(std::map<int,ConnectionSlotEvent> & eventList, std::map<int,bool> & mapSlotSignalledList);
     void checkForCompletedClients(std::map<int,bool> & mapSlotSignalledList,std::vector <string> &errorMsgList,std::map<int,ConnectionSlotEvent> &eventList);
-    void checkForLaggingClients(std::map<int,bool> &mapSlotSignalledList, std::map<int,ConnectionSlotEvent> &eventList, std::map<PLATFORM_SOCKET,bool> &socketTriggeredList,std::vector <string> &errorMsgList);
+    void checkForLaggingClients(std::map<int,bool> &mapSlotSignalledList, std::map<int,ConnectionSlotEvent> &eventList, std::vector <string> &errorMsgList);
     void executeNetworkCommandsFromClients();
     void dispatchPendingChatMessages(std::vector <string> &errorMsgList);
     void dispatchPendingMarkCellMessages(std::vector <string> &errorMsgList);
@@ -215,6 +215,7 @@ void Faction::sortUnitsByCommandGroups() {
 FactionThread::FactionThread(Faction *faction) : BaseThread() {
 	this->triggerIdMutex = new Mutex(CODE_AT_LINE);
 	this->faction = faction;
+	this->frameBarrier = NULL;
 	this->masterController = NULL;
 	uniqueID = "FactionThread";
 }
@@ -237,12 +238,13 @@ void FactionThread::setQuitStatus(bool value) {
 	if(SystemFlags::getSystemSettingType(SystemFlags::debugSystem).enabled) SystemFlags::OutputDebug(SystemFlags::debugSystem,"In [%s::%s] Line: %d\n",__FILE__,__FUNCTION__,__LINE__);
 }
 
-void FactionThread::signalPathfinder(int frameIndex) {
+void FactionThread::signalPathfinder(int frameIndex, FrameBarrier *frameBarrier) {
 	if(frameIndex >= 0) {
 		static string mutexOwnerId = string(__FILE__) + string("_") + intToStr(__LINE__);
 		MutexSafeWrapper safeMutex(triggerIdMutex,mutexOwnerId);
 		this->frameIndex.first = frameIndex;
 		this->frameIndex.second = false;
+		this->frameBarrier = frameBarrier;
 
 		safeMutex.ReleaseLock();
 	}
@@ -253,10 +255,16 @@ void FactionThread::setTaskCompleted(int frameIndex) {
 	if(frameIndex >= 0) {
 		static string mutexOwnerId = string(__FILE__) + string("_") + intToStr(__LINE__);
 		MutexSafeWrapper safeMutex(triggerIdMutex,mutexOwnerId);
+		FrameBarrier *barrier = NULL;
 		if(this->frameIndex.first == frameIndex) {
 			this->frameIndex.second = true;
+			barrier = this->frameBarrier;
 		}
 		safeMutex.ReleaseLock();
+
+		if(barrier != NULL) {
+			barrier->arrive(frameIndex);
+		}
 	}
 }
 
@@ -672,9 +680,9 @@ bool Faction::canUnitsPathfind() {
 	return result;
 }
 
-void Faction::signalWorkerThread(int frameIndex) {
+void Faction::signalWorkerThread(int frameIndex, FrameBarrier *frameBarrier) {
 	if(workerThread != NULL) {
-		workerThread->signalPathfinder(frameIndex);
+		workerThread->signalPathfinder(frameIndex,frameBarrier);
 	}
 }
 
@@ -58,19 +58,6 @@ public:
 	std::map<Vec2i,float> surfPosAlphaList;
 };
 
-class ExploredCellsLookupItem {
-public:
-
-	ExploredCellsLookupItem() {
-		ExploredCellsLookupItemCacheTimerCountIndex = 0;
-	}
-	int ExploredCellsLookupItemCacheTimerCountIndex;
-	std::vector<SurfaceCell *> exploredCellList;
-	std::vector<SurfaceCell *> visibleCellList;
-
-	static time_t lastDebug;
-};
-
 // =====================================================
 // 	class Faction
 //
@@ -94,6 +81,7 @@ protected:
 	Semaphore semTaskSignalled;
 	Mutex *triggerIdMutex;
 	std::pair<int,bool> frameIndex;
+	FrameBarrier *frameBarrier;
 	MasterSlaveThreadController *masterController;
 
 	virtual void setQuitStatus(bool value);
@@ -108,7 +96,7 @@ public:
 	virtual void setMasterController(MasterSlaveThreadController *master) { masterController = master; }
 	virtual void signalSlave(void *userdata) { signalPathfinder(*((int *)(userdata))); }
 
-    void signalPathfinder(int frameIndex);
+    void signalPathfinder(int frameIndex, FrameBarrier *frameBarrier=NULL);
     bool isSignalPathfinderCompleted(int frameIndex);
 };
 
@@ -348,7 +336,7 @@ public:
 	inline World * getWorld() { return world; }
 	int getFrameCount();
 
-	void signalWorkerThread(int frameIndex);
+	void signalWorkerThread(int frameIndex, FrameBarrier *frameBarrier=NULL);
 	bool isWorkerThreadSignalCompleted(int frameIndex);
 	FactionThread *getWorkerThread() { return workerThread; }
 
@@ -111,7 +111,7 @@ void Object::initParticlesFromTypes(const ModelParticleSystemTypes *particleType
 	if(showTilesetParticles == true && GlobalStaticFlags::getIsNonGraphicalModeEnabled() == false &&
 			particleTypes->empty() == false && unitParticleSystems.empty() == true) {
 		for(ObjectParticleSystemTypes::const_iterator it= particleTypes->begin(); it != particleTypes->end(); ++it){
-			UnitParticleSystem *ups= new UnitParticleSystem(200);
+			UnitParticleSystem *ups= UnitParticleSystem::create(200);
 			ups->setParticleOwner(this);
 			(*it)->setValues(ups);
 			ups->setPos(this->pos);
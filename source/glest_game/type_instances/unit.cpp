@@ -327,7 +327,7 @@ void UnitAttackBoostEffect::applyLoadedAttackBoostParticles(UnitParticleSystemTy
 			*upst = *upstPtr;
 			upst->loadGame(node);
 
-			ups = new UnitParticleSystem(200);
+			ups = UnitParticleSystem::create(200);
 			//ups->loadGame(node2);
 			ups->setParticleOwner(unit);
 			upst->setValues(ups);
@@ -1288,7 +1288,7 @@ void Unit::setCurrSkill(const SkillType *currSkill) {
 			if((*it)->getStartTime() == 0.0) {
 				//printf("Adding NON-queued particle system type [%s] [%f] [%f]\n",(*it)->getType().c_str(),(*it)->getStartTime(),(*it)->getEndTime());
 
-				UnitParticleSystem *ups = new UnitParticleSystem(200);
+				UnitParticleSystem *ups = UnitParticleSystem::create(200);
 				ups->setParticleOwner(this);
 				(*it)->setValues(ups);
 				ups->setPos(getCurrVector());
@@ -2332,7 +2332,7 @@ void Unit::updateAttackBoostProgress(const Game* game) {
 						*currentAttackBoostOriginatorEffect.currentAppliedEffect->upst = *attackBoost->unitParticleSystemTypeForSourceUnit;
 						//effect.upst = boost->unitParticleSystemTypeForAffectedUnit;
 
-						currentAttackBoostOriginatorEffect.currentAppliedEffect->ups = new UnitParticleSystem(200);
+						currentAttackBoostOriginatorEffect.currentAppliedEffect->ups = UnitParticleSystem::create(200);
 						currentAttackBoostOriginatorEffect.currentAppliedEffect->ups->setParticleOwner(this);
 						currentAttackBoostOriginatorEffect.currentAppliedEffect->upst->setValues(
 								currentAttackBoostOriginatorEffect.currentAppliedEffect->ups);
@@ -2443,7 +2443,7 @@ void Unit::updateAttackBoostProgress(const Game* game) {
 						*currentAttackBoostOriginatorEffect.currentAppliedEffect->upst = *attackBoost->unitParticleSystemTypeForSourceUnit;
 						//effect.upst = boost->unitParticleSystemTypeForAffectedUnit;
 
-						currentAttackBoostOriginatorEffect.currentAppliedEffect->ups = new UnitParticleSystem(200);
+						currentAttackBoostOriginatorEffect.currentAppliedEffect->ups = UnitParticleSystem::create(200);
 						currentAttackBoostOriginatorEffect.currentAppliedEffect->ups->setParticleOwner(this);
 						currentAttackBoostOriginatorEffect.currentAppliedEffect->upst->setValues(
 								currentAttackBoostOriginatorEffect.currentAppliedEffect->ups);
@@ -2710,7 +2710,7 @@ void Unit::updateTimedParticles() {
 			if(pst != NULL) {
 				if(truncateDecimal<float>(pst->getStartTime(),6) <= truncateDecimal<float>(getAnimProgressAsFloat(),6)) {
 
-					UnitParticleSystem *ups = new UnitParticleSystem(200);
+					UnitParticleSystem *ups = UnitParticleSystem::create(200);
 					ups->setParticleOwner(this);
 					pst->setValues(ups);
 					ups->setPos(getCurrVector());
@@ -2851,7 +2851,7 @@ bool Unit::applyAttackBoost(const AttackBoost *boost, const Unit *source) {
 				*effect->upst = *boost->unitParticleSystemTypeForAffectedUnit;
 				//effect.upst = boost->unitParticleSystemTypeForAffectedUnit;
 
-				effect->ups = new UnitParticleSystem(200);
+				effect->ups = UnitParticleSystem::create(200);
 				effect->ups->setParticleOwner(this);
 				effect->upst->setValues(effect->ups);
 				effect->ups->setPos(getCurrVector());
@@ -3979,7 +3979,7 @@ void Unit::checkCustomizedParticleTriggers(bool force) {
 				if(showParticle == true) {
 					//printf("STARTING customized particle trigger by HP [%d to %d] current hp = %d\n",pst->getMinHp(),pst->getMaxHp(),hp);
 
-					UnitParticleSystem *ups = new UnitParticleSystem(200);
+					UnitParticleSystem *ups = UnitParticleSystem::create(200);
 					ups->setParticleOwner(this);
 					pst->setValues(ups);
 					ups->setPos(getCurrVector());
@@ -4006,7 +4006,7 @@ void Unit::startDamageParticles() {
 				UnitParticleSystemType *pst = type->damageParticleSystemTypes[i];
 
 				if(pst->getMinmaxEnabled() == false && damageParticleSystemsInUse.find(i) == damageParticleSystemsInUse.end()) {
-					UnitParticleSystem *ups = new UnitParticleSystem(200);
+					UnitParticleSystem *ups = UnitParticleSystem::create(200);
 					ups->setParticleOwner(this);
 					pst->setValues(ups);
 					ups->setPos(getCurrVector());
@@ -4024,7 +4024,7 @@ void Unit::startDamageParticles() {
 
 		// start fire
 		if(type->getProperty(UnitType::pBurnable) && this->fire == NULL) {
-			FireParticleSystem *fps = new FireParticleSystem(200);
+			FireParticleSystem *fps = FireParticleSystem::create(200);
 			fps->setParticleOwner(this);
 			const Game *game = Renderer::getInstance().getGame();
 			fps->setSpeed(2.5f / game->getWorld()->getUpdateFps(this->getFactionIndex()));
@@ -4038,7 +4038,7 @@ void Unit::startDamageParticles() {
 			Renderer::getInstance().manageParticleSystem(fps, rsGame);
 			if(showUnitParticles == true) {
 				// smoke
-				UnitParticleSystem *ups= new UnitParticleSystem(400);
+				UnitParticleSystem *ups= UnitParticleSystem::create(400);
 				ups->setParticleOwner(this);
 				ups->setColorNoEnergy(Vec4f(0.0f, 0.0f, 0.0f, 0.13f));
 				ups->setColor(Vec4f(0.115f, 0.115f, 0.115f, 0.22f));
@@ -4114,19 +4114,7 @@ void Unit::exploreCells() {
 			throw megaglest_runtime_error("game->getWorld() == NULL");
 		}
 
-		// Try the local unit exploration cache
-		if(cacheExploredCellsKey.first == newPos &&
-			cacheExploredCellsKey.second == sightRange) {
-			game->getWorld()->exploreCells(teamIndex, cacheExploredCells);
-		}
-		else {
-			// Try the world exploration scan or possible cache
-			cacheExploredCells = game->getWorld()->exploreCells(newPos, sightRange, teamIndex);
-
-			// Cache the result for this unit
-			cacheExploredCellsKey.first = newPos;
-			cacheExploredCellsKey.second = sightRange;
-		}
+		game->getWorld()->exploreCells(newPos, sightRange, teamIndex);
 	}
 }
 
@@ -4348,11 +4336,6 @@ void Unit::clearCaches() {
 	cachedFow.surfPosAlphaList.clear();
 	cachedFowPos = Vec2i(0,0);
 
-	cacheExploredCells.exploredCellList.clear();
-	cacheExploredCells.visibleCellList.clear();
-	cacheExploredCellsKey.first = Vec2i(-1,-1);
-	cacheExploredCellsKey.second = -1;
-
 	if(unitPath != NULL) {
 		unitPath->clearCaches();
 	}
@@ -4994,7 +4977,7 @@ Unit * Unit::loadGame(const XmlNode *rootNode, GameSettings *settings, Faction *
 //	}
 	if(unitNode->hasChild("FireParticleSystem") == true) {
 		XmlNode *fireNode = unitNode->getChild("FireParticleSystem");
-		result->fire = new FireParticleSystem();
+		result->fire = FireParticleSystem::create();
 		result->fire->setParticleOwner(result);
 		result->fire->loadGame(fireNode);
 		//result->fire->setTexture(CoreData::getInstance().getFireTexture());
@@ -5042,7 +5025,7 @@ Unit * Unit::loadGame(const XmlNode *rootNode, GameSettings *settings, Faction *
 		for(unsigned int i = 0; i < unitParticleSystemNodeList.size(); ++i) {
 			XmlNode *node = unitParticleSystemNodeList[i];
 
-			UnitParticleSystem *ups = new UnitParticleSystem();
+			UnitParticleSystem *ups = UnitParticleSystem::create();
 			ups->setParticleOwner(result);
 			ups->loadGame(node);
 			result->unitParticleSystems.push_back(ups);
@@ -5069,7 +5052,7 @@ Unit * Unit::loadGame(const XmlNode *rootNode, GameSettings *settings, Faction *
 		for(unsigned int i = 0; i < unitParticleSystemNodeList.size(); ++i) {
 			XmlNode *node = unitParticleSystemNodeList[i];
 
-			UnitParticleSystem *ups = new UnitParticleSystem();
+			UnitParticleSystem *ups = UnitParticleSystem::create();
 			ups->setParticleOwner(result);
 			ups->loadGame(node);
 			result->damageParticleSystems.push_back(ups);
@@ -5098,7 +5081,7 @@ Unit * Unit::loadGame(const XmlNode *rootNode, GameSettings *settings, Faction *
 //			for(unsigned int i = 0; i < unitParticleSystemNodeList.size(); ++i) {
 //				XmlNode *node = unitParticleSystemNodeList[i];
 //
-//				UnitParticleSystem *ups = new UnitParticleSystem();
+//				UnitParticleSystem *ups = UnitParticleSystem::create();
 //				ups->loadGame(node);
 //				result->unitParticleSystems.push_back(ups);
 //
@@ -5125,7 +5108,7 @@ Unit * Unit::loadGame(const XmlNode *rootNode, GameSettings *settings, Faction *
 		for(int i = 0; i < (int)unitParticleSystemNodeList.size(); ++i) {
 			XmlNode *node = unitParticleSystemNodeList[i];
 
-			FireParticleSystem *ups = new FireParticleSystem();
+			FireParticleSystem *ups = FireParticleSystem::create();
 			ups->loadGame(node);
 			//ups->setTexture(CoreData::getInstance().getFireTexture());
 			result->fireParticleSystems.push_back(ups);
@@ -5150,7 +5133,7 @@ Unit * Unit::loadGame(const XmlNode *rootNode, GameSettings *settings, Faction *
 			XmlNode *node = unitParticleSystemNodeList[i];
 
 //			printf("Load Smoke particle i = %d\n",i);
-			UnitParticleSystem *ups = new UnitParticleSystem();
+			UnitParticleSystem *ups = UnitParticleSystem::create();
 			ups->setParticleOwner(result);
 			ups->loadGame(node);
 			//ups->setTexture(CoreData::getInstance().getFireTexture());
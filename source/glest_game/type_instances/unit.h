@@ -485,9 +485,6 @@ private:
 	FowAlphaCellsLookupItem cachedFow;
 	Vec2i cachedFowPos;
 
-	ExploredCellsLookupItem cacheExploredCells;
-	std::pair<Vec2i, int> cacheExploredCellsKey;
-
 	Vec2i lastHarvestedResourcePos;
 
 	string networkCRCLogInfo;
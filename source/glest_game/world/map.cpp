@@ -13,6 +13,7 @@
 #include "map.h"
 
 #include <cassert>
+#include <algorithm>
 
 #include "tileset.h"
 #include "unit.h"
@@ -131,11 +132,8 @@ SurfaceCell::SurfaceCell() {
 	surfaceTexture= NULL;
 	nearSubmerged = false;
 	cellChangedFromOriginalMapLoad = false;
-
-	for(int i = 0; i < GameConstants::maxPlayers + GameConstants::specialFactions; ++i) {
-		visible[i] = false;
-		explored[i] = false;
-	}
+	visibility= NULL;
+	visibilityIndex= 0;
 }
 
 SurfaceCell::~SurfaceCell() {
@@ -170,12 +168,12 @@ bool SurfaceCell::decAmount(int value) {
 	return object->getResource()->decAmount(value);
 }
 void SurfaceCell::setExplored(int teamIndex, bool explored) {
-	this->explored[teamIndex]= explored;
+	visibility->setExplored(teamIndex, visibilityIndex, explored);
 	//printf("Setting explored to %d for teamIndex %d\n",explored,teamIndex);
 }
 
 void SurfaceCell::setVisible(int teamIndex, bool visible) {
-    this->visible[teamIndex]= visible;
+	visibility->setVisible(teamIndex, visibilityIndex, visible);
 }
 
 void SurfaceCell::saveGame(XmlNode *rootNode,int index) const {
@@ -276,6 +274,48 @@ void SurfaceCell::loadGame(const XmlNode *rootNode, int index, World *world) {
 //		}
 	}
 }
+// =====================================================
+// 	class MoveCellCache
+// =====================================================
+
+MoveCellCache::MoveCellCache() {
+	map = NULL;
+	unit = NULL;
+	field = fLand;
+	teamIndex = -1;
+	harvesting = false;
+	cellsVersion = 0;
+	stamp = 0;
+}
+
+void MoveCellCache::begin(const Map *map, const Unit *unit) {
+	this->map = map;
+	this->unit = unit;
+	originPos = unit->getPosNotThreadSafe();
+	field = unit->getCurrField();
+	teamIndex = unit->getTeam();
+	cellsVersion = map->getCellsVersion();
+
+	harvesting = false;
+	Command *command= unit->getCurrCommand();
+	if(command != NULL) {
+		harvesting = (dynamic_cast<const HarvestCommandType*>(command->getCommandType()) != NULL);
+	}
+
+	if((int)cells.size() != map->getCellArraySize()) {
+		cells.assign(map->getCellArraySize(), 0);
+		stamp = 0;
+	}
+
+	// results of earlier searches are ignored once the stamp moves on, the
+	// stamp is stored shifted left by one so it has to wrap before the top bit
+	stamp++;
+	if(stamp >= 0x7FFFFFFF) {
+		std::fill(cells.begin(), cells.end(), 0);
+		stamp = 1;
+	}
+}
+
 // =====================================================
 // 	class Map
 // =====================================================
@@ -302,6 +342,7 @@ Map::Map() {
 	surfaceSize=(surfaceW * surfaceH);
 	maxPlayers=0;
 	maxMapHeight=0;
+	cellsVersion=0;
 }
 
 Map::~Map() {
@@ -428,7 +469,12 @@ Checksum Map::load(const string &path, TechTree *techTree, Tileset *tileset) {
 
 			//cells
 			cells= new Cell[getCellArraySize()];
+			unitCellGrid.init(w, h);
 			surfaceCells= new SurfaceCell[getSurfaceCellArraySize()];
+			surfaceVisibility.init(getSurfaceCellArraySize());
+			for(int i = 0; i < getSurfaceCellArraySize(); ++i) {
+				surfaceCells[i].setVisibility(&surfaceVisibility, i);
+			}
 
 			//read heightmap
 			for(int j = 0; j < surfaceH; ++j) {
@@ -773,12 +819,13 @@ bool Map::isFreeCellOrHasUnit(const Vec2i &pos, Field field, const Unit *unit) c
 
 bool Map::isAproxFreeCell(const Vec2i &pos, Field field, int teamIndex) const {
 	if(isInside(pos) && isInsideSurface(toSurfCoords(pos))) {
-		const SurfaceCell *sc= getSurfaceCell(toSurfCoords(pos));
+		const Vec2i sPos= toSurfCoords(pos);
 
-		if(sc->isVisible(teamIndex)) {
+		if(isSurfaceVisible(teamIndex, sPos)) {
 			return isFreeCell(pos, field);
 		}
-		else if(sc->isExplored(teamIndex)) {
+		else if(isSurfaceExplored(teamIndex, sPos)) {
+			const SurfaceCell *sc= getSurfaceCell(sPos);
 			return field==fLand? sc->isFree() && !getDeepSubmerged(getCell(pos)): true;
 		}
 		else {
@@ -858,45 +905,20 @@ bool Map::canOccupy(const Vec2i &pos, Field field, const UnitType *ut, CardinalD
 // ==================== unit placement ====================
 
 //checks if a unit can move from between 2 cells
-bool Map::canMove(const Unit *unit, const Vec2i &pos1, const Vec2i &pos2, std::map<Vec2i, std::map<Vec2i, std::map<int, std::map<Field,bool> > > > *lookupCache) const {
+bool Map::canMove(const Unit *unit, const Vec2i &pos1, const Vec2i &pos2) const {
 	int size= unit->getType()->getSize();
 	Field field= unit->getCurrField();
 
-	if(lookupCache != NULL) {
-		std::map<Vec2i, std::map<Vec2i, std::map<int, std::map<Field,bool> > > >::const_iterator iterFind1 = lookupCache->find(pos1);
-		if(iterFind1 != lookupCache->end()) {
-			std::map<Vec2i, std::map<int, std::map<Field,bool> > >::const_iterator iterFind2 = iterFind1->second.find(pos2);
-			if(iterFind2 != iterFind1->second.end()) {
-				std::map<int, std::map<Field,bool> >::const_iterator iterFind3 = iterFind2->second.find(size);
-				if(iterFind3 != iterFind2->second.end()) {
-					std::map<Field,bool>::const_iterator iterFind4 = iterFind3->second.find(field);
-					if(iterFind4 != iterFind3->second.end()) {
-						// Found this result in the cache
-						return iterFind4->second;
-					}
-				}
-			}
-		}
-	}
-
 	for(int i=pos2.x; i<pos2.x+size; ++i) {
 		for(int j=pos2.y; j<pos2.y+size; ++j) {
 			if(isInside(i, j) && isInsideSurface(toSurfCoords(Vec2i(i,j)))) {
 				if(getCell(i, j)->getUnit(field) != unit) {
 					if(isFreeCell(Vec2i(i, j), field) == false) {
-						if(lookupCache != NULL) {
-							(*lookupCache)[pos1][pos2][size][field]=false;
-						}
-
 						return false;
 					}
 				}
 			}
 			else {
-				if(lookupCache != NULL) {
-					(*lookupCache)[pos1][pos2][size][field]=false;
-				}
-
 				return false;
 			}
 		}
@@ -914,22 +936,14 @@ bool Map::canMove(const Unit *unit, const Vec2i &pos1, const Vec2i &pos2, std::m
 	//}
 
 	if(isBadHarvestPos == true) {
-		if(lookupCache != NULL) {
-			(*lookupCache)[pos1][pos2][size][field]=false;
-		}
-
 		return false;
 	}
 
-	if(lookupCache != NULL) {
-		(*lookupCache)[pos1][pos2][size][field]=true;
-	}
-
     return true;
 }
 
 //checks if a unit can move from between 2 cells using only visible cells (for pathfinding)
-bool Map::aproxCanMove(const Unit *unit, const Vec2i &pos1, const Vec2i &pos2, std::map<Vec2i, std::map<Vec2i, std::map<int, std::map<int, std::map<Field,bool> > > > > *lookupCache) const {
+bool Map::aproxCanMove(const Unit *unit, const Vec2i &pos1, const Vec2i &pos2) const {
 	if(isInside(pos1) == false || isInsideSurface(toSurfCoords(pos1)) == false ||
 	   isInside(pos2) == false || isInsideSurface(toSurfCoords(pos2)) == false) {
 
@@ -944,45 +958,14 @@ bool Map::aproxCanMove(const Unit *unit, const Vec2i &pos1, const Vec2i &pos2, s
 	int teamIndex= unit->getTeam();
 	Field field= unit->getCurrField();
 
-	if(lookupCache != NULL) {
-		std::map<Vec2i, std::map<Vec2i, std::map<int, std::map<int, std::map<Field,bool> > > > >::const_iterator iterFind1 = lookupCache->find(pos1);
-		if(iterFind1 != lookupCache->end()) {
-			std::map<Vec2i, std::map<int, std::map<int, std::map<Field,bool> > > >::const_iterator iterFind2 = iterFind1->second.find(pos2);
-			if(iterFind2 != iterFind1->second.end()) {
-				std::map<int, std::map<int, std::map<Field,bool> > >::const_iterator iterFind3 = iterFind2->second.find(teamIndex);
-				if(iterFind3 != iterFind2->second.end()) {
-					std::map<int, std::map<Field,bool> >::const_iterator iterFind4 = iterFind3->second.find(size);
-					if(iterFind4 != iterFind3->second.end()) {
-						std::map<Field,bool>::const_iterator iterFind5 = iterFind4->second.find(field);
-						if(iterFind5 != iterFind4->second.end()) {
-							// Found this result in the cache
-							if(iterFind5->second == false) {
-								//printf("[%s] Line: %d returning false\n",__FUNCTION__,__LINE__);
-							}
-							return iterFind5->second;
-						}
-					}
-				}
-			}
-		}
-	}
-
 	//single cell units
 	if(size == 1) {
 		if(isAproxFreeCell(pos2, field, teamIndex) == false) {
-			if(lookupCache != NULL) {
-				(*lookupCache)[pos1][pos2][teamIndex][size][field]=false;
-			}
-
 			//printf("[%s] Line: %d returning false\n",__FUNCTION__,__LINE__);
 			return false;
 		}
 		if(pos1.x != pos2.x && pos1.y != pos2.y) {
 			if(isAproxFreeCell(Vec2i(pos1.x, pos2.y), field, teamIndex) == false) {
-				if(lookupCache != NULL) {
-					(*lookupCache)[pos1][pos2][teamIndex][size][field]=false;
-				}
-
 				//Unit *cellUnit = getCell(Vec2i(pos1.x, pos2.y))->getUnit(field);
 				//Object * obj = getSurfaceCell(toSurfCoords(Vec2i(pos1.x, pos2.y)))->getObject();
 
@@ -991,10 +974,6 @@ bool Map::aproxCanMove(const Unit *unit, const Vec2i &pos1, const Vec2i &pos2, s
 				return false;
 			}
 			if(isAproxFreeCell(Vec2i(pos2.x, pos1.y), field, teamIndex) == false) {
-				if(lookupCache != NULL) {
-					(*lookupCache)[pos1][pos2][teamIndex][size][field]=false;
-				}
-
 				//printf("[%s] Line: %d returning false\n",__FUNCTION__,__LINE__);
 				return false;
 			}
@@ -1012,18 +991,10 @@ bool Map::aproxCanMove(const Unit *unit, const Vec2i &pos1, const Vec2i &pos2, s
 		//}
 
 		if(unit == NULL || isBadHarvestPos == true) {
-			if(lookupCache != NULL) {
-				(*lookupCache)[pos1][pos2][teamIndex][size][field]=false;
-			}
-
 			//printf("[%s] Line: %d returning false\n",__FUNCTION__,__LINE__);
 			return false;
 		}
 
-		if(lookupCache != NULL) {
-			(*lookupCache)[pos1][pos2][teamIndex][size][field]=true;
-		}
-
 		return true;
 	}
 	//multi cell units
@@ -1035,10 +1006,6 @@ bool Map::aproxCanMove(const Unit *unit, const Vec2i &pos1, const Vec2i &pos2, s
 				if(isInside(cellPos) && isInsideSurface(toSurfCoords(cellPos))) {
 					if(getCell(cellPos)->getUnit(unit->getCurrField()) != unit) {
 						if(isAproxFreeCell(cellPos, field, teamIndex) == false) {
-							if(lookupCache != NULL) {
-								(*lookupCache)[pos1][pos2][teamIndex][size][field]=false;
-							}
-
 							//printf("[%s] Line: %d returning false\n",__FUNCTION__,__LINE__);
 							return false;
 						}
@@ -1046,10 +1013,6 @@ bool Map::aproxCanMove(const Unit *unit, const Vec2i &pos1, const Vec2i &pos2, s
 				}
 				else {
 
-					if(lookupCache != NULL) {
-						(*lookupCache)[pos1][pos2][teamIndex][size][field]=false;
-					}
-
 					//printf("[%s] Line: %d returning false\n",__FUNCTION__,__LINE__);
 					return false;
 				}
@@ -1066,17 +1029,10 @@ bool Map::aproxCanMove(const Unit *unit, const Vec2i &pos1, const Vec2i &pos2, s
 		}
 
 		if(isBadHarvestPos == true) {
-			if(lookupCache != NULL) {
-				(*lookupCache)[pos1][pos2][teamIndex][size][field]=false;
-			}
-
 			//printf("[%s] Line: %d returning false\n",__FUNCTION__,__LINE__);
 			return false;
 		}
 
-		if(lookupCache != NULL) {
-			(*lookupCache)[pos1][pos2][teamIndex][size][field]=true;
-		}
 	}
 	return true;
 }
@@ -1347,11 +1303,11 @@ void Map::putUnitCellsPrivate(Unit *unit, const Vec2i &pos, const UnitType *ut,
 								   getCell(currPos)->getUnit(field) == unit) {
 					if(isMorph) {
 						// unit is beeing morphed to another unit with maybe other field.
-						getCell(currPos)->setUnit(field, unit);
+						setCellUnit(currPos, field, unit);
 						canPutInCell = false;
 					}
 					if(canPutInCell == true) {
-						getCell(currPos)->setUnit(unit->getCurrField(), unit);
+						setCellUnit(currPos, unit->getCurrField(), unit);
 					}
 				}
 				else if(canPutInCell == true) {
@@ -1375,6 +1331,10 @@ void Map::putUnitCellsPrivate(Unit *unit, const Vec2i &pos, const UnitType *ut,
 	if(canPutInCell == true) {
         unit->setPos(pos);
 	}
+
+	if(ut->isMobile() == false) {
+		notifyStaticCellsChanged(pos, ut->getSize());
+	}
 }
 
 //removes a unit from cells
@@ -1425,7 +1385,7 @@ void Map::clearUnitCells(Unit *unit, const Vec2i &pos, bool ignoreSkill) {
 
                 // Only clear the cell if its the unit we expect to clear out of it
                 if(getCell(currPos)->getUnit(currentField) == unit) {
-                    getCell(currPos)->setUnit(currentField, NULL);
+                    setCellUnit(currPos, currentField, NULL);
                 }
 			}
 			else if(ut->hasCellMap() == true &&
@@ -1440,6 +1400,38 @@ void Map::clearUnitCells(Unit *unit, const Vec2i &pos, bool ignoreSkill) {
 			}
 		}
 	}
+
+	if(ut->isMobile() == false) {
+		notifyStaticCellsChanged(pos, ut->getSize());
+	}
+}
+
+void Map::setCellUnit(const Vec2i &pos, int field, Unit *unit) {
+	Cell *cell = getCell(pos);
+	Unit *oldUnit = cell->getUnit(field);
+	cell->setUnit(field, unit);
+	cellsVersion++;
+	unitCellGrid.setCellUnit(pos.x, pos.y, field, oldUnit, unit);
+}
+
+void Map::addStaticCellsCallback(MapStaticCellsCallbackInterface *cb) {
+	if(cb != NULL && std::find(staticCellsCallbacks.begin(),staticCellsCallbacks.end(),cb) == staticCellsCallbacks.end()) {
+		staticCellsCallbacks.push_back(cb);
+	}
+}
+
+void Map::removeStaticCellsCallback(MapStaticCellsCallbackInterface *cb) {
+	vector<MapStaticCellsCallbackInterface *>::iterator iterFind = std::find(staticCellsCallbacks.begin(),staticCellsCallbacks.end(),cb);
+	if(iterFind != staticCellsCallbacks.end()) {
+		staticCellsCallbacks.erase(iterFind);
+	}
+}
+
+void Map::notifyStaticCellsChanged(const Vec2i &pos, int size) {
+	cellsVersion++;
+	for(unsigned int i = 0; i < (unsigned int)staticCellsCallbacks.size(); ++i) {
+		staticCellsCallbacks[i]->staticCellsChanged(pos, size);
+	}
 }
 
 // ==================== misc ====================
@@ -1734,54 +1726,17 @@ void Map::saveGame(XmlNode *rootNode) const {
 //	SurfaceCell *surfaceCells;
 	//printf("getSurfaceCellArraySize() = %d\n",getSurfaceCellArraySize());
 
-	string exploredList = "";
-	string visibleList = "";
-
 	for(unsigned int i = 0; i < (unsigned int)getSurfaceCellArraySize(); ++i) {
 		SurfaceCell &surfaceCell = surfaceCells[i];
-
-		if(exploredList != "") {
-			exploredList += ",";
-		}
-
-		for(unsigned int j = 0; j < (unsigned int)GameConstants::maxPlayers; ++j) {
-			if(j > 0) {
-				exploredList += "|";
-			}
-
-			exploredList += intToStr(surfaceCell.isExplored(j));
-		}
-
-		if(visibleList != "") {
-			visibleList += ",";
-		}
-
-		for(unsigned int j = 0; j < (unsigned int)GameConstants::maxPlayers; ++j) {
-			if(j > 0) {
-				visibleList += "|";
-			}
-
-			visibleList += intToStr(surfaceCell.isVisible(j));
-		}
-
 		surfaceCell.saveGame(mapNode,i);
-
-		if(i > 0 && i % 100 == 0) {
-			XmlNode *surfaceCellNode = mapNode->addChild("SurfaceCell");
-			surfaceCellNode->addAttribute("batchIndex",intToStr(i), mapTagReplacements);
-			surfaceCellNode->addAttribute("exploredList",exploredList, mapTagReplacements);
-			surfaceCellNode->addAttribute("visibleList",visibleList, mapTagReplacements);
-
-			exploredList = "";
-			visibleList = "";
-		}
 	}
 
-	if(exploredList != "") {
-		XmlNode *surfaceCellNode = mapNode->addChild("SurfaceCell");
-		surfaceCellNode->addAttribute("batchIndex",intToStr(getSurfaceCellArraySize()), mapTagReplacements);
-		surfaceCellNode->addAttribute("exploredList",exploredList, mapTagReplacements);
-		surfaceCellNode->addAttribute("visibleList",visibleList, mapTagReplacements);
+	// one packed explored and visible plane per team
+	for(unsigned int i = 0; i < (unsigned int)GameConstants::maxPlayers; ++i) {
+		XmlNode *surfaceVisibilityNode = mapNode->addChild("SurfaceVisibility");
+		surfaceVisibilityNode->addAttribute("team",intToStr(i), mapTagReplacements);
+		surfaceVisibilityNode->addAttribute("explored",surfaceVisibility.getExploredString(i), mapTagReplacements);
+		surfaceVisibilityNode->addAttribute("visible",surfaceVisibility.getVisibleString(i), mapTagReplacements);
 	}
 
 //	Vec2i *startLocations;
@@ -1823,6 +1778,19 @@ void Map::loadGame(const XmlNode *rootNode, World *world) {
 		surfaceCell.loadGame(mapNode,i,world);
 	}
 
+	vector<XmlNode *> surfaceVisibilityNodeList = mapNode->getChildList("SurfaceVisibility");
+	for(unsigned int i = 0; i < surfaceVisibilityNodeList.size(); ++i) {
+		XmlNode *surfaceVisibilityNode = surfaceVisibilityNodeList[i];
+
+		int teamIndex = surfaceVisibilityNode->getAttribute("team")->getIntValue();
+		if(teamIndex < 0 || teamIndex >= GameConstants::maxPlayers) {
+			throw megaglest_runtime_error("Invalid surface visibility team: " + intToStr(teamIndex));
+		}
+		surfaceVisibility.setExploredString(teamIndex,surfaceVisibilityNode->getAttribute("explored")->getValue());
+		surfaceVisibility.setVisibleString(teamIndex,surfaceVisibilityNode->getAttribute("visible")->getValue());
+	}
+
+	// saves made before the packed planes store a list per surface cell
 	int surfaceCellIndexExplored = 0;
 	int surfaceCellIndexVisible = 0;
 	vector<XmlNode *> surfaceCellNodeList = mapNode->getChildList("SurfaceCell");
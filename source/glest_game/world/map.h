@@ -28,6 +28,8 @@
 #include "unit_type.h"
 #include "command.h"
 #include "checksum.h"
+#include "unit_cell_grid.h"
+#include "surface_visibility.h"
 #include "leak_dumper.h"
 
 
@@ -130,9 +132,9 @@ private:
 	//object & resource
 	Object *object;
 
-	//visibility
-	bool visible[GameConstants::maxPlayers + GameConstants::specialFactions];
-    bool explored[GameConstants::maxPlayers + GameConstants::specialFactions];
+	//visibility, the flags live in the bit planes of the map
+	SurfaceVisibility *visibility;
+	int visibilityIndex;
 
 	//cache
 	bool nearSubmerged;
@@ -156,8 +158,8 @@ public:
 	inline const Vec2f &getSurfTexCoord() const		{return surfTexCoord;}
 	inline bool getNearSubmerged() const				{return nearSubmerged;}
 
-	inline bool isVisible(int teamIndex) const		{return visible[teamIndex];}
-	inline bool isExplored(int teamIndex) const		{return explored[teamIndex];}
+	inline bool isVisible(int teamIndex) const		{return visibility->isVisible(teamIndex, visibilityIndex);}
+	inline bool isExplored(int teamIndex) const		{return visibility->isExplored(teamIndex, visibilityIndex);}
 
 	//set
 	inline void setVertex(const Vec3f &vertex)			{this->vertex= vertex;}
@@ -171,6 +173,10 @@ public:
 	inline void setSurfTexCoord(const Vec2f &stc)		{this->surfTexCoord= stc;}
 	void setExplored(int teamIndex, bool explored);
     void setVisible(int teamIndex, bool visible);
+	inline void setVisibility(SurfaceVisibility *visibility, int index) {
+		this->visibility= visibility;
+		this->visibilityIndex= index;
+	}
     inline void setNearSubmerged(bool nearSubmerged)	{this->nearSubmerged= nearSubmerged;}
 
 	//misc
@@ -191,19 +197,54 @@ public:
 };
 
 
+// =====================================================
+// 	class MapStaticCellsCallbackInterface
+//
+///	Notified when cells become blocked or free for reasons
+///	other than mobile units moving (buildings, resources)
+// =====================================================
+
+class MapStaticCellsCallbackInterface {
+public:
+	virtual void staticCellsChanged(const Vec2i &pos, int size) = 0;
+
+	virtual ~MapStaticCellsCallbackInterface() {}
+};
+
 // =====================================================
 // 	class Map
 //
 ///	Represents the game map (and loads it from a gbm file)
 // =====================================================
 
-class FastAINodeCache {
+// =====================================================
+// 	class MoveCellCache
+//
+///	Remembers which cells one unit may step into while a
+///	single path search runs, using one stamped word per map
+///	cell so nothing is cleared or allocated per search
+// =====================================================
+
+class MoveCellCache {
+private:
+	const Map *map;
+	const Unit *unit;
+	Vec2i originPos;
+	Field field;
+	int teamIndex;
+	bool harvesting;
+	uint32 cellsVersion;
+	uint32 stamp;
+	// search stamp shifted left by one, the lowest bit holds the result
+	vector<uint32> cells;
+
 public:
-	FastAINodeCache(Unit *unit) {
-		this->unit = unit;
-	}
-	Unit *unit;
-	std::map<Vec2i,std::map<Vec2i,bool> > cachedCanMoveSoonList;
+	MoveCellCache();
+
+	void begin(const Map *map, const Unit *unit);
+	inline bool isValidFor(const Unit *unit) const;
+	inline bool isHarvesting() const	{ return harvesting; }
+	inline bool isAproxFreeCellOrMightBeFreeSoon(const Vec2i &pos);
 };
 
 class Map {
@@ -231,6 +272,12 @@ private:
 	float maxMapHeight;
 	string mapFile;
 
+	vector<MapStaticCellsCallbackInterface *> staticCellsCallbacks;
+	UnitCellGrid unitCellGrid;
+	SurfaceVisibility surfaceVisibility;
+	// changes whenever a unit enters or leaves a cell or static cells change
+	uint32 cellsVersion;
+
 private:
 	Map(Map&);
 	void operator=(Map&);
@@ -291,6 +338,7 @@ public:
 		return getSurfaceCell(sPos.x, sPos.y);
 	}
 
+	inline uint32 getCellsVersion() const								{return cellsVersion;}
 	inline int getW() const											{return w;}
 	inline int getH() const											{return h;}
 	inline int getSurfaceW() const										{return surfaceW;}
@@ -333,11 +381,27 @@ public:
 	bool canOccupy(const Vec2i &pos, Field field, const UnitType *ut, CardinalDir facing);
 
 	//unit placement
-	bool aproxCanMove(const Unit *unit, const Vec2i &pos1, const Vec2i &pos2, std::map<Vec2i, std::map<Vec2i, std::map<int, std::map<int, std::map<Field,bool> > > > > *lookupCache=NULL) const;
-	bool canMove(const Unit *unit, const Vec2i &pos1, const Vec2i &pos2,std::map<Vec2i, std::map<Vec2i, std::map<int, std::map<Field,bool> > > > *lookupCache=NULL) const;
+	bool aproxCanMove(const Unit *unit, const Vec2i &pos1, const Vec2i &pos2) const;
+	bool canMove(const Unit *unit, const Vec2i &pos1, const Vec2i &pos2) const;
     void putUnitCells(Unit *unit, const Vec2i &pos,bool ignoreSkill = false);
 	void clearUnitCells(Unit *unit, const Vec2i &pos,bool ignoreSkill = false);
 
+	void addStaticCellsCallback(MapStaticCellsCallbackInterface *cb);
+	void removeStaticCellsCallback(MapStaticCellsCallbackInterface *cb);
+	void notifyStaticCellsChanged(const Vec2i &pos, int size);
+
+	const UnitCellGrid * getUnitCellGrid() const { return &unitCellGrid; }
+
+	inline SurfaceVisibility * getSurfaceVisibility() { return &surfaceVisibility; }
+	inline const SurfaceVisibility * getSurfaceVisibility() const { return &surfaceVisibility; }
+	inline int getSurfaceCellIndex(const Vec2i &sPos) const { return sPos.y * surfaceW + sPos.x; }
+	inline bool isSurfaceVisible(int teamIndex, const Vec2i &sPos) const {
+		return surfaceVisibility.isVisible(teamIndex, getSurfaceCellIndex(sPos));
+	}
+	inline bool isSurfaceExplored(int teamIndex, const Vec2i &sPos) const {
+		return surfaceVisibility.isExplored(teamIndex, getSurfaceCellIndex(sPos));
+	}
+
 	Vec2i computeRefPos(const Selection *selection) const;
 	Vec2i computeDestPos(	const Vec2i &refUnitPos, const Vec2i &unitPos,
 							const Vec2i &commandPos) const;
@@ -374,12 +438,13 @@ public:
 
 	inline bool isAproxFreeCellOrMightBeFreeSoon(Vec2i originPos,const Vec2i &pos, Field field, int teamIndex) const {
 		if(isInside(pos) && isInsideSurface(toSurfCoords(pos))) {
-			const SurfaceCell *sc= getSurfaceCell(toSurfCoords(pos));
+			const Vec2i sPos= toSurfCoords(pos);
 
-			if(sc->isVisible(teamIndex)) {
+			if(isSurfaceVisible(teamIndex, sPos)) {
 				return isFreeCellOrMightBeFreeSoon(originPos, pos, field);
 			}
-			else if(sc->isExplored(teamIndex)) {
+			else if(isSurfaceExplored(teamIndex, sPos)) {
+				const SurfaceCell *sc= getSurfaceCell(sPos);
 				return field==fLand? sc->isFree() && !getDeepSubmerged(getCell(pos)): true;
 			}
 			else {
@@ -391,8 +456,15 @@ public:
 		return false;
 	}
 
+	inline bool isAproxFreeCellOrMightBeFreeSoon(const Unit *unit, MoveCellCache *moveCache, const Vec2i &pos) const {
+		if(moveCache != NULL) {
+			return moveCache->isAproxFreeCellOrMightBeFreeSoon(pos);
+		}
+		return isAproxFreeCellOrMightBeFreeSoon(unit->getPosNotThreadSafe(), pos, unit->getCurrField(), unit->getTeam());
+	}
+
 	//checks if a unit can move from between 2 cells using only visible cells (for pathfinding)
-	inline bool aproxCanMoveSoon(const Unit *unit, const Vec2i &pos1, const Vec2i &pos2) const {
+	inline bool aproxCanMoveSoon(const Unit *unit, const Vec2i &pos1, const Vec2i &pos2, MoveCellCache *moveCache=NULL) const {
 		if(isInside(pos1) == false || isInsideSurface(toSurfCoords(pos1)) == false ||
 		   isInside(pos2) == false || isInsideSurface(toSurfCoords(pos2)) == false) {
 
@@ -405,29 +477,36 @@ public:
 		}
 
 		int size= unit->getType()->getSize();
-		int teamIndex= unit->getTeam();
-		Field field= unit->getCurrField();
+
+		if(moveCache != NULL && moveCache->isValidFor(unit) == false) {
+			moveCache = NULL;
+		}
 
 		//single cell units
 		if(size == 1) {
-			if(isAproxFreeCellOrMightBeFreeSoon(unit->getPosNotThreadSafe(),pos2, field, teamIndex) == false) {
+			if(isAproxFreeCellOrMightBeFreeSoon(unit,moveCache,pos2) == false) {
 				return false;
 			}
 			if(pos1.x != pos2.x && pos1.y != pos2.y) {
-				if(isAproxFreeCellOrMightBeFreeSoon(unit->getPosNotThreadSafe(),Vec2i(pos1.x, pos2.y), field, teamIndex) == false) {
+				if(isAproxFreeCellOrMightBeFreeSoon(unit,moveCache,Vec2i(pos1.x, pos2.y)) == false) {
 					return false;
 				}
-				if(isAproxFreeCellOrMightBeFreeSoon(unit->getPosNotThreadSafe(),Vec2i(pos2.x, pos1.y), field, teamIndex) == false) {
+				if(isAproxFreeCellOrMightBeFreeSoon(unit,moveCache,Vec2i(pos2.x, pos1.y)) == false) {
 					return false;
 				}
 			}
 
 			bool isBadHarvestPos = false;
-			Command *command= unit->getCurrCommand();
-			if(command != NULL) {
-				const HarvestCommandType *hct = dynamic_cast<const HarvestCommandType*>(command->getCommandType());
-				if(hct != NULL && unit->isBadHarvestPos(pos2) == true) {
-					isBadHarvestPos = true;
+			if(moveCache != NULL) {
+				isBadHarvestPos = (moveCache->isHarvesting() == true && unit->isBadHarvestPos(pos2) == true);
+			}
+			else {
+				Command *command= unit->getCurrCommand();
+				if(command != NULL) {
+					const HarvestCommandType *hct = dynamic_cast<const HarvestCommandType*>(command->getCommandType());
+					if(hct != NULL && unit->isBadHarvestPos(pos2) == true) {
+						isBadHarvestPos = true;
+					}
 				}
 			}
 
@@ -445,7 +524,7 @@ public:
 					Vec2i cellPos = Vec2i(i,j);
 					if(isInside(cellPos) && isInsideSurface(toSurfCoords(cellPos))) {
 						if(getCell(cellPos)->getUnit(unit->getCurrField()) != unit) {
-							if(isAproxFreeCellOrMightBeFreeSoon(unit->getPosNotThreadSafe(),cellPos, field, teamIndex) == false) {
+							if(isAproxFreeCellOrMightBeFreeSoon(unit,moveCache,cellPos) == false) {
 								return false;
 							}
 						}
@@ -457,11 +536,16 @@ public:
 			}
 
 			bool isBadHarvestPos = false;
-			Command *command= unit->getCurrCommand();
-			if(command != NULL) {
-				const HarvestCommandType *hct = dynamic_cast<const HarvestCommandType*>(command->getCommandType());
-				if(hct != NULL && unit->isBadHarvestPos(pos2) == true) {
-					isBadHarvestPos = true;
+			if(moveCache != NULL) {
+				isBadHarvestPos = (moveCache->isHarvesting() == true && unit->isBadHarvestPos(pos2) == true);
+			}
+			else {
+				Command *command= unit->getCurrCommand();
+				if(command != NULL) {
+					const HarvestCommandType *hct = dynamic_cast<const HarvestCommandType*>(command->getCommandType());
+					if(hct != NULL && unit->isBadHarvestPos(pos2) == true) {
+						isBadHarvestPos = true;
+					}
 				}
 			}
 
@@ -484,8 +568,33 @@ private:
 	void computeNearSubmerged();
 	void computeCellColors();
     void putUnitCellsPrivate(Unit *unit, const Vec2i &pos, const UnitType *ut, bool isMorph);
+	void setCellUnit(const Vec2i &pos, int field, Unit *unit);
 };
 
+// =====================================================
+// 	class MoveCellCache inline methods
+// =====================================================
+
+inline bool MoveCellCache::isValidFor(const Unit *unit) const {
+	return (this->unit == unit && map != NULL &&
+			cellsVersion == map->getCellsVersion());
+}
+
+inline bool MoveCellCache::isAproxFreeCellOrMightBeFreeSoon(const Vec2i &pos) {
+	if(map->isInside(pos) == false) {
+		return false;
+	}
+
+	uint32 &cell = cells[pos.y * map->getW() + pos.x];
+	if((cell >> 1) == stamp) {
+		return (cell & 1) != 0;
+	}
+
+	bool result = map->isAproxFreeCellOrMightBeFreeSoon(originPos, pos, field, teamIndex);
+	cell = (stamp << 1) | (result == true ? 1 : 0);
+	return result;
+}
+
 
 // ===============================
 // 	class PosCircularIterator
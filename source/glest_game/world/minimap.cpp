@@ -55,6 +55,7 @@ void Minimap::init(int w, int h, const World *world, bool fogOfWar) {
 
 	this->fogOfWar = fogOfWar;
 	this->gameSettings = world->getGameSettings();
+	fowTexReset.requestFullUpdate();
 	Renderer &renderer= Renderer::getInstance();
 
 	if(SystemFlags::getSystemSettingType(SystemFlags::debugSystem).enabled) SystemFlags::OutputDebug(SystemFlags::debugSystem,"In [%s::%s Line: %d]\n",__FILE__,__FUNCTION__,__LINE__);
@@ -160,6 +161,7 @@ void Minimap::copyFowTexAlphaSurface() {
 	}
 }
 void Minimap::restoreFowTexAlphaSurface() {
+	fowTexReset.requestFullUpdate();
 	if(fowPixmap1 != NULL && fowPixmap1_default != NULL) {
 		fowPixmap1->copy(fowPixmap1_default);
 	}
@@ -170,7 +172,27 @@ void Minimap::restoreFowTexAlphaSurface() {
 
 void Minimap::setFogOfWar(bool value) {
 	fogOfWar = value;
+	fowTexReset.requestFullUpdate();
 	resetFowTex();
+	fowTexReset.requestFullUpdate();
+}
+
+void Minimap::setFowTexIncremental(bool value) {
+	fowTexReset.setIncremental(value);
+}
+
+void Minimap::addFowTexChangedRegion(int minX, int minY, int maxX, int maxY) {
+	fowTexReset.addChangedRegion(minX, minY, maxX, maxY);
+}
+
+void Minimap::resetFowTexChangedRegions() {
+	if(fowTex && fowPixmap0 && fowPixmap1) {
+		fowTexReset.resetChangedRegions(fowPixmap0, fowPixmap1, getFowTexResetMode(), exploredAlpha);
+	}
+}
+
+bool Minimap::needsFowTexRedraw(int minX, int minY, int maxX, int maxY) const {
+	return fowTexReset.needsRedraw(minX, minY, maxX, maxY);
 }
 
 void Minimap::copyFowTex() {
@@ -182,6 +204,7 @@ void Minimap::copyFowTex() {
 	}
 }
 void Minimap::restoreFowTex() {
+	fowTexReset.requestFullUpdate();
 	if(fowPixmap0 != NULL && fowPixmap0Copy != NULL) {
 		fowPixmap0->copy(fowPixmap0Copy);
 	}
@@ -196,49 +219,25 @@ void Minimap::resetFowTex() {
 		fowPixmap0= fowPixmap1;
 		fowPixmap1= tmpPixmap;
 
-		// Could turn off ONLY fog of war by setting below to false
-		bool overridefogOfWarValue = fogOfWar;
-
-		for(int indexPixelWidth = 0;
-				indexPixelWidth < fowTex->getPixmap()->getW();
-				++indexPixelWidth){
-			for(int indexPixelHeight = 0;
-					indexPixelHeight < fowTex->getPixmap()->getH();
-					++indexPixelHeight){
-				if ((fogOfWar == false && overridefogOfWarValue == false) &&
-					(gameSettings->getFlagTypes1() & ft1_show_map_resources) != ft1_show_map_resources) {
-					//printf("Line: %d\n",__LINE__);
-
-					float p0 = fowPixmap0->getPixelf(indexPixelWidth, indexPixelHeight);
-					float p1 = fowPixmap1->getPixelf(indexPixelWidth, indexPixelHeight);
-					if (p0 > p1) {
-						fowPixmap1->setPixel(indexPixelWidth, indexPixelHeight, p0);
-					}
-					else {
-						fowPixmap1->setPixel(indexPixelWidth, indexPixelHeight, p1);
-					}
-				}
-				else if((fogOfWar && overridefogOfWarValue) ||
-					(gameSettings->getFlagTypes1() & ft1_show_map_resources) != ft1_show_map_resources) {
-					//printf("Line: %d\n",__LINE__);
+		// an incremental update resets the pixels of the changed sight areas
+		// once World knows them, see resetFowTexChangedRegions
+		fowTexReset.beginTick(fowPixmap0, fowPixmap1, getFowTexResetMode(), exploredAlpha);
+	}
+}
 
-					float p0= fowPixmap0->getPixelf(indexPixelWidth, indexPixelHeight);
-					float p1= fowPixmap1->getPixelf(indexPixelWidth, indexPixelHeight);
+FowTextureReset::ResetMode Minimap::getFowTexResetMode() const {
+	// Could turn off ONLY fog of war by setting below to false
+	bool overridefogOfWarValue = fogOfWar;
 
-					if(p1 > exploredAlpha) {
-						fowPixmap1->setPixel(indexPixelWidth, indexPixelHeight, exploredAlpha);
-					}
-					if(p0 > p1) {
-						fowPixmap1->setPixel(indexPixelWidth, indexPixelHeight, p0);
-					}
-				}
-				else {
-					//printf("Line: %d\n",__LINE__);
-					fowPixmap1->setPixel(indexPixelWidth, indexPixelHeight, 1.f);
-				}
-			}
-		}
+	if ((fogOfWar == false && overridefogOfWarValue == false) &&
+		(gameSettings->getFlagTypes1() & ft1_show_map_resources) != ft1_show_map_resources) {
+		return FowTextureReset::rmNoFogOfWar;
+	}
+	else if((fogOfWar && overridefogOfWarValue) ||
+		(gameSettings->getFlagTypes1() & ft1_show_map_resources) != ft1_show_map_resources) {
+		return FowTextureReset::rmFogOfWar;
 	}
+	return FowTextureReset::rmShowAll;
 }
 
 void Minimap::updateFowTex(float t) {
@@ -323,6 +322,7 @@ void Minimap::loadGame(const XmlNode *rootNode) {
 			fowPixmap1->getPixels()[pixelIndex] = fowPixmap1Node->getAttribute("pixel")->getIntValue();
 		}
 	}
+	fowTexReset.requestFullUpdate();
 }
 
 }}//end namespace
@@ -19,6 +19,7 @@
 
 #include "pixmap.h"
 #include "texture.h"
+#include "fow_texture.h"
 #include "xml_parser.h"
 #include "leak_dumper.h"
 
@@ -29,6 +30,7 @@ using Shared::Graphics::Vec3f;
 using Shared::Graphics::Vec2i;
 using Shared::Graphics::Pixmap2D;
 using Shared::Graphics::Texture2D;
+using Shared::Graphics::FowTextureReset;
 using Shared::Xml::XmlNode;
 
 class World;
@@ -60,6 +62,9 @@ private:
 	bool fogOfWar;
 	const GameSettings *gameSettings;
 
+	// decides which fog of war pixels are reset each tick
+	FowTextureReset fowTexReset;
+
 private:
 	static const float exploredAlpha;
 
@@ -76,6 +81,15 @@ public:
 	void updateFowTex(float t);
 	void setFogOfWar(bool value);
 
+	void setFowTexIncremental(bool value);
+	bool isFowTexFullUpdate() const	{return fowTexReset.isFullUpdate();}
+	// incremental updates: World reports the area a sight was drawn to
+	// before and after it changed, then draws again every unchanged sight
+	// that needsFowTexRedraw after resetFowTexChangedRegions
+	void addFowTexChangedRegion(int minX, int minY, int maxX, int maxY);
+	void resetFowTexChangedRegions();
+	bool needsFowTexRedraw(int minX, int minY, int maxX, int maxY) const;
+
 	void copyFowTex();
 	void restoreFowTex();
 
@@ -87,6 +101,7 @@ public:
 
 private:
 	void computeTexture(const World *world);
+	FowTextureReset::ResetMode getFowTexResetMode() const;
 };
 
 }}//end namespace
@@ -0,0 +1,170 @@
+// ==============================================================
+//	This file is part of MegaGlest (www.megaglest.org)
+//
+//	Copyright (C) 2013 MegaGlest team
+//
+//	You can redistribute this code and/or modify it under
+//	the terms of the GNU General Public License as published
+//	by the Free Software Foundation; either version 2 of the
+//	License, or (at your option) any later version
+// ==============================================================
+
+#include "surface_visibility.h"
+#include "conversion.h"
+#include "platform_util.h"
+#include "leak_dumper.h"
+
+using namespace Shared::Platform;
+using namespace Shared::Util;
+
+namespace Glest{ namespace Game{
+
+// =====================================================
+// 	class SurfaceVisibility
+// =====================================================
+
+SurfaceVisibility::SurfaceVisibility() {
+	cellCount = 0;
+	wordCount = 0;
+}
+
+void SurfaceVisibility::init(int cellCount) {
+	this->cellCount = cellCount;
+	this->wordCount = (cellCount + cellsPerWord - 1) / cellsPerWord;
+
+	for(int i = 0; i < teamCount; ++i) {
+		visiblePlanes[i].assign(wordCount, 0);
+		exploredPlanes[i].assign(wordCount, 0);
+	}
+}
+
+void SurfaceVisibility::setAllVisible(int teamIndex, bool value) {
+	setAll(visiblePlanes[teamIndex], value);
+}
+
+void SurfaceVisibility::setAllExplored(int teamIndex, bool value) {
+	setAll(exploredPlanes[teamIndex], value);
+}
+
+void SurfaceVisibility::setVisibleSpan(int teamIndex, int cellIndex, int count, vector<int> *newCells) {
+	setSpan(visiblePlanes[teamIndex], cellIndex, count, newCells);
+}
+
+void SurfaceVisibility::setExploredSpan(int teamIndex, int cellIndex, int count, vector<int> *newCells) {
+	setSpan(exploredPlanes[teamIndex], cellIndex, count, newCells);
+}
+
+string SurfaceVisibility::getVisibleString(int teamIndex) const {
+	return planeToString(visiblePlanes[teamIndex]);
+}
+
+string SurfaceVisibility::getExploredString(int teamIndex) const {
+	return planeToString(exploredPlanes[teamIndex]);
+}
+
+void SurfaceVisibility::setVisibleString(int teamIndex, const string &value) {
+	planeFromString(visiblePlanes[teamIndex], value);
+}
+
+void SurfaceVisibility::setExploredString(int teamIndex, const string &value) {
+	planeFromString(exploredPlanes[teamIndex], value);
+}
+
+void SurfaceVisibility::setAll(vector<uint64> &plane, bool value) const {
+	if(value == false) {
+		plane.assign(wordCount, 0);
+		return;
+	}
+
+	plane.assign(wordCount, ~(uint64)0);
+	// keep the bits past the last cell clear
+	int tailBits = cellCount % cellsPerWord;
+	if(tailBits != 0) {
+		plane[wordCount - 1] = ((uint64)1 << tailBits) - 1;
+	}
+}
+
+void SurfaceVisibility::setSpan(vector<uint64> &plane, int cellIndex, int count, vector<int> *newCells) const {
+	if(cellIndex < 0) {
+		count += cellIndex;
+		cellIndex = 0;
+	}
+	if(cellIndex + count > cellCount) {
+		count = cellCount - cellIndex;
+	}
+	if(count <= 0) {
+		return;
+	}
+
+	int firstWord = cellIndex / cellsPerWord;
+	int lastWord = (cellIndex + count - 1) / cellsPerWord;
+	int firstBit = cellIndex % cellsPerWord;
+	int lastBit = (cellIndex + count - 1) % cellsPerWord;
+
+	uint64 firstMask = ~(uint64)0 << firstBit;
+	uint64 lastMask = ~(uint64)0 >> (cellsPerWord - 1 - lastBit);
+	if(firstWord == lastWord) {
+		setWordBits(plane, firstWord, firstMask & lastMask, newCells);
+		return;
+	}
+
+	setWordBits(plane, firstWord, firstMask, newCells);
+	for(int word = firstWord + 1; word < lastWord; ++word) {
+		setWordBits(plane, word, ~(uint64)0, newCells);
+	}
+	setWordBits(plane, lastWord, lastMask, newCells);
+}
+
+void SurfaceVisibility::setWordBits(vector<uint64> &plane, int word, uint64 mask, vector<int> *newCells) {
+	if(newCells != NULL) {
+		uint64 added = mask & ~plane[word];
+		for(int bit = 0; added != 0; ++bit, added >>= 1) {
+			if((added & 1) != 0) {
+				newCells->push_back(word * cellsPerWord + bit);
+			}
+		}
+	}
+	plane[word] |= mask;
+}
+
+string SurfaceVisibility::planeToString(const vector<uint64> &plane) {
+	static const char hexDigits[] = "0123456789abcdef";
+
+	string result;
+	result.reserve(plane.size() * 16);
+	for(unsigned int word = 0; word < plane.size(); ++word) {
+		for(int shift = 60; shift >= 0; shift -= 4) {
+			result += hexDigits[(plane[word] >> shift) & 0xF];
+		}
+	}
+	return result;
+}
+
+void SurfaceVisibility::planeFromString(vector<uint64> &plane, const string &value) const {
+	if((int)value.size() != wordCount * 16) {
+		throw megaglest_runtime_error("Invalid surface visibility data size: " + intToStr((int)value.size()) +
+									  " expected: " + intToStr(wordCount * 16));
+	}
+
+	plane.assign(wordCount, 0);
+	for(int word = 0; word < wordCount; ++word) {
+		uint64 bits = 0;
+		for(int digit = 0; digit < 16; ++digit) {
+			char c = value[word * 16 + digit];
+			int nibble = 0;
+			if(c >= '0' && c <= '9') {
+				nibble = c - '0';
+			}
+			else if(c >= 'a' && c <= 'f') {
+				nibble = c - 'a' + 10;
+			}
+			else {
+				throw megaglest_runtime_error("Invalid surface visibility data character: " + string(1,c));
+			}
+			bits = (bits << 4) | (uint64)nibble;
+		}
+		plane[word] = bits;
+	}
+}
+
+}}//end namespace
@@ -0,0 +1,110 @@
+// ==============================================================
+//	This file is part of MegaGlest (www.megaglest.org)
+//
+//	Copyright (C) 2013 MegaGlest team
+//
+//	You can redistribute this code and/or modify it under
+//	the terms of the GNU General Public License as published
+//	by the Free Software Foundation; either version 2 of the
+//	License, or (at your option) any later version
+// ==============================================================
+
+#ifndef _GLEST_GAME_SURFACEVISIBILITY_H_
+#define _GLEST_GAME_SURFACEVISIBILITY_H_
+
+#ifdef WIN32
+    #include <winsock2.h>
+    #include <winsock.h>
+#endif
+
+#include <cassert>
+#include <string>
+#include <vector>
+#include "data_types.h"
+#include "game_constants.h"
+#include "leak_dumper.h"
+
+using std::string;
+using std::vector;
+using Shared::Platform::uint64;
+
+namespace Glest{ namespace Game{
+
+// =====================================================
+// 	class SurfaceVisibility
+//
+///	Visible and explored flags of all surface cells, one bit
+///	plane per team packed 64 cells to a word in surface cell
+///	array order
+// =====================================================
+
+class SurfaceVisibility {
+public:
+	static const int teamCount = GameConstants::maxPlayers + GameConstants::specialFactions;
+	static const int cellsPerWord = 64;
+
+private:
+	int cellCount;
+	int wordCount;
+	vector<uint64> visiblePlanes[teamCount];
+	vector<uint64> exploredPlanes[teamCount];
+
+public:
+	SurfaceVisibility();
+
+	void init(int cellCount);
+	int getCellCount() const	{ return cellCount; }
+
+	inline bool isVisible(int teamIndex, int cellIndex) const {
+		return getBit(visiblePlanes[teamIndex], cellIndex);
+	}
+	inline bool isExplored(int teamIndex, int cellIndex) const {
+		return getBit(exploredPlanes[teamIndex], cellIndex);
+	}
+	inline void setVisible(int teamIndex, int cellIndex, bool value) {
+		setBit(visiblePlanes[teamIndex], cellIndex, value);
+	}
+	inline void setExplored(int teamIndex, int cellIndex, bool value) {
+		setBit(exploredPlanes[teamIndex], cellIndex, value);
+	}
+
+	void setAllVisible(int teamIndex, bool value);
+	void setAllExplored(int teamIndex, bool value);
+
+	// Sets count consecutive cells starting at cellIndex, a word at a time.
+	// The indexes of cells that were not set before are appended to newCells
+	void setVisibleSpan(int teamIndex, int cellIndex, int count, vector<int> *newCells=NULL);
+	void setExploredSpan(int teamIndex, int cellIndex, int count, vector<int> *newCells=NULL);
+
+	// compact hex form of a team plane for save games
+	string getVisibleString(int teamIndex) const;
+	string getExploredString(int teamIndex) const;
+	void setVisibleString(int teamIndex, const string &value);
+	void setExploredString(int teamIndex, const string &value);
+
+private:
+	inline static bool getBit(const vector<uint64> &plane, int cellIndex) {
+		assert(cellIndex >= 0 && cellIndex / cellsPerWord < (int)plane.size());
+		return ((plane[cellIndex / cellsPerWord] >> (cellIndex % cellsPerWord)) & 1) != 0;
+	}
+	inline static void setBit(vector<uint64> &plane, int cellIndex, bool value) {
+		assert(cellIndex >= 0 && cellIndex / cellsPerWord < (int)plane.size());
+		uint64 mask = ((uint64)1 << (cellIndex % cellsPerWord));
+		if(value == true) {
+			plane[cellIndex / cellsPerWord] |= mask;
+		}
+		else {
+			plane[cellIndex / cellsPerWord] &= ~mask;
+		}
+	}
+
+	void setAll(vector<uint64> &plane, bool value) const;
+	void setSpan(vector<uint64> &plane, int cellIndex, int count, vector<int> *newCells) const;
+	static void setWordBits(vector<uint64> &plane, int word, uint64 mask, vector<int> *newCells);
+	static string planeToString(const vector<uint64> &plane);
+	void planeFromString(vector<uint64> &plane, const string &value) const;
+};
+
+}}//end namespace
+
+#endif
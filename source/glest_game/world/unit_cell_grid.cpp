@@ -0,0 +1,144 @@
+// ==============================================================
+//	This file is part of MegaGlest (www.megaglest.org)
+//
+//	Copyright (C) 2013 MegaGlest team
+//
+//	You can redistribute this code and/or modify it under
+//	the terms of the GNU General Public License as published
+//	by the Free Software Foundation; either version 2 of the
+//	License, or (at your option) any later version
+// ==============================================================
+
+#include "unit_cell_grid.h"
+#include <algorithm>
+#include "unit.h"
+#include "util.h"
+#include "leak_dumper.h"
+
+using namespace Shared::Util;
+
+namespace Glest{ namespace Game{
+
+// =====================================================
+// 	class UnitCellGrid
+// =====================================================
+
+const int UnitCellGrid::bucketSize = 8;
+
+namespace {
+
+class UnitCellEntryScanOrder {
+public:
+	bool operator()(const UnitCellEntry &a, const UnitCellEntry &b) const {
+		if(a.x != b.x) {
+			return a.x < b.x;
+		}
+		if(a.y != b.y) {
+			return a.y < b.y;
+		}
+		return a.field < b.field;
+	}
+};
+
+}
+
+UnitCellGrid::UnitCellGrid() {
+	w = 0;
+	h = 0;
+	bucketW = 0;
+	bucketH = 0;
+	entryCount = 0;
+}
+
+void UnitCellGrid::init(int w, int h) {
+	this->w = w;
+	this->h = h;
+	bucketW = (w + bucketSize - 1) / bucketSize;
+	bucketH = (h + bucketSize - 1) / bucketSize;
+	clear();
+}
+
+void UnitCellGrid::clear() {
+	planes.clear();
+	entryCount = 0;
+}
+
+void UnitCellGrid::setCellUnit(int x, int y, int field, Unit *oldUnit, Unit *newUnit) {
+	if(oldUnit == newUnit || x < 0 || y < 0 || x >= w || y >= h) {
+		return;
+	}
+	int bucketIndex = getBucketIndex(x, y);
+
+	if(oldUnit != NULL) {
+		// search every plane so we never touch the previous occupant,
+		// it may be on its way out
+		bool removed = false;
+		for(unsigned int plane = 0; plane < planes.size() && removed == false; ++plane) {
+			Bucket &bucket = planes[plane][bucketIndex];
+			for(unsigned int i = 0; i < bucket.size(); ++i) {
+				const UnitCellEntry &entry = bucket[i];
+				if(entry.x == x && entry.y == y && entry.field == field) {
+					bucket[i] = bucket.back();
+					bucket.pop_back();
+					entryCount--;
+					removed = true;
+					break;
+				}
+			}
+		}
+	}
+
+	if(newUnit != NULL) {
+		int factionIndex = newUnit->getFactionIndex();
+		if(factionIndex < 0 || factionIndex >= 32) {
+			throw megaglest_runtime_error("Invalid faction index for unit cell grid: " + intToStr(factionIndex));
+		}
+		while((int)planes.size() <= factionIndex) {
+			planes.push_back(vector<Bucket>(bucketW * bucketH));
+		}
+		planes[factionIndex][bucketIndex].push_back(UnitCellEntry(x, y, field, newUnit));
+		entryCount++;
+	}
+}
+
+void UnitCellGrid::getEntries(int x0, int y0, int x1, int y1, unsigned int fieldMask,
+							  unsigned int factionMask, vector<UnitCellEntry> &result) const {
+	result.clear();
+
+	if(x0 < 0) x0 = 0;
+	if(y0 < 0) y0 = 0;
+	if(x1 > w) x1 = w;
+	if(y1 > h) y1 = h;
+	if(x0 >= x1 || y0 >= y1) {
+		return;
+	}
+
+	int bx0 = x0 / bucketSize;
+	int by0 = y0 / bucketSize;
+	int bx1 = (x1 - 1) / bucketSize;
+	int by1 = (y1 - 1) / bucketSize;
+
+	for(unsigned int plane = 0; plane < planes.size(); ++plane) {
+		if((factionMask & (1u << plane)) == 0) {
+			continue;
+		}
+		const vector<Bucket> &buckets = planes[plane];
+		for(int by = by0; by <= by1; ++by) {
+			for(int bx = bx0; bx <= bx1; ++bx) {
+				const Bucket &bucket = buckets[by * bucketW + bx];
+				for(unsigned int i = 0; i < bucket.size(); ++i) {
+					const UnitCellEntry &entry = bucket[i];
+					if(entry.x >= x0 && entry.x < x1 &&
+						entry.y >= y0 && entry.y < y1 &&
+						(fieldMask & (1u << entry.field)) != 0) {
+						result.push_back(entry);
+					}
+				}
+			}
+		}
+	}
+
+	std::sort(result.begin(), result.end(), UnitCellEntryScanOrder());
+}
+
+}}//end namespace
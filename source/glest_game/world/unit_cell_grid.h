@@ -0,0 +1,104 @@
+// ==============================================================
+//	This file is part of MegaGlest (www.megaglest.org)
+//
+//	Copyright (C) 2013 MegaGlest team
+//
+//	You can redistribute this code and/or modify it under
+//	the terms of the GNU General Public License as published
+//	by the Free Software Foundation; either version 2 of the
+//	License, or (at your option) any later version
+// ==============================================================
+
+#ifndef _GLEST_GAME_UNITCELLGRID_H_
+#define _GLEST_GAME_UNITCELLGRID_H_
+
+#ifdef WIN32
+    #include <winsock2.h>
+    #include <winsock.h>
+#endif
+
+#include <cstddef>
+#include <vector>
+#include "leak_dumper.h"
+
+using std::vector;
+
+namespace Glest{ namespace Game{
+
+class Unit;
+
+// =====================================================
+// 	class UnitCellEntry
+// =====================================================
+
+class UnitCellEntry {
+public:
+	UnitCellEntry() {
+		x = 0;
+		y = 0;
+		field = 0;
+		unit = NULL;
+	}
+	UnitCellEntry(int x, int y, int field, Unit *unit) {
+		this->x = x;
+		this->y = y;
+		this->field = field;
+		this->unit = unit;
+	}
+
+	int x;
+	int y;
+	int field;
+	Unit *unit;
+};
+
+// =====================================================
+// 	class UnitCellGrid
+//
+///	Mirror of the unit slots of the map cells, bucketed into
+///	coarse squares per faction so proximity queries only touch
+///	occupied cells instead of scanning every cell in range
+// =====================================================
+
+class UnitCellGrid {
+public:
+	static const int bucketSize;
+
+private:
+	typedef vector<UnitCellEntry> Bucket;
+
+	int w;
+	int h;
+	int bucketW;
+	int bucketH;
+	int entryCount;
+	// one plane of buckets per faction index
+	vector<vector<Bucket> > planes;
+
+public:
+	UnitCellGrid();
+
+	void init(int w, int h);
+	void clear();
+
+	// Must be called for every change of Cell::units, oldUnit is the previous
+	// occupant of the cell field (or NULL)
+	void setCellUnit(int x, int y, int field, Unit *oldUnit, Unit *newUnit);
+
+	// Collects the occupied cell fields in the box [x0,x1) x [y0,y1) whose field
+	// bit is set in fieldMask and whose faction bit is set in factionMask. The
+	// result is ordered by x, then y, then field, matching a cell by cell scan
+	void getEntries(int x0, int y0, int x1, int y1, unsigned int fieldMask,
+					unsigned int factionMask, vector<UnitCellEntry> &result) const;
+
+	int getEntryCount() const	{ return entryCount; }
+
+private:
+	inline int getBucketIndex(int x, int y) const {
+		return (y / bucketSize) * bucketW + (x / bucketSize);
+	}
+};
+
+}}//end namespace
+
+#endif
@@ -53,6 +53,7 @@ UnitUpdater::UnitUpdater() : mutexAttackWarnings(new Mutex(CODE_AT_LINE)),
 	this->pathFinder = NULL;
 	//UnitRangeCellsLookupItemCacheTimerCount = 0;
 	attackWarnRange=0;
+	useUnitCellGrid=false;
 }
 
 void UnitUpdater::init(Game *game){
@@ -67,11 +68,23 @@ void UnitUpdater::init(Game *game){
 	this->pathFinder = NULL;
 	attackWarnRange=Config::getInstance().getFloat("AttackWarnRange","50.0");
 	//UnitRangeCellsLookupItemCacheTimerCount = 0;
+	useUnitCellGrid=Config::getInstance().getBool("UnitUpdaterUseUnitCellGrid","true");
 
 	switch(this->game->getGameSettings()->getPathFinderType()) {
 		case pfBasic:
 			pathFinder = new PathFinder();
 			pathFinder->init(map);
+			if(isFlagType1BitEnabled(this->game->getGameSettings()->getFlagTypes1(),ft1_hierarchical_pathfinding) == true) {
+				pathFinder->enableHierarchicalPath(map);
+			}
+			if(isFlagType1BitEnabled(this->game->getGameSettings()->getFlagTypes1(),ft1_parallel_pathfinding) == true) {
+				// 0 workers means one per core, the calling thread counts as one
+				int threadCount = Config::getInstance().getInt("PathFinderRequestThreads","0");
+				if(threadCount <= 0) {
+					threadCount = getCPUCoreCount() - 1;
+				}
+				pathFinder->enablePathRequestQueue(threadCount);
+			}
 			break;
 		default:
 			throw megaglest_runtime_error("detected unsupported pathfinder type!");
@@ -84,6 +97,12 @@ void UnitUpdater::clearUnitPrecache(Unit *unit) {
 	}
 }
 
+void UnitUpdater::processPathRequests(int frameIndex) {
+	if(pathFinder != NULL) {
+		pathFinder->processPathRequests(frameIndex);
+	}
+}
+
 void UnitUpdater::removeUnitPrecache(Unit *unit) {
 	if(pathFinder != NULL) {
 		pathFinder->removeUnitPrecache(unit);
@@ -1692,6 +1711,7 @@ void UnitUpdater::updateHarvest(Unit *unit, int frameIndex) {
 								//const ResourceType *rt = r->getType();
 								sc->deleteResource();
 								world->removeResourceTargetFromCache(unitTargetPos);
+								map->notifyStaticCellsChanged(Map::toUnitCoords(Map::toSurfCoords(unitTargetPos)),Map::cellScale);
 
 								switch(this->game->getGameSettings()->getPathFinderType()) {
 									case pfBasic:
@@ -2687,6 +2707,61 @@ bool UnitUpdater::findCachedCellsEnemies(Vec2i center, int range, int size, vect
 	return result;
 }
 
+// the cell in range test shared by the cell scans and the unit cell grid
+static inline bool isCellOnRange(const Vec2f &floatCenter, int i, int j, int range) {
+#ifdef USE_STREFLOP
+	return streflop::floor(static_cast<streflop::Simple>(floatCenter.dist(Vec2f((float)i, (float)j)))) <= (range+1);
+#else
+	return floor(floatCenter.dist(Vec2f((float)i, (float)j))) <= (range+1);
+#endif
+}
+
+class UnitCellEntryFieldOrder {
+public:
+	bool operator()(const UnitCellEntry &a, const UnitCellEntry &b) const {
+		return a.field < b.field;
+	}
+};
+
+void UnitUpdater::findGridEnemies(const Vec2i &center, int range, int size, const Vec2f &floatCenter,
+								  const AttackSkillType *ast, const Unit *unit,
+								  const Unit *commandTarget, vector<Unit*> &enemies) {
+	unsigned int fieldMask = 0;
+	for(int k = 0; k < fieldCount; k++) {
+		if(ast == NULL || ast->getAttackField(static_cast<Field>(k))) {
+			fieldMask |= (1u << k);
+		}
+	}
+
+	unsigned int factionMask = 0;
+	if(commandTarget != NULL) {
+		factionMask = (1u << commandTarget->getFactionIndex());
+	}
+	else {
+		for(int i = 0; i < world->getFactionCount(); ++i) {
+			const Faction *faction = world->getFaction(i);
+			if(unit->getFaction()->isAlly(faction) == false) {
+				factionMask |= (1u << faction->getIndex());
+			}
+		}
+	}
+
+	vector<UnitCellEntry> entries;
+	map->getUnitCellGrid()->getEntries(center.x - range, center.y - range,
+			center.x + range + size, center.y + range + size,
+			fieldMask, factionMask, entries);
+
+	for(unsigned int i = 0; i < entries.size(); ++i) {
+		const UnitCellEntry &entry = entries[i];
+		Unit *possibleEnemy = entry.unit;
+		if(possibleEnemy->isAlive() &&
+			(commandTarget == NULL || commandTarget == possibleEnemy) &&
+			isCellOnRange(floatCenter, entry.x, entry.y, range) == true) {
+			enemies.push_back(possibleEnemy);
+		}
+	}
+}
+
 void UnitUpdater::findEnemiesForCell(const AttackSkillType *ast, Cell *cell, const Unit *unit,
 									 const Unit *commandTarget,vector<Unit*> &enemies) {
 	//all fields
@@ -2710,6 +2785,36 @@ void UnitUpdater::findEnemiesForCell(const AttackSkillType *ast, Cell *cell, con
 }
 
 void UnitUpdater::findEnemiesForCell(const Vec2i pos, int size, int sightRange, const Faction *faction, vector<Unit*> &enemies, bool attackersOnly) const {
+	if(useUnitCellGrid == true) {
+		unsigned int factionMask = 0;
+		for(int i = 0; i < world->getFactionCount(); ++i) {
+			const Faction *otherFaction = world->getFaction(i);
+			if(faction->getTeam() != otherFaction->getTeam()) {
+				factionMask |= (1u << otherFaction->getIndex());
+			}
+		}
+
+		vector<UnitCellEntry> entries;
+		map->getUnitCellGrid()->getEntries(pos.x - sightRange, pos.y - sightRange,
+				pos.x + size + sightRange, pos.y + size + sightRange,
+				(1u << fieldCount) - 1, factionMask, entries);
+		// the cell scan below visits each field in turn
+		std::stable_sort(entries.begin(), entries.end(), UnitCellEntryFieldOrder());
+
+		for(unsigned int i = 0; i < entries.size(); ++i) {
+			Unit *possibleEnemy = entries[i].unit;
+			if(possibleEnemy->isAlive() &&
+				map->isInsideSurface(map->toSurfCoords(Vec2i(entries[i].x,entries[i].y)))) {
+				if(attackersOnly == false ||
+					possibleEnemy->getType()->hasCommandClass(ccAttack) ||
+					possibleEnemy->getType()->hasCommandClass(ccAttackStopped)) {
+					enemies.push_back(possibleEnemy);
+				}
+			}
+		}
+		return;
+	}
+
 	//all fields
 	for(int k = 0; k < fieldCount; k++) {
 		Field f= static_cast<Field>(k);
@@ -2765,7 +2870,10 @@ bool UnitUpdater::unitOnRange(Unit *unit, int range, Unit **rangedPtr,
 	Vec2f floatCenter	= unit->getFloatCenteredPos();
 
 	//bool foundInCache = true;
-	if(findCachedCellsEnemies(center,range,size,enemies,ast,
+	if(useUnitCellGrid == true) {
+		findGridEnemies(center,range,size,floatCenter,ast,unit,commandTarget,enemies);
+	}
+	else if(findCachedCellsEnemies(center,range,size,enemies,ast,
 							  unit,commandTarget) == false) {
 
 		//foundInCache = false;
@@ -3000,7 +3108,10 @@ vector<Unit*> UnitUpdater::enemyUnitsOnRange(const Unit *unit,const AttackSkillT
 	Vec2f floatCenter	= unit->getFloatCenteredPos();
 
 	//bool foundInCache = true;
-	if(findCachedCellsEnemies(center,range,size,enemies,ast,
+	if(useUnitCellGrid == true) {
+		findGridEnemies(center,range,size,floatCenter,ast,unit,commandTarget,enemies);
+	}
+	else if(findCachedCellsEnemies(center,range,size,enemies,ast,
 							  unit,commandTarget) == false) {
 
 		//foundInCache = false;
@@ -3075,6 +3186,22 @@ vector<Unit*> UnitUpdater::findUnitsInRange(const Unit *unit, int radius) {
 	Vec2i center 		= unit->getPosNotThreadSafe();
 	Vec2f floatCenter	= unit->getFloatCenteredPos();
 
+	if(useUnitCellGrid == true) {
+		vector<UnitCellEntry> entries;
+		map->getUnitCellGrid()->getEntries(center.x - range, center.y - range,
+				center.x + range + size, center.y + range + size,
+				(1u << fieldCount) - 1, 0xFFFFFFFFu, entries);
+
+		for(unsigned int i = 0; i < entries.size(); ++i) {
+			const UnitCellEntry &entry = entries[i];
+			if(entry.unit->isAlive() &&
+				isCellOnRange(floatCenter, entry.x, entry.y, range) == true) {
+				units.push_back(entry.unit);
+			}
+		}
+		return units;
+	}
+
 	//nearby cells
 	//UnitRangeCellsLookupItem cacheItem;
 	for(int i = center.x - range; i < center.x + range + size; ++i) {
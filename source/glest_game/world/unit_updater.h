@@ -88,6 +88,7 @@ private:
 	std::map<Vec2i, std::map<int, std::map<int, UnitRangeCellsLookupItem > > > UnitRangeCellsLookupItemCache;
 	//std::map<int,ExploredCellsLookupKey> ExploredCellsLookupItemCacheTimer;
 	//int UnitRangeCellsLookupItemCacheTimerCount;
+	bool useUnitCellGrid;
 
 	bool findCachedCellsEnemies(Vec2i center, int range,
 								int size, vector<Unit*> &enemies,
@@ -95,6 +96,9 @@ private:
 								const Unit *commandTarget);
 	void findEnemiesForCell(const AttackSkillType *ast, Cell *cell, const Unit *unit,
 							const Unit *commandTarget,vector<Unit*> &enemies);
+	void findGridEnemies(const Vec2i &center, int range, int size, const Vec2f &floatCenter,
+						 const AttackSkillType *ast, const Unit *unit,
+						 const Unit *commandTarget, vector<Unit*> &enemies);
 
 public:
 	UnitUpdater();
@@ -121,6 +125,7 @@ public:
 
 	void clearUnitPrecache(Unit *unit);
 	void removeUnitPrecache(Unit *unit);
+	void processPathRequests(int frameIndex);
 
 	inline unsigned int getAttackWarningCount() const { return (unsigned int)attackWarnings.size(); }
 	std::pair<bool,Unit *> unitBeingAttacked(const Unit *unit);
@@ -34,12 +34,52 @@ using namespace Shared::Util;
 namespace Glest{ namespace Game{
 
 // =====================================================
-// 	class World
+// 	class SightDiscTable
 // =====================================================
 
-// This limit is to keep RAM use under control while offering better performance.
-int MaxExploredCellsLookupItemCache = 9500;
-time_t ExploredCellsLookupItem::lastDebug = 0;
+const vector<int> & SightDiscTable::getRowHalfWidths(int radius) {
+	if(radius < 0) {
+		throw megaglest_runtime_error("Invalid sight disc radius: " + intToStr(radius));
+	}
+
+	if(radius >= (int)rowHalfWidths.size()) {
+		rowHalfWidths.resize(radius + 1);
+	}
+
+	vector<int> &rows = rowHalfWidths[radius];
+	if(radius > 0 && rows.empty() == true) {
+		// a cell is inside when its distance to the center is below the radius,
+		// compared in integers so every platform builds the same spans
+		rows.resize(radius * 2 - 1);
+		for(int dy = -radius + 1; dy < radius; ++dy) {
+			int halfWidth = 0;
+			while((halfWidth + 1) * (halfWidth + 1) + dy * dy < radius * radius) {
+				halfWidth++;
+			}
+			rows[dy + radius - 1] = halfWidth;
+		}
+	}
+	return rows;
+}
+
+string SightDiscTable::getStats() const {
+	int radiusCount = 0;
+	int spanCount = 0;
+	for(unsigned int radius = 0; radius < rowHalfWidths.size(); ++radius) {
+		if(rowHalfWidths[radius].empty() == false) {
+			radiusCount++;
+			spanCount += (int)rowHalfWidths[radius].size();
+		}
+	}
+
+	char szBuf[8096]="";
+	snprintf(szBuf,8096,"radius [%d] spans [%d] total KB: %s",radiusCount,spanCount,formatNumber(spanCount * sizeof(int) / 1000).c_str());
+	return szBuf;
+}
+
+// =====================================================
+// 	class World
+// =====================================================
 
 // ===================== PUBLIC ========================
 
@@ -51,10 +91,6 @@ World::World() : mutexFactionNextUnitId(new Mutex(CODE_AT_LINE)) {
 
 	animatedTilesetObjectPosListLoaded = false;
 
-	ExploredCellsLookupItemCache.clear();
-	ExploredCellsLookupItemCacheTimer.clear();
-	ExploredCellsLookupItemCacheTimerCount = 0;
-
 	nextCommandGroupId = 0;
 	techTree = NULL;
 	fogOfWarOverride = false;
@@ -81,6 +117,25 @@ World::World() : mutexFactionNextUnitId(new Mutex(CODE_AT_LINE)) {
 	cacheFowAlphaTexture = false;
 	cacheFowAlphaTextureFogOfWarValue = false;
 
+	fowIncremental = config.getBool("FogOfWarIncrementalUpdate","true");
+	fowFullRebuild = true;
+	fowTickIndex = 0;
+	fowThisTeamIndex = -1;
+
+	// Independent phases of a frame may run concurrently, the results are
+	// the same as running them one after another
+	worldTaskPool = NULL;
+	if(config.getBool("WorldTaskGraph","true") == true) {
+		int threadCount = config.getInt("WorldTaskThreads","0");
+		if(threadCount <= 0) {
+			threadCount = min(getCPUCoreCount() - 1, 3);
+		}
+		if(threadCount > 0) {
+			worldTaskPool = new WorkerThreadPool(threadCount,"WorldTaskThread");
+		}
+	}
+	worldTaskGraphValidate = config.getBool("WorldTaskGraphValidate","false");
+
 	if(SystemFlags::getSystemSettingType(SystemFlags::debugSystem).enabled) SystemFlags::OutputDebug(SystemFlags::debugSystem,"In [%s::%s Line: %d]\n",__FILE__,__FUNCTION__,__LINE__);
 }
 
@@ -89,8 +144,6 @@ void World::cleanup() {
 
 	animatedTilesetObjectPosListLoaded = false;
 
-	ExploredCellsLookupItemCache.clear();
-	ExploredCellsLookupItemCacheTimer.clear();
 	//FowAlphaCellsLookupItemCache.clear();
 
 	if(SystemFlags::getSystemSettingType(SystemFlags::debugSystem).enabled) SystemFlags::OutputDebug(SystemFlags::debugSystem,"In [%s::%s Line: %d]\n",__FILE__,__FUNCTION__,__LINE__);
@@ -141,6 +194,9 @@ World::~World() {
 
 	cleanup();
 
+	delete worldTaskPool;
+	worldTaskPool = NULL;
+
 	delete mutexFactionNextUnitId;
 	mutexFactionNextUnitId = NULL;
 
@@ -153,9 +209,6 @@ void World::endScenario() {
 
     animatedTilesetObjectPosListLoaded = false;
 
-    ExploredCellsLookupItemCache.clear();
-    ExploredCellsLookupItemCacheTimer.clear();
-
 	fogOfWarOverride = false;
 	originalGameFogOfWar = fogOfWar;
 	fogOfWarSkillTypeValue = -1;
@@ -174,9 +227,6 @@ void World::end(){
 
     animatedTilesetObjectPosListLoaded = false;
 
-    ExploredCellsLookupItemCache.clear();
-    ExploredCellsLookupItemCacheTimer.clear();
-
 	for(int i= 0; i < (int)factions.size(); ++i){
 		factions[i]->end();
 	}
@@ -200,6 +250,7 @@ void World::end(){
 	map.end();
 	cacheFowAlphaTexture = false;
 	cacheFowAlphaTextureFogOfWarValue = false;
+	resetFowIncremental();
 
 	//stats will be deleted by BattleEnd
 	if(SystemFlags::getSystemSettingType(SystemFlags::debugSystem).enabled) SystemFlags::OutputDebug(SystemFlags::debugSystem,"In [%s::%s Line: %d]\n",__FILE__,__FUNCTION__,__LINE__);
@@ -296,7 +347,7 @@ void World::restoreExploredFogOfWarCells() {
 		for (int j = 0; j < map.getSurfaceH(); ++j) {
 			for (int k = 0;	k < GameConstants::maxPlayers + GameConstants::specialFactions; ++k) {
 				if (k == thisTeamIndex) {
-					if (map.getSurfaceCell(i, j)->isExplored(k) == true) {
+					if (map.isSurfaceExplored(k, Vec2i(i, j)) == true) {
 						const Vec2i pos(i, j);
 						Vec2i surfPos = pos;
 						//compute max alpha
@@ -325,9 +376,6 @@ void World::init(Game *game, bool createUnits, bool initFactions){
 
 	if(SystemFlags::getSystemSettingType(SystemFlags::debugSystem).enabled) SystemFlags::OutputDebug(SystemFlags::debugSystem,"In [%s::%s Line: %d]\n",__FILE__,__FUNCTION__,__LINE__);
 
-	ExploredCellsLookupItemCache.clear();
-	ExploredCellsLookupItemCacheTimer.clear();
-
 	this->game = game;
 	scriptManager= game->getScriptManager();
 
@@ -390,24 +438,15 @@ void World::init(Game *game, bool createUnits, bool initFactions){
 		map.loadGame(loadWorldNode,this);
 
 		if(fogOfWar == false) {
-		    for(int i=0; i< map.getSurfaceW(); ++i) {
-		        for(int j=0; j< map.getSurfaceH(); ++j) {
-
-					SurfaceCell *sc= map.getSurfaceCell(i, j);
-					if(sc == NULL) {
-						throw megaglest_runtime_error("sc == NULL");
-					}
-
-					for (int k = 0; k < GameConstants::maxPlayers; k++) {
-						//sc->setExplored(k, (game->getGameSettings()->getFlagTypes1() & ft1_show_map_resources) == ft1_show_map_resources);
-						sc->setVisible(k, !fogOfWar);
-					}
-					for (int k = GameConstants::maxPlayers; k < GameConstants::maxPlayers + GameConstants::specialFactions; k++) {
-						sc->setExplored(k, true);
-						sc->setVisible(k, true);
-					}
-		        }
-		    }
+			SurfaceVisibility *surfaceVisibility = map.getSurfaceVisibility();
+			for (int k = 0; k < GameConstants::maxPlayers; k++) {
+				//surfaceVisibility->setAllExplored(k, (game->getGameSettings()->getFlagTypes1() & ft1_show_map_resources) == ft1_show_map_resources);
+				surfaceVisibility->setAllVisible(k, !fogOfWar);
+			}
+			for (int k = GameConstants::maxPlayers; k < GameConstants::maxPlayers + GameConstants::specialFactions; k++) {
+				surfaceVisibility->setAllExplored(k, true);
+				surfaceVisibility->setAllVisible(k, true);
+			}
 		}
 		else {
 			restoreExploredFogOfWarCells();
@@ -417,6 +456,7 @@ void World::init(Game *game, bool createUnits, bool initFactions){
 	}
 
 	//initExplorationState(); ... was only for !fog-of-war, now handled in initCells()
+	fowFullRebuild = true;
 	computeFow();
 
 	if(gotError == true) {
@@ -615,6 +655,8 @@ void World::updateAllFactionUnits() {
 		masterController.signalSlaves(&frameCount);
 		bool slavesCompleted = masterController.waitTillSlavesTrigger(20000);
 
+		if(this->game) this->game->addPerformanceCount("updateAllFactionUnits faction threads wait",chrono.getMillis());
+
 		if(SystemFlags::VERBOSE_MODE_ENABLED && chrono.getMillis() >= 10) printf("In [%s::%s Line: %d] *** Faction thread preprocessing took [%lld] msecs for %d factions for frameCount = %d slavesCompleted = %d.\n",__FILE__,__FUNCTION__,__LINE__,(long long int)chrono.getMillis(),factionCount,frameCount,slavesCompleted);
 
 		if(showPerfStats) {
@@ -625,9 +667,16 @@ void World::updateAllFactionUnits() {
 	}
 	else {
 		// Signal the faction threads to do any pre-processing
+		int workerThreadCount = 0;
+		for(int i = 0; i < factionCount; ++i) {
+			if(getFaction(i)->getWorkerThread() != NULL) {
+				workerThreadCount++;
+			}
+		}
+		factionFrameBarrier.beginFrame(frameCount,workerThreadCount);
 		for(int i = 0; i < factionCount; ++i) {
 			Faction *faction = getFaction(i);
-			faction->signalWorkerThread(frameCount);
+			faction->signalWorkerThread(frameCount,&factionFrameBarrier);
 		}
 
 		if(showPerfStats) {
@@ -639,6 +688,7 @@ void World::updateAllFactionUnits() {
 		chrono.start();
 
 		const int MAX_FACTION_THREAD_WAIT_MILLISECONDS = 20000;
+		const int FACTION_THREAD_WAIT_SLICE_MILLISECONDS = 100;
 		for(;chrono.getMillis() < MAX_FACTION_THREAD_WAIT_MILLISECONDS;) {
 			bool workThreadsFinished = true;
 			for(int i = 0; i < factionCount; ++i) {
@@ -651,12 +701,13 @@ void World::updateAllFactionUnits() {
 			if(workThreadsFinished == true) {
 				break;
 			}
-			// WARNING... Sleep in here causes the server to lag a bit
-			//if(chrono.getMillis() % 5 == 0) {
-			//	sleep(0);
-			//}
+			// Sleep until the last faction thread arrives, the slice only bounds
+			// how long it takes to notice a thread that stopped without arriving
+			factionFrameBarrier.waitForFrame(frameCount,FACTION_THREAD_WAIT_SLICE_MILLISECONDS);
 		}
 
+		if(this->game) this->game->addPerformanceCount("updateAllFactionUnits faction threads wait",chrono.getMillis());
+
 		if(showPerfStats) {
 			sprintf(perfBuf,"In [%s::%s] Line: %d took msecs: " MG_I64_SPECIFIER "\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,chronoPerf.getMillis());
 			perfList.push_back(perfBuf);
@@ -665,6 +716,10 @@ void World::updateAllFactionUnits() {
 		if(SystemFlags::VERBOSE_MODE_ENABLED && chrono.getMillis() >= 10) printf("In [%s::%s Line: %d] *** Faction thread preprocessing took [%lld] msecs for %d factions for frameCount = %d.\n",__FILE__,__FUNCTION__,__LINE__,(long long int)chrono.getMillis(),factionCount,frameCount);
 	}
 
+	// Solve the path searches the faction threads queued while precaching,
+	// spread over all cores rather than one thread per faction
+	unitUpdater.processPathRequests(frameCount);
+
 	if(showPerfStats) {
 		sprintf(perfBuf,"In [%s::%s] Line: %d took msecs: " MG_I64_SPECIFIER "\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,chronoPerf.getMillis());
 		perfList.push_back(perfBuf);
@@ -839,23 +894,17 @@ void World::update() {
 		perfList.push_back(perfBuf);
 	}
 
-	//water effects
-	waterEffects.update(1.0f);
-	// attack effects
-	attackEffects.update(0.25f);
-
-	if(showPerfStats) {
-		sprintf(perfBuf,"In [%s::%s] Line: %d took msecs: " MG_I64_SPECIFIER "\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,chronoPerf.getMillis());
-		perfList.push_back(perfBuf);
-	}
-
 	if(SystemFlags::getSystemSettingType(SystemFlags::debugSystem).enabled) SystemFlags::OutputDebug(SystemFlags::debugSystem,"In [%s::%s Line: %d]\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__);
-	// objects on the map from tilesets
-	if(this->game) chronoGamePerformanceCounts.start();
-
-	updateAllTilesetObjects();
-
-	if(this->game) this->game->addPerformanceCount("updateAllTilesetObjects",chronoGamePerformanceCounts.getMillis());
+	//water effects, attack effects and objects on the map from tilesets
+	worldTaskGraph.clear();
+	int taskIndex = worldTaskGraph.addTask("waterEffects.update",wtWaterEffects);
+	worldTaskGraph.addWrite(taskIndex,wtrWaterEffects);
+	taskIndex = worldTaskGraph.addTask("attackEffects.update",wtAttackEffects);
+	worldTaskGraph.addWrite(taskIndex,wtrAttackEffects);
+	// reads the gui highlight so it stays on the main thread
+	taskIndex = worldTaskGraph.addTask("updateAllTilesetObjects",wtTilesetObjects,0,true);
+	worldTaskGraph.addWrite(taskIndex,wtrTilesetObjects);
+	runWorldTaskGraph();
 
 	if(showPerfStats) {
 		sprintf(perfBuf,"In [%s::%s] Line: %d took msecs: " MG_I64_SPECIFIER "\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,chronoPerf.getMillis());
@@ -889,28 +938,19 @@ void World::update() {
 
 		if(SystemFlags::getSystemSettingType(SystemFlags::debugSystem).enabled) SystemFlags::OutputDebug(SystemFlags::debugSystem,"In [%s::%s Line: %d]\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__);
 
-		//food costs
-		if(this->game) chronoGamePerformanceCounts.start();
-
-		updateAllFactionConsumableCosts();
-
-		if(this->game) this->game->addPerformanceCount("updateAllFactionConsumableCosts",chronoGamePerformanceCounts.getMillis());
-
-		if(showPerfStats) {
-			sprintf(perfBuf,"In [%s::%s] Line: %d took msecs: " MG_I64_SPECIFIER "\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,chronoPerf.getMillis());
-			perfList.push_back(perfBuf);
-		}
+		//food costs and fow smoothing
+		worldTaskGraph.clear();
+		// runs scripts and plays sounds so it stays on the main thread
+		taskIndex = worldTaskGraph.addTask("updateAllFactionConsumableCosts",wtConsumableCosts,0,true);
+		addFactionTaskResources(taskIndex,true);
+		worldTaskGraph.addWrite(taskIndex,wtrScripts);
+		worldTaskGraph.addWrite(taskIndex,wtrParticles);
 
-		if(SystemFlags::getSystemSettingType(SystemFlags::debugSystem).enabled) SystemFlags::OutputDebug(SystemFlags::debugSystem,"In [%s::%s Line: %d]\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__);
-		//fow smoothing
 		if(fogOfWarSmoothing && ((frameCount+1) % (fogOfWarSmoothingFrameSkip+1)) == 0) {
-			if(this->game) chronoGamePerformanceCounts.start();
-
-			float fogFactor= static_cast<float>(frameCount % GameConstants::updateFps) / GameConstants::updateFps;
-			minimap.updateFowTex(clamp(fogFactor, 0.f, 1.f));
-
-			if(this->game) this->game->addPerformanceCount("minimap.updateFowTex",chronoGamePerformanceCounts.getMillis());
+			taskIndex = worldTaskGraph.addTask("minimap.updateFowTex",wtFowTexture,0);
+			worldTaskGraph.addWrite(taskIndex,wtrMinimap);
 		}
+		runWorldTaskGraph();
 
 		if(showPerfStats) {
 			sprintf(perfBuf,"In [%s::%s] Line: %d took msecs: " MG_I64_SPECIFIER "\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,chronoPerf.getMillis());
@@ -969,34 +1009,142 @@ void World::tick() {
 		perfList.push_back(perfBuf);
 	}
 
-	Chrono chronoGamePerformanceCounts;
-	if(this->game) chronoGamePerformanceCounts.start();
+	// the fog of war texture can be blended while units tick, the resource
+	// balance of every faction is computed on its own
+	worldTaskGraph.clear();
+	int taskIndex = worldTaskGraph.addTask("world->computeFow",wtComputeFow,0,true);
+	worldTaskGraph.addWrite(taskIndex,wtrSurfaceVisibility);
+	worldTaskGraph.addWrite(taskIndex,wtrMinimap);
+	worldTaskGraph.addWrite(taskIndex,wtrParticles);
+	addFactionTaskResources(taskIndex,false);
 
-	computeFow();
+	if(fogOfWarSmoothing == false) {
+		taskIndex = worldTaskGraph.addTask("minimap.updateFowTex",wtFowTexture,1);
+		worldTaskGraph.addWrite(taskIndex,wtrMinimap);
+	}
 
-	if(this->game) this->game->addPerformanceCount("world->computeFow",chronoGamePerformanceCounts.getMillis());
+	//increase hp
+	taskIndex = worldTaskGraph.addTask("world unit->tick()",wtUnitTick,0,true);
+	addFactionTaskResources(taskIndex,true);
+	worldTaskGraph.addWrite(taskIndex,wtrScripts);
+	worldTaskGraph.addWrite(taskIndex,wtrParticles);
+
+	//compute resources balance
+	for(int factionIndex = 0; factionIndex < getFactionCount(); ++factionIndex) {
+		taskIndex = worldTaskGraph.addTask("world faction->setResourceBalance()",wtResourceBalance,factionIndex);
+		worldTaskGraph.addWrite(taskIndex,wtrFaction + factionIndex);
+	}
+	runWorldTaskGraph();
 
 	if(showPerfStats) {
-		sprintf(perfBuf,"In [%s::%s] Line: %d took msecs: " MG_I64_SPECIFIER " fogOfWar: %d\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,chronoPerf.getMillis(),fogOfWar);
+		sprintf(perfBuf,"In [%s::%s] Line: %d took msecs: " MG_I64_SPECIFIER "\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,chronoPerf.getMillis());
 		perfList.push_back(perfBuf);
 	}
 
-	if(fogOfWarSmoothing == false) {
-		if(this->game) chronoGamePerformanceCounts.start();
+	if(showPerfStats && chronoPerf.getMillis() >= 50) {
+		for(unsigned int x = 0; x < perfList.size(); ++x) {
+			printf("%s",perfList[x].c_str());
+		}
+	}
+}
 
-		minimap.updateFowTex(1.f);
+void World::graphTask(int taskId, int taskParam) {
+	switch(taskId) {
+		case wtWaterEffects:
+			waterEffects.update(1.0f);
+			break;
+		case wtAttackEffects:
+			attackEffects.update(0.25f);
+			break;
+		case wtTilesetObjects:
+			updateAllTilesetObjects();
+			break;
+		case wtConsumableCosts:
+			updateAllFactionConsumableCosts();
+			break;
+		case wtFowTexture:
+			if(taskParam == 0) {
+				float fogFactor= static_cast<float>(frameCount % GameConstants::updateFps) / GameConstants::updateFps;
+				minimap.updateFowTex(clamp(fogFactor, 0.f, 1.f));
+			}
+			else {
+				minimap.updateFowTex(1.f);
+			}
+			break;
+		case wtComputeFow:
+			computeFow();
+			break;
+		case wtUnitTick:
+			tickAllFactionUnits();
+			break;
+		case wtResourceBalance:
+			updateFactionResourceBalance(taskParam);
+			break;
+		default:
+			throw megaglest_runtime_error("Unknown world task: " + intToStr(taskId));
+	}
+}
+
+void World::addFactionTaskResources(int taskIndex, bool write) {
+	for(int factionIndex = 0; factionIndex < getFactionCount(); ++factionIndex) {
+		if(write == true) {
+			worldTaskGraph.addWrite(taskIndex,wtrFaction + factionIndex);
+		}
+		else {
+			worldTaskGraph.addRead(taskIndex,wtrFaction + factionIndex);
+		}
+	}
+}
+
+void World::runWorldTaskGraph() {
+	if(worldTaskGraphValidate == true) {
+		runWorldTaskGraphValidated();
+	}
+	else {
+		worldTaskGraph.run(this,worldTaskPool);
+	}
 
-		if(this->game) this->game->addPerformanceCount("minimap.updateFowTex",chronoGamePerformanceCounts.getMillis());
+	// performance counts are not thread safe so they are added here
+	if(this->game) {
+		std::map<string,int64> taskMillis;
+		for(int taskIndex = 0; taskIndex < worldTaskGraph.getTaskCount(); ++taskIndex) {
+			taskMillis[worldTaskGraph.getTaskName(taskIndex)] += worldTaskGraph.getTaskMillis(taskIndex);
+		}
+		for(std::map<string,int64>::iterator iterMap = taskMillis.begin();
+			iterMap != taskMillis.end(); ++iterMap) {
+			this->game->addPerformanceCount(iterMap->first,iterMap->second);
+		}
 	}
+}
 
-	if(showPerfStats) {
-		sprintf(perfBuf,"In [%s::%s] Line: %d took msecs: " MG_I64_SPECIFIER "\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,chronoPerf.getMillis());
-		perfList.push_back(perfBuf);
+// Runs the tasks one by one and checks that no task changes the state of
+// a faction it did not declare as written. An undeclared write would make
+// the concurrent result depend on thread timing and desync the peers.
+void World::runWorldTaskGraphValidated() {
+	int factionCount = getFactionCount();
+	vector<uint32> factionCRCs(factionCount);
+	for(int factionIndex = 0; factionIndex < factionCount; ++factionIndex) {
+		factionCRCs[factionIndex] = getFaction(factionIndex)->getCRC().getSum();
 	}
 
-	//increase hp
-	if(this->game) chronoGamePerformanceCounts.start();
+	for(int taskIndex = 0; taskIndex < worldTaskGraph.getTaskCount(); ++taskIndex) {
+		worldTaskGraph.runTask(this,taskIndex);
 
+		for(int factionIndex = 0; factionIndex < factionCount; ++factionIndex) {
+			uint32 crc = getFaction(factionIndex)->getCRC().getSum();
+			if(crc != factionCRCs[factionIndex] &&
+				worldTaskGraph.isWriting(taskIndex,wtrFaction + factionIndex) == false) {
+				char szBuf[8096]="";
+				snprintf(szBuf,8096,"World task [%s] changed faction %d without declaring it, frameCount = %d",
+						worldTaskGraph.getTaskName(taskIndex).c_str(),factionIndex,frameCount);
+				throw megaglest_runtime_error(szBuf);
+			}
+			factionCRCs[factionIndex] = crc;
+		}
+	}
+}
+
+void World::tickAllFactionUnits() {
 	int factionCount = getFactionCount();
 	for(int factionIndex = 0; factionIndex < factionCount; ++factionIndex) {
 		Faction *faction = getFaction(factionIndex);
@@ -1011,65 +1159,43 @@ void World::tick() {
 			unit->tick();
 		}
 	}
-	if(this->game) this->game->addPerformanceCount("world unit->tick()",chronoGamePerformanceCounts.getMillis());
-
-	if(showPerfStats) {
-		sprintf(perfBuf,"In [%s::%s] Line: %d took msecs: " MG_I64_SPECIFIER "\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,chronoPerf.getMillis());
-		perfList.push_back(perfBuf);
-	}
-
-	//compute resources balance
-	if(this->game) chronoGamePerformanceCounts.start();
+}
 
+void World::updateFactionResourceBalance(int factionIndex) {
 	std::map<const UnitType *, std::map<const ResourceType *, const Resource *> > resourceCostCache;
-	factionCount = getFactionCount();
-	for(int factionIndex = 0; factionIndex < factionCount; ++factionIndex) {
-		Faction *faction = getFaction(factionIndex);
+	Faction *faction = getFaction(factionIndex);
 
-		//for each resource
-		for(int resourceTypeIndex = 0;
-				resourceTypeIndex < techTree->getResourceTypeCount(); ++resourceTypeIndex) {
-			const ResourceType *rt= techTree->getResourceType(resourceTypeIndex);
-
-			//if consumable
-			if(rt != NULL && rt->getClass() == rcConsumable) {
-				int balance= 0;
-				for(int unitIndex = 0;
-						unitIndex < faction->getUnitCount(); ++unitIndex) {
-
-					//if unit operative and has this cost
-					const Unit *unit = faction->getUnit(unitIndex);
-					if(unit != NULL && unit->isOperative()) {
-						const UnitType *ut = unit->getType();
-						const Resource *resource = NULL;
-						std::map<const UnitType *, std::map<const ResourceType *, const Resource *> >::iterator iterFind = resourceCostCache.find(ut);
-						if(iterFind != resourceCostCache.end() &&
-								iterFind->second.find(rt) != iterFind->second.end()) {
-							resource = iterFind->second.find(rt)->second;
-						}
-						else {
-							resource = ut->getCost(rt);
-							resourceCostCache[ut][rt] = resource;
-						}
-						if(resource != NULL) {
-							balance -= resource->getAmount();
-						}
+	//for each resource
+	for(int resourceTypeIndex = 0;
+			resourceTypeIndex < techTree->getResourceTypeCount(); ++resourceTypeIndex) {
+		const ResourceType *rt= techTree->getResourceType(resourceTypeIndex);
+
+		//if consumable
+		if(rt != NULL && rt->getClass() == rcConsumable) {
+			int balance= 0;
+			for(int unitIndex = 0;
+					unitIndex < faction->getUnitCount(); ++unitIndex) {
+
+				//if unit operative and has this cost
+				const Unit *unit = faction->getUnit(unitIndex);
+				if(unit != NULL && unit->isOperative()) {
+					const UnitType *ut = unit->getType();
+					const Resource *resource = NULL;
+					std::map<const UnitType *, std::map<const ResourceType *, const Resource *> >::iterator iterFind = resourceCostCache.find(ut);
+					if(iterFind != resourceCostCache.end() &&
+							iterFind->second.find(rt) != iterFind->second.end()) {
+						resource = iterFind->second.find(rt)->second;
+					}
+					else {
+						resource = ut->getCost(rt);
+						resourceCostCache[ut][rt] = resource;
+					}
+					if(resource != NULL) {
+						balance -= resource->getAmount();
 					}
 				}
-				faction->setResourceBalance(rt, balance);
 			}
-		}
-	}
-	if(this->game) this->game->addPerformanceCount("world faction->setResourceBalance()",chronoGamePerformanceCounts.getMillis());
-
-	if(showPerfStats) {
-		sprintf(perfBuf,"In [%s::%s] Line: %d took msecs: " MG_I64_SPECIFIER "\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,chronoPerf.getMillis());
-		perfList.push_back(perfBuf);
-	}
-
-	if(showPerfStats && chronoPerf.getMillis() >= 50) {
-		for(unsigned int x = 0; x < perfList.size(); ++x) {
-			printf("%s",perfList[x].c_str());
+			faction->setResourceBalance(rt, balance);
 		}
 	}
 }
@@ -1690,10 +1816,6 @@ void World::moveToUnit(int unitId, int destUnitId) {
 }
 
 void World::clearCaches() {
-	ExploredCellsLookupItemCache.clear();
-	ExploredCellsLookupItemCacheTimer.clear();
-	ExploredCellsLookupItemCacheTimerCount = 0;
-
 	unitUpdater.clearCaches();
 }
 
@@ -1939,17 +2061,19 @@ void World::initCells(bool fogOfWar) {
 			sc->setFowTexCoord(Vec2f(
 				i/(next2Power(map.getSurfaceW())-1.f),
 				j/(next2Power(map.getSurfaceH())-1.f)));
-
-			for (int k = 0; k < GameConstants::maxPlayers; k++) {
-				sc->setExplored(k, (game->getGameSettings()->getFlagTypes1() & ft1_show_map_resources) == ft1_show_map_resources);
-				sc->setVisible(k, !fogOfWar);
-			}
-			for (int k = GameConstants::maxPlayers; k < GameConstants::maxPlayers + GameConstants::specialFactions; k++) {
-				sc->setExplored(k, true);
-				sc->setVisible(k, true);
-			}
 		}
     }
+
+	SurfaceVisibility *surfaceVisibility = map.getSurfaceVisibility();
+	for (int k = 0; k < GameConstants::maxPlayers; k++) {
+		surfaceVisibility->setAllExplored(k, (game->getGameSettings()->getFlagTypes1() & ft1_show_map_resources) == ft1_show_map_resources);
+		surfaceVisibility->setAllVisible(k, !fogOfWar);
+	}
+	for (int k = GameConstants::maxPlayers; k < GameConstants::maxPlayers + GameConstants::specialFactions; k++) {
+		surfaceVisibility->setAllExplored(k, true);
+		surfaceVisibility->setAllVisible(k, true);
+	}
+	fowFullRebuild = true;
     if(SystemFlags::getSystemSettingType(SystemFlags::debugSystem).enabled) SystemFlags::OutputDebug(SystemFlags::debugSystem,"In [%s::%s Line: %d]\n",__FILE__,__FUNCTION__,__LINE__);
 }
 
@@ -2136,6 +2260,7 @@ void World::initMinimap() {
 	if(SystemFlags::getSystemSettingType(SystemFlags::debugSystem).enabled) SystemFlags::OutputDebug(SystemFlags::debugSystem,"In [%s::%s Line: %d]\n",__FILE__,__FUNCTION__,__LINE__);
 
 	minimap.init(map.getW(), map.getH(), this, game->getGameSettings()->getFogOfWar());
+	minimap.setFowTexIncremental(fowIncremental);
 	Logger::getInstance().add(Lang::getInstance().getString("LogScreenGameLoadingMinimapSurface","",true), true);
 
 	if(SystemFlags::getSystemSettingType(SystemFlags::debugSystem).enabled) SystemFlags::OutputDebug(SystemFlags::debugSystem,"In [%s::%s Line: %d]\n",__FILE__,__FUNCTION__,__LINE__);
@@ -2298,129 +2423,49 @@ void World::initMap() {
 	if(SystemFlags::getSystemSettingType(SystemFlags::debugSystem).enabled) SystemFlags::OutputDebug(SystemFlags::debugSystem,"In [%s::%s Line: %d]\n",__FILE__,__FUNCTION__,__LINE__);
 }
 
-void World::exploreCells(int teamIndex, ExploredCellsLookupItem &exploredCellsCache) {
-	std::vector<SurfaceCell*> &cellList = exploredCellsCache.exploredCellList;
-	for (int idx2 = 0; idx2 < (int)cellList.size(); ++idx2) {
-		SurfaceCell* sc = cellList[idx2];
-		sc->setExplored(teamIndex, true);
-	}
-	cellList = exploredCellsCache.visibleCellList;
-	for (int idx2 = 0; idx2 < (int)cellList.size(); ++idx2) {
-		SurfaceCell* sc = cellList[idx2];
-		sc->setVisible(teamIndex, true);
-	}
-}
-
 // ==================== exploration ====================
 
-ExploredCellsLookupItem World::exploreCells(const Vec2i &newPos, int sightRange, int teamIndex) {
-	// cache lookup of previously calculated cells + sight range
-	if(MaxExploredCellsLookupItemCache > 0) {
-		if(difftime(time(NULL),ExploredCellsLookupItem::lastDebug) >= 10) {
-			ExploredCellsLookupItem::lastDebug = time(NULL);
-			if(SystemFlags::getSystemSettingType(SystemFlags::debugSystem).enabled) SystemFlags::OutputDebug(SystemFlags::debugSystem,"In [%s::%s Line: %d] ExploredCellsLookupItemCache.size() = %d\n",__FILE__,__FUNCTION__,__LINE__,ExploredCellsLookupItemCache.size());
-			if(SystemFlags::getSystemSettingType(SystemFlags::debugPerformance).enabled) SystemFlags::OutputDebug(SystemFlags::debugPerformance,"In [%s::%s Line: %d] ExploredCellsLookupItemCache.size() = %d\n",__FILE__,__FUNCTION__,__LINE__,ExploredCellsLookupItemCache.size());
-		}
-
-		// Ok we limit the cache size due to possible RAM constraints when
-		// the threshold is met
-		bool MaxExploredCellsLookupItemCacheTriggered = false;
-		if((int)ExploredCellsLookupItemCache.size() >= MaxExploredCellsLookupItemCache) {
-			MaxExploredCellsLookupItemCacheTriggered = true;
-			// Snag the oldest entry in the list
-			std::map<int,ExploredCellsLookupKey>::reverse_iterator purgeItem = ExploredCellsLookupItemCacheTimer.rbegin();
-
-			ExploredCellsLookupItemCache[purgeItem->second.pos].erase(purgeItem->second.sightRange);
-
-			if(ExploredCellsLookupItemCache[purgeItem->second.pos].empty() == true) {
-				ExploredCellsLookupItemCache.erase(purgeItem->second.pos);
-			}
-
-			ExploredCellsLookupItemCacheTimer.erase(purgeItem->first);
-		}
-
-		// Check the cache for the pos, sightrange and use from
-		// cache if already found
-		std::map<Vec2i, std::map<int, ExploredCellsLookupItem> >::iterator iterFind = ExploredCellsLookupItemCache.find(newPos);
-		if(iterFind != ExploredCellsLookupItemCache.end()) {
-
-			std::map<int, ExploredCellsLookupItem>::iterator iterFind2 = iterFind->second.find(sightRange);
-			if(iterFind2 != iterFind->second.end()) {
-
-				ExploredCellsLookupItem &exploredCellsCache = iterFind2->second;
-				exploreCells(teamIndex, exploredCellsCache);
-
-				// Only start worrying about updating the cache timer if we
-				// have hit the threshold
-				if(MaxExploredCellsLookupItemCacheTriggered == true) {
-					// Remove the old timer entry since the search key id is stale
-					ExploredCellsLookupItemCacheTimer.erase(exploredCellsCache.ExploredCellsLookupItemCacheTimerCountIndex);
-					exploredCellsCache.ExploredCellsLookupItemCacheTimerCountIndex = ExploredCellsLookupItemCacheTimerCount++;
-
-					ExploredCellsLookupKey lookupKey;
-					lookupKey.pos = newPos;
-					lookupKey.sightRange = sightRange;
-					lookupKey.teamIndex = teamIndex;
-
-					// Add a new search key since we just used this exploredCellsCache
-					ExploredCellsLookupItemCacheTimer[exploredCellsCache.ExploredCellsLookupItemCacheTimerCountIndex] = lookupKey;
-				}
-
-				return exploredCellsCache;
-			}
-		}
-	}
-
+void World::exploreCells(const Vec2i &newPos, int sightRange, int teamIndex) {
 	Vec2i newSurfPos= Map::toSurfCoords(newPos);
 	int surfSightRange= sightRange / Map::cellScale+1;
 
-	// Explore, this code is quite expensive when we have lots of units
-	ExploredCellsLookupItem exploredCellsCache;
-	exploredCellsCache.exploredCellList.reserve(surfSightRange + indirectSightRange * 4);
-	exploredCellsCache.visibleCellList.reserve(surfSightRange + indirectSightRange * 4);
-
-	//int loopCount = 0;
-    for(int i = -surfSightRange - indirectSightRange -1; i <= surfSightRange + indirectSightRange +1; ++i) {
-        for(int j = -surfSightRange - indirectSightRange -1; j <= surfSightRange + indirectSightRange +1; ++j) {
-        	//loopCount++;
-        	Vec2i currRelPos= Vec2i(i, j);
-            Vec2i currPos= newSurfPos + currRelPos;
-            if(map.isInsideSurface(currPos) == true){
-				SurfaceCell *sc= map.getSurfaceCell(currPos);
-				if(sc == NULL) {
-					throw megaglest_runtime_error("sc == NULL");
-				}
+	stampSightDisc(newSurfPos, surfSightRange + indirectSightRange + 1, teamIndex, false);
+	stampSightDisc(newSurfPos, surfSightRange, teamIndex, true);
+}
 
-				//explore
-				float posLength = currRelPos.length();
-				if(posLength < surfSightRange + indirectSightRange + 1) {
-                    sc->setExplored(teamIndex, true);
-                    exploredCellsCache.exploredCellList.push_back(sc);
-				}
+// Marks the surface cells closer than radius to surfPos as visible or
+// explored, one row span at a time
+void World::stampSightDisc(const Vec2i &surfPos, int radius, int teamIndex, bool visible) {
+	SurfaceVisibility *surfaceVisibility = map.getSurfaceVisibility();
+	const vector<int> &rowHalfWidths = sightDiscTable.getRowHalfWidths(radius);
 
-				//visible
-				if(posLength < surfSightRange) {
-					sc->setVisible(teamIndex, true);
-					exploredCellsCache.visibleCellList.push_back(sc);
-				}
-            }
-        }
-    }
+	// cells that become visible in between ticks are reverted by the
+	// incremental fog of war unless a unit still counts for them
+	vector<int> *newCells = NULL;
+	if(visible == true && fowIncremental == true &&
+		teamIndex >= 0 && teamIndex < (int)fowTransientCells.size()) {
+		newCells = &fowTransientCells[teamIndex];
+	}
 
-    // Ok update our caches with the latest info for this position, sight and team
-    if(MaxExploredCellsLookupItemCache > 0) {
-		if(exploredCellsCache.exploredCellList.empty() == false || exploredCellsCache.visibleCellList.empty() == false) {
-			exploredCellsCache.ExploredCellsLookupItemCacheTimerCountIndex = ExploredCellsLookupItemCacheTimerCount++;
-			ExploredCellsLookupItemCache[newPos][sightRange] = exploredCellsCache;
+	for(int row = 0; row < (int)rowHalfWidths.size(); ++row) {
+		int y = surfPos.y + row - radius + 1;
+		if(y < 0 || y >= map.getSurfaceH()) {
+			continue;
+		}
+		int x0 = max(surfPos.x - rowHalfWidths[row], 0);
+		int x1 = min(surfPos.x + rowHalfWidths[row], map.getSurfaceW() - 1);
+		if(x0 > x1) {
+			continue;
+		}
 
-			ExploredCellsLookupKey lookupKey;
-			lookupKey.pos 			= newPos;
-			lookupKey.sightRange 	= sightRange;
-			lookupKey.teamIndex 	= teamIndex;
-			ExploredCellsLookupItemCacheTimer[exploredCellsCache.ExploredCellsLookupItemCacheTimerCountIndex] = lookupKey;
+		int cellIndex = map.getSurfaceCellIndex(Vec2i(x0, y));
+		if(visible == true) {
+			surfaceVisibility->setVisibleSpan(teamIndex, cellIndex, x1 - x0 + 1, newCells);
 		}
-    }
-    return exploredCellsCache;
+		else {
+			surfaceVisibility->setExploredSpan(teamIndex, cellIndex, x1 - x0 + 1);
+		}
+	}
 }
 
 bool World::showWorldForPlayer(int factionIndex, bool excludeFogOfWarCheck) const {
@@ -2497,6 +2542,13 @@ void World::computeFow() {
 			minimap.restoreFowTexAlphaSurface();
 		}
 	}
+	// The incremental fog of war only has to reset all cells when it
+	// (re)builds its visibility counts
+	if(fowIncremental == true && fowThisTeamIndex != thisTeamIndex) {
+		fowFullRebuild = true;
+	}
+	bool resetVisibleCells = (fowIncremental == false || fowFullRebuild == true);
+
 	int resetFowAlphaFactionCount = 0;
 	for(int indexFaction = 0;
 			indexFaction < GameConstants::maxPlayers + GameConstants::specialFactions;
@@ -2506,35 +2558,38 @@ void World::computeFow() {
 			if(showWorldForFaction == true) {
 				resetFowAlphaFactionCount++;
 			}
+			bool resetFowAlpha = (cacheFowAlphaTexture == false &&
+								  showWorldForFaction == true &&
+								  resetFowAlphaFactionCount <= 1);
+			// set all cells to not visible
+			if(resetVisibleCells == true) {
+				map.getSurfaceVisibility()->setAllVisible(indexFaction, false);
+			}
+			if(resetFowAlpha == false) {
+				continue;
+			}
 
 			for(int indexSurfaceW = 0; indexSurfaceW < map.getSurfaceW(); ++indexSurfaceW) {
 				for(int indexSurfaceH = 0; indexSurfaceH < map.getSurfaceH(); ++indexSurfaceH) {
-					// set all cells to not visible
-					map.getSurfaceCell(indexSurfaceW, indexSurfaceH)->setVisible(indexFaction, false);
-
 					// reset fog of ware texture alpha values
-					if(cacheFowAlphaTexture == false &&
-						showWorldForFaction == true &&
-							resetFowAlphaFactionCount <= 1) {
-						const Vec2i surfPos(indexSurfaceW,indexSurfaceH);
-
-						//compute max alpha
-						float maxAlpha= 0.0f;
-						if(surfPos.x > 1 && surfPos.y > 1 &&
-						   surfPos.x < map.getSurfaceW() - 2 &&
-						   surfPos.y < map.getSurfaceH() - 2) {
-							maxAlpha= 1.f;
-						}
-						else if(surfPos.x > 0 && surfPos.y > 0 &&
-								surfPos.x < map.getSurfaceW() - 1 &&
-								surfPos.y < map.getSurfaceH() - 1){
-							maxAlpha= 0.3f;
-						}
-
-						// compute alpha
-						float alpha = maxAlpha;
-						minimap.incFowTextureAlphaSurface(surfPos, alpha);
+					const Vec2i surfPos(indexSurfaceW,indexSurfaceH);
+
+					//compute max alpha
+					float maxAlpha= 0.0f;
+					if(surfPos.x > 1 && surfPos.y > 1 &&
+					   surfPos.x < map.getSurfaceW() - 2 &&
+					   surfPos.y < map.getSurfaceH() - 2) {
+						maxAlpha= 1.f;
+					}
+					else if(surfPos.x > 0 && surfPos.y > 0 &&
+							surfPos.x < map.getSurfaceW() - 1 &&
+							surfPos.y < map.getSurfaceH() - 1){
+						maxAlpha= 0.3f;
 					}
+
+					// compute alpha
+					float alpha = maxAlpha;
+					minimap.incFowTextureAlphaSurface(surfPos, alpha);
 				}
 			}
 		}
@@ -2556,6 +2611,13 @@ void World::computeFow() {
 	//compute cells
 	if(this->game) chronoGamePerformanceCounts.start();
 
+	if(fowIncremental == true) {
+		computeFowIncremental();
+
+		if(this->game) this->game->addPerformanceCount("world compute cells",chronoGamePerformanceCounts.getMillis());
+		return;
+	}
+
 	for(int factionIndex = 0; factionIndex < getFactionCount(); ++factionIndex) {
 		Faction *faction = getFaction(factionIndex);
 		bool cellVisibleForFaction = showWorldForPlayer(thisFactionIndex);
@@ -2601,6 +2663,218 @@ void World::computeFow() {
 	if(this->game) this->game->addPerformanceCount("world compute cells",chronoGamePerformanceCounts.getMillis());
 }
 
+void World::computeFowIncremental() {
+	const int teamCount = GameConstants::maxPlayers + GameConstants::specialFactions;
+
+	if(fowFullRebuild == true) {
+		// all cells were just reset to not visible by computeFow, the fog of
+		// war texture still has the sights of the dropped stamps drawn
+		for(std::map<int,FowVisibilityStamp>::iterator iterMap = fowVisibilityStamps.begin();
+			iterMap != fowVisibilityStamps.end(); ++iterMap) {
+			addFowTexChangedArea(iterMap->second);
+		}
+		fowVisibleCounts.assign(teamCount, vector<int>(map.getSurfaceCellArraySize(), 0));
+		fowTransientCells.assign(teamCount, vector<int>());
+		fowVisibilityStamps.clear();
+		fowThisTeamIndex = thisTeamIndex;
+		fowFullRebuild = false;
+	}
+	fowTickIndex++;
+
+	// own units whose sight is drawn into the fog of war texture
+	vector<Unit *> fowTexUnits;
+	vector<const FowVisibilityStamp *> fowTexStamps;
+
+	for(int factionIndex = 0; factionIndex < getFactionCount(); ++factionIndex) {
+		Faction *faction = getFaction(factionIndex);
+		int unitCount = faction->getUnitCount();
+		for(int unitIndex = 0; unitIndex < unitCount; ++unitIndex) {
+			Unit *unit= faction->getUnit(unitIndex);
+
+			// exploration
+			if(unit->isOperative() == true) {
+				FowVisibilityStamp stamp;
+				stamp.pos = unit->getCenteredPos();
+				stamp.sightRange = unit->getType()->getSight();
+				stamp.teamIndex = unit->getTeam();
+				stamp.tickIndex = fowTickIndex;
+				stamp.areaTickIndex = fowTickIndex;
+
+				FowVisibilityStamp *unitStamp = NULL;
+				std::map<int,FowVisibilityStamp>::iterator iterFind = fowVisibilityStamps.find(unit->getId());
+				if(iterFind == fowVisibilityStamps.end()) {
+					unit->exploreCells();
+					updateFowVisibleCounts(stamp, 1);
+					setFowTexArea(unit, stamp);
+					addFowTexChangedArea(stamp);
+					unitStamp = &(fowVisibilityStamps[unit->getId()] = stamp);
+				}
+				else if(iterFind->second.isSameArea(stamp) == false) {
+					updateFowVisibleCounts(iterFind->second, -1);
+					addFowTexChangedArea(iterFind->second);
+					unit->exploreCells();
+					updateFowVisibleCounts(stamp, 1);
+					setFowTexArea(unit, stamp);
+					addFowTexChangedArea(stamp);
+					iterFind->second = stamp;
+					unitStamp = &iterFind->second;
+				}
+				else {
+					iterFind->second.tickIndex = fowTickIndex;
+					unitStamp = &iterFind->second;
+				}
+
+				if(fogOfWar == true && faction->getTeam() == thisTeamIndex) {
+					if(unitStamp->fowTexMax.x < unitStamp->fowTexMin.x) {
+						// fog of war was off when the area was stamped
+						setFowTexArea(unit, *unitStamp);
+					}
+					fowTexUnits.push_back(unit);
+					fowTexStamps.push_back(unitStamp);
+				}
+			}
+		}
+	}
+
+	// units that died, stopped being operative or left the game
+	for(std::map<int,FowVisibilityStamp>::iterator iterMap = fowVisibilityStamps.begin();
+		iterMap != fowVisibilityStamps.end();) {
+		if(iterMap->second.tickIndex != fowTickIndex) {
+			updateFowVisibleCounts(iterMap->second, -1);
+			addFowTexChangedArea(iterMap->second);
+			fowVisibilityStamps.erase(iterMap++);
+		}
+		else {
+			++iterMap;
+		}
+	}
+
+	// compute fog of war render texture: the texture is reset where sights
+	// changed lately, so every sight touching the reset pixels is drawn again
+	minimap.resetFowTexChangedRegions();
+	for(unsigned int i = 0; i < fowTexUnits.size(); ++i) {
+		const FowVisibilityStamp *stamp = fowTexStamps[i];
+		if(stamp->areaTickIndex == fowTickIndex ||
+			minimap.needsFowTexRedraw(stamp->fowTexMin.x, stamp->fowTexMin.y, stamp->fowTexMax.x, stamp->fowTexMax.y) == true) {
+
+			const FowAlphaCellsLookupItem &cellList = fowTexUnits[i]->getCachedFow();
+			for(std::map<Vec2i,float>::const_iterator iterMap = cellList.surfPosAlphaList.begin();
+				iterMap != cellList.surfPosAlphaList.end(); ++iterMap) {
+				const Vec2i &surfPos = iterMap->first;
+				const float &alpha = iterMap->second;
+
+				minimap.incFowTextureAlphaSurface(surfPos, alpha, true);
+			}
+		}
+	}
+
+	// cells explored in between ticks stay visible only if a unit still sees them
+	for(int teamIndex = 0; teamIndex < (int)fowTransientCells.size(); ++teamIndex) {
+		vector<int> &cellList = fowTransientCells[teamIndex];
+		if(fogOfWar || teamIndex != thisTeamIndex) {
+			for(unsigned int i = 0; i < cellList.size(); ++i) {
+				int cellIndex = cellList[i];
+				map.getSurfaceVisibility()->setVisible(teamIndex, cellIndex, fowVisibleCounts[teamIndex][cellIndex] > 0);
+			}
+		}
+		cellList.clear();
+	}
+
+	// fire particle visible
+	bool cellVisibleForFaction = showWorldForPlayer(thisFactionIndex);
+	for(int factionIndex = 0; factionIndex < getFactionCount(); ++factionIndex) {
+		Faction *faction = getFaction(factionIndex);
+		int unitCount = faction->getUnitCount();
+		for(int unitIndex = 0; unitIndex < unitCount; ++unitIndex) {
+			Unit *unit= faction->getUnit(unitIndex);
+			ParticleSystem *fire = unit->getFire();
+			if(fire != NULL) {
+				bool cellVisible = cellVisibleForFaction;
+				if(cellVisible == false) {
+					Vec2i sCoords = Map::toSurfCoords(unit->getPos());
+					SurfaceCell *sc = map.getSurfaceCell(sCoords);
+					if(sc != NULL) {
+						cellVisible = sc->isVisible(thisTeamIndex);
+					}
+				}
+
+				fire->setActive(cellVisible);
+			}
+		}
+	}
+}
+
+// Adds or removes the visible part of a unit's exploreCells area
+void World::updateFowVisibleCounts(const FowVisibilityStamp &stamp, int delta) {
+	if(stamp.teamIndex < 0 || stamp.teamIndex >= (int)fowVisibleCounts.size()) {
+		return;
+	}
+	vector<int> &counts = fowVisibleCounts[stamp.teamIndex];
+	bool updateVisible = (fogOfWar || stamp.teamIndex != thisTeamIndex);
+
+	Vec2i surfPos= Map::toSurfCoords(stamp.pos);
+	int surfSightRange= stamp.sightRange / Map::cellScale+1;
+	const vector<int> &rowHalfWidths = sightDiscTable.getRowHalfWidths(surfSightRange);
+
+	for(int row = 0; row < (int)rowHalfWidths.size(); ++row) {
+		int y = surfPos.y + row - surfSightRange + 1;
+		if(y < 0 || y >= map.getSurfaceH()) {
+			continue;
+		}
+		int x0 = max(surfPos.x - rowHalfWidths[row], 0);
+		int x1 = min(surfPos.x + rowHalfWidths[row], map.getSurfaceW() - 1);
+
+		int rowIndex = map.getSurfaceCellIndex(Vec2i(0, y));
+		for(int x = x0; x <= x1; ++x) {
+			int cellIndex = rowIndex + x;
+			int &count = counts[cellIndex];
+			count += delta;
+			if(updateVisible == true && (count == 0 || (count == 1 && delta > 0))) {
+				map.getSurfaceVisibility()->setVisible(stamp.teamIndex, cellIndex, count > 0);
+			}
+		}
+	}
+}
+
+// Remembers the fog of war texture pixels an own unit's sight is drawn to
+void World::setFowTexArea(const Unit *unit, FowVisibilityStamp &stamp) const {
+	stamp.fowTexMin = Vec2i(0,0);
+	stamp.fowTexMax = Vec2i(-1,-1);
+	if(fogOfWar == false || stamp.teamIndex != thisTeamIndex) {
+		return;
+	}
+
+	const FowAlphaCellsLookupItem &cellList = unit->getCachedFow();
+	for(std::map<Vec2i,float>::const_iterator iterMap = cellList.surfPosAlphaList.begin();
+		iterMap != cellList.surfPosAlphaList.end(); ++iterMap) {
+		const Vec2i &surfPos = iterMap->first;
+		if(iterMap == cellList.surfPosAlphaList.begin()) {
+			stamp.fowTexMin = surfPos;
+			stamp.fowTexMax = surfPos;
+		}
+		else {
+			stamp.fowTexMin.x = min(stamp.fowTexMin.x, surfPos.x);
+			stamp.fowTexMin.y = min(stamp.fowTexMin.y, surfPos.y);
+			stamp.fowTexMax.x = max(stamp.fowTexMax.x, surfPos.x);
+			stamp.fowTexMax.y = max(stamp.fowTexMax.y, surfPos.y);
+		}
+	}
+}
+
+// The texture pixels of a sight that appeared, moved or went away have to
+// be reset for a few ticks
+void World::addFowTexChangedArea(const FowVisibilityStamp &stamp) {
+	minimap.addFowTexChangedRegion(stamp.fowTexMin.x, stamp.fowTexMin.y, stamp.fowTexMax.x, stamp.fowTexMax.y);
+}
+
+void World::resetFowIncremental() {
+	fowFullRebuild = true;
+	fowThisTeamIndex = -1;
+	fowVisibilityStamps.clear();
+	fowVisibleCounts.clear();
+	fowTransientCells.clear();
+}
+
 GameSettings * World::getGameSettingsPtr() {
     return (game != NULL ? game->getGameSettings() : NULL);
 }
@@ -2662,36 +2936,8 @@ void World::removeResourceTargetFromCache(const Vec2i &pos) {
 	}
 }
 
-string World::getExploredCellsLookupItemCacheStats() {
-	string result = "";
-
-	int posCount = 0;
-	int sightCount = 0;
-	int exploredCellCount = 0;
-	int visibleCellCount = 0;
-
-	for(std::map<Vec2i, std::map<int, ExploredCellsLookupItem > >::iterator iterMap1 = ExploredCellsLookupItemCache.begin();
-		iterMap1 != ExploredCellsLookupItemCache.end(); ++iterMap1) {
-		posCount++;
-
-		for(std::map<int, ExploredCellsLookupItem >::iterator iterMap2 = iterMap1->second.begin();
-			iterMap2 != iterMap1->second.end(); ++iterMap2) {
-			sightCount++;
-
-			exploredCellCount += (int)iterMap2->second.exploredCellList.size();
-			visibleCellCount += (int)iterMap2->second.visibleCellList.size();
-		}
-	}
-
-	uint64 totalBytes = exploredCellCount * sizeof(SurfaceCell *);
-	totalBytes += visibleCellCount * sizeof(SurfaceCell *);
-
-	totalBytes /= 1000;
-
-	char szBuf[8096]="";
-	snprintf(szBuf,8096,"pos [%d] sight [%d] [%d][%d] total KB: %s",posCount,sightCount,exploredCellCount,visibleCellCount,formatNumber(totalBytes).c_str());
-	result = szBuf;
-	return result;
+string World::getSightDiscTableStats() const {
+	return sightDiscTable.getStats();
 }
 
 string World::getFowAlphaCellsLookupItemCacheStats() {
@@ -35,6 +35,7 @@
 #include "unit_updater.h"
 #include "randomgen.h"
 #include "game_constants.h"
+#include "simple_threads.h"
 #include "leak_dumper.h"
 
 namespace Glest{ namespace Game{
@@ -42,6 +43,9 @@ namespace Glest{ namespace Game{
 using Shared::Graphics::Quad2i;
 using Shared::Graphics::Rect2i;
 using Shared::Util::RandomGen;
+using Shared::PlatformCommon::TaskGraph;
+using Shared::PlatformCommon::TaskGraphCallbackInterface;
+using Shared::PlatformCommon::WorkerThreadPool;
 
 class Faction;
 class Unit;
@@ -61,21 +65,87 @@ class StrSound;
 ///	The game world: Map + Tileset + TechTree
 // =====================================================
 
-class ExploredCellsLookupKey {
+// =====================================================
+// 	class SightDiscTable
+//
+///	Row spans of the surface cells closer than a radius to
+///	a center cell, generated once per radius
+// =====================================================
+
+class SightDiscTable {
+private:
+	// per radius, the half width of each row from -(radius-1) to radius-1
+	vector<vector<int> > rowHalfWidths;
+
 public:
+	const vector<int> & getRowHalfWidths(int radius);
+	string getStats() const;
+};
+
+// =====================================================
+// 	class FowVisibilityStamp
+//
+///	The sight area a unit last added to the team visibility
+///	counts of World
+// =====================================================
+
+class FowVisibilityStamp {
+public:
+	FowVisibilityStamp() {
+		sightRange = 0;
+		teamIndex = -1;
+		tickIndex = 0;
+		areaTickIndex = 0;
+		fowTexMin = Vec2i(0,0);
+		fowTexMax = Vec2i(-1,-1);
+	}
+
+	bool isSameArea(const FowVisibilityStamp &stamp) const {
+		return (pos == stamp.pos && sightRange == stamp.sightRange &&
+				teamIndex == stamp.teamIndex);
+	}
 
 	Vec2i pos;
 	int sightRange;
 	int teamIndex;
+	int tickIndex;
+	// tick the area last changed in
+	int areaTickIndex;
+	// fog of war texture pixels the sight was drawn to, own team only
+	Vec2i fowTexMin;
+	Vec2i fowTexMax;
 };
 
-class World {
+class World : public TaskGraphCallbackInterface {
 private:
 	typedef vector<Faction *> Factions;
 
-	std::map<Vec2i, std::map<int, ExploredCellsLookupItem > > ExploredCellsLookupItemCache;
-	std::map<int,ExploredCellsLookupKey> ExploredCellsLookupItemCacheTimer;
-	int ExploredCellsLookupItemCacheTimerCount;
+	// phases of the simulation frame that run through worldTaskGraph
+	enum WorldTask {
+		wtWaterEffects,
+		wtAttackEffects,
+		wtTilesetObjects,
+		wtConsumableCosts,
+		wtFowTexture,
+		wtComputeFow,
+		wtUnitTick,
+		wtResourceBalance
+	};
+
+	// shared state the phases read or write, every faction (its units and
+	// resources) is a resource of its own starting at wtrFaction
+	enum WorldTaskResource {
+		wtrWaterEffects,
+		wtrAttackEffects,
+		wtrTilesetObjects,
+		wtrMinimap,
+		wtrSurfaceVisibility,
+		wtrParticles,
+		wtrScripts,
+		wtrFaction
+	};
+
+	SightDiscTable sightDiscTable;
 
 public:
 	static const int generationArea= 100;
@@ -132,6 +202,7 @@ private:
 	const XmlNode *loadWorldNode;
 
 	MasterSlaveThreadController masterController;
+	FrameBarrier factionFrameBarrier;
 
 	bool originalGameFogOfWar;
 	std::map<int,std::pair<const Unit *,const FogOfWarSkillType *> > mapFogOfWarUnitList;
@@ -142,6 +213,23 @@ private:
 	bool cacheFowAlphaTexture;
 	bool cacheFowAlphaTextureFogOfWarValue;
 
+	// incremental fog of war: per team reference counts of the units that
+	// see each surface cell, only units that moved are re-applied each tick
+	bool fowIncremental;
+	bool fowFullRebuild;
+	int fowTickIndex;
+	int fowThisTeamIndex;
+	std::map<int,FowVisibilityStamp> fowVisibilityStamps;
+	vector<vector<int> > fowVisibleCounts;
+	// indexes of cells made visible in between ticks that no unit counts for
+	vector<vector<int> > fowTransientCells;
+
+	TaskGraph worldTaskGraph;
+	WorkerThreadPool *worldTaskPool;
+	// runs the phases one by one and checks that every phase only changed
+	// the faction CRCs of the factions it declared to write
+	bool worldTaskGraphValidate;
+
 public:
 	World();
 	~World();
@@ -292,8 +380,7 @@ public:
 	}
 	bool canTickWorld() const;
 
-	ExploredCellsLookupItem exploreCells(const Vec2i &newPos, int sightRange, int teamIndex);
-	void exploreCells(int teamIndex,ExploredCellsLookupItem &exploredCellsCache);
+	void exploreCells(const Vec2i &newPos, int sightRange, int teamIndex);
 	bool showWorldForPlayer(int factionIndex, bool excludeFogOfWarCheck=false) const;
 
 	inline UnitUpdater * getUnitUpdater() { return &unitUpdater; }
@@ -305,7 +392,7 @@ public:
 
 	void removeResourceTargetFromCache(const Vec2i &pos);
 
-	string getExploredCellsLookupItemCacheStats();
+	string getSightDiscTableStats() const;
 	string getFowAlphaCellsLookupItemCacheStats();
 	string getAllFactionsCacheStats();
 
@@ -329,6 +416,18 @@ private:
 	//misc
 	void tick();
 	void computeFow();
+	void computeFowIncremental();
+	virtual void graphTask(int taskId, int taskParam);
+	void addFactionTaskResources(int taskIndex, bool write);
+	void runWorldTaskGraph();
+	void runWorldTaskGraphValidated();
+	void tickAllFactionUnits();
+	void updateFactionResourceBalance(int factionIndex);
+	void updateFowVisibleCounts(const FowVisibilityStamp &stamp, int delta);
+	void setFowTexArea(const Unit *unit, FowVisibilityStamp &stamp) const;
+	void addFowTexChangedArea(const FowVisibilityStamp &stamp);
+	void stampSightDisc(const Vec2i &surfPos, int radius, int teamIndex, bool visible);
+	void resetFowIncremental();
 
 	void updateAllTilesetObjects();
 	void updateAllFactionUnits();
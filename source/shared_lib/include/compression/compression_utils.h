@@ -13,6 +13,7 @@
 #define _SHARED_COMPRESSION_UTIL_CHECKSUM_H_
 
 #include <string>
+#include <vector>
 
 using std::string;
 
@@ -21,6 +22,10 @@ namespace Shared{ namespace CompressionUtil{
 bool compressFileToZIPFile(string inFile, string outFile, int compressionLevel=5);
 bool extractFileFromZIPFile(string inFile, string outFile);
 
+// zlib streams held in memory, outBuffer is resized to the data produced
+bool compressBuffer(const unsigned char *inBuffer, size_t inSize, std::vector<unsigned char> &outBuffer, int compressionLevel=5);
+bool uncompressBuffer(const unsigned char *inBuffer, size_t inSize, std::vector<unsigned char> &outBuffer, size_t uncompressedSize);
+
 }};
 
 #endif
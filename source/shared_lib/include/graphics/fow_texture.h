@@ -0,0 +1,95 @@
+// ==============================================================
+//	This file is part of MegaGlest Shared Library (www.megaglest.org)
+//
+//	Copyright (C) 2013 MegaGlest team
+//
+//	You can redistribute this code and/or modify it under
+//	the terms of the GNU General Public License as published
+//	by the Free Software Foundation; either version 2 of the
+//	License, or (at your option) any later version
+// ==============================================================
+
+#ifndef _SHARED_GRAPHICS_FOWTEXTURE_H_
+#define _SHARED_GRAPHICS_FOWTEXTURE_H_
+
+#include "pixmap.h"
+#include "leak_dumper.h"
+
+namespace Shared{ namespace Graphics{
+
+// =====================================================
+//	class FowTextureRegion
+//
+/// Rectangle of fog of war texture pixels, empty while max is below min
+// =====================================================
+
+class FowTextureRegion {
+public:
+	int minX;
+	int minY;
+	int maxX;
+	int maxY;
+
+	FowTextureRegion()	{clear();}
+
+	void clear();
+	bool isEmpty() const	{return (maxX < minX || maxY < minY);}
+	void add(int minX, int minY, int maxX, int maxY);
+	void add(const FowTextureRegion &region);
+	bool intersects(int minX, int minY, int maxX, int maxY) const;
+};
+
+// =====================================================
+//	class FowTextureReset
+//
+/// Resets the fog of war alpha pixmap of a new tick from the pixmaps of
+/// the two ticks before. A full update resets every pixel. An incremental
+/// update only resets the pixels a changed sight area covered in one of
+/// the last three ticks: a pixel takes two more ticks to settle after its
+/// sight areas stopped changing, and everywhere else the pixmap of two
+/// ticks ago already holds the result. Every sight area that touches the
+/// reset pixels has to be drawn again afterwards.
+// =====================================================
+
+class FowTextureReset {
+public:
+	enum ResetMode {
+		rmFogOfWar,		// lit pixels fall back to the explored alpha
+		rmNoFogOfWar,	// pixels keep the highest alpha
+		rmShowAll		// every pixel is lit
+	};
+
+	static const int changedTickCount = 3;
+
+private:
+	bool incremental;
+	int fullUpdateCount;
+	bool fullUpdate;
+	// changedRegions[0] is the current tick
+	FowTextureRegion changedRegions[changedTickCount];
+	FowTextureRegion resetRegion;
+
+public:
+	FowTextureReset();
+
+	void setIncremental(bool value);
+	bool isIncremental() const	{return incremental;}
+	void requestFullUpdate();
+	bool isFullUpdate() const	{return fullUpdate;}
+
+	// pixmap1 is the new pixmap, pixmap0 the one of the last tick. Does the
+	// full reset when one is due, an incremental reset waits for the
+	// changed regions of the tick
+	void beginTick(const Pixmap2D *pixmap0, Pixmap2D *pixmap1, ResetMode mode, float exploredAlpha);
+	// the area a sight was drawn to before and after it changed
+	void addChangedRegion(int minX, int minY, int maxX, int maxY);
+	void resetChangedRegions(const Pixmap2D *pixmap0, Pixmap2D *pixmap1, ResetMode mode, float exploredAlpha);
+	// whether a sight area that did not change has to be drawn again
+	bool needsRedraw(int minX, int minY, int maxX, int maxY) const;
+
+	static void resetPixels(const Pixmap2D *pixmap0, Pixmap2D *pixmap1, FowTextureRegion region, ResetMode mode, float exploredAlpha);
+};
+
+}}//end namespace
+
+#endif
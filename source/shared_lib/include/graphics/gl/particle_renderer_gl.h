@@ -13,10 +13,13 @@
 #define _SHARED_GRAPHICS_GL_PARTICLERENDERERGL_H_
 
 #include "particle_renderer.h"
+#include "particle_batch.h"
 #include "leak_dumper.h"
 
 namespace Shared{ namespace Graphics{ namespace Gl{
 
+class ParticleStreamBuffer;
+
 // =====================================================
 //	class ParticleRendererGl
 // =====================================================
@@ -26,21 +29,41 @@ public:
 	static const int bufferSize = 1024;
 
 private:
+	static bool enableBatching;
+
 	bool rendering;
 	Vec3f vertexBuffer[bufferSize];
 	Vec2f texCoordBuffer[bufferSize];
 	Vec4f colorBuffer[bufferSize];
 
+	// quad systems of the current renderManager call, drawn at its end
+	ParticleBatch batch;
+	ParticleStreamBuffer *streamBuffer;
+
+	int drawCallCount;
+	int systemCount;
+	int lastDrawCallCount;
+	int lastSystemCount;
+
 public:
 	//particles
 	ParticleRendererGl();
+	virtual ~ParticleRendererGl();
+
+	static void setEnableBatching(bool value)	{ enableBatching = value; }
+	static bool getEnableBatching()				{ return enableBatching; }
+
 	virtual void renderManager(ParticleManager *pm, ModelRenderer *mr);
 	virtual void renderSystem(ParticleSystem *ps);
 	virtual void renderSystemLine(ParticleSystem *ps);
 	virtual void renderSystemLineAlpha(ParticleSystem *ps);
 	virtual void renderModel(GameParticleSystem *ps, ModelRenderer *mr);
+
+	virtual int getLastDrawCallCount() const	{ return lastDrawCallCount; }
+	virtual int getLastSystemCount() const		{ return lastSystemCount; }
 	
 protected:
+	void renderBatch();
 	void renderBufferQuads(int quadCount);
 	void renderBufferLines(int lineCount);
 	void setBlendMode(ParticleSystem::BlendMode blendMode);
@@ -15,10 +15,93 @@
 #include "vec.h"
 #include "model.h"
 #include <map>
+#include <list>
 #include "leak_dumper.h"
 
 namespace Shared{ namespace Graphics{
 
+// =====================================================
+//	class InterpolationCacheEntry
+// =====================================================
+
+class InterpolationCacheEntry {
+private:
+	friend class InterpolationCache;
+
+	class Key {
+	public:
+		uint32 owner;
+		int channel;
+		uint32 prevFrame;
+		uint32 nextFrame;
+		int step;
+
+		bool operator<(const Key &other) const;
+	};
+
+	Key key;
+	Vec3f *data;
+	uint32 vertexCount;
+	int refCount;
+	std::list<InterpolationCacheEntry *>::iterator lruPosition;
+
+public:
+	const Vec3f *getData() const	{return data;}
+};
+
+// =====================================================
+//	class InterpolationCache
+//
+///	Interpolated key frames shared by every user of a mesh. The units of
+///	a type share their models, so units playing the same animation in
+///	the same phase reuse one buffer. The blend factor between two key
+///	frames is quantized into steps. Entries are evicted least recently
+///	used first, never while an InterpolationData still renders from them.
+// =====================================================
+
+class InterpolationCache {
+private:
+	typedef std::map<InterpolationCacheEntry::Key, InterpolationCacheEntry *> EntryMap;
+
+	EntryMap entries;
+	std::list<InterpolationCacheEntry *> lru;	// most recently used first
+	int steps;
+	int64 maxBytes;
+	int64 usedBytes;
+	int64 hitCount;
+	int64 missCount;
+
+	static InterpolationCache instance;
+
+	InterpolationCache();
+	~InterpolationCache();
+
+	void erase(InterpolationCacheEntry *entry);
+	void evict();
+
+public:
+	static InterpolationCache &getInstance();
+
+	// blend steps between two key frames and memory for the buffers,
+	// either at 0 turns the cache off
+	void setLimits(int steps, int megabytes);
+	bool isEnabled() const		{return steps > 0 && maxBytes > 0;}
+	int getSteps() const		{return steps;}
+
+	// the interpolated frames, computed on a miss. The caller holds a
+	// reference until it calls release
+	InterpolationCacheEntry *acquire(uint32 owner, int channel, const Vec3f *src, uint32 vertexCount,
+									uint32 prevFrame, uint32 nextFrame, int step);
+	void release(InterpolationCacheEntry *entry);
+	// drops the unreferenced entries of an owner
+	void purge(uint32 owner);
+	void clear();
+
+	int64 getHitCount() const	{return hitCount;}
+	int64 getMissCount() const	{return missCount;}
+	int64 getUsedBytes() const	{return usedBytes;}
+};
+
 // =====================================================
 //	class InterpolationData
 // =====================================================
@@ -30,11 +113,17 @@ private:
 	Vec3f *vertices;
 	Vec3f *normals;
 
+	// set instead of vertices and normals while the cache is enabled
+	InterpolationCacheEntry *vertexEntry;
+	InterpolationCacheEntry *normalEntry;
+	uint32 cacheOwner;
+
 	int raw_frame_ofs;
 
 	static bool enableInterpolation;
+	static uint32 nextCacheOwner;
 	
-	void update(const Vec3f* src, Vec3f* &dest, float t, bool cycle);
+	void update(const Vec3f* src, Vec3f* &dest, InterpolationCacheEntry* &entry, int channel, float t, bool cycle);
 
 public:
 	InterpolationData(const Mesh *mesh);
@@ -42,8 +131,11 @@ public:
 
 	static void setEnableInterpolation(bool enabled) { enableInterpolation = enabled; }
 
-	const Vec3f *getVertices() const	{return !vertices || !enableInterpolation? mesh->getVertices()+raw_frame_ofs: vertices;}
-	const Vec3f *getNormals() const		{return !normals || !enableInterpolation? mesh->getNormals()+raw_frame_ofs: normals;}
+	// dest= a + (b - a) * t for count vertices, same bits as Vec3f::lerp
+	static void lerp(const Vec3f *a, const Vec3f *b, float t, Vec3f *dest, uint32 count);
+
+	const Vec3f *getVertices() const;
+	const Vec3f *getNormals() const;
 	
 	void update(float t, bool cycle);
 	void updateVertices(float t, bool cycle);
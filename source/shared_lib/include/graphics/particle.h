@@ -13,6 +13,7 @@
 #define _SHARED_GRAPHICS_PARTICLE_H_
 
 #include <list>
+#include <deque>
 #include <cassert>
 #include "vec.h"
 #include "pixmap.h"
@@ -21,11 +22,16 @@
 #include "xml_parser.h"
 #include "leak_dumper.h"
 #include "interpolation.h"
+#include "particle_kernel.h"
 
 using std::list;
 using Shared::Util::RandomGen;
 using Shared::Xml::XmlNode;
 
+namespace Shared{ namespace PlatformCommon{
+class WorkerThreadPool;
+}}
+
 namespace Shared{ namespace Graphics{
 
 class ParticleSystem;
@@ -38,6 +44,7 @@ class SplashParticleSystem;
 class ParticleRenderer;
 class ModelRenderer;
 class Model;
+class ParticleSystemPool;
 
 // =====================================================
 //	class Particle
@@ -96,6 +103,7 @@ public:
 // =====================================================
 
 class ParticleSystem {
+	friend class ParticleSystemPool;
 
 public:
 
@@ -123,6 +131,7 @@ enum ParticleSystemType {
 protected:
 	
 	std::vector<Particle> particles;
+	ParticleArrays *particleArrays;	// replaces particles when not NULL
 	RandomGen random;
 
 	BlendMode blendMode;
@@ -154,6 +163,10 @@ protected:
 	int particleSystemStartDelay;
 	ParticleObserver *particleObserver;
 	ParticleOwner *particleOwner;
+	ParticleSystemPool *recyclePool;	// pool the system returns to, if any
+
+private:
+	void setDefaults(int particleCount);
 
 public:
 	//conmstructor and destructor
@@ -170,9 +183,16 @@ public:
 	BlendMode getBlendMode() const				{return blendMode;}
 	Texture *getTexture() const					{return texture;}
 	Vec3f getPos() const						{return pos;}
+	// only for systems without particle arrays, use the getters below
 	Particle *getParticle(int i)				{return &particles[i];}
 	const Particle *getParticle(int i) const	{return &particles[i];}
 	int getAliveParticleCount() const			{return aliveParticleCount;}
+	bool getUsesParticleArrays() const			{return particleArrays != NULL;}
+
+	Vec3f getParticlePos(int i) const			{return particleArrays != NULL ? particleArrays->getPos(i) : particles[i].pos;}
+	Vec3f getParticleLastPos(int i) const		{return particleArrays != NULL ? particleArrays->getLastPos(i) : particles[i].lastPos;}
+	Vec4f getParticleColor(int i) const			{return particleArrays != NULL ? particleArrays->getColor(i) : particles[i].color;}
+	float getParticleSize(int i) const			{return particleArrays != NULL ? particleArrays->getSize(i) : particles[i].size;}
 	bool getActive() const						{return active;}
 	virtual bool getVisible() const				{return visible;}
 
@@ -211,6 +231,10 @@ public:
 	virtual ParticleOwner * getParticleOwner() { return this->particleOwner;}
 	virtual void callParticleOwnerEnd(ParticleSystem *particleSystem);
 
+	// true when update() only changes this system, those systems may be
+	// updated on worker threads
+	virtual bool getUpdateIsSelfContained();
+
 	//children
 	virtual int getChildCount() { return 0; }
 	virtual ParticleSystem* getChild(int i);
@@ -225,8 +249,19 @@ public:
 protected:
 	//protected
 	Particle *createParticle();
+	int createParticleIndex();
 	void killParticle(Particle *p);
 
+	// Keeps the particles in ParticleArrays and updates them with
+	// updateParticleArrays instead of updateParticle and deathTest
+	void useParticleArrays();
+	virtual void updateParticleArrays();
+
+	// Pooling: prepareForPool drops every link the destructor would drop,
+	// reset puts back the constructed state but keeps the particle buffers
+	virtual void prepareForPool();
+	virtual void reset(int particleCount);
+
 	//virtual protected
 	virtual void initParticle(Particle *p, int particleIndex);
 	virtual void updateParticle(Particle *p);
@@ -242,14 +277,24 @@ private:
 	float radius;
 	Vec3f windSpeed;
 
+	static ParticleSystemPool pool;
+
+	void setDefaults();
+
+protected:
+	virtual void reset(int particleCount);
+
 public:
 	FireParticleSystem(int particleCount= 2000);
+	// reuses a released system when there is one
+	static FireParticleSystem *create(int particleCount= 2000);
 
 	virtual ParticleSystemType getParticleSystemType() const { return pst_FireParticleSystem;}
 
 	//virtual
 	virtual void initParticle(Particle *p, int particleIndex);
 	virtual void updateParticle(Particle *p);
+	virtual void updateParticleArrays();
 
 	//set params
 	void setRadius(float radius);
@@ -317,6 +362,13 @@ protected:
 	GameParticleSystem(int particleCount);
 	void positionChildren();
 	void setTween(float relative,float absolute);
+	void releaseChildren();
+
+	virtual void prepareForPool();
+	virtual void reset(int particleCount);
+
+private:
+	void setDefaults();
 };
 
 // =====================================================
@@ -337,6 +389,15 @@ private:
     bool energyUp;
     float startTime;
     float endTime;
+
+	static ParticleSystemPool pool;
+
+	void setDefaults();
+	void leaveParent();
+
+protected:
+	virtual void prepareForPool();
+	virtual void reset(int particleCount);
     
 public:
 	enum Shape{
@@ -367,12 +428,15 @@ public:
 public:
 	UnitParticleSystem(int particleCount= 2000);
 	~UnitParticleSystem();
+	// reuses a released system when there is one
+	static UnitParticleSystem *create(int particleCount= 2000);
 
 	virtual ParticleSystemType getParticleSystemType() const { return pst_UnitParticleSystem;}
 
 	//virtual
 	virtual void initParticle(Particle *p, int particleIndex);
 	virtual void updateParticle(Particle *p);
+	virtual void updateParticleArrays();
 	virtual void update();
 	virtual bool getVisible() const;
 	virtual void fade();
@@ -441,6 +505,7 @@ public:
 
 	virtual void initParticle(Particle *p, int particleIndex);
 	virtual bool deathTest(Particle *p);
+	virtual void updateParticleArrays();
 
 	void setRadius(float radius);
 	void setWind(float windAngle, float windSpeed);
@@ -466,6 +531,7 @@ public:
 
 	virtual void initParticle(Particle *p, int particleIndex);
 	virtual bool deathTest(Particle *p);
+	virtual void updateParticleArrays();
 
 	void setRadius(float radius);
 	void setWind(float windAngle, float windSpeed);
@@ -486,6 +552,12 @@ class AttackParticleSystem: public GameParticleSystem {
 protected:
 	float sizeNoEnergy;
 	float gravity;
+
+	virtual void reset(int particleCount);
+
+private:
+	void setDefaults();
+
 public:
 	AttackParticleSystem(int particleCount);
 
@@ -495,6 +567,7 @@ public:
 	void setGravity(float gravity)				{this->gravity= gravity;}
 	
 	virtual void initParticleSystem() {} // opportunity to do any initialization when the system has been created and all settings set
+	virtual bool getUpdateIsSelfContained() { return false; } // moves linked systems and reports to observers
 
 	virtual void saveGame(XmlNode *rootNode);
 	virtual void loadGame(const XmlNode *rootNode);
@@ -540,9 +613,20 @@ private:
 	float arriveDestinationDistance;
 	void rotateChildren();
 
+	static ParticleSystemPool pool;
+
+	void setDefaults();
+	void unlinkSplash();
+
+protected:
+	virtual void prepareForPool();
+	virtual void reset(int particleCount);
+
 public:
 	ProjectileParticleSystem(int particleCount= 1000);
 	virtual ~ProjectileParticleSystem();
+	// reuses a released system when there is one
+	static ProjectileParticleSystem *create(int particleCount= 1000);
 
 	virtual ParticleSystemType getParticleSystemType() const { return pst_SplashParticleSystem;}
 
@@ -588,9 +672,20 @@ private:
 	
 	float startEmissionRate;
 
+	static ParticleSystemPool pool;
+
+	void setDefaults();
+	void unlinkProjectile();
+
+protected:
+	virtual void prepareForPool();
+	virtual void reset(int particleCount);
+
 public:
 	SplashParticleSystem(int particleCount= 1000);
 	virtual ~SplashParticleSystem();
+	// reuses a released system when there is one
+	static SplashParticleSystem *create(int particleCount= 1000);
 	
 	virtual void update();
 	virtual void initParticle(Particle *p, int particleIndex);
@@ -612,6 +707,55 @@ public:
 	virtual Checksum getCRC();
 };
 
+// =====================================================
+//	class ParticleSystemPool
+//
+///	Released particle systems of one class waiting to be reused. Reusing
+///	a system saves the allocation of the object and its particle buffers.
+///	Systems are reused oldest first so a stale pointer is unlikely to see
+///	its old address come back right away. Like ParticleManager a pool is
+///	only used by the thread that creates and manages the systems.
+// =====================================================
+
+class ParticleSystemPool {
+private:
+	string name;
+	std::deque<ParticleSystem *> freeSystems;
+	int64 hitCount;
+	int64 missCount;
+	int liveCount;
+
+	static int maxFreeSystems;
+	static vector<ParticleSystemPool *> &getPoolList();
+
+	ParticleSystemPool(const ParticleSystemPool &);
+	ParticleSystemPool &operator=(const ParticleSystemPool &);
+
+public:
+	ParticleSystemPool(const string &name);
+	~ParticleSystemPool();
+
+	// a reset system of this pool, NULL when the pool is empty in which
+	// case the caller creates one and hands it to track
+	ParticleSystem *acquire(int particleCount);
+	void track(ParticleSystem *ps);
+	void release(ParticleSystem *ps);
+	void clear();
+
+	const string &getName() const	{return name;}
+	int64 getHitCount();
+	int64 getMissCount();
+	int getLiveCount();
+	int getFreeCount();
+
+	// deletes the system or returns it to its pool
+	static void destroy(ParticleSystem *ps);
+	// released systems kept per pool, 0 disables reuse
+	static void setMaxFreeSystems(int value);
+	static int getMaxFreeSystems()	{return maxFreeSystems;}
+	static string getStatsString();
+};
+
 // =====================================================
 //	class ParticleManager
 // =====================================================
@@ -619,10 +763,16 @@ public:
 class ParticleManager {
 private:
 	vector<ParticleSystem *> particleSystems;
+	Shared::PlatformCommon::WorkerThreadPool *updatePool;
+
+	bool getUpdateParticleSystem(ParticleSystem *ps) const;
 
 public:
 	ParticleManager();
 	~ParticleManager();
+	// Self contained systems are updated on threadCount worker threads
+	// plus the calling thread, 0 updates everything on the calling thread
+	void setUpdateThreadCount(int threadCount);
 	void update(int renderFps=-1);
 	void render(ParticleRenderer *pr, ModelRenderer *mr) const;	
 	void manage(ParticleSystem *ps);
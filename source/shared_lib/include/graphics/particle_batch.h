@@ -0,0 +1,91 @@
+// ==============================================================
+//	This file is part of MegaGlest Shared Library (www.megaglest.org)
+//
+//	Copyright (C) 2013 MegaGlest team
+//
+//	You can redistribute this code and/or modify it under
+//	the terms of the GNU General Public License as published
+//	by the Free Software Foundation; either version 2 of the
+//	License, or (at your option) any later version
+// ==============================================================
+
+#ifndef _SHARED_GRAPHICS_PARTICLEBATCH_H_
+#define _SHARED_GRAPHICS_PARTICLEBATCH_H_
+
+#include <vector>
+#include "vec.h"
+#include "particle.h"
+#include "leak_dumper.h"
+
+namespace Shared{ namespace Graphics{
+
+class Texture;
+
+// =====================================================
+//	class ParticleVertex
+//
+/// One corner of a billboard, interleaved so a whole batch is one
+/// vertex buffer
+// =====================================================
+
+class ParticleVertex {
+public:
+	Vec3f pos;
+	Vec2f texCoord;
+	Vec4f color;
+};
+
+// =====================================================
+//	class ParticleBatchDraw
+//
+/// A range of quads sharing texture and blend mode
+// =====================================================
+
+class ParticleBatchDraw {
+public:
+	Texture *texture;
+	ParticleSystem::BlendMode blendMode;
+	int firstVertex;
+	int vertexCount;
+};
+
+// =====================================================
+//	class ParticleBatch
+//
+/// Collects the billboard particle systems of a frame and expands them
+/// into quads grouped by material, so the renderer needs one draw per
+/// texture and blend mode instead of one per system. Materials keep the
+/// order they first appeared in and systems keep their order inside a
+/// material. Does not touch the graphics API.
+// =====================================================
+
+class ParticleBatch {
+private:
+	class Run {
+	public:
+		const ParticleSystem *system;
+		int material;
+	};
+
+	std::vector<Run> runs;
+	std::vector<ParticleBatchDraw> draws;
+	std::vector<ParticleVertex> vertices;
+
+	int findMaterial(Texture *texture, ParticleSystem::BlendMode blendMode);
+
+public:
+	void clear();
+	// the system must stay alive until build
+	void addSystem(const ParticleSystem *ps);
+	// camera aligned billboards like ParticleRendererGl::renderSystem
+	void build(const Vec3f &rightVector, const Vec3f &upVector);
+
+	bool isEmpty() const								{return runs.empty();}
+	int getSystemCount() const							{return (int)runs.size();}
+	const std::vector<ParticleBatchDraw> &getDraws() const		{return draws;}
+	const std::vector<ParticleVertex> &getVertices() const		{return vertices;}
+};
+
+}}//end namespace
+
+#endif
@@ -0,0 +1,119 @@
+// ==============================================================
+//	This file is part of MegaGlest Shared Library (www.megaglest.org)
+//
+//	Copyright (C) 2013 MegaGlest team
+//
+//	You can redistribute this code and/or modify it under
+//	the terms of the GNU General Public License as published
+//	by the Free Software Foundation; either version 2 of the
+//	License, or (at your option) any later version
+// ==============================================================
+
+#ifndef _SHARED_GRAPHICS_PARTICLEKERNEL_H_
+#define _SHARED_GRAPHICS_PARTICLEKERNEL_H_
+
+#include <vector>
+#include "vec.h"
+#include "leak_dumper.h"
+
+namespace Shared{ namespace Graphics{
+
+class Particle;
+
+enum ParticleKernelEngine {
+	pkeScalar,	// one particle per step, the reference
+	pkeSSE2		// four particles per step, same result
+};
+
+// =====================================================
+//	class ParticleArrays
+//
+/// Structure of arrays particle storage, every particle component lives
+/// in its own array so the integrators can handle several particles with
+/// one instruction
+// =====================================================
+
+class ParticleArrays {
+public:
+	std::vector<float> posX, posY, posZ;
+	std::vector<float> lastPosX, lastPosY, lastPosZ;
+	std::vector<float> speedX, speedY, speedZ;
+	std::vector<float> accelX, accelY, accelZ;
+	std::vector<float> colorR, colorG, colorB, colorA;
+	std::vector<float> size;
+	std::vector<int> energy;
+
+public:
+	void resize(int count);
+	int getCapacity() const		{return (int)energy.size();}
+
+	void store(int index, const Particle &particle);
+	void load(int index, Particle &particle) const;
+	void move(int fromIndex, int toIndex);
+
+	Vec3f getPos(int i) const		{return Vec3f(posX[i], posY[i], posZ[i]);}
+	Vec3f getLastPos(int i) const	{return Vec3f(lastPosX[i], lastPosY[i], lastPosZ[i]);}
+	Vec4f getColor(int i) const		{return Vec4f(colorR[i], colorG[i], colorB[i], colorA[i]);}
+	float getSize(int i) const		{return size[i];}
+	int getEnergy(int i) const		{return energy[i];}
+};
+
+// =====================================================
+//	class UnitParticleParams
+//
+/// System wide values read by the unit particle integrator
+// =====================================================
+
+class UnitParticleParams {
+public:
+	int maxParticleEnergy;
+	int alternations;
+	Vec4f color;
+	Vec4f colorNoEnergy;
+	float particleSize;
+	float sizeNoEnergy;
+	bool fixed;
+	Vec3f fixedAddition;
+	bool isDaylightAffected;
+	Vec3f lightColor;
+	// false for static systems, their energy pulses between 1 and max
+	bool decrementEnergy;
+	// direction of the static pulse, updated by the integrator
+	bool energyUp;
+
+	UnitParticleParams();
+};
+
+// =====================================================
+//	class ParticleKernel
+//
+/// Integrators for the common particle systems working on ParticleArrays.
+/// Every engine gives the same bits as the virtual updateParticle of the
+/// matching system, including the decimal truncation.
+// =====================================================
+
+class ParticleKernel {
+private:
+	static ParticleKernelEngine engine;
+
+public:
+	static void setEngine(ParticleKernelEngine value);
+	static ParticleKernelEngine getEngine() { return engine; }
+	static bool isEngineAvailable(ParticleKernelEngine value);
+
+	// lastPos= pos, pos+= speed, speed+= accel, energy-- (rain and snow)
+	static void integrateLinear(ParticleArrays &arrays, int count);
+	// FireParticleSystem::updateParticle
+	static void integrateFire(ParticleArrays &arrays, int count);
+	// UnitParticleSystem::updateParticle
+	static void integrateUnit(ParticleArrays &arrays, int count, UnitParticleParams &params);
+
+	// Swap remove dead particles, the alive ones stay at the front, returns
+	// the new alive count
+	static int removeExhausted(ParticleArrays &arrays, int count);	// energy <= 0
+	static int removeBelowGround(ParticleArrays &arrays, int count);	// pos.y < 0
+};
+
+}}//end namespace
+
+#endif
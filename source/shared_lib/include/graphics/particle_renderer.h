@@ -32,6 +32,10 @@ public:
 	virtual void renderSystemLine(ParticleSystem *ps)=0;
 	virtual void renderSystemLineAlpha(ParticleSystem *ps)=0;
 	virtual void renderModel(GameParticleSystem *ps, ModelRenderer *mr)=0;
+
+	//stats of the last renderManager call
+	virtual int getLastDrawCallCount() const=0;
+	virtual int getLastSystemCount() const=0;
 };
 
 }}//end namespace
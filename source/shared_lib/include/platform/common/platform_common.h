@@ -245,6 +245,7 @@ int getScreenW();
 int getScreenH();
 
 void sleep(int millis);
+int getCPUCoreCount();
 
 bool isCursorShowing();
 void showCursor(bool b);
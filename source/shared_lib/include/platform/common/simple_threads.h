@@ -169,6 +169,163 @@ public:
     virtual bool canShutdown(bool deleteSelfIfShutdownDelayed=false);
 };
 
+// =====================================================
+//	class WorkerThreadPool
+// =====================================================
+
+//
+// This interface describes the methods a callback object must implement
+//
+class WorkerTaskCallbackInterface {
+public:
+	// Called once per task index, workerIndex identifies the executing
+	// worker so callers can keep per worker scratch data without locking
+	virtual void workerTask(int taskIndex, int workerIndex) = 0;
+
+	virtual ~WorkerTaskCallbackInterface() {}
+};
+
+class WorkerThreadPool;
+
+class WorkerThread : public BaseThread
+{
+protected:
+	WorkerThreadPool *pool;
+	int workerIndex;
+	Semaphore semTaskSignalled;
+
+	virtual void setQuitStatus(bool value);
+
+public:
+	WorkerThread(WorkerThreadPool *pool, int workerIndex);
+	virtual ~WorkerThread();
+	virtual void execute();
+	virtual bool canShutdown(bool deleteSelfIfShutdownDelayed=false);
+
+	void signalWorker();
+};
+
+///	Fixed set of worker threads that run a batch of indexed tasks. Each
+///	worker owns a contiguous range of task indexes and steals half of the
+///	largest remaining range when its own range runs dry. The calling thread
+///	takes part as the last worker and runTasks returns once every task
+///	of the batch has completed.
+class WorkerThreadPool {
+protected:
+	class TaskRange {
+	public:
+		TaskRange() {
+			next = 0;
+			end = 0;
+		}
+		int next;
+		int end;
+	};
+
+	vector<WorkerThread *> workers;
+	Mutex *mutexTasks;
+	WorkerTaskCallbackInterface *callback;
+	vector<TaskRange> taskRanges;
+	int taskCount;
+	int tasksCompleted;
+	int tasksStolen;
+	string taskError;
+	Semaphore semTasksCompleted;
+
+	bool claimTask(int workerIndex, WorkerTaskCallbackInterface *&taskCallback, int &taskIndex);
+	void completeTask(const string &error);
+	void assignTasks(WorkerTaskCallbackInterface *callback, int taskCount, int workerCount);
+
+public:
+	WorkerThreadPool(int threadCount, string uniqueID);
+	virtual ~WorkerThreadPool();
+
+	// number of worker slots including the calling thread
+	int getWorkerCount() const { return (int)workers.size() + 1; }
+	int getLastTasksStolen() const { return tasksStolen; }
+
+	void runTasks(WorkerTaskCallbackInterface *callback, int taskCount);
+	void runWorkerTasks(int workerIndex);
+
+	// Hands a batch to the worker threads only so the calling thread is free
+	// to do other work until waitForTasks. Without worker threads the batch
+	// runs right away on the calling thread.
+	void beginTasks(WorkerTaskCallbackInterface *callback, int taskCount);
+	void waitForTasks();
+};
+
+// =====================================================
+//	class TaskGraph
+// =====================================================
+
+//
+// This interface describes the methods a callback object must implement
+//
+class TaskGraphCallbackInterface {
+public:
+	virtual void graphTask(int taskId, int taskParam) = 0;
+
+	virtual ~TaskGraphCallbackInterface() {}
+};
+
+///	Set of tasks that declare the shared resources they read and write.
+///	A task is placed on a level after every earlier added task it
+///	conflicts with, the tasks of one level run concurrently on a
+///	WorkerThreadPool. Tasks bound to the calling thread never leave it.
+///	As long as the declared resources are complete the outcome is the
+///	same as running the tasks one by one in the order they were added.
+class TaskGraph : public WorkerTaskCallbackInterface {
+protected:
+	class Task {
+	public:
+		Task() {
+			id = 0;
+			param = 0;
+			callerThread = false;
+			level = 0;
+			millis = 0;
+		}
+		string name;
+		int id;
+		int param;
+		bool callerThread;
+		vector<int> reads;
+		vector<int> writes;
+		int level;
+		int64 millis;
+	};
+
+	vector<Task> tasks;
+	int levelCount;
+	TaskGraphCallbackInterface *callback;
+	// indexes of the worker tasks of the level being run
+	vector<int> levelWorkerTasks;
+
+	bool conflicts(const Task &task1, const Task &task2) const;
+	void computeLevels();
+
+public:
+	TaskGraph();
+
+	void clear();
+	int addTask(const string &name, int id, int param=0, bool callerThread=false);
+	void addRead(int taskIndex, int resource);
+	void addWrite(int taskIndex, int resource);
+
+	int getTaskCount() const						{ return (int)tasks.size(); }
+	const string & getTaskName(int taskIndex) const	{ return tasks[taskIndex].name; }
+	int64 getTaskMillis(int taskIndex) const		{ return tasks[taskIndex].millis; }
+	int getLevelCount() const						{ return levelCount; }
+	bool isWriting(int taskIndex, int resource) const;
+
+	// Runs every task, concurrently where allowed when pool is not NULL
+	void run(TaskGraphCallbackInterface *callback, WorkerThreadPool *pool);
+	// Runs a single task on the calling thread
+	void runTask(TaskGraphCallbackInterface *callback, int taskIndex);
+
+	virtual void workerTask(int taskIndex, int workerIndex);
+};
+
 }}//end namespace
 
 #endif
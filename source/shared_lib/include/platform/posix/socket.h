@@ -151,6 +151,14 @@ protected:
 
 	bool isSocketBlocking;
 	time_t lastSocketError;
+	int64 sentByteCount;
+
+	// sockets created in this process are numbered, a new connection keeps
+	// its own number even when it gets the address or descriptor of an old one
+	static Mutex nextSerialSynchAccessor;
+	static uint32 nextSerial;
+	uint32 serial;
+	void assignSerial();
 
 public:
 	Socket(PLATFORM_SOCKET sock);
@@ -180,9 +188,11 @@ public:
     virtual void disconnectSocket();
 
     PLATFORM_SOCKET getSocketId() const { return sock; }
+    uint32 getSerial() const { return serial; }
 
 	int getDataToRead(bool wantImmediateReply=false);
 	int send(const void *data, int dataSize);
+	int64 getSentByteCount();
 	int receive(void *data, int dataSize, bool tryReceiveUntilDataSizeMet);
 	int peek(void *data, int dataSize, bool mustGetData=true,int *pLastSocketError=NULL);
 
@@ -0,0 +1,89 @@
+// ==============================================================
+//	This file is part of MegaGlest Shared Library (www.megaglest.org)
+//
+//	Copyright (C) 2013 MegaGlest team
+//
+//	You can redistribute this code and/or modify it under
+//	the terms of the GNU General Public License as published
+//	by the Free Software Foundation; either version 2 of the
+//	License, or (at your option) any later version
+// ==============================================================
+
+#ifndef _SHARED_PLATFORM_SOCKETREACTOR_H_
+#define _SHARED_PLATFORM_SOCKETREACTOR_H_
+
+#include "socket.h"
+#include <vector>
+
+#if defined(__linux__) && !defined(WIN32)
+	#define MG_SOCKET_REACTOR_EPOLL
+	#include <sys/epoll.h>
+#endif
+
+#include "leak_dumper.h"
+
+using std::vector;
+
+namespace Shared { namespace Platform {
+
+// =====================================================
+//	class SocketReactor
+//
+///	Persistent set of sockets watched for incoming data.
+///	Sockets are registered once under a small integer key
+///	(e.g. a slot index) instead of being collected before
+///	every poll. Uses epoll on Linux and select elsewhere or
+///	when epoll is disabled or not available.
+// =====================================================
+
+class SocketReactor {
+protected:
+	vector<PLATFORM_SOCKET> keySockets;
+	vector<uint32> keySerials;
+	int socketCount;
+	bool usingEpoll;
+#ifdef MG_SOCKET_REACTOR_EPOLL
+	int epollId;
+	vector<struct epoll_event> epollEvents;
+#endif
+
+	void registerSocket(int key, PLATFORM_SOCKET socket);
+	void unregisterSocket(int key, PLATFORM_SOCKET socket);
+	int waitWithSelect(vector<int> &readyKeys, int waitMicroseconds);
+#ifdef MG_SOCKET_REACTOR_EPOLL
+	int waitWithEpoll(vector<int> &readyKeys, int waitMicroseconds);
+#endif
+
+private:
+	SocketReactor(const SocketReactor &);
+	SocketReactor & operator=(const SocketReactor &);
+
+public:
+	SocketReactor(bool useEpoll=true);
+	~SocketReactor();
+
+	bool isUsingEpoll() const 	{ return usingEpoll; }
+	int getSocketCount() const	{ return socketCount; }
+
+	// Watches socket under key, replacing the previous socket of key.
+	// An invalid socket removes the key
+	void setSocket(int key, PLATFORM_SOCKET socket);
+	// Same with the serial of the Socket object (see Socket::getSerial).
+	// A socket with a new serial is registered again even when it got the
+	// descriptor number and address of the socket it replaces, which left
+	// the epoll set when it was closed
+	void setSocket(int key, PLATFORM_SOCKET socket, uint32 serial);
+	void removeSocket(int key);
+	PLATFORM_SOCKET getSocket(int key) const;
+	void clear();
+
+	// Waits up to waitMicroseconds for a watched socket to become readable
+	// and fills readyKeys with the keys of all readable sockets. Closed or
+	// failed sockets are reported as readable so their owner notices.
+	// Returns the number of ready keys
+	int waitForReadable(vector<int> &readyKeys, int waitMicroseconds=0);
+};
+
+}}//end namespace
+
+#endif
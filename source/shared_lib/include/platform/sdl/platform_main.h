@@ -33,6 +33,7 @@ const char  *GAME_ARGS[] = {
 	"--starthost",
 	"--headless-server-mode",
 	"--headless-server-status",
+	"--headless-server-benchmark",
 	"--use-ports",
 
 	"--load-scenario",
@@ -45,6 +46,7 @@ const char  *GAME_ARGS[] = {
 	"--lua-debug",
 	"--curl-info",
 	"--xerces-info",
+	"--crc-benchmark",
 
 	"--validate-techtrees",
 	"--validate-factions",
@@ -114,6 +116,7 @@ enum GAME_ARG_TYPE {
 	GAME_ARG_SERVER,
 	GAME_ARG_MASTERSERVER_MODE,
 	GAME_ARG_MASTERSERVER_STATUS,
+	GAME_ARG_MASTERSERVER_BENCHMARK,
 	GAME_ARG_USE_PORTS,
 
 	GAME_ARG_LOADSCENARIO,
@@ -126,6 +129,7 @@ enum GAME_ARG_TYPE {
 	GAME_ARG_LUA_DEBUG,
 	GAME_ARG_CURL_INFO,
 	GAME_ARG_XERCES_INFO,
+	GAME_ARG_CRC_BENCHMARK,
 
 	GAME_ARG_VALIDATE_TECHTREES,
 	GAME_ARG_VALIDATE_FACTIONS,
@@ -237,6 +241,14 @@ void printParameterHelp(const char *argv0, bool foundInvalidArgs) {
 
 	printf("\n%s\tCheck the current status of a headless server.",GAME_ARGS[GAME_ARG_MASTERSERVER_STATUS]);
 
+	printf("\n%s=x,y,z\tBenchmark a headless server against simulated clients.",GAME_ARGS[GAME_ARG_MASTERSERVER_BENCHMARK]);
+	printf("\n                     \t\tWhere x is the number of clients connecting over");
+	printf("\n                     \t\t        localhost (default is 7)");
+	printf("\n                     \t\t      y is the number of frames to run (default is 2400)");
+	printf("\n                     \t\t      z is an optional .replay file with the commands");
+	printf("\n                     \t\t        the clients send, else random commands are sent");
+	printf("\n                     \t\t*NOTE: the server listens on the port set with %s",GAME_ARGS[GAME_ARG_USE_PORTS]);
+
 	printf("\n%s=x,y,z\t\t\tForce hosted games to listen internally on port",GAME_ARGS[GAME_ARG_USE_PORTS]);
 	printf("\n\t\t\t\tx, externally on port y and game status on port z.");
 	printf("\n                     \t\tWhere x is the internal port # on the local");
@@ -261,6 +273,9 @@ void printParameterHelp(const char *argv0, bool foundInvalidArgs) {
 	printf("\n%s\t\t\tdisplays LUA debug information.",GAME_ARGS[GAME_ARG_LUA_DEBUG]);
 	printf("\n%s\t\t\tdisplays your CURL version information.",GAME_ARGS[GAME_ARG_CURL_INFO]);
 	printf("\n%s\t\t\tdisplays your XERCES version information.",GAME_ARGS[GAME_ARG_XERCES_INFO]);
+	printf("\n%s=x\t\tmeasures the speed of the CRC32 kernels.",GAME_ARGS[GAME_ARG_CRC_BENCHMARK]);
+	printf("\n                     \t\tWhere x is the megabytes hashed by each kernel");
+	printf("\n                     \t\t        (default is 64)");
 
 	printf("\n%s=x=purgeunused=purgeduplicates=gitdelete=hideduplicates",GAME_ARGS[GAME_ARG_VALIDATE_TECHTREES]);
 	printf("\n                     \t\tdisplay a report detailing any known problems");
@@ -665,7 +680,9 @@ int mainSetup(int argc, char **argv) {
 	   hasCommandArgument(argc, argv,string(GAME_ARGS[GAME_ARG_VERSION])) == true ||
 	   hasCommandArgument(argc, argv,string(GAME_ARGS[GAME_ARG_SHOW_INI_SETTINGS])) == true ||
 	   hasCommandArgument(argc, argv,string(GAME_ARGS[GAME_ARG_MASTERSERVER_MODE])) == true ||
-	   hasCommandArgument(argc, argv,string(GAME_ARGS[GAME_ARG_MASTERSERVER_STATUS]))) {
+	   hasCommandArgument(argc, argv,string(GAME_ARGS[GAME_ARG_MASTERSERVER_STATUS])) == true ||
+	   hasCommandArgument(argc, argv,string(GAME_ARGS[GAME_ARG_MASTERSERVER_BENCHMARK])) == true ||
+	   hasCommandArgument(argc, argv,string(GAME_ARGS[GAME_ARG_CRC_BENCHMARK]))) {
 	     // Use this for masterserver mode for timers like Chrono
 		 if(SystemFlags::VERBOSE_MODE_ENABLED) printf("In [%s::%s Line: %d]\n",__FILE__,__FUNCTION__,__LINE__);
 
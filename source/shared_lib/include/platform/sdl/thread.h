@@ -406,6 +406,35 @@ public:
 	int waitTillSignalled(Mutex *mutex, int waitMilliseconds=-1);
 };
 
+// =====================================================
+//	class FrameBarrier
+//
+///	Blocks a master thread until every participant has
+///	arrived for the current frame. Waiting sleeps on a
+///	condition variable instead of polling.
+// =====================================================
+
+class FrameBarrier {
+private:
+	Mutex *mutex;
+	Trigger *trigger;
+	int frameIndex;
+	int participantCount;
+	int arrivedCount;
+
+public:
+	FrameBarrier();
+	~FrameBarrier();
+
+	void beginFrame(int frameIndex, int participantCount);
+	// arrivals for any frame other than the current one are ignored
+	void arrive(int frameIndex);
+	bool waitForFrame(int frameIndex, int waitMilliseconds=-1);
+
+	bool isFrameComplete(int frameIndex);
+	int getFrameIndex();
+};
+
 class MasterSlaveThreadController;
 
 class SlaveThreadControllerInterface {
@@ -417,11 +446,9 @@ public:
 
 class MasterSlaveThreadController {
 private:
-	static const int triggerBaseCount = 1;
-
 	Mutex *mutex;
-	Semaphore *slaveTriggerSem;
-	int slaveTriggerCounter;
+	FrameBarrier *slaveBarrier;
+	int slaveFrameIndex;
 
 	std::vector<SlaveThreadControllerInterface *> slaveThreadList;
 
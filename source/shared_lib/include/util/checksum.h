@@ -14,6 +14,7 @@
 
 #include <string>
 #include <map>
+#include <vector>
 #include "data_types.h"
 #include "thread.h"
 #include "leak_dumper.h"
@@ -27,16 +28,23 @@ namespace Shared{ namespace Util{
 //	class Checksum
 // =====================================================
 
+enum ChecksumEngine {
+	ceByteTable,	// one table lookup per byte
+	ceSliceBy8		// eight table lookups per 8 bytes, same result
+};
+
 class Checksum {
 private:
 	uint32	sum;
 	int32	r;
     int32	c1;
     int32	c2;
+	ChecksumEngine engine;
 	std::map<string,uint32> fileList;
 
 	static Mutex fileListCacheSynchAccessor;
 	static std::map<string,uint32> fileListCache;
+	static int fileSumThreadCount;
 
 	void addSum(uint32 value);
 	bool addFileToSum(const string &path);
@@ -59,6 +67,35 @@ public:
 
 	static void removeFileFromCache(const string file);
 	static void clearFileCache();
+
+	// CRC of a single file as used for the file list sums
+	static uint32 computeFileSum(const string &path);
+	// Computes the sums of all files not cached yet, spread over worker
+	// threads when there are enough of them
+	static void cacheFileSums(const std::vector<string> &paths);
+	// CRC32 kernels, both compute the same standard CRC32 continuing from
+	// crc (0 to start)
+	static uint32 crc32ByteTable(uint32 crc, const void *data, size_t size);
+	static uint32 crc32SliceBy8(uint32 crc, const void *data, size_t size);
+	// kernel used by addBytes and everything built on it for this checksum
+	void setEngine(ChecksumEngine value) { engine = value; }
+	ChecksumEngine getEngine() const { return engine; }
+
+	// Persistent per file sum index so unchanged files are not read again
+	// on the next run
+	static void openFileSumIndex(const string &indexFile);
+	// writes the new sums now instead of waiting for enough of them
+	static void saveFileSumIndex();
+	// saves and releases the index, call once the precache has stopped
+	static void closeFileSumIndex();
+	static bool isFileSumIndexOpen();
+
+	// Worker threads used by cacheFileSums, 0 hashes on the calling thread
+	static void setFileSumThreadCount(int value) { fileSumThreadCount = value; }
+	static int getFileSumThreadCount() { return fileSumThreadCount; }
+	// stops the worker threads kept between cacheFileSums calls, the next
+	// call starts them again
+	static void releaseFileSumThreads();
 };
 
 }}//end namespace
@@ -0,0 +1,98 @@
+// ==============================================================
+//	This file is part of MegaGlest Shared Library (www.megaglest.org)
+//
+//	Copyright (C) 2013 MegaGlest team
+//
+//	You can redistribute this code and/or modify it under
+//	the terms of the GNU General Public License as published
+//	by the Free Software Foundation; either version 2 of the
+//	License, or (at your option) any later version
+// ==============================================================
+
+#ifndef _SHARED_UTIL_FILECRCINDEX_H_
+#define _SHARED_UTIL_FILECRCINDEX_H_
+
+#include <string>
+#include <map>
+#include <ctime>
+#include "data_types.h"
+#include "thread.h"
+#include "leak_dumper.h"
+
+using std::string;
+using namespace Shared::Platform;
+
+namespace Shared{ namespace Util{
+
+// =====================================================
+//	class FileCRCIndex
+//
+/// Persistent index mapping a file path plus its size, modification time
+/// and inode to the CRC of its contents. The index file is memory mapped
+/// and searched in place, new sums are kept in memory until save().
+// =====================================================
+
+class FileCRCIndex {
+public:
+	struct FileStamp {
+		uint64 size;
+		int64 modifiedTime;
+		uint64 inode;
+
+		FileStamp() : size(0), modifiedTime(0), inode(0) {}
+		bool operator==(const FileStamp &other) const {
+			return size == other.size && modifiedTime == other.modifiedTime && inode == other.inode;
+		}
+	};
+
+private:
+	typedef std::map<string,std::pair<FileStamp,uint32> > PendingMap;
+
+	Mutex mutex;
+	string indexFile;
+	bool opened;
+
+	const unsigned char *mappedData;
+	size_t mappedSize;
+#ifdef WIN32
+	void *fileHandle;
+	void *mappingHandle;
+#endif
+
+	uint32 entryCount;
+	uint32 stringsSize;
+	PendingMap pending;
+	time_t lastSaveTime;
+
+	bool mapIndexFile();
+	void unmapIndexFile();
+	int findMappedEntry(const string &path, uint32 pathHash) const;
+	bool getMappedEntry(uint32 index, string &path, FileStamp &stamp, uint32 &sum) const;
+
+public:
+	FileCRCIndex();
+	~FileCRCIndex();
+
+	// Starts using indexFile, a missing or unreadable file gives an empty index
+	void open(const string &indexFile);
+	// Releases the index file, pending sums not saved are dropped
+	void close();
+	bool isOpen();
+
+	static bool getFileStamp(const string &path, FileStamp &stamp);
+
+	bool findSum(const string &path, const FileStamp &stamp, uint32 &sum);
+	void setSum(const string &path, const FileStamp &stamp, uint32 sum);
+	bool hasPendingSums();
+	// Merges the new sums into the index file, drops entries of files that
+	// no longer exist
+	bool save();
+	// save() once pendingLimit sums are waiting or the last save is more
+	// than seconds old, so a long scan does not rewrite the file per folder
+	bool saveIfDue(uint32 pendingLimit, int seconds);
+	uint32 getEntryCount();
+};
+
+}}//end namespace
+
+#endif
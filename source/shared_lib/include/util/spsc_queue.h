@@ -0,0 +1,161 @@
+// ==============================================================
+//	This file is part of MegaGlest Shared Library (www.megaglest.org)
+//
+//	Copyright (C) 2013 MegaGlest team
+//
+//	You can redistribute this code and/or modify it under
+//	the terms of the GNU General Public License as published
+//	by the Free Software Foundation; either version 2 of the
+//	License, or (at your option) any later version
+// ==============================================================
+
+#ifndef _SHARED_UTIL_SPSCQUEUE_H_
+#define _SHARED_UTIL_SPSCQUEUE_H_
+
+#include <vector>
+#include <string>
+#include "data_types.h"
+#include "thread.h"
+#include "platform_common.h"
+
+#if defined(WIN32) && !defined(__MINGW32__)
+  #include <windows.h>
+  #define SPSC_QUEUE_MEMORY_BARRIER() MemoryBarrier()
+#else
+  #define SPSC_QUEUE_MEMORY_BARRIER() __sync_synchronize()
+#endif
+
+#include "leak_dumper.h"
+
+using namespace Shared::Platform;
+
+namespace Shared{ namespace Util{
+
+// =====================================================
+//	class SPSCQueue
+//
+/// Bounded single producer / single consumer queue. Pushing and popping
+/// through the ring never lock, only when the ring is full the producer
+/// spills into a locked overflow list so nothing is dropped and order is
+/// kept. Producers may change threads as long as they never push at the
+/// same time, the same goes for consumers.
+// =====================================================
+
+template<typename T>
+class SPSCQueue {
+private:
+	std::vector<T> ring;
+	uint32 capacityMask;
+	volatile uint32 readPosition;		// written by the consumer only
+	volatile uint32 writePosition;		// written by the producer only
+	volatile uint32 discardPosition;	// ring items before this are dropped
+
+	Mutex overflowMutex;
+	std::vector<T> overflow;
+	volatile bool overflowUsed;
+
+	SPSCQueue(const SPSCQueue &);
+	SPSCQueue &operator=(const SPSCQueue &);
+
+	void popRing(std::vector<T> &items) {
+		uint32 read = readPosition;
+		uint32 write = writePosition;
+		SPSC_QUEUE_MEMORY_BARRIER();
+		uint32 discard = discardPosition;
+		if((int32)(discard - read) > 0 && (int32)(write - discard) >= 0) {
+			read = discard;
+		}
+		const uint32 first = read;
+		const size_t firstItem = items.size();
+		for(; read != write; ++read) {
+			items.push_back(ring[read & capacityMask]);
+		}
+		SPSC_QUEUE_MEMORY_BARRIER();
+
+		// A discardAll on the producer thread (a reconnect) may have run
+		// while the items were copied, the ones it covers belong to the old
+		// connection and are dropped here. The slots stay untouched until
+		// readPosition moves on, so a later discardPosition is all it takes.
+		discard = discardPosition;
+		if((int32)(discard - first) > 0) {
+			uint32 dropCount = discard - first;
+			if(dropCount > write - first) {
+				dropCount = write - first;
+			}
+			items.erase(items.begin() + firstItem, items.begin() + firstItem + dropCount);
+		}
+		readPosition = read;
+	}
+
+public:
+	explicit SPSCQueue(uint32 capacity) : overflowMutex(CODE_AT_LINE) {
+		uint32 size = 1;
+		while(size < capacity) {
+			size <<= 1;
+		}
+		ring.resize(size);
+		capacityMask = size - 1;
+		readPosition = 0;
+		writePosition = 0;
+		discardPosition = 0;
+		overflowUsed = false;
+	}
+
+	// producer side
+	void push(const T &item) {
+		if(overflowUsed == false) {
+			uint32 write = writePosition;
+			SPSC_QUEUE_MEMORY_BARRIER();
+			if(write - readPosition < (uint32)ring.size()) {
+				ring[write & capacityMask] = item;
+				// the item has to be visible before the position moves on
+				SPSC_QUEUE_MEMORY_BARRIER();
+				writePosition = write + 1;
+				return;
+			}
+		}
+
+		// once spilled everything goes to overflow until it is drained
+		MutexSafeWrapper safeMutex(&overflowMutex,CODE_AT_LINE);
+		overflow.push_back(item);
+		overflowUsed = true;
+	}
+
+	// producer side, drops everything not popped yet. A popAll running at
+	// the same time returns none of the dropped items unless it was already
+	// done with the ring, such a pop simply counts as before the discard.
+	void discardAll() {
+		MutexSafeWrapper safeMutex(&overflowMutex,CODE_AT_LINE);
+		overflow.clear();
+		overflowUsed = false;
+		SPSC_QUEUE_MEMORY_BARRIER();
+		discardPosition = writePosition;
+	}
+
+	// consumer side, appends all queued items in push order
+	void popAll(std::vector<T> &items) {
+		popRing(items);
+
+		SPSC_QUEUE_MEMORY_BARRIER();
+		if(overflowUsed == true) {
+			MutexSafeWrapper safeMutex(&overflowMutex,CODE_AT_LINE);
+			// no ring pushes happen while overflow is in use, so whatever
+			// is left in the ring is older than the overflow items
+			popRing(items);
+			items.insert(items.end(),overflow.begin(),overflow.end());
+			overflow.clear();
+			overflowUsed = false;
+		}
+	}
+
+	// consumer side
+	bool empty() const {
+		return (readPosition == writePosition && overflowUsed == false);
+	}
+
+	uint32 getCapacity() const { return (uint32)ring.size(); }
+};
+
+}}//end namespace
+
+#endif
@@ -324,4 +324,29 @@ bool extractFileFromZIPFile(string inFile, string outFile) {
 	return(result == EXIT_SUCCESS ? true : false);
 }
 
+bool compressBuffer(const unsigned char *inBuffer, size_t inSize, std::vector<unsigned char> &outBuffer, int compressionLevel) {
+	mz_ulong outSize = mz_compressBound((mz_ulong)inSize);
+	outBuffer.resize(outSize);
+	int result = mz_compress2(&outBuffer[0], &outSize, inBuffer, (mz_ulong)inSize, compressionLevel);
+	if(result != MZ_OK) {
+		if(SystemFlags::VERBOSE_MODE_ENABLED) printf("mz_compress2() failed: %d\n", result);
+		outBuffer.clear();
+		return false;
+	}
+	outBuffer.resize(outSize);
+	return true;
+}
+
+bool uncompressBuffer(const unsigned char *inBuffer, size_t inSize, std::vector<unsigned char> &outBuffer, size_t uncompressedSize) {
+	outBuffer.resize(uncompressedSize);
+	mz_ulong outSize = (mz_ulong)uncompressedSize;
+	int result = mz_uncompress((uncompressedSize > 0 ? &outBuffer[0] : NULL), &outSize, inBuffer, (mz_ulong)inSize);
+	if(result != MZ_OK || outSize != (mz_ulong)uncompressedSize) {
+		if(SystemFlags::VERBOSE_MODE_ENABLED) printf("mz_uncompress() failed: %d\n", result);
+		outBuffer.clear();
+		return false;
+	}
+	return true;
+}
+
 }}
@@ -0,0 +1,152 @@
+// ==============================================================
+//	This file is part of MegaGlest Shared Library (www.megaglest.org)
+//
+//	Copyright (C) 2013 MegaGlest team
+//
+//	You can redistribute this code and/or modify it under
+//	the terms of the GNU General Public License as published
+//	by the Free Software Foundation; either version 2 of the
+//	License, or (at your option) any later version
+// ==============================================================
+
+#include "fow_texture.h"
+
+#include <climits>
+#include "leak_dumper.h"
+
+namespace Shared{ namespace Graphics{
+
+// =====================================================
+//	class FowTextureRegion
+// =====================================================
+
+void FowTextureRegion::clear() {
+	minX = INT_MAX;
+	minY = INT_MAX;
+	maxX = -1;
+	maxY = -1;
+}
+
+void FowTextureRegion::add(int minX, int minY, int maxX, int maxY) {
+	if(maxX < minX || maxY < minY) {
+		return;
+	}
+	if(minX < this->minX) this->minX = minX;
+	if(minY < this->minY) this->minY = minY;
+	if(maxX > this->maxX) this->maxX = maxX;
+	if(maxY > this->maxY) this->maxY = maxY;
+}
+
+void FowTextureRegion::add(const FowTextureRegion &region) {
+	add(region.minX, region.minY, region.maxX, region.maxY);
+}
+
+bool FowTextureRegion::intersects(int minX, int minY, int maxX, int maxY) const {
+	return (isEmpty() == false &&
+			minX <= this->maxX && maxX >= this->minX &&
+			minY <= this->maxY && maxY >= this->minY);
+}
+
+// =====================================================
+//	class FowTextureReset
+// =====================================================
+
+FowTextureReset::FowTextureReset() {
+	incremental = false;
+	requestFullUpdate();
+}
+
+void FowTextureReset::setIncremental(bool value) {
+	incremental = value;
+	requestFullUpdate();
+}
+
+void FowTextureReset::requestFullUpdate() {
+	// both pixmaps have to go through a full reset before the changed
+	// regions can be trusted again
+	fullUpdateCount = 2;
+	fullUpdate = true;
+}
+
+void FowTextureReset::beginTick(const Pixmap2D *pixmap0, Pixmap2D *pixmap1, ResetMode mode, float exploredAlpha) {
+	resetRegion.clear();
+	if(incremental == false || fullUpdateCount > 0) {
+		if(fullUpdateCount > 0) {
+			fullUpdateCount--;
+		}
+		fullUpdate = true;
+
+		FowTextureRegion region;
+		region.add(0, 0, pixmap1->getW() - 1, pixmap1->getH() - 1);
+		resetPixels(pixmap0, pixmap1, region, mode, exploredAlpha);
+	}
+	else {
+		fullUpdate = false;
+	}
+}
+
+void FowTextureReset::addChangedRegion(int minX, int minY, int maxX, int maxY) {
+	changedRegions[0].add(minX, minY, maxX, maxY);
+}
+
+void FowTextureReset::resetChangedRegions(const Pixmap2D *pixmap0, Pixmap2D *pixmap1, ResetMode mode, float exploredAlpha) {
+	// the reset is not idempotent, every pixel must be reset once per tick
+	resetRegion.clear();
+	if(fullUpdate == false) {
+		for(int i = 0; i < changedTickCount; ++i) {
+			resetRegion.add(changedRegions[i]);
+		}
+		resetPixels(pixmap0, pixmap1, resetRegion, mode, exploredAlpha);
+	}
+
+	for(int i = changedTickCount - 1; i > 0; --i) {
+		changedRegions[i] = changedRegions[i - 1];
+	}
+	changedRegions[0].clear();
+}
+
+bool FowTextureReset::needsRedraw(int minX, int minY, int maxX, int maxY) const {
+	return (fullUpdate == true || resetRegion.intersects(minX, minY, maxX, maxY) == true);
+}
+
+void FowTextureReset::resetPixels(const Pixmap2D *pixmap0, Pixmap2D *pixmap1, FowTextureRegion region, ResetMode mode, float exploredAlpha) {
+	if(region.minX < 0) region.minX = 0;
+	if(region.minY < 0) region.minY = 0;
+	if(region.maxX >= pixmap1->getW()) region.maxX = pixmap1->getW() - 1;
+	if(region.maxY >= pixmap1->getH()) region.maxY = pixmap1->getH() - 1;
+
+	for(int indexPixelWidth = region.minX;
+			indexPixelWidth <= region.maxX;
+			++indexPixelWidth){
+		for(int indexPixelHeight = region.minY;
+				indexPixelHeight <= region.maxY;
+				++indexPixelHeight){
+			if(mode == rmNoFogOfWar) {
+				float p0 = pixmap0->getPixelf(indexPixelWidth, indexPixelHeight);
+				float p1 = pixmap1->getPixelf(indexPixelWidth, indexPixelHeight);
+				if (p0 > p1) {
+					pixmap1->setPixel(indexPixelWidth, indexPixelHeight, p0);
+				}
+				else {
+					pixmap1->setPixel(indexPixelWidth, indexPixelHeight, p1);
+				}
+			}
+			else if(mode == rmFogOfWar) {
+				float p0= pixmap0->getPixelf(indexPixelWidth, indexPixelHeight);
+				float p1= pixmap1->getPixelf(indexPixelWidth, indexPixelHeight);
+
+				if(p1 > exploredAlpha) {
+					pixmap1->setPixel(indexPixelWidth, indexPixelHeight, exploredAlpha);
+				}
+				if(p0 > p1) {
+					pixmap1->setPixel(indexPixelWidth, indexPixelHeight, p0);
+				}
+			}
+			else {
+				pixmap1->setPixel(indexPixelWidth, indexPixelHeight, 1.f);
+			}
+		}
+	}
+}
+
+}}//end namespace
@@ -15,20 +15,212 @@
 #include "texture_gl.h"
 #include "model_renderer.h"
 #include "math_util.h"
+#include "util.h"
+#include <cstring>
 #include "leak_dumper.h"
 
+using namespace Shared::Util;
+
 namespace Shared{ namespace Graphics{ namespace Gl{
 
+#if defined(GL_ARB_buffer_storage) && defined(GL_ARB_sync) && defined(GL_ARB_map_buffer_range)
+	#define PARTICLE_PERSISTENT_BUFFER_SUPPORTED
+#endif
+
+// =====================================================
+//	class ParticleStreamBuffer
+//
+/// Vertex buffer refilled every frame. Uses a persistently mapped ring
+/// of regions fenced per frame where the driver can, an orphaned buffer
+/// object where it cannot, and plain client memory without buffer objects.
+// =====================================================
+
+class ParticleStreamBuffer {
+private:
+	enum Mode {
+		smUndecided,
+		smClientMemory,
+		smOrphan,
+		smPersistent
+	};
+
+	static const int regionCount = 3;
+
+	Mode mode;
+	GLuint handle;
+	int capacity;	// bytes, per region in persistent mode
+
+#ifdef PARTICLE_PERSISTENT_BUFFER_SUPPORTED
+	char *mapping;
+	int region;
+	GLsync fences[regionCount];
+#endif
+
+	void chooseMode();
+	void release();
+	const char *uploadPersistent(const void *data, int byteCount);
+	const char *uploadOrphan(const void *data, int byteCount);
+
+public:
+	ParticleStreamBuffer();
+	~ParticleStreamBuffer();
+
+	// returns what the gl*Pointer calls take, an offset into the bound
+	// buffer or the data itself for client memory
+	const char *upload(const void *data, int byteCount);
+	// call once the draws reading the uploaded data were issued
+	void endUpload();
+};
+
+ParticleStreamBuffer::ParticleStreamBuffer() {
+	mode= smUndecided;
+	handle= 0;
+	capacity= 0;
+#ifdef PARTICLE_PERSISTENT_BUFFER_SUPPORTED
+	mapping= NULL;
+	region= 0;
+	for(int i = 0; i < regionCount; ++i) {
+		fences[i]= NULL;
+	}
+#endif
+}
+
+ParticleStreamBuffer::~ParticleStreamBuffer() {
+	release();
+}
+
+void ParticleStreamBuffer::chooseMode() {
+	mode= smClientMemory;
+	if(getVBOSupported() == true) {
+		mode= smOrphan;
+#ifdef PARTICLE_PERSISTENT_BUFFER_SUPPORTED
+		if(isGlExtensionSupported("GL_ARB_buffer_storage") == true &&
+			isGlExtensionSupported("GL_ARB_sync") == true &&
+			isGlExtensionSupported("GL_ARB_map_buffer_range") == true) {
+			mode= smPersistent;
+		}
+#endif
+	}
+	if(SystemFlags::getSystemSettingType(SystemFlags::debugSystem).enabled) SystemFlags::OutputDebug(SystemFlags::debugSystem,"In [%s::%s Line: %d] particle stream buffer mode = %d\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,mode);
+}
+
+void ParticleStreamBuffer::release() {
+#ifdef PARTICLE_PERSISTENT_BUFFER_SUPPORTED
+	for(int i = 0; i < regionCount; ++i) {
+		if(fences[i] != NULL) {
+			glDeleteSync(fences[i]);
+			fences[i]= NULL;
+		}
+	}
+	if(mapping != NULL) {
+		glBindBufferARB(GL_ARRAY_BUFFER_ARB, handle);
+		glUnmapBufferARB(GL_ARRAY_BUFFER_ARB);
+		glBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
+		mapping= NULL;
+	}
+#endif
+	if(handle != 0) {
+		glDeleteBuffersARB(1, &handle);
+		handle= 0;
+	}
+	capacity= 0;
+}
+
+const char *ParticleStreamBuffer::upload(const void *data, int byteCount) {
+	if(mode == smUndecided) {
+		chooseMode();
+	}
+	if(mode == smPersistent) {
+		return uploadPersistent(data, byteCount);
+	}
+	else if(mode == smOrphan) {
+		return uploadOrphan(data, byteCount);
+	}
+	return static_cast<const char *>(data);
+}
+
+const char *ParticleStreamBuffer::uploadOrphan(const void *data, int byteCount) {
+	if(handle == 0) {
+		glGenBuffersARB(1, &handle);
+	}
+	glBindBufferARB(GL_ARRAY_BUFFER_ARB, handle);
+	if(byteCount > capacity) {
+		capacity= max(byteCount, capacity * 2);
+	}
+	// a fresh store lets the driver keep the one still read by the gpu
+	glBufferDataARB(GL_ARRAY_BUFFER_ARB, capacity, NULL, GL_STREAM_DRAW_ARB);
+	glBufferSubDataARB(GL_ARRAY_BUFFER_ARB, 0, byteCount, data);
+	return (char *) NULL;
+}
+
+const char *ParticleStreamBuffer::uploadPersistent(const void *data, int byteCount) {
+#ifdef PARTICLE_PERSISTENT_BUFFER_SUPPORTED
+	if(byteCount > capacity) {
+		// storage is immutable, grow by starting over
+		int newCapacity= max(byteCount, capacity * 2);
+		release();
+		capacity= newCapacity;
+
+		const GLbitfield flags= GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glGenBuffersARB(1, &handle);
+		glBindBufferARB(GL_ARRAY_BUFFER_ARB, handle);
+		glBufferStorage(GL_ARRAY_BUFFER_ARB, (GLsizeiptr)capacity * regionCount, NULL, flags);
+		mapping= static_cast<char *>(glMapBufferRange(GL_ARRAY_BUFFER_ARB, 0, (GLsizeiptr)capacity * regionCount, flags));
+		if(mapping == NULL) {
+			// the driver claims support but refuses, stream the old way
+			release();
+			mode= smOrphan;
+			return uploadOrphan(data, byteCount);
+		}
+	}
+
+	region= (region + 1) % regionCount;
+	if(fences[region] != NULL) {
+		// the frame that used this region two frames ago must be done
+		GLenum waitResult= glClientWaitSync(fences[region], GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+		while(waitResult == GL_TIMEOUT_EXPIRED) {
+			waitResult= glClientWaitSync(fences[region], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+		}
+		glDeleteSync(fences[region]);
+		fences[region]= NULL;
+	}
+
+	memcpy(mapping + region * capacity, data, byteCount);
+	glBindBufferARB(GL_ARRAY_BUFFER_ARB, handle);
+	return (char *) NULL + region * capacity;
+#else
+	return uploadOrphan(data, byteCount);
+#endif
+}
+
+void ParticleStreamBuffer::endUpload() {
+#ifdef PARTICLE_PERSISTENT_BUFFER_SUPPORTED
+	if(mode == smPersistent && mapping != NULL) {
+		fences[region]= glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+#endif
+	if(handle != 0) {
+		glBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
+	}
+}
+
 // =====================================================
 //	class ParticleRendererGl
 // =====================================================
 
+bool ParticleRendererGl::enableBatching = true;
+
 // ===================== PUBLIC ========================
 
 ParticleRendererGl::ParticleRendererGl(){
 	assert(bufferSize%4 == 0);
 
 	rendering= false;
+	streamBuffer= NULL;
+	drawCallCount= 0;
+	systemCount= 0;
+	lastDrawCallCount= 0;
+	lastSystemCount= 0;
 
 	// init texture coordinates for quads
 	for(int i= 0; i<bufferSize; i+=4){
@@ -39,6 +231,11 @@ ParticleRendererGl::ParticleRendererGl(){
 	}
 }
 
+ParticleRendererGl::~ParticleRendererGl(){
+	delete streamBuffer;
+	streamBuffer= NULL;
+}
+
 void ParticleRendererGl::renderManager(ParticleManager *pm, ModelRenderer *mr){
 
 	//assertions
@@ -60,10 +257,18 @@ void ParticleRendererGl::renderManager(ParticleManager *pm, ModelRenderer *mr){
 	glEnable(GL_BLEND);
 
 	//render
+	drawCallCount= 0;
+	systemCount= 0;
+	batch.clear();
+
 	rendering= true;
 	pm->render(this, mr);
+	renderBatch();
 	rendering= false;
 
+	lastDrawCallCount= drawCallCount;
+	lastSystemCount= systemCount;
+
 	//pop state
 	glPopClientAttrib();
 	glPopAttrib();
@@ -76,6 +281,12 @@ void ParticleRendererGl::renderSystem(ParticleSystem *ps){
 	assertGl();
 	assert(rendering);
 
+	systemCount++;
+	if(enableBatching == true) {
+		batch.addSystem(ps);
+		return;
+	}
+
 	Vec3f rightVector;
 	Vec3f upVector;
 	float modelview[16];
@@ -107,10 +318,9 @@ void ParticleRendererGl::renderSystem(ParticleSystem *ps){
 	int bufferIndex= 0;
 
 	for(int i=0; i<ps->getAliveParticleCount(); ++i){
-		const Particle *particle= ps->getParticle(i);
-		float size= particle->getSize()/2.0f;
-		Vec3f pos= particle->getPos();
-		Vec4f color= particle->getColor();
+		float size= ps->getParticleSize(i)/2.0f;
+		Vec3f pos= ps->getParticlePos(i);
+		Vec4f color= ps->getParticleColor(i);
 
 		vertexBuffer[bufferIndex] = pos - (rightVector - upVector) * size;
 		vertexBuffer[bufferIndex+1] = pos - (rightVector + upVector) * size;
@@ -139,9 +349,9 @@ void ParticleRendererGl::renderSystemLine(ParticleSystem *ps){
 	assertGl();
 	assert(rendering);
 
-	if(!ps->isEmpty()){
-		const Particle *particle= ps->getParticle(0);
+	systemCount++;
 
+	if(!ps->isEmpty()){
 		setBlendMode(ps->getBlendMode());
 
 		glDisable(GL_TEXTURE_2D);
@@ -153,14 +363,13 @@ void ParticleRendererGl::renderSystemLine(ParticleSystem *ps){
 		//fill vertex buffer with lines
 		int bufferIndex= 0;
 
-		glLineWidth(particle->getSize());
+		glLineWidth(ps->getParticleSize(0));
 
 		for(int i=0; i<ps->getAliveParticleCount(); ++i){
-			particle= ps->getParticle(i);
-			Vec4f color= particle->getColor();
+			Vec4f color= ps->getParticleColor(i);
 
-			vertexBuffer[bufferIndex] = particle->getPos();
-			vertexBuffer[bufferIndex+1] = particle->getLastPos();
+			vertexBuffer[bufferIndex] = ps->getParticlePos(i);
+			vertexBuffer[bufferIndex+1] = ps->getParticleLastPos(i);
 
 			colorBuffer[bufferIndex]= color;
 			colorBuffer[bufferIndex+1]= color;
@@ -183,9 +392,9 @@ void ParticleRendererGl::renderSystemLineAlpha(ParticleSystem *ps){
 	assertGl();
 	assert(rendering);
 
-	if(!ps->isEmpty()){
-		const Particle *particle= ps->getParticle(0);
+	systemCount++;
 
+	if(!ps->isEmpty()){
 		setBlendMode(ps->getBlendMode());
 
 		glDisable(GL_TEXTURE_2D);
@@ -197,14 +406,13 @@ void ParticleRendererGl::renderSystemLineAlpha(ParticleSystem *ps){
 		//fill vertex buffer with lines
 		int bufferIndex= 0;
 
-		glLineWidth(particle->getSize());
+		glLineWidth(ps->getParticleSize(0));
 
 		for(int i=0; i<ps->getAliveParticleCount(); ++i){
-			particle= ps->getParticle(i);
-			Vec4f color= particle->getColor();
+			Vec4f color= ps->getParticleColor(i);
 
-			vertexBuffer[bufferIndex] = particle->getPos();
-			vertexBuffer[bufferIndex+1] = particle->getLastPos();
+			vertexBuffer[bufferIndex] = ps->getParticlePos(i);
+			vertexBuffer[bufferIndex+1] = ps->getParticleLastPos(i);
 
 			colorBuffer[bufferIndex]= color;
 			colorBuffer[bufferIndex+1]= color;
@@ -272,12 +480,72 @@ void ParticleRendererGl::renderModel(GameParticleSystem *ps, ModelRenderer *mr){
 
 // ============== PRIVATE =====================================
 
+// draws the queued quad systems, one draw call per texture and blend mode
+void ParticleRendererGl::renderBatch(){
+	if(batch.isEmpty() == true) {
+		return;
+	}
+	assertGl();
+
+	// same camera aligned billboards as renderSystem
+	float modelview[16];
+	glGetFloatv(GL_MODELVIEW_MATRIX , modelview);
+	Vec3f rightVector= Vec3f(modelview[0], modelview[4], modelview[8]);
+	Vec3f upVector= Vec3f(modelview[1], modelview[5], modelview[9]);
+
+	batch.build(rightVector, upVector);
+
+	const vector<ParticleVertex> &vertices= batch.getVertices();
+	const vector<ParticleBatchDraw> &draws= batch.getDraws();
+	if(vertices.empty() == false) {
+		if(streamBuffer == NULL) {
+			streamBuffer= new ParticleStreamBuffer();
+		}
+		const char *base= streamBuffer->upload(&vertices[0], (int)(vertices.size() * sizeof(ParticleVertex)));
+
+		const ParticleVertex &layout= vertices[0];
+		const char *layoutBase= reinterpret_cast<const char *>(&layout);
+		const GLsizei stride= sizeof(ParticleVertex);
+
+		glDisable(GL_ALPHA_TEST);
+		glDisable(GL_FOG);
+		glAlphaFunc(GL_GREATER, 0.0f);
+		glEnable(GL_TEXTURE_2D);
+		glEnableClientState(GL_VERTEX_ARRAY);
+		glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+		glEnableClientState(GL_COLOR_ARRAY);
+
+		glVertexPointer(3, GL_FLOAT, stride, base + (reinterpret_cast<const char *>(&layout.pos) - layoutBase));
+		glTexCoordPointer(2, GL_FLOAT, stride, base + (reinterpret_cast<const char *>(&layout.texCoord) - layoutBase));
+		glColorPointer(4, GL_FLOAT, stride, base + (reinterpret_cast<const char *>(&layout.color) - layoutBase));
+
+		for(unsigned int i = 0; i < draws.size(); ++i) {
+			const ParticleBatchDraw &draw= draws[i];
+
+			setBlendMode(draw.blendMode);
+			if(draw.texture != NULL){
+				glBindTexture(GL_TEXTURE_2D, static_cast<Texture2DGl*>(draw.texture)->getHandle());
+			}
+			else{
+				glBindTexture(GL_TEXTURE_2D, 0);
+			}
+			glDrawArrays(GL_QUADS, draw.firstVertex, draw.vertexCount);
+			drawCallCount++;
+		}
+		streamBuffer->endUpload();
+	}
+	batch.clear();
+
+	assertGl();
+}
+
 void ParticleRendererGl::renderBufferQuads(int quadCount){
 	glVertexPointer(3, GL_FLOAT, 0, vertexBuffer);
 	glTexCoordPointer(2, GL_FLOAT, 0, texCoordBuffer);
 	glColorPointer(4, GL_FLOAT, 0, colorBuffer);
 
 	glDrawArrays(GL_QUADS, 0, quadCount);
+	drawCallCount++;
 }
 
 void ParticleRendererGl::renderBufferLines(int lineCount){
@@ -285,6 +553,7 @@ void ParticleRendererGl::renderBufferLines(int lineCount){
 	glColorPointer(4, GL_FLOAT, 0, colorBuffer);
 
 	glDrawArrays(GL_LINES, 0, lineCount);
+	drawCallCount++;
 }
 
 void ParticleRendererGl::setBlendMode(ParticleSystem::BlendMode blendMode){
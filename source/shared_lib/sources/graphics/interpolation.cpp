@@ -11,6 +11,11 @@
 
 #include "interpolation.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #define INTERPOLATION_SSE2
+  #include <emmintrin.h>
+#endif
+
 #include <cassert>
 #include <algorithm>
 
@@ -26,11 +31,143 @@ using namespace Shared::Util;
 
 namespace Shared{ namespace Graphics{
 
+// =====================================================
+//	class InterpolationCacheEntry
+// =====================================================
+
+bool InterpolationCacheEntry::Key::operator<(const Key &other) const {
+	if(owner != other.owner) {
+		return owner < other.owner;
+	}
+	if(channel != other.channel) {
+		return channel < other.channel;
+	}
+	if(prevFrame != other.prevFrame) {
+		return prevFrame < other.prevFrame;
+	}
+	if(nextFrame != other.nextFrame) {
+		return nextFrame < other.nextFrame;
+	}
+	return step < other.step;
+}
+
+// =====================================================
+//	class InterpolationCache
+// =====================================================
+
+InterpolationCache::InterpolationCache() {
+	steps= 32;
+	maxBytes= 32 * 1024 * 1024;
+	usedBytes= 0;
+	hitCount= 0;
+	missCount= 0;
+}
+
+InterpolationCache::~InterpolationCache() {
+	clear();
+}
+
+// not a function local static, meshes owned by singletons are released
+// at exit and must still find the cache
+InterpolationCache InterpolationCache::instance;
+
+InterpolationCache &InterpolationCache::getInstance() {
+	return instance;
+}
+
+void InterpolationCache::setLimits(int steps, int megabytes) {
+	this->steps= max(steps, 0);
+	this->maxBytes= (int64)max(megabytes, 0) * 1024 * 1024;
+	evict();
+}
+
+InterpolationCacheEntry *InterpolationCache::acquire(uint32 owner, int channel, const Vec3f *src, uint32 vertexCount,
+													uint32 prevFrame, uint32 nextFrame, int step) {
+	InterpolationCacheEntry::Key key;
+	key.owner= owner;
+	key.channel= channel;
+	key.prevFrame= prevFrame;
+	key.nextFrame= nextFrame;
+	key.step= step;
+
+	EntryMap::iterator iterFind= entries.find(key);
+	if(iterFind != entries.end()) {
+		hitCount++;
+		InterpolationCacheEntry *entry= iterFind->second;
+		entry->refCount++;
+		lru.splice(lru.begin(), lru, entry->lruPosition);
+		return entry;
+	}
+	missCount++;
+
+	InterpolationCacheEntry *entry= new InterpolationCacheEntry();
+	entry->key= key;
+	entry->vertexCount= vertexCount;
+	entry->data= new Vec3f[vertexCount];
+	entry->refCount= 1;
+	InterpolationData::lerp(src + prevFrame * vertexCount, src + nextFrame * vertexCount,
+							static_cast<float>(step) / steps, entry->data, vertexCount);
+
+	lru.push_front(entry);
+	entry->lruPosition= lru.begin();
+	entries[key]= entry;
+	usedBytes+= (int64)vertexCount * sizeof(Vec3f);
+
+	evict();
+	return entry;
+}
+
+void InterpolationCache::release(InterpolationCacheEntry *entry) {
+	if(entry != NULL) {
+		entry->refCount--;
+	}
+}
+
+void InterpolationCache::erase(InterpolationCacheEntry *entry) {
+	usedBytes-= (int64)entry->vertexCount * sizeof(Vec3f);
+	lru.erase(entry->lruPosition);
+	entries.erase(entry->key);
+	delete [] entry->data;
+	delete entry;
+}
+
+void InterpolationCache::evict() {
+	std::list<InterpolationCacheEntry *>::iterator iter= lru.end();
+	while(usedBytes > maxBytes && iter != lru.begin()) {
+		--iter;
+		InterpolationCacheEntry *entry= *iter;
+		if(entry->refCount <= 0) {
+			// step back first, erase invalidates the entry's position
+			std::list<InterpolationCacheEntry *>::iterator next= iter;
+			++next;
+			erase(entry);
+			iter= next;
+		}
+	}
+}
+
+void InterpolationCache::purge(uint32 owner) {
+	for(std::list<InterpolationCacheEntry *>::iterator iter= lru.begin(); iter != lru.end();) {
+		InterpolationCacheEntry *entry= *iter;
+		++iter;
+		if(entry->key.owner == owner && entry->refCount <= 0) {
+			erase(entry);
+		}
+	}
+}
+
+void InterpolationCache::clear() {
+	while(lru.empty() == false) {
+		erase(lru.back());
+	}
+}
+
 // =====================================================
 //	class InterpolationData
 // =====================================================
 
 bool InterpolationData::enableInterpolation = true;
+uint32 InterpolationData::nextCacheOwner = 1;
 
 InterpolationData::InterpolationData(const Mesh *mesh) {
 	if(GlobalStaticFlags::getIsNonGraphicalModeEnabled() == true) {
@@ -39,6 +176,10 @@ InterpolationData::InterpolationData(const Mesh *mesh) {
 
 	vertices= NULL;
 	normals= NULL;
+	vertexEntry= NULL;
+	normalEntry= NULL;
+	// an id instead of the mesh address, a new mesh may reuse the address
+	cacheOwner= nextCacheOwner++;
 	
 	raw_frame_ofs = 0;
 	
@@ -50,6 +191,66 @@ InterpolationData::~InterpolationData(){
 	vertices=NULL;
 	delete [] normals;
 	normals=NULL;
+
+	InterpolationCache &cache= InterpolationCache::getInstance();
+	cache.release(vertexEntry);
+	vertexEntry=NULL;
+	cache.release(normalEntry);
+	normalEntry=NULL;
+	cache.purge(cacheOwner);
+}
+
+const Vec3f *InterpolationData::getVertices() const {
+	if(enableInterpolation == true) {
+		if(vertexEntry != NULL) {
+			return vertexEntry->getData();
+		}
+		if(vertices != NULL) {
+			return vertices;
+		}
+	}
+	return mesh->getVertices()+raw_frame_ofs;
+}
+
+const Vec3f *InterpolationData::getNormals() const {
+	if(enableInterpolation == true) {
+		if(normalEntry != NULL) {
+			return normalEntry->getData();
+		}
+		if(normals != NULL) {
+			return normals;
+		}
+	}
+	return mesh->getNormals()+raw_frame_ofs;
+}
+
+void InterpolationData::lerp(const Vec3f *a, const Vec3f *b, float t, Vec3f *dest, uint32 count) {
+	uint32 j= 0;
+#ifdef INTERPOLATION_SSE2
+	// the vertices are packed floats, lerp them four floats at a time
+	if(sizeof(Vec3f) == sizeof(float) * 3) {
+		const float *floatsA= &a[0].x;
+		const float *floatsB= &b[0].x;
+		float *floatsDest= &dest[0].x;
+		const uint32 floatCount= count * 3;
+		const __m128 factor= _mm_set1_ps(t);
+
+		uint32 i= 0;
+		for(; i + 4 <= floatCount; i+= 4) {
+			__m128 valueA= _mm_loadu_ps(floatsA + i);
+			__m128 valueB= _mm_loadu_ps(floatsB + i);
+			__m128 result= _mm_add_ps(valueA, _mm_mul_ps(_mm_sub_ps(valueB, valueA), factor));
+			_mm_storeu_ps(floatsDest + i, result);
+		}
+		for(; i < floatCount; ++i) {
+			floatsDest[i]= floatsA[i] + (floatsB[i] - floatsA[i]) * t;
+		}
+		j= count;
+	}
+#endif
+	for(; j < count; ++j) {
+		dest[j]= a[j].lerp(t, b[j]);
+	}
 }
 
 void InterpolationData::update(float t, bool cycle){
@@ -58,14 +259,14 @@ void InterpolationData::update(float t, bool cycle){
 }
 
 void InterpolationData::updateVertices(float t, bool cycle) {
-	update(mesh->getVertices(), vertices, t, cycle);
+	update(mesh->getVertices(), vertices, vertexEntry, 0, t, cycle);
 }
 
 void InterpolationData::updateNormals(float t, bool cycle) {
-	update(mesh->getNormals(), normals, t, cycle);
+	update(mesh->getNormals(), normals, normalEntry, 1, t, cycle);
 }
 
-void InterpolationData::update(const Vec3f* src, Vec3f* &dest, float t, bool cycle) {
+void InterpolationData::update(const Vec3f* src, Vec3f* &dest, InterpolationCacheEntry* &entry, int channel, float t, bool cycle) {
 
 	if(t <0.0f || t>1.0f) {
 		printf("ERROR t = [%f] for cycle [%d] f [%d] v [%d]\n",t,cycle,mesh->getFrameCount(),mesh->getVertexCount());
@@ -106,11 +307,24 @@ void InterpolationData::update(const Vec3f* src, Vec3f* &dest, float t, bool cyc
 		assert(nextFrame<frameCount);
 		
 		if(enableInterpolation) {
-			if(!dest) { // not previously allocated
-			      dest = new Vec3f[vertexCount];
+			InterpolationCache &cache= InterpolationCache::getInstance();
+			if(cache.isEnabled() == true) {
+				int steps= cache.getSteps();
+				int step= min(max(static_cast<int>(localT * steps + 0.5f), 0), steps);
+
+				// acquire before release so an unchanged pose is not evicted
+				InterpolationCacheEntry *oldEntry= entry;
+				entry= cache.acquire(cacheOwner, channel, src, vertexCount, prevFrame, nextFrame, step);
+				cache.release(oldEntry);
 			}
-			for(uint32 j=0; j<vertexCount; ++j){
-				dest[j]= src[prevFrameBase+j].lerp(localT, src[nextFrameBase+j]);
+			else {
+				cache.release(entry);
+				entry= NULL;
+
+				if(!dest) { // not previously allocated
+				      dest = new Vec3f[vertexCount];
+				}
+				lerp(src + prevFrameBase, src + nextFrameBase, localT, dest, vertexCount);
 			}
 		} else {
 			raw_frame_ofs = prevFrameBase;
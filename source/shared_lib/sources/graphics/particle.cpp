@@ -24,6 +24,7 @@
 #include "model.h"
 #include "texture.h"
 #include "platform_util.h"
+#include "simple_threads.h"
 #include "leak_dumper.h"
 
 using namespace std;
@@ -86,18 +87,24 @@ ParticleSystem::ParticleSystem(int particleCount) {
 		memoryObjectList[this]++;
 	}
 
-	textureFileLoadDeferred = "";
-	textureFileLoadDeferredSystemId = 0;
-	textureFileLoadDeferredFormat = Texture::fAuto;
-	textureFileLoadDeferredComponents = 0;
-
 	//init particle vector
-	blendMode= bmOne;
 	//particles= new Particle[particleCount];
 	particles.clear();
 	//particles.reserve(particleCount);
 	particles.resize(particleCount);
+	particleArrays= NULL;
+	recyclePool= NULL;
+
+	setDefaults(particleCount);
+}
 
+void ParticleSystem::setDefaults(int particleCount) {
+	textureFileLoadDeferred = "";
+	textureFileLoadDeferredSystemId = 0;
+	textureFileLoadDeferredFormat = Texture::fAuto;
+	textureFileLoadDeferredComponents = 0;
+
+	blendMode= bmOne;
 	state= sPlay;
 	aliveParticleCount= 0;
 	active= true;
@@ -122,6 +129,7 @@ ParticleSystem::ParticleSystem(int particleCount) {
 	teamcolorEnergy= false;
 	alternations= 0;
 	particleSystemStartDelay= 0;
+	factionColor= Vec3f(0.0f);
 
 	this->particleOwner = NULL;
 	this->particleSize = 0.0f;
@@ -136,11 +144,18 @@ ParticleSystem::~ParticleSystem() {
 
 	//delete [] particles;
 	particles.clear();
+	delete particleArrays;
+	particleArrays = NULL;
 
 	delete particleObserver;
 	particleObserver = NULL;
 }
 
+bool ParticleSystem::getUpdateIsSelfContained() {
+	// observers run game code and children are moved by their parent
+	return (particleObserver == NULL && getChildCount() == 0);
+}
+
 void ParticleSystem::callParticleOwnerEnd(ParticleSystem *particleSystem) {
 	if(this->particleOwner != NULL) {
 		this->particleOwner->end(particleSystem);
@@ -188,24 +203,30 @@ Checksum ParticleSystem::getCRC() {
 
 //updates all living particles and creates new ones
 void ParticleSystem::update() {
-	if(aliveParticleCount > (int) particles.size()) {
+	int capacity= (particleArrays != NULL ? particleArrays->getCapacity() : (int) particles.size());
+	if(aliveParticleCount > capacity) {
 		throw megaglest_runtime_error("aliveParticleCount >= particles.size()");
 	}
     if(particleSystemStartDelay > 0) {
     	particleSystemStartDelay--;
     }
     else if(state != sPause) {
-		for(int i= 0; i < aliveParticleCount; ++i) {
-			updateParticle(&particles[i]);
+		if(particleArrays != NULL) {
+			updateParticleArrays();
+		}
+		else {
+			for(int i= 0; i < aliveParticleCount; ++i) {
+				updateParticle(&particles[i]);
 
-			if(deathTest(&particles[i])) {
+				if(deathTest(&particles[i])) {
 
-				//kill the particle
-				killParticle(&particles[i]);
+					//kill the particle
+					killParticle(&particles[i]);
 
-				//maintain alive particles at front of the array
-				if(aliveParticleCount > 0) {
-					particles[i]= particles[aliveParticleCount];
+					//maintain alive particles at front of the array
+					if(aliveParticleCount > 0) {
+						particles[i]= particles[aliveParticleCount];
+					}
 				}
 			}
 		}
@@ -214,8 +235,16 @@ void ParticleSystem::update() {
 			emissionState= emissionState + emissionRate;
 			int emissionIntValue= (int) emissionState;
 			for(int i= 0; i < emissionIntValue; i++){
-				Particle *p= createParticle();
-				initParticle(p, i);
+				if(particleArrays != NULL) {
+					Particle particle;
+					int particleIndex= createParticleIndex();
+					initParticle(&particle, i);
+					particleArrays->store(particleIndex, particle);
+				}
+				else {
+					Particle *p= createParticle();
+					initParticle(p, i);
+				}
 			}
 			emissionState = emissionState - (float) emissionIntValue;
 			emissionState = truncateDecimal<float>(emissionState,6);
@@ -314,7 +343,7 @@ void ParticleSystem::setVisible(bool visible){
 string ParticleSystem::toString() const {
 	string result = "ParticleSystem ";
 
-	result += "particles = " + intToStr(particles.size());
+	result += "particles = " + intToStr(particleArrays != NULL ? particleArrays->getCapacity() : (int) particles.size());
 
 //	for(unsigned int i = 0; i < particles.size(); ++i) {
 //		Particle &particle = particles[i];
@@ -449,8 +478,13 @@ void ParticleSystem::loadGame(const XmlNode *rootNode) {
 //		particle.saveGame(particleSystemNode);
 //	}
 
-	particles.clear();
-	particles.resize(particleCount);
+	if(particleArrays != NULL) {
+		particleArrays->resize(particleCount);
+	}
+	else {
+		particles.clear();
+		particles.resize(particleCount);
+	}
 
 //	vector<XmlNode *> particleNodeList = particleSystemNode->getChildList("Particle");
 //	for(unsigned int i = 0; i < particleNodeList.size(); ++i) {
@@ -563,14 +597,29 @@ int ParticleSystem::isEmpty() const {
 // if there is one dead particle it returns it else, return the particle with 
 // less energy
 Particle * ParticleSystem::createParticle() {
+	return &particles[createParticleIndex()];
+}
+
+int ParticleSystem::createParticleIndex() {
 
 	//if any dead particles
 	if(aliveParticleCount < particleCount) {
 		++aliveParticleCount;
-		return &particles[aliveParticleCount - 1];
+		return aliveParticleCount - 1;
 	}
 
 	//if not
+	if(particleArrays != NULL) {
+		const std::vector<int> &energy= particleArrays->energy;
+		int minEnergyParticle= 0;
+		for(int i= 0; i < particleCount; ++i){
+			if(energy[i] < energy[minEnergyParticle]){
+				minEnergyParticle= i;
+			}
+		}
+		return minEnergyParticle;
+	}
+
 	int minEnergy= particles[0].energy;
 	int minEnergyParticle= 0;
 
@@ -580,7 +629,7 @@ Particle * ParticleSystem::createParticle() {
 			minEnergyParticle= i;
 		}
 	}
-	return &particles[minEnergyParticle];
+	return minEnergyParticle;
 }
 
 void ParticleSystem::initParticle(Particle *p, int particleIndex) {
@@ -609,6 +658,38 @@ void ParticleSystem::killParticle(Particle *p) {
 	aliveParticleCount--;
 }
 
+void ParticleSystem::useParticleArrays() {
+	if(particleArrays == NULL) {
+		particleArrays= new ParticleArrays();
+	}
+	particleArrays->resize(particleCount);
+	std::vector<Particle>().swap(particles);
+}
+
+void ParticleSystem::updateParticleArrays() {
+	ParticleKernel::integrateLinear(*particleArrays, aliveParticleCount);
+	aliveParticleCount= ParticleKernel::removeExhausted(*particleArrays, aliveParticleCount);
+}
+
+void ParticleSystem::prepareForPool() {
+	delete particleObserver;
+	particleObserver= NULL;
+	particleOwner= NULL;
+}
+
+void ParticleSystem::reset(int particleCount) {
+	// shrinking keeps the capacity, so a recycled system rarely allocates
+	if(particleArrays != NULL) {
+		particleArrays->resize(particleCount);
+	}
+	else {
+		particles.resize(particleCount);
+	}
+	random= RandomGen();
+
+	setDefaults(particleCount);
+}
+
 void ParticleSystem::setFactionColor(Vec3f factionColor){
 	this->factionColor= factionColor;
 	Vec3f tmpCol;
@@ -628,9 +709,25 @@ void ParticleSystem::setFactionColor(Vec3f factionColor){
 // ===========================================================================
 
 
+ParticleSystemPool FireParticleSystem::pool("Fire");
+
 FireParticleSystem::FireParticleSystem(int particleCount) :
 	ParticleSystem(particleCount){
 
+	setDefaults();
+	useParticleArrays();
+}
+
+FireParticleSystem *FireParticleSystem::create(int particleCount) {
+	FireParticleSystem *result= static_cast<FireParticleSystem *>(pool.acquire(particleCount));
+	if(result == NULL) {
+		result= new FireParticleSystem(particleCount);
+		pool.track(result);
+	}
+	return result;
+}
+
+void FireParticleSystem::setDefaults() {
 	radius= 0.5f;
 	speed= 0.01f;
 	windSpeed= Vec3f(0.0f);
@@ -639,6 +736,11 @@ FireParticleSystem::FireParticleSystem(int particleCount) :
 	setColorNoEnergy(Vec4f(1.0f, 0.5f, 0.0f, 1.0f));
 }
 
+void FireParticleSystem::reset(int particleCount) {
+	ParticleSystem::reset(particleCount);
+	setDefaults();
+}
+
 void FireParticleSystem::initParticle(Particle *p, int particleIndex){
 	ParticleSystem::initParticle(p, particleIndex);
 
@@ -695,6 +797,11 @@ void FireParticleSystem::updateParticle(Particle *p){
 
 }
 
+void FireParticleSystem::updateParticleArrays() {
+	ParticleKernel::integrateFire(*particleArrays, aliveParticleCount);
+	aliveParticleCount= ParticleKernel::removeExhausted(*particleArrays, aliveParticleCount);
+}
+
 string FireParticleSystem::toString() const {
 	string result = ParticleSystem::toString();
 
@@ -772,10 +879,36 @@ GameParticleSystem::GameParticleSystem(int particleCount):
 {}
 
 GameParticleSystem::~GameParticleSystem(){
+	releaseChildren();
+}
+
+void GameParticleSystem::setDefaults() {
+	children.clear();
+	primitive= pQuad;
+	modelFileLoadDeferred= "";
+	model= NULL;
+	modelCycle= 0.0f;
+	offset= Vec3f(0.0f);
+	direction= Vec3f(0.0f, 1.0f, 0.0f);
+	tween= 0.0f;
+}
+
+void GameParticleSystem::releaseChildren() {
 	for(Children::iterator it= children.begin(); it != children.end(); ++it){
 		(*it)->setParent(NULL);
 		(*it)->fade();
 	}
+	children.clear();
+}
+
+void GameParticleSystem::prepareForPool() {
+	releaseChildren();
+	ParticleSystem::prepareForPool();
+}
+
+void GameParticleSystem::reset(int particleCount) {
+	ParticleSystem::reset(particleCount);
+	setDefaults();
 }
 
 GameParticleSystem::Primitive GameParticleSystem::strToPrimitive(const string &str){
@@ -931,7 +1064,7 @@ void GameParticleSystem::loadGame(const XmlNode *rootNode) {
 	for(unsigned int i = 0; i < childrenNodeList.size(); ++i) {
 		XmlNode *node = childrenNodeList[i];
 
-		UnitParticleSystem *ups = new UnitParticleSystem();
+		UnitParticleSystem *ups = UnitParticleSystem::create();
 		//ups->setParticleOwner(!!!);
 		ups->loadGame(node);
 
@@ -989,8 +1122,24 @@ string GameParticleSystem::toString() const {
 bool UnitParticleSystem::isNight= false;
 Vec3f UnitParticleSystem::lightColor=Vec3f(1.0f,1.0f,1.0f);
 
+ParticleSystemPool UnitParticleSystem::pool("Unit");
+
 UnitParticleSystem::UnitParticleSystem(int particleCount) :
 		GameParticleSystem(particleCount),	parent(NULL) {
+	setDefaults();
+	useParticleArrays();
+}
+
+UnitParticleSystem *UnitParticleSystem::create(int particleCount) {
+	UnitParticleSystem *result= static_cast<UnitParticleSystem *>(pool.acquire(particleCount));
+	if(result == NULL) {
+		result= new UnitParticleSystem(particleCount);
+		pool.track(result);
+	}
+	return result;
+}
+
+void UnitParticleSystem::setDefaults() {
 	radius= 0.5f;
 	speed= 0.01f;
 	windSpeed= Vec3f(0.0f);
@@ -1031,16 +1180,33 @@ UnitParticleSystem::UnitParticleSystem(int particleCount) :
 	endTime = 1;
 	unitModel=NULL;
 	meshName="";
+	oldPosition= Vec3f(0.0f);
+	parent= NULL;
 
 	radiusBasedStartenergy = false;
 }
 
 UnitParticleSystem::~UnitParticleSystem(){
+	leaveParent();
+}
+
+void UnitParticleSystem::leaveParent() {
 	if(parent){
 		parent->removeChild(this);
+		parent= NULL;
 	}
 }
 
+void UnitParticleSystem::prepareForPool() {
+	leaveParent();
+	GameParticleSystem::prepareForPool();
+}
+
+void UnitParticleSystem::reset(int particleCount) {
+	GameParticleSystem::reset(particleCount);
+	setDefaults();
+}
+
 bool UnitParticleSystem::getVisible() const{
 	if((isNight==true) && (isVisibleAtNight==true)){
 		return visible;
@@ -1334,6 +1500,26 @@ void UnitParticleSystem::updateParticle(Particle *p){
 	}
 }
 
+void UnitParticleSystem::updateParticleArrays() {
+	UnitParticleParams params;
+	params.maxParticleEnergy= maxParticleEnergy;
+	params.alternations= alternations;
+	params.color= color;
+	params.colorNoEnergy= colorNoEnergy;
+	params.particleSize= particleSize;
+	params.sizeNoEnergy= sizeNoEnergy;
+	params.fixed= fixed;
+	params.fixedAddition= fixedAddition;
+	params.isDaylightAffected= isDaylightAffected;
+	params.lightColor= lightColor;
+	params.decrementEnergy= (state == ParticleSystem::sFade || staticParticleCount < 1);
+	params.energyUp= energyUp;
+
+	ParticleKernel::integrateUnit(*particleArrays, aliveParticleCount, params);
+	energyUp= params.energyUp;
+	aliveParticleCount= ParticleKernel::removeExhausted(*particleArrays, aliveParticleCount);
+}
+
 // ================= SET PARAMS ====================
 
 void UnitParticleSystem::setWind(float windAngle, float windSpeed){
@@ -1538,6 +1724,7 @@ RainParticleSystem::RainParticleSystem(int particleCount) :
 	setParticleSize(3.0f);
 	setColor(Vec4f(0.5f, 0.5f, 0.5f, 0.3f));
 	setSpeed(0.2f);
+	useParticleArrays();
 }
 
 void RainParticleSystem::render(ParticleRenderer *pr, ModelRenderer *mr){
@@ -1569,6 +1756,11 @@ bool RainParticleSystem::deathTest(Particle *p){
 	return p->pos.y < 0;
 }
 
+void RainParticleSystem::updateParticleArrays() {
+	ParticleKernel::integrateLinear(*particleArrays, aliveParticleCount);
+	aliveParticleCount= ParticleKernel::removeBelowGround(*particleArrays, aliveParticleCount);
+}
+
 void RainParticleSystem::setRadius(float radius) {
 	this->radius= radius;
 }
@@ -1618,6 +1810,7 @@ SnowParticleSystem::SnowParticleSystem(int particleCount) :
 	setParticleSize(0.2f);
 	setColor(Vec4f(0.8f, 0.8f, 0.8f, 0.8f));
 	setSpeed(0.05f);
+	useParticleArrays();
 }
 
 void SnowParticleSystem::initParticle(Particle *p, int particleIndex){
@@ -1648,6 +1841,11 @@ bool SnowParticleSystem::deathTest(Particle *p){
 	return p->pos.y < 0;
 }
 
+void SnowParticleSystem::updateParticleArrays() {
+	ParticleKernel::integrateLinear(*particleArrays, aliveParticleCount);
+	aliveParticleCount= ParticleKernel::removeBelowGround(*particleArrays, aliveParticleCount);
+}
+
 void SnowParticleSystem::setRadius(float radius){
 	this->radius= radius;
 }
@@ -1691,11 +1889,20 @@ string SnowParticleSystem::toString() const {
 
 AttackParticleSystem::AttackParticleSystem(int particleCount) :
 	GameParticleSystem(particleCount){
+	setDefaults();
+}
+
+void AttackParticleSystem::setDefaults() {
 	primitive= pQuad;
 	gravity= 0.0f;
 	sizeNoEnergy = 0.0;
 }
 
+void AttackParticleSystem::reset(int particleCount) {
+	GameParticleSystem::reset(particleCount);
+	setDefaults();
+}
+
 void AttackParticleSystem::saveGame(XmlNode *rootNode) {
 	std::map<string,string> mapTagReplacements;
 	XmlNode *attackParticleSystemNode = rootNode->addChild("AttackParticleSystem");
@@ -1739,8 +1946,23 @@ string AttackParticleSystem::toString() const {
 //  ProjectileParticleSystem
 // ===========================================================================
 
+ParticleSystemPool ProjectileParticleSystem::pool("Projectile");
+
 ProjectileParticleSystem::ProjectileParticleSystem(int particleCount) :
 	AttackParticleSystem(particleCount){
+	setDefaults();
+}
+
+ProjectileParticleSystem *ProjectileParticleSystem::create(int particleCount) {
+	ProjectileParticleSystem *result= static_cast<ProjectileParticleSystem *>(pool.acquire(particleCount));
+	if(result == NULL) {
+		result= new ProjectileParticleSystem(particleCount);
+		pool.track(result);
+	}
+	return result;
+}
+
+void ProjectileParticleSystem::setDefaults() {
 	setEmissionRate(20.0f);
 	setColor(Vec4f(1.0f, 0.3f, 0.0f, 0.5f));
 	setMaxParticleEnergy(100);
@@ -1757,15 +1979,38 @@ ProjectileParticleSystem::ProjectileParticleSystem(int particleCount) :
 
 	nextParticleSystem= NULL;
 	arriveDestinationDistance = 0.0f;
+
+	lastPos= Vec3f(0.0f);
+	startPos= Vec3f(0.0f);
+	endPos= Vec3f(0.0f);
+	flatPos= Vec3f(0.0f);
+	xVector= Vec3f(0.0f);
+	yVector= Vec3f(0.0f);
+	zVector= Vec3f(0.0f);
 	//printf("#aXX trajectorySpeed = %f\n",trajectorySpeed);
 }
 
 ProjectileParticleSystem::~ProjectileParticleSystem(){
+	unlinkSplash();
+}
+
+void ProjectileParticleSystem::unlinkSplash() {
 	if(nextParticleSystem != NULL){
 		nextParticleSystem->prevParticleSystem= NULL;
+		nextParticleSystem= NULL;
 	}
 }
 
+void ProjectileParticleSystem::prepareForPool() {
+	unlinkSplash();
+	AttackParticleSystem::prepareForPool();
+}
+
+void ProjectileParticleSystem::reset(int particleCount) {
+	AttackParticleSystem::reset(particleCount);
+	setDefaults();
+}
+
 void ProjectileParticleSystem::link(SplashParticleSystem *particleSystem){
 	nextParticleSystem= particleSystem;
 	nextParticleSystem->setVisible(false);
@@ -2095,7 +2340,7 @@ void ProjectileParticleSystem::loadGame(const XmlNode *rootNode) {
 //	}
 	if(projectileParticleSystemNode->hasChild("SplashParticleSystem") == true) {
 		XmlNode *splashParticleSystemNode = projectileParticleSystemNode->getChild("SplashParticleSystem");
-		nextParticleSystem = new SplashParticleSystem();
+		nextParticleSystem = SplashParticleSystem::create();
 		nextParticleSystem->setParticleOwner(this->getParticleOwner());
 		nextParticleSystem->loadGame(splashParticleSystemNode);
 	}
@@ -2162,8 +2407,23 @@ string ProjectileParticleSystem::toString() const {
 //  SplashParticleSystem
 // ===========================================================================
 
+ParticleSystemPool SplashParticleSystem::pool("Splash");
+
 SplashParticleSystem::SplashParticleSystem(int particleCount) :
 	AttackParticleSystem(particleCount){
+	setDefaults();
+}
+
+SplashParticleSystem *SplashParticleSystem::create(int particleCount) {
+	SplashParticleSystem *result= static_cast<SplashParticleSystem *>(pool.acquire(particleCount));
+	if(result == NULL) {
+		result= new SplashParticleSystem(particleCount);
+		pool.track(result);
+	}
+	return result;
+}
+
+void SplashParticleSystem::setDefaults() {
 	setColor(Vec4f(1.0f, 0.3f, 0.0f, 0.8f));
 	setMaxParticleEnergy(100);
 	setVarParticleEnergy(50);
@@ -2181,11 +2441,26 @@ SplashParticleSystem::SplashParticleSystem(int particleCount) :
 }
 
 SplashParticleSystem::~SplashParticleSystem(){
+	unlinkProjectile();
+}
+
+void SplashParticleSystem::unlinkProjectile() {
 	if(prevParticleSystem != NULL){
 		prevParticleSystem->nextParticleSystem= NULL;
+		prevParticleSystem= NULL;
 	}
 }
 
+void SplashParticleSystem::prepareForPool() {
+	unlinkProjectile();
+	AttackParticleSystem::prepareForPool();
+}
+
+void SplashParticleSystem::reset(int particleCount) {
+	AttackParticleSystem::reset(particleCount);
+	setDefaults();
+}
+
 void SplashParticleSystem::initParticleSystem() {
 	startEmissionRate = emissionRate;
 }
@@ -2302,7 +2577,7 @@ void SplashParticleSystem::loadGame(const XmlNode *rootNode) {
 //	}
 	if(splashParticleSystemNode->hasChild("ProjectileParticleSystem") == true) {
 		XmlNode *projectileParticleSystemNode = splashParticleSystemNode->getChild("ProjectileParticleSystem");
-		prevParticleSystem = new ProjectileParticleSystem();
+		prevParticleSystem = ProjectileParticleSystem::create();
 		prevParticleSystem->setParticleOwner(this->getParticleOwner());
 		prevParticleSystem->loadGame(projectileParticleSystemNode);
 	}
@@ -2346,15 +2621,192 @@ string SplashParticleSystem::toString() const {
 	return result;
 }
 
+// ===========================================================================
+//  ParticleSystemPool
+// ===========================================================================
+
+int ParticleSystemPool::maxFreeSystems= 64;
+
+vector<ParticleSystemPool *> &ParticleSystemPool::getPoolList() {
+	static vector<ParticleSystemPool *> poolList;
+	return poolList;
+}
+
+ParticleSystemPool::ParticleSystemPool(const string &name) {
+	this->name= name;
+	hitCount= 0;
+	missCount= 0;
+	liveCount= 0;
+
+	getPoolList().push_back(this);
+}
+
+ParticleSystemPool::~ParticleSystemPool() {
+	clear();
+
+	vector<ParticleSystemPool *> &poolList= getPoolList();
+	vector<ParticleSystemPool *>::iterator iterFind= std::find(poolList.begin(), poolList.end(), this);
+	if(iterFind != poolList.end()) {
+		poolList.erase(iterFind);
+	}
+}
+
+ParticleSystem *ParticleSystemPool::acquire(int particleCount) {
+	if(freeSystems.empty() == true) {
+		missCount++;
+		return NULL;
+	}
+	hitCount++;
+	liveCount++;
+
+	ParticleSystem *ps= freeSystems.front();
+	freeSystems.pop_front();
+	ps->reset(particleCount);
+	return ps;
+}
+
+void ParticleSystemPool::track(ParticleSystem *ps) {
+	ps->recyclePool= this;
+	liveCount++;
+}
+
+void ParticleSystemPool::release(ParticleSystem *ps) {
+	liveCount--;
+	if((int)freeSystems.size() >= maxFreeSystems) {
+		delete ps;
+		return;
+	}
+	ps->prepareForPool();
+	freeSystems.push_back(ps);
+}
+
+void ParticleSystemPool::clear() {
+	while(freeSystems.empty() == false) {
+		ParticleSystem *ps= freeSystems.back();
+		freeSystems.pop_back();
+		delete ps;
+	}
+}
+
+int64 ParticleSystemPool::getHitCount() {
+	return hitCount;
+}
+
+int64 ParticleSystemPool::getMissCount() {
+	return missCount;
+}
+
+int ParticleSystemPool::getLiveCount() {
+	return liveCount;
+}
+
+int ParticleSystemPool::getFreeCount() {
+	return (int)freeSystems.size();
+}
+
+void ParticleSystemPool::destroy(ParticleSystem *ps) {
+	if(ps != NULL && ps->recyclePool != NULL) {
+		ps->recyclePool->release(ps);
+	}
+	else {
+		delete ps;
+	}
+}
+
+void ParticleSystemPool::setMaxFreeSystems(int value) {
+	maxFreeSystems= max(value, 0);
+
+	vector<ParticleSystemPool *> &poolList= getPoolList();
+	for(unsigned int i = 0; i < poolList.size(); ++i) {
+		ParticleSystemPool *pool= poolList[i];
+		while((int)pool->freeSystems.size() > maxFreeSystems) {
+			delete pool->freeSystems.front();
+			pool->freeSystems.pop_front();
+		}
+	}
+}
+
+string ParticleSystemPool::getStatsString() {
+	string result= "Particle pools (hit/miss live free):";
+
+	vector<ParticleSystemPool *> &poolList= getPoolList();
+	for(unsigned int i = 0; i < poolList.size(); ++i) {
+		ParticleSystemPool *pool= poolList[i];
+		char szBuf[256]="";
+		snprintf(szBuf,255," %s %lld/%lld %d %d",pool->name.c_str(),
+				(long long int)pool->hitCount,(long long int)pool->missCount,
+				pool->liveCount,(int)pool->freeSystems.size());
+		result += szBuf;
+	}
+	return result;
+}
+
 // ===========================================================================
 //  ParticleManager
 // ===========================================================================
 
+// =====================================================
+//	class ParticleUpdateTask
+//
+/// Updates a list of self contained particle systems, each task handles
+/// one chunk of consecutive systems
+// =====================================================
+
+class ParticleUpdateTask : public WorkerTaskCallbackInterface {
+private:
+	const vector<ParticleSystem *> &particleSystems;
+	int chunkSize;
+
+public:
+	ParticleUpdateTask(const vector<ParticleSystem *> &particleSystems, int chunkSize) :
+		particleSystems(particleSystems) {
+		this->chunkSize = chunkSize;
+	}
+
+	int getTaskCount() const {
+		return ((int)particleSystems.size() + chunkSize - 1) / chunkSize;
+	}
+
+	virtual void workerTask(int taskIndex, int workerIndex) {
+		int endIndex = min((taskIndex + 1) * chunkSize, (int)particleSystems.size());
+		for(int index = taskIndex * chunkSize; index < endIndex; ++index) {
+			particleSystems[index]->update();
+		}
+	}
+};
+
+// systems per worker task, small systems cost less than claiming a task
+static const int PARTICLE_UPDATE_CHUNK_SIZE = 8;
+// below this many self contained systems threads are not worth waking up
+static const int MIN_SYSTEMS_FOR_THREADED_UPDATE = 32;
+
 ParticleManager::ParticleManager() {
+	updatePool = NULL;
 }
 
 ParticleManager::~ParticleManager() {
 	end();
+
+	delete updatePool;
+	updatePool = NULL;
+}
+
+void ParticleManager::setUpdateThreadCount(int threadCount) {
+	delete updatePool;
+	updatePool = NULL;
+
+	if(threadCount > 0) {
+		updatePool = new WorkerThreadPool(threadCount,"ParticleUpdateThread");
+	}
+}
+
+bool ParticleManager::getUpdateParticleSystem(ParticleSystem *ps) const {
+	bool showParticle= true;
+	if( dynamic_cast<UnitParticleSystem *> (ps) != NULL ||
+		dynamic_cast<FireParticleSystem *> (ps) != NULL) {
+		showParticle = ps->getVisible() || (ps->getState() == ParticleSystem::sFade);
+	}
+	return showParticle;
 }
 
 void ParticleManager::render(ParticleRenderer *pr, ModelRenderer *mr) const{
@@ -2405,18 +2857,16 @@ void ParticleManager::update(int renderFps){
 	size_t particleSystemCount= particleSystems.size();
 	int currentParticleCount= 0;
 
+	// Systems that move other systems or call back into the game are
+	// updated here first, they may also add or remove systems
 	vector<ParticleSystem *> cleanupParticleSystemsList;
 	for(unsigned int i= 0; i < particleSystems.size(); i++){
 		ParticleSystem *ps= particleSystems[i];
-		if(ps != NULL && validateParticleSystemStillExists(ps) == true) {
+		if(ps != NULL && (updatePool == NULL || ps->getUpdateIsSelfContained() == false) &&
+			validateParticleSystemStillExists(ps) == true) {
 			currentParticleCount+= ps->getAliveParticleCount();
 
-			bool showParticle= true;
-			if( dynamic_cast<UnitParticleSystem *> (ps) != NULL ||
-				dynamic_cast<FireParticleSystem *> (ps) != NULL) {
-				showParticle = ps->getVisible() || (ps->getState() == ParticleSystem::sFade);
-			}
-			if(showParticle == true){
+			if(getUpdateParticleSystem(ps) == true){
 				ps->update();
 				if(ps->isEmpty() && ps->getState() == ParticleSystem::sFade) {
 					cleanupParticleSystemsList.push_back(ps);
@@ -2424,6 +2874,40 @@ void ParticleManager::update(int renderFps){
 			}
 		}
 	}
+
+	// The self contained ones only touch their own data, so they run in
+	// chunks on the worker threads. Empty systems are removed after the
+	// join because cleanup changes the system list.
+	if(updatePool != NULL) {
+		vector<ParticleSystem *> selfContainedSystems;
+		for(unsigned int i= 0; i < particleSystems.size(); i++){
+			ParticleSystem *ps= particleSystems[i];
+			if(ps != NULL && ps->getUpdateIsSelfContained() == true) {
+				currentParticleCount+= ps->getAliveParticleCount();
+
+				if(getUpdateParticleSystem(ps) == true) {
+					selfContainedSystems.push_back(ps);
+				}
+			}
+		}
+
+		ParticleUpdateTask task(selfContainedSystems,PARTICLE_UPDATE_CHUNK_SIZE);
+		if((int)selfContainedSystems.size() >= MIN_SYSTEMS_FOR_THREADED_UPDATE) {
+			updatePool->runTasks(&task,task.getTaskCount());
+		}
+		else {
+			for(int taskIndex= 0; taskIndex < task.getTaskCount(); ++taskIndex) {
+				task.workerTask(taskIndex,0);
+			}
+		}
+
+		for(unsigned int i= 0; i < selfContainedSystems.size(); i++){
+			ParticleSystem *ps= selfContainedSystems[i];
+			if(ps->isEmpty() && ps->getState() == ParticleSystem::sFade) {
+				cleanupParticleSystemsList.push_back(ps);
+			}
+		}
+	}
 	//particleSystems.remove(NULL);
 	cleanupParticleSystems(cleanupParticleSystemsList);
 
@@ -2484,7 +2968,7 @@ void ParticleManager::cleanupParticleSystems(ParticleSystem *ps) {
 			ps->callParticleOwnerEnd(ps);
 		}
 
-		delete ps;
+		ParticleSystemPool::destroy(ps);
 		this->particleSystems.erase(this->particleSystems.begin() + index);
 	}
 }
@@ -2532,7 +3016,7 @@ void ParticleManager::end(){
 		if(ps != NULL) {
 			ps->callParticleOwnerEnd(ps);
 		}
-		delete ps;
+		ParticleSystemPool::destroy(ps);
 		particleSystems.pop_back();
 	}
 }
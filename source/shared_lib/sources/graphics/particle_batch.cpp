@@ -0,0 +1,108 @@
+// ==============================================================
+//	This file is part of MegaGlest Shared Library (www.megaglest.org)
+//
+//	Copyright (C) 2013 MegaGlest team
+//
+//	You can redistribute this code and/or modify it under
+//	the terms of the GNU General Public License as published
+//	by the Free Software Foundation; either version 2 of the
+//	License, or (at your option) any later version
+// ==============================================================
+
+#include "particle_batch.h"
+
+#include "leak_dumper.h"
+
+namespace Shared{ namespace Graphics{
+
+// =====================================================
+//	class ParticleBatch
+// =====================================================
+
+void ParticleBatch::clear() {
+	runs.clear();
+	draws.clear();
+	vertices.clear();
+}
+
+int ParticleBatch::findMaterial(Texture *texture, ParticleSystem::BlendMode blendMode) {
+	// a frame uses few materials, a linear search beats a map here
+	for(int i = (int)draws.size() - 1; i >= 0; --i) {
+		if(draws[i].texture == texture && draws[i].blendMode == blendMode) {
+			return i;
+		}
+	}
+
+	ParticleBatchDraw draw;
+	draw.texture= texture;
+	draw.blendMode= blendMode;
+	draw.firstVertex= 0;
+	draw.vertexCount= 0;
+	draws.push_back(draw);
+	return (int)draws.size() - 1;
+}
+
+void ParticleBatch::addSystem(const ParticleSystem *ps) {
+	if(ps->getAliveParticleCount() <= 0) {
+		return;
+	}
+	Run run;
+	run.system= ps;
+	run.material= findMaterial(ps->getTexture(), ps->getBlendMode());
+	runs.push_back(run);
+}
+
+void ParticleBatch::build(const Vec3f &rightVector, const Vec3f &upVector) {
+	// counting sort of the runs by material, the draws get their ranges
+	// first and every run is then written straight to its place
+	for(unsigned int i = 0; i < draws.size(); ++i) {
+		draws[i].vertexCount= 0;
+	}
+	for(unsigned int i = 0; i < runs.size(); ++i) {
+		draws[runs[i].material].vertexCount+= runs[i].system->getAliveParticleCount() * 4;
+	}
+
+	int vertexCount= 0;
+	std::vector<int> cursors(draws.size());
+	for(unsigned int i = 0; i < draws.size(); ++i) {
+		draws[i].firstVertex= vertexCount;
+		cursors[i]= vertexCount;
+		vertexCount+= draws[i].vertexCount;
+	}
+	vertices.resize(vertexCount);
+
+	const Vec3f cornerA= rightVector - upVector;
+	const Vec3f cornerB= rightVector + upVector;
+
+	for(unsigned int i = 0; i < runs.size(); ++i) {
+		const ParticleSystem *ps= runs[i].system;
+		int &cursor= cursors[runs[i].material];
+
+		int aliveParticleCount= ps->getAliveParticleCount();
+		for(int j = 0; j < aliveParticleCount; ++j) {
+			float size= ps->getParticleSize(j)/2.0f;
+			Vec3f pos= ps->getParticlePos(j);
+			Vec4f color= ps->getParticleColor(j);
+
+			ParticleVertex *quad= &vertices[cursor];
+			quad[0].pos= pos - cornerA * size;
+			quad[1].pos= pos - cornerB * size;
+			quad[2].pos= pos + cornerA * size;
+			quad[3].pos= pos + cornerB * size;
+
+			quad[0].texCoord= Vec2f(0.0f, 1.0f);
+			quad[1].texCoord= Vec2f(0.0f, 0.0f);
+			quad[2].texCoord= Vec2f(1.0f, 0.0f);
+			quad[3].texCoord= Vec2f(1.0f, 1.0f);
+
+			quad[0].color= color;
+			quad[1].color= color;
+			quad[2].color= color;
+			quad[3].color= color;
+
+			cursor+= 4;
+		}
+	}
+}
+
+}}//end namespace
@@ -0,0 +1,538 @@
+// ==============================================================
+//	This file is part of MegaGlest Shared Library (www.megaglest.org)
+//
+//	Copyright (C) 2013 MegaGlest team
+//
+//	You can redistribute this code and/or modify it under
+//	the terms of the GNU General Public License as published
+//	by the Free Software Foundation; either version 2 of the
+//	License, or (at your option) any later version
+// ==============================================================
+
+#include "particle_kernel.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #define PARTICLE_KERNEL_SSE2
+  #include <emmintrin.h>
+#endif
+
+#include "particle.h"
+#include "util.h"
+#include "leak_dumper.h"
+
+using namespace Shared::Util;
+
+namespace Shared{ namespace Graphics{
+
+// =====================================================
+//	class ParticleArrays
+// =====================================================
+
+void ParticleArrays::resize(int count) {
+	posX.resize(count);
+	posY.resize(count);
+	posZ.resize(count);
+	lastPosX.resize(count);
+	lastPosY.resize(count);
+	lastPosZ.resize(count);
+	speedX.resize(count);
+	speedY.resize(count);
+	speedZ.resize(count);
+	accelX.resize(count);
+	accelY.resize(count);
+	accelZ.resize(count);
+	colorR.resize(count);
+	colorG.resize(count);
+	colorB.resize(count);
+	colorA.resize(count);
+	size.resize(count);
+	energy.resize(count);
+}
+
+void ParticleArrays::store(int index, const Particle &particle) {
+	posX[index]= particle.pos.x;
+	posY[index]= particle.pos.y;
+	posZ[index]= particle.pos.z;
+	lastPosX[index]= particle.lastPos.x;
+	lastPosY[index]= particle.lastPos.y;
+	lastPosZ[index]= particle.lastPos.z;
+	speedX[index]= particle.speed.x;
+	speedY[index]= particle.speed.y;
+	speedZ[index]= particle.speed.z;
+	accelX[index]= particle.accel.x;
+	accelY[index]= particle.accel.y;
+	accelZ[index]= particle.accel.z;
+	colorR[index]= particle.color.x;
+	colorG[index]= particle.color.y;
+	colorB[index]= particle.color.z;
+	colorA[index]= particle.color.w;
+	size[index]= particle.size;
+	energy[index]= particle.energy;
+}
+
+void ParticleArrays::load(int index, Particle &particle) const {
+	particle.pos= Vec3f(posX[index], posY[index], posZ[index]);
+	particle.lastPos= Vec3f(lastPosX[index], lastPosY[index], lastPosZ[index]);
+	particle.speed= Vec3f(speedX[index], speedY[index], speedZ[index]);
+	particle.accel= Vec3f(accelX[index], accelY[index], accelZ[index]);
+	particle.color= Vec4f(colorR[index], colorG[index], colorB[index], colorA[index]);
+	particle.size= size[index];
+	particle.energy= energy[index];
+}
+
+void ParticleArrays::move(int fromIndex, int toIndex) {
+	posX[toIndex]= posX[fromIndex];
+	posY[toIndex]= posY[fromIndex];
+	posZ[toIndex]= posZ[fromIndex];
+	lastPosX[toIndex]= lastPosX[fromIndex];
+	lastPosY[toIndex]= lastPosY[fromIndex];
+	lastPosZ[toIndex]= lastPosZ[fromIndex];
+	speedX[toIndex]= speedX[fromIndex];
+	speedY[toIndex]= speedY[fromIndex];
+	speedZ[toIndex]= speedZ[fromIndex];
+	accelX[toIndex]= accelX[fromIndex];
+	accelY[toIndex]= accelY[fromIndex];
+	accelZ[toIndex]= accelZ[fromIndex];
+	colorR[toIndex]= colorR[fromIndex];
+	colorG[toIndex]= colorG[fromIndex];
+	colorB[toIndex]= colorB[fromIndex];
+	colorA[toIndex]= colorA[fromIndex];
+	size[toIndex]= size[fromIndex];
+	energy[toIndex]= energy[fromIndex];
+}
+
+// =====================================================
+//	class UnitParticleParams
+// =====================================================
+
+UnitParticleParams::UnitParticleParams() {
+	maxParticleEnergy= 0;
+	alternations= 0;
+	particleSize= 0.0f;
+	sizeNoEnergy= 0.0f;
+	fixed= false;
+	isDaylightAffected= false;
+	lightColor= Vec3f(1.0f);
+	decrementEnergy= true;
+	energyUp= false;
+}
+
+// =====================================================
+//	scalar steps, written like the virtual updateParticle methods and
+//	also used for the tail the vector loops leave over
+// =====================================================
+
+static inline void linearStep(ParticleArrays &a, int i) {
+	a.lastPosX[i]= a.posX[i];
+	a.lastPosY[i]= a.posY[i];
+	a.lastPosZ[i]= a.posZ[i];
+	a.posX[i]= a.posX[i] + a.speedX[i];
+	a.posY[i]= a.posY[i] + a.speedY[i];
+	a.posZ[i]= a.posZ[i] + a.speedZ[i];
+	a.speedX[i]= a.speedX[i] + a.accelX[i];
+	a.speedY[i]= a.speedY[i] + a.accelY[i];
+	a.speedZ[i]= a.speedZ[i] + a.accelZ[i];
+	a.energy[i]--;
+}
+
+static inline void fireStep(ParticleArrays &a, int i) {
+	a.lastPosX[i]= a.posX[i];
+	a.lastPosY[i]= a.posY[i];
+	a.lastPosZ[i]= a.posZ[i];
+	a.posX[i]= a.posX[i] + a.speedX[i];
+	a.posY[i]= a.posY[i] + a.speedY[i];
+	a.posZ[i]= a.posZ[i] + a.speedZ[i];
+	a.energy[i]--;
+
+	if(a.colorR[i] > 0.0f)
+		a.colorR[i]*= 0.98f;
+	if(a.colorG[i] > 0.0f)
+		a.colorG[i]*= 0.98f;
+	if(a.colorA[i] > 0.0f)
+		a.colorA[i]*= 0.98f;
+
+	a.speedX[i]*= 1.001f;
+	a.speedX[i] = truncateDecimal<float>(a.speedX[i],6);
+	a.speedY[i] = truncateDecimal<float>(a.speedY[i],6);
+	a.speedZ[i] = truncateDecimal<float>(a.speedZ[i],6);
+}
+
+static inline float unitEnergyRatio(int energy, const UnitParticleParams &params) {
+	float energyRatio;
+	if(params.alternations > 0){
+		int interval= (params.maxParticleEnergy / params.alternations);
+		float moduloValue= (float)((int)(static_cast<float> (energy)) % interval);
+
+		if(moduloValue < interval / 2){
+			energyRatio= (interval - moduloValue) / interval;
+		}
+		else{
+			energyRatio= moduloValue / interval;
+		}
+		energyRatio= clamp(energyRatio, 0.f, 1.f);
+	}
+	else{
+		energyRatio= clamp(static_cast<float> (energy) / params.maxParticleEnergy, 0.f, 1.f);
+	}
+
+	return truncateDecimal<float>(energyRatio,6);
+}
+
+static inline void unitStep(ParticleArrays &a, int i, const UnitParticleParams &params) {
+	const float energyRatio= unitEnergyRatio(a.energy[i], params);
+
+	a.lastPosX[i] = truncateDecimal<float>(a.lastPosX[i] + a.speedX[i],6);
+	a.lastPosY[i] = truncateDecimal<float>(a.lastPosY[i] + a.speedY[i],6);
+	a.lastPosZ[i] = truncateDecimal<float>(a.lastPosZ[i] + a.speedZ[i],6);
+
+	a.posX[i] = truncateDecimal<float>(a.posX[i] + a.speedX[i],6);
+	a.posY[i] = truncateDecimal<float>(a.posY[i] + a.speedY[i],6);
+	a.posZ[i] = truncateDecimal<float>(a.posZ[i] + a.speedZ[i],6);
+
+	if(params.fixed) {
+		a.lastPosX[i] = truncateDecimal<float>(a.lastPosX[i] + params.fixedAddition.x,6);
+		a.lastPosY[i] = truncateDecimal<float>(a.lastPosY[i] + params.fixedAddition.y,6);
+		a.lastPosZ[i] = truncateDecimal<float>(a.lastPosZ[i] + params.fixedAddition.z,6);
+
+		a.posX[i] = truncateDecimal<float>(a.posX[i] + params.fixedAddition.x,6);
+		a.posY[i] = truncateDecimal<float>(a.posY[i] + params.fixedAddition.y,6);
+		a.posZ[i] = truncateDecimal<float>(a.posZ[i] + params.fixedAddition.z,6);
+	}
+	a.speedX[i] = truncateDecimal<float>(a.speedX[i] + a.accelX[i],6);
+	a.speedY[i] = truncateDecimal<float>(a.speedY[i] + a.accelY[i],6);
+	a.speedZ[i] = truncateDecimal<float>(a.speedZ[i] + a.accelZ[i],6);
+
+	Vec4f color= params.color * energyRatio + params.colorNoEnergy * (1.0f - energyRatio);
+	if(params.isDaylightAffected == true) {
+		color.x= color.x * params.lightColor.x;
+		color.y= color.y * params.lightColor.y;
+		color.z= color.z * params.lightColor.z;
+	}
+	a.colorR[i]= color.x;
+	a.colorG[i]= color.y;
+	a.colorB[i]= color.z;
+	a.colorA[i]= color.w;
+
+	a.size[i]= params.particleSize * energyRatio + params.sizeNoEnergy * (1.0f - energyRatio);
+	a.size[i] = truncateDecimal<float>(a.size[i],6);
+
+	if(params.decrementEnergy == true) {
+		a.energy[i]--;
+	}
+}
+
+// static systems pulse their energy, the direction is shared by the whole
+// system so this has to run in particle order
+static void unitStaticEnergySteps(ParticleArrays &a, int count, UnitParticleParams &params) {
+	if(params.maxParticleEnergy <= 2) {
+		return;
+	}
+	for(int i= 0; i < count; ++i) {
+		if(params.energyUp) {
+			a.energy[i]++;
+		}
+		else {
+			a.energy[i]--;
+		}
+
+		if(a.energy[i] == 1) {
+			params.energyUp= true;
+		}
+		if(a.energy[i] == params.maxParticleEnergy) {
+			params.energyUp= false;
+		}
+	}
+}
+
+#ifdef PARTICLE_KERNEL_SSE2
+
+// =====================================================
+//	SSE2 steps, four particles at a time
+// =====================================================
+
+// Same bits as truncateDecimal<float>(value,6): the integer part of
+// value * 10^6 divided by 10^6. From 2^23 on floats have no fraction left
+// so the product is used as is, which also keeps cvttps2dq in range.
+static inline __m128 truncateDecimal6(__m128 value) {
+	const __m128 precision= _mm_set1_ps(1000000.0f);
+	const __m128 noFractionLimit= _mm_set1_ps(8388608.0f);
+	const __m128 absMask= _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+
+	__m128 scaled= _mm_mul_ps(value, precision);
+	__m128 truncated= _mm_cvtepi32_ps(_mm_cvttps_epi32(scaled));
+	__m128 hasFraction= _mm_cmplt_ps(_mm_and_ps(scaled, absMask), noFractionLimit);
+	scaled= _mm_or_ps(_mm_and_ps(hasFraction, truncated), _mm_andnot_ps(hasFraction, scaled));
+	return _mm_div_ps(scaled, precision);
+}
+
+static inline __m128 loadFloats(const std::vector<float> &values, int i) {
+	return _mm_loadu_ps(&values[i]);
+}
+
+static inline void storeFloats(std::vector<float> &values, int i, __m128 value) {
+	_mm_storeu_ps(&values[i], value);
+}
+
+static inline void decrementEnergy(std::vector<int> &energy, int i) {
+	__m128i value= _mm_loadu_si128((const __m128i *)&energy[i]);
+	value= _mm_sub_epi32(value, _mm_set1_epi32(1));
+	_mm_storeu_si128((__m128i *)&energy[i], value);
+}
+
+static void integrateLinearSSE2(ParticleArrays &a, int count) {
+	int i= 0;
+	for(; i + 4 <= count; i+= 4) {
+		__m128 posX= loadFloats(a.posX, i);
+		__m128 posY= loadFloats(a.posY, i);
+		__m128 posZ= loadFloats(a.posZ, i);
+		__m128 speedX= loadFloats(a.speedX, i);
+		__m128 speedY= loadFloats(a.speedY, i);
+		__m128 speedZ= loadFloats(a.speedZ, i);
+
+		storeFloats(a.lastPosX, i, posX);
+		storeFloats(a.lastPosY, i, posY);
+		storeFloats(a.lastPosZ, i, posZ);
+		storeFloats(a.posX, i, _mm_add_ps(posX, speedX));
+		storeFloats(a.posY, i, _mm_add_ps(posY, speedY));
+		storeFloats(a.posZ, i, _mm_add_ps(posZ, speedZ));
+		storeFloats(a.speedX, i, _mm_add_ps(speedX, loadFloats(a.accelX, i)));
+		storeFloats(a.speedY, i, _mm_add_ps(speedY, loadFloats(a.accelY, i)));
+		storeFloats(a.speedZ, i, _mm_add_ps(speedZ, loadFloats(a.accelZ, i)));
+		decrementEnergy(a.energy, i);
+	}
+	for(; i < count; ++i) {
+		linearStep(a, i);
+	}
+}
+
+// multiplies the lanes above zero, keeps the others
+static inline __m128 fadePositive(__m128 value, __m128 factor) {
+	__m128 positive= _mm_cmpgt_ps(value, _mm_setzero_ps());
+	return _mm_or_ps(_mm_and_ps(positive, _mm_mul_ps(value, factor)), _mm_andnot_ps(positive, value));
+}
+
+static void integrateFireSSE2(ParticleArrays &a, int count) {
+	const __m128 colorFade= _mm_set1_ps(0.98f);
+	const __m128 windGrowth= _mm_set1_ps(1.001f);
+
+	int i= 0;
+	for(; i + 4 <= count; i+= 4) {
+		__m128 posX= loadFloats(a.posX, i);
+		__m128 posY= loadFloats(a.posY, i);
+		__m128 posZ= loadFloats(a.posZ, i);
+		__m128 speedX= loadFloats(a.speedX, i);
+		__m128 speedY= loadFloats(a.speedY, i);
+		__m128 speedZ= loadFloats(a.speedZ, i);
+
+		storeFloats(a.lastPosX, i, posX);
+		storeFloats(a.lastPosY, i, posY);
+		storeFloats(a.lastPosZ, i, posZ);
+		storeFloats(a.posX, i, _mm_add_ps(posX, speedX));
+		storeFloats(a.posY, i, _mm_add_ps(posY, speedY));
+		storeFloats(a.posZ, i, _mm_add_ps(posZ, speedZ));
+		decrementEnergy(a.energy, i);
+
+		storeFloats(a.colorR, i, fadePositive(loadFloats(a.colorR, i), colorFade));
+		storeFloats(a.colorG, i, fadePositive(loadFloats(a.colorG, i), colorFade));
+		storeFloats(a.colorA, i, fadePositive(loadFloats(a.colorA, i), colorFade));
+
+		storeFloats(a.speedX, i, truncateDecimal6(_mm_mul_ps(speedX, windGrowth)));
+		storeFloats(a.speedY, i, truncateDecimal6(speedY));
+		storeFloats(a.speedZ, i, truncateDecimal6(speedZ));
+	}
+	for(; i < count; ++i) {
+		fireStep(a, i);
+	}
+}
+
+static void integrateUnitSSE2(ParticleArrays &a, int count, const UnitParticleParams &params) {
+	const __m128 zero= _mm_setzero_ps();
+	const __m128 one= _mm_set1_ps(1.0f);
+	const __m128 maxEnergy= _mm_set1_ps(static_cast<float>(params.maxParticleEnergy));
+	const __m128 fixedX= _mm_set1_ps(params.fixedAddition.x);
+	const __m128 fixedY= _mm_set1_ps(params.fixedAddition.y);
+	const __m128 fixedZ= _mm_set1_ps(params.fixedAddition.z);
+	const __m128 colorR= _mm_set1_ps(params.color.x);
+	const __m128 colorG= _mm_set1_ps(params.color.y);
+	const __m128 colorB= _mm_set1_ps(params.color.z);
+	const __m128 colorA= _mm_set1_ps(params.color.w);
+	const __m128 colorNoEnergyR= _mm_set1_ps(params.colorNoEnergy.x);
+	const __m128 colorNoEnergyG= _mm_set1_ps(params.colorNoEnergy.y);
+	const __m128 colorNoEnergyB= _mm_set1_ps(params.colorNoEnergy.z);
+	const __m128 colorNoEnergyA= _mm_set1_ps(params.colorNoEnergy.w);
+	const __m128 lightR= _mm_set1_ps(params.lightColor.x);
+	const __m128 lightG= _mm_set1_ps(params.lightColor.y);
+	const __m128 lightB= _mm_set1_ps(params.lightColor.z);
+	const __m128 particleSize= _mm_set1_ps(params.particleSize);
+	const __m128 sizeNoEnergy= _mm_set1_ps(params.sizeNoEnergy);
+
+	int i= 0;
+	for(; i + 4 <= count; i+= 4) {
+		__m128 energyRatio;
+		if(params.alternations > 0) {
+			// integer modulo has no SSE2 instruction, this case is rare
+			energyRatio= _mm_setr_ps(unitEnergyRatio(a.energy[i], params),
+									unitEnergyRatio(a.energy[i + 1], params),
+									unitEnergyRatio(a.energy[i + 2], params),
+									unitEnergyRatio(a.energy[i + 3], params));
+		}
+		else {
+			__m128i energy= _mm_loadu_si128((const __m128i *)&a.energy[i]);
+			energyRatio= _mm_div_ps(_mm_cvtepi32_ps(energy), maxEnergy);
+			// operand order keeps a NaN like clamp() does
+			energyRatio= _mm_min_ps(one, _mm_max_ps(zero, energyRatio));
+			energyRatio= truncateDecimal6(energyRatio);
+		}
+		const __m128 noEnergyRatio= _mm_sub_ps(one, energyRatio);
+
+		__m128 speedX= loadFloats(a.speedX, i);
+		__m128 speedY= loadFloats(a.speedY, i);
+		__m128 speedZ= loadFloats(a.speedZ, i);
+
+		__m128 lastPosX= truncateDecimal6(_mm_add_ps(loadFloats(a.lastPosX, i), speedX));
+		__m128 lastPosY= truncateDecimal6(_mm_add_ps(loadFloats(a.lastPosY, i), speedY));
+		__m128 lastPosZ= truncateDecimal6(_mm_add_ps(loadFloats(a.lastPosZ, i), speedZ));
+		__m128 posX= truncateDecimal6(_mm_add_ps(loadFloats(a.posX, i), speedX));
+		__m128 posY= truncateDecimal6(_mm_add_ps(loadFloats(a.posY, i), speedY));
+		__m128 posZ= truncateDecimal6(_mm_add_ps(loadFloats(a.posZ, i), speedZ));
+		if(params.fixed) {
+			lastPosX= truncateDecimal6(_mm_add_ps(lastPosX, fixedX));
+			lastPosY= truncateDecimal6(_mm_add_ps(lastPosY, fixedY));
+			lastPosZ= truncateDecimal6(_mm_add_ps(lastPosZ, fixedZ));
+			posX= truncateDecimal6(_mm_add_ps(posX, fixedX));
+			posY= truncateDecimal6(_mm_add_ps(posY, fixedY));
+			posZ= truncateDecimal6(_mm_add_ps(posZ, fixedZ));
+		}
+		storeFloats(a.lastPosX, i, lastPosX);
+		storeFloats(a.lastPosY, i, lastPosY);
+		storeFloats(a.lastPosZ, i, lastPosZ);
+		storeFloats(a.posX, i, posX);
+		storeFloats(a.posY, i, posY);
+		storeFloats(a.posZ, i, posZ);
+
+		storeFloats(a.speedX, i, truncateDecimal6(_mm_add_ps(speedX, loadFloats(a.accelX, i))));
+		storeFloats(a.speedY, i, truncateDecimal6(_mm_add_ps(speedY, loadFloats(a.accelY, i))));
+		storeFloats(a.speedZ, i, truncateDecimal6(_mm_add_ps(speedZ, loadFloats(a.accelZ, i))));
+
+		__m128 red= _mm_add_ps(_mm_mul_ps(colorR, energyRatio), _mm_mul_ps(colorNoEnergyR, noEnergyRatio));
+		__m128 green= _mm_add_ps(_mm_mul_ps(colorG, energyRatio), _mm_mul_ps(colorNoEnergyG, noEnergyRatio));
+		__m128 blue= _mm_add_ps(_mm_mul_ps(colorB, energyRatio), _mm_mul_ps(colorNoEnergyB, noEnergyRatio));
+		__m128 alpha= _mm_add_ps(_mm_mul_ps(colorA, energyRatio), _mm_mul_ps(colorNoEnergyA, noEnergyRatio));
+		if(params.isDaylightAffected == true) {
+			red= _mm_mul_ps(red, lightR);
+			green= _mm_mul_ps(green, lightG);
+			blue= _mm_mul_ps(blue, lightB);
+		}
+		storeFloats(a.colorR, i, red);
+		storeFloats(a.colorG, i, green);
+		storeFloats(a.colorB, i, blue);
+		storeFloats(a.colorA, i, alpha);
+
+		__m128 size= _mm_add_ps(_mm_mul_ps(particleSize, energyRatio), _mm_mul_ps(sizeNoEnergy, noEnergyRatio));
+		storeFloats(a.size, i, truncateDecimal6(size));
+
+		if(params.decrementEnergy == true) {
+			decrementEnergy(a.energy, i);
+		}
+	}
+	for(; i < count; ++i) {
+		unitStep(a, i, params);
+	}
+}
+
+#endif
+
+// =====================================================
+//	class ParticleKernel
+// =====================================================
+
+#ifdef PARTICLE_KERNEL_SSE2
+ParticleKernelEngine ParticleKernel::engine= pkeSSE2;
+#else
+ParticleKernelEngine ParticleKernel::engine= pkeScalar;
+#endif
+
+bool ParticleKernel::isEngineAvailable(ParticleKernelEngine value) {
+	if(value == pkeSSE2) {
+#ifdef PARTICLE_KERNEL_SSE2
+		return true;
+#else
+		return false;
+#endif
+	}
+	return true;
+}
+
+void ParticleKernel::setEngine(ParticleKernelEngine value) {
+	engine= (isEngineAvailable(value) == true ? value : pkeScalar);
+}
+
+void ParticleKernel::integrateLinear(ParticleArrays &arrays, int count) {
+#ifdef PARTICLE_KERNEL_SSE2
+	if(engine == pkeSSE2) {
+		integrateLinearSSE2(arrays, count);
+		return;
+	}
+#endif
+	for(int i= 0; i < count; ++i) {
+		linearStep(arrays, i);
+	}
+}
+
+void ParticleKernel::integrateFire(ParticleArrays &arrays, int count) {
+#ifdef PARTICLE_KERNEL_SSE2
+	if(engine == pkeSSE2) {
+		integrateFireSSE2(arrays, count);
+		return;
+	}
+#endif
+	for(int i= 0; i < count; ++i) {
+		fireStep(arrays, i);
+	}
+}
+
+void ParticleKernel::integrateUnit(ParticleArrays &arrays, int count, UnitParticleParams &params) {
+#ifdef PARTICLE_KERNEL_SSE2
+	if(engine == pkeSSE2) {
+		integrateUnitSSE2(arrays, count, params);
+	}
+	else
+#endif
+	{
+		for(int i= 0; i < count; ++i) {
+			unitStep(arrays, i, params);
+		}
+	}
+
+	if(params.decrementEnergy == false) {
+		unitStaticEnergySteps(arrays, count, params);
+	}
+}
+
+int ParticleKernel::removeExhausted(ParticleArrays &arrays, int count) {
+	for(int i= 0; i < count;) {
+		if(arrays.energy[i] <= 0) {
+			--count;
+			arrays.move(count, i);
+		}
+		else {
+			++i;
+		}
+	}
+	return count;
+}
+
+int ParticleKernel::removeBelowGround(ParticleArrays &arrays, int count) {
+	for(int i= 0; i < count;) {
+		if(arrays.posY[i] < 0) {
+			--count;
+			arrays.move(count, i);
+		}
+		else {
+			++i;
+		}
+	}
+	return count;
+}
+
+}}//end namespace
@@ -799,6 +799,12 @@ pair<bool,time_t> hasCachedFileCRCValue(string crcCacheFile, uint32 &value) {
 	return result;
 }
 
+// With the per file sum index open every file is checked against its own
+// stamp, so the whole tree result stored on disk is not trusted
+static bool useFolderTreeCRCCacheFile(bool forceNoCache) {
+	return (forceNoCache == false && Checksum::isFileSumIndexOpen() == false);
+}
+
 void writeCachedFileCRCValue(string crcCacheFile, uint32 &crcValue, string actualFileName) {
 #ifdef WIN32
 		FILE *fp = _wfopen(utf8_decode(crcCacheFile).c_str(), L"w");
@@ -916,7 +922,7 @@ uint32 getFolderTreeContentsCheckSumRecursively(vector<string> paths, string pat
 	}
 
 	uint32 crcValue = 0;
-	if(forceNoCache == false && hasCachedFileCRCValue(crcCacheFile, crcValue).first == true) {
+	if(useFolderTreeCRCCacheFile(forceNoCache) == true && hasCachedFileCRCValue(crcCacheFile, crcValue).first == true) {
 		crcTreeCache[cacheKey] = crcValue;
 		if(SystemFlags::getSystemSettingType(SystemFlags::debugSystem).enabled) SystemFlags::OutputDebug(SystemFlags::debugSystem,"In [%s::%s Line: %d] scanning folders found CACHED FILE checksum = %d for cacheKey [%s] forceNoCache = %d\n",__FILE__,__FUNCTION__,__LINE__,crcTreeCache[cacheKey],cacheKey.c_str(),forceNoCache);
 		if(recursiveChecksum == NULL) {
@@ -998,7 +1004,7 @@ uint32 getFolderTreeContentsCheckSumRecursively(const string &path, const string
 	}
 
 	uint32 crcValue = 0;
-	if(forceNoCache == false && hasCachedFileCRCValue(crcCacheFile, crcValue).first == true) {
+	if(useFolderTreeCRCCacheFile(forceNoCache) == true && hasCachedFileCRCValue(crcCacheFile, crcValue).first == true) {
 		crcTreeCache[cacheKey] = crcValue;
 		if(SystemFlags::getSystemSettingType(SystemFlags::debugSystem).enabled) SystemFlags::OutputDebug(SystemFlags::debugSystem,"In [%s::%s Line: %d] scanning folders found CACHED FILE checksum = %d for cacheKey [%s] forceNoCache = %d\n",__FILE__,__FUNCTION__,__LINE__,crcTreeCache[cacheKey],cacheKey.c_str(),forceNoCache);
 		if(recursiveChecksum == NULL) {
@@ -1359,6 +1365,7 @@ vector<std::pair<string,uint32> > getFolderTreeContentsCheckSumListRecursively(c
 	}
 #endif
 
+	vector<string> matchedFiles;
 	for(int i = 0; i < (int)globbuf.gl_pathc; ++i) {
 		const char* p = globbuf.gl_pathv[i];
 
@@ -1372,16 +1379,22 @@ vector<std::pair<string,uint32> > getFolderTreeContentsCheckSumListRecursively(c
             }
 
             if(addFile) {
-                Checksum checksum;
-                checksum.addFile(p);
-
-                checksumFiles.push_back(std::pair<string,uint32>(p,checksum.getSum()));
+                matchedFiles.push_back(p);
             }
 		}
 	}
 
 	globfree(&globbuf);
 
+	// hash the folder's files together so they can use several threads
+	Checksum::cacheFileSums(matchedFiles);
+	for(unsigned int index = 0; index < matchedFiles.size(); ++index) {
+		Checksum checksum;
+		checksum.addFile(matchedFiles[index]);
+
+		checksumFiles.push_back(std::pair<string,uint32>(matchedFiles[index],checksum.getSum()));
+	}
+
     // Look recursively for sub-folders
 #if defined(__APPLE__) || defined(__FreeBSD__)
 	res = glob(mypath.c_str(), 0, 0, &globbuf);
@@ -1803,6 +1816,21 @@ void sleep(int millis) {
 	SDL_Delay(millis);
 }
 
+int getCPUCoreCount() {
+	int result = 1;
+#ifdef WIN32
+	SYSTEM_INFO sysInfo;
+	GetSystemInfo(&sysInfo);
+	result = (int)sysInfo.dwNumberOfProcessors;
+#elif defined(_SC_NPROCESSORS_ONLN)
+	result = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+	if(result < 1) {
+		result = 1;
+	}
+	return result;
+}
+
 bool isCursorShowing() {
 	int state = SDL_ShowCursor(SDL_QUERY);
 	return (state == SDL_ENABLE);
@@ -262,6 +262,10 @@ void FileCRCPreCacheThread::execute() {
 			            if(SystemFlags::getSystemSettingType(SystemFlags::debugSystem).enabled) SystemFlags::OutputDebug(SystemFlags::debugSystem,"In [%s::%s Line: %d] unknown error\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__);
 			        }
 
+					// the workers only save the index now and then, keep what they found
+					Checksum::saveFileSumIndex();
+					Checksum::releaseFileSumThreads();
+
 					if(SystemFlags::VERBOSE_MODE_ENABLED) printf("********************** CRC Controller thread took %.2f seconds END **********************\n",difftime(time(NULL),elapsedTime));
                 }
             }
@@ -787,4 +791,376 @@ void LogFileThread::saveToDisk(bool forceSaveAll,bool logListAlreadyLocked) {
     }
 }
 
+// =====================================================
+//	class WorkerThread
+// =====================================================
+
+WorkerThread::WorkerThread(WorkerThreadPool *pool, int workerIndex) : BaseThread() {
+	this->pool = pool;
+	this->workerIndex = workerIndex;
+	uniqueID = "WorkerThread";
+}
+
+WorkerThread::~WorkerThread() {
+	this->pool = NULL;
+}
+
+void WorkerThread::setQuitStatus(bool value) {
+	BaseThread::setQuitStatus(value);
+	if(value == true) {
+		signalWorker();
+	}
+}
+
+void WorkerThread::signalWorker() {
+	semTaskSignalled.signal();
+}
+
+bool WorkerThread::canShutdown(bool deleteSelfIfShutdownDelayed) {
+	bool ret = (getExecutingTask() == false);
+	if(ret == false && deleteSelfIfShutdownDelayed == true) {
+	    setDeleteSelfOnExecutionDone(deleteSelfIfShutdownDelayed);
+	    deleteSelfIfRequired();
+	    signalQuit();
+	}
+
+	return ret;
+}
+
+void WorkerThread::execute() {
+    RunningStatusSafeWrapper runningStatus(this);
+	try {
+		if(SystemFlags::getSystemSettingType(SystemFlags::debugSystem).enabled) SystemFlags::OutputDebug(SystemFlags::debugSystem,"In [%s::%s Line: %d] uniqueID [%s]\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,this->getUniqueID().c_str());
+
+		for(;this->pool != NULL;) {
+			if(getQuitStatus() == true) {
+				break;
+			}
+
+			semTaskSignalled.waitTillSignalled();
+
+			if(getQuitStatus() == true) {
+				break;
+			}
+
+			ExecutingTaskSafeWrapper safeExecutingTaskMutex(this);
+			this->pool->runWorkerTasks(this->workerIndex);
+		}
+
+		if(SystemFlags::getSystemSettingType(SystemFlags::debugSystem).enabled) SystemFlags::OutputDebug(SystemFlags::debugSystem,"In [%s::%s Line: %d] uniqueID [%s] is exiting\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,this->getUniqueID().c_str());
+	}
+	catch(const exception &ex) {
+		SystemFlags::OutputDebug(SystemFlags::debugError,"In [%s::%s Line: %d] Error [%s]\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,ex.what());
+		throw megaglest_runtime_error(ex.what());
+	}
+}
+
+// =====================================================
+//	class WorkerThreadPool
+// =====================================================
+
+WorkerThreadPool::WorkerThreadPool(int threadCount, string uniqueID) :
+	mutexTasks(new Mutex(CODE_AT_LINE)) {
+
+	callback = NULL;
+	taskCount = 0;
+	tasksCompleted = 0;
+	tasksStolen = 0;
+
+	for(int index = 0; index < threadCount; ++index) {
+		WorkerThread *worker = new WorkerThread(this, index);
+		worker->setUniqueID(uniqueID + "_" + intToStr(index));
+		worker->start();
+		workers.push_back(worker);
+	}
+}
+
+WorkerThreadPool::~WorkerThreadPool() {
+	for(unsigned int index = 0; index < workers.size(); ++index) {
+		WorkerThread *worker = workers[index];
+		worker->signalQuit();
+		if(worker->shutdownAndWait() == true) {
+			delete worker;
+		}
+	}
+	workers.clear();
+
+	delete mutexTasks;
+	mutexTasks = NULL;
+}
+
+void WorkerThreadPool::runTasks(WorkerTaskCallbackInterface *callback, int taskCount) {
+	if(callback == NULL || taskCount <= 0) {
+		return;
+	}
+
+	int workerCount = getWorkerCount();
+	assignTasks(callback, taskCount, workerCount);
+
+	for(unsigned int index = 0; index < workers.size() && (int)index < taskCount - 1; ++index) {
+		workers[index]->signalWorker();
+	}
+
+	runWorkerTasks(workerCount - 1);
+	waitForTasks();
+}
+
+void WorkerThreadPool::beginTasks(WorkerTaskCallbackInterface *callback, int taskCount) {
+	if(callback == NULL || taskCount <= 0) {
+		return;
+	}
+	if(workers.empty() == true) {
+		runTasks(callback, taskCount);
+		return;
+	}
+
+	int workerCount = (int)workers.size();
+	assignTasks(callback, taskCount, workerCount);
+
+	for(int index = 0; index < workerCount && index < taskCount; ++index) {
+		workers[index]->signalWorker();
+	}
+}
+
+void WorkerThreadPool::waitForTasks() {
+	string mutexOwnerId = CODE_AT_LINE;
+	MutexSafeWrapper safeMutex(mutexTasks,mutexOwnerId);
+	if(this->callback == NULL) {
+		return;
+	}
+	safeMutex.ReleaseLock();
+
+	semTasksCompleted.waitTillSignalled();
+
+	safeMutex.Lock();
+	this->callback = NULL;
+	taskRanges.clear();
+	string error = this->taskError;
+	safeMutex.ReleaseLock();
+
+	if(error != "") {
+		throw megaglest_runtime_error(error);
+	}
+}
+
+void WorkerThreadPool::assignTasks(WorkerTaskCallbackInterface *callback, int taskCount, int workerCount) {
+	string mutexOwnerId = CODE_AT_LINE;
+	MutexSafeWrapper safeMutex(mutexTasks,mutexOwnerId);
+	this->callback = callback;
+	this->taskCount = taskCount;
+	this->tasksCompleted = 0;
+	this->tasksStolen = 0;
+	this->taskError = "";
+
+	taskRanges.assign(workerCount,TaskRange());
+	for(int index = 0; index < workerCount; ++index) {
+		taskRanges[index].next = (int)(((int64)taskCount * index) / workerCount);
+		taskRanges[index].end = (int)(((int64)taskCount * (index + 1)) / workerCount);
+	}
+}
+
+void WorkerThreadPool::runWorkerTasks(int workerIndex) {
+	WorkerTaskCallbackInterface *taskCallback = NULL;
+	int taskIndex = -1;
+	for(;claimTask(workerIndex, taskCallback, taskIndex) == true;) {
+		string error = "";
+		try {
+			taskCallback->workerTask(taskIndex, workerIndex);
+		}
+		catch(const exception &ex) {
+			SystemFlags::OutputDebug(SystemFlags::debugError,"In [%s::%s Line: %d] Error [%s]\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,ex.what());
+			error = ex.what();
+		}
+		catch(...) {
+			error = "Unknown error in worker task #" + intToStr(taskIndex);
+		}
+		completeTask(error);
+	}
+}
+
+bool WorkerThreadPool::claimTask(int workerIndex, WorkerTaskCallbackInterface *&taskCallback, int &taskIndex) {
+	string mutexOwnerId = CODE_AT_LINE;
+	MutexSafeWrapper safeMutex(mutexTasks,mutexOwnerId);
+	if(this->callback == NULL || workerIndex >= (int)taskRanges.size()) {
+		return false;
+	}
+
+	TaskRange &ownRange = taskRanges[workerIndex];
+	if(ownRange.next >= ownRange.end) {
+		// steal the upper half of the largest range still pending
+		int victimIndex = -1;
+		int victimRemaining = 0;
+		for(unsigned int index = 0; index < taskRanges.size(); ++index) {
+			int remaining = taskRanges[index].end - taskRanges[index].next;
+			if(remaining > victimRemaining) {
+				victimIndex = index;
+				victimRemaining = remaining;
+			}
+		}
+		if(victimIndex < 0) {
+			return false;
+		}
+
+		TaskRange &victimRange = taskRanges[victimIndex];
+		int stealCount = (victimRemaining + 1) / 2;
+		ownRange.end = victimRange.end;
+		ownRange.next = victimRange.end - stealCount;
+		victimRange.end = ownRange.next;
+		this->tasksStolen += stealCount;
+	}
+
+	taskCallback = this->callback;
+	taskIndex = ownRange.next;
+	ownRange.next++;
+	return true;
+}
+
+void WorkerThreadPool::completeTask(const string &error) {
+	string mutexOwnerId = CODE_AT_LINE;
+	MutexSafeWrapper safeMutex(mutexTasks,mutexOwnerId);
+	if(error != "" && this->taskError == "") {
+		this->taskError = error;
+	}
+	this->tasksCompleted++;
+	if(this->tasksCompleted == this->taskCount) {
+		semTasksCompleted.signal();
+	}
+}
+
+// =====================================================
+//	class TaskGraph
+// =====================================================
+
+TaskGraph::TaskGraph() {
+	levelCount = 0;
+	callback = NULL;
+}
+
+void TaskGraph::clear() {
+	tasks.clear();
+	levelCount = 0;
+}
+
+int TaskGraph::addTask(const string &name, int id, int param, bool callerThread) {
+	Task task;
+	task.name = name;
+	task.id = id;
+	task.param = param;
+	task.callerThread = callerThread;
+	tasks.push_back(task);
+	return (int)tasks.size() - 1;
+}
+
+void TaskGraph::addRead(int taskIndex, int resource) {
+	tasks[taskIndex].reads.push_back(resource);
+}
+
+void TaskGraph::addWrite(int taskIndex, int resource) {
+	tasks[taskIndex].writes.push_back(resource);
+}
+
+bool TaskGraph::isWriting(int taskIndex, int resource) const {
+	const vector<int> &writes = tasks[taskIndex].writes;
+	return (std::find(writes.begin(),writes.end(),resource) != writes.end());
+}
+
+bool TaskGraph::conflicts(const Task &task1, const Task &task2) const {
+	for(unsigned int i = 0; i < task1.writes.size(); ++i) {
+		int resource = task1.writes[i];
+		if(std::find(task2.writes.begin(),task2.writes.end(),resource) != task2.writes.end() ||
+			std::find(task2.reads.begin(),task2.reads.end(),resource) != task2.reads.end()) {
+			return true;
+		}
+	}
+	for(unsigned int i = 0; i < task1.reads.size(); ++i) {
+		int resource = task1.reads[i];
+		if(std::find(task2.writes.begin(),task2.writes.end(),resource) != task2.writes.end()) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void TaskGraph::computeLevels() {
+	levelCount = 0;
+	for(unsigned int i = 0; i < tasks.size(); ++i) {
+		int level = 0;
+		for(unsigned int j = 0; j < i; ++j) {
+			if(tasks[j].level >= level && conflicts(tasks[j], tasks[i]) == true) {
+				level = tasks[j].level + 1;
+			}
+		}
+		tasks[i].level = level;
+		if(level + 1 > levelCount) {
+			levelCount = level + 1;
+		}
+	}
+}
+
+void TaskGraph::run(TaskGraphCallbackInterface *callback, WorkerThreadPool *pool) {
+	computeLevels();
+
+	if(pool == NULL || pool->getWorkerCount() <= 1) {
+		for(unsigned int i = 0; i < tasks.size(); ++i) {
+			runTask(callback, i);
+		}
+		return;
+	}
+
+	this->callback = callback;
+	for(int level = 0; level < levelCount; ++level) {
+		vector<int> callerTasks;
+		levelWorkerTasks.clear();
+		for(unsigned int i = 0; i < tasks.size(); ++i) {
+			if(tasks[i].level == level) {
+				if(tasks[i].callerThread == true) {
+					callerTasks.push_back(i);
+				}
+				else {
+					levelWorkerTasks.push_back(i);
+				}
+			}
+		}
+
+		if(callerTasks.empty() == true) {
+			if(levelWorkerTasks.size() == 1) {
+				runTask(callback, levelWorkerTasks[0]);
+			}
+			else {
+				pool->runTasks(this, (int)levelWorkerTasks.size());
+			}
+			continue;
+		}
+
+		// the tasks of a level never conflict so the worker tasks may run
+		// while the calling thread works through its own tasks
+		pool->beginTasks(this, (int)levelWorkerTasks.size());
+		try {
+			for(unsigned int i = 0; i < callerTasks.size(); ++i) {
+				runTask(callback, callerTasks[i]);
+			}
+		}
+		catch(...) {
+			pool->waitForTasks();
+			throw;
+		}
+		pool->waitForTasks();
+	}
+	this->callback = NULL;
+}
+
+void TaskGraph::runTask(TaskGraphCallbackInterface *callback, int taskIndex) {
+	Task &task = tasks[taskIndex];
+	Chrono chrono;
+	chrono.start();
+
+	callback->graphTask(task.id, task.param);
+
+	task.millis = chrono.getMillis();
+}
+
+void TaskGraph::workerTask(int taskIndex, int workerIndex) {
+	runTask(this->callback, levelWorkerTasks[taskIndex]);
+}
+
 }}//end namespace
@@ -70,6 +70,8 @@ int Socket::DEFAULT_SOCKET_SENDBUF_SIZE = -1;
 int Socket::DEFAULT_SOCKET_RECVBUF_SIZE = -1;
 
 int Socket::broadcast_portno    = 61357;
+Mutex Socket::nextSerialSynchAccessor;
+uint32 Socket::nextSerial = 0;
 int ServerSocket::ftpServerPort = 61358;
 int ServerSocket::maxPlayerCount = -1;
 int ServerSocket::externalPort  = Socket::broadcast_portno;
@@ -791,6 +793,8 @@ Socket::Socket(PLATFORM_SOCKET sock) {
 	dataSynchAccessorWrite = new Mutex(CODE_AT_LINE);
 	inSocketDestructorSynchAccessor = new Mutex(CODE_AT_LINE);
 	lastSocketError = 0;
+	sentByteCount = 0;
+	assignSerial();
 
 	MutexSafeWrapper safeMutexSocketDestructorFlag(inSocketDestructorSynchAccessor,CODE_AT_LINE);
 	inSocketDestructorSynchAccessor->setOwnerId(CODE_AT_LINE);
@@ -814,8 +818,10 @@ Socket::Socket() {
 	dataSynchAccessorWrite = new Mutex(CODE_AT_LINE);
 	inSocketDestructorSynchAccessor = new Mutex(CODE_AT_LINE);
 	lastSocketError = 0;
+	sentByteCount = 0;
 	lastDebugEvent = 0;
 	lastThreadedPing = 0;
+	assignSerial();
 
 	MutexSafeWrapper safeMutexSocketDestructorFlag(inSocketDestructorSynchAccessor,CODE_AT_LINE);
 	inSocketDestructorSynchAccessor->setOwnerId(CODE_AT_LINE);
@@ -1375,12 +1381,30 @@ int Socket::send(const void *data, int dataSize) {
 
 	    if(SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled) SystemFlags::OutputDebug(SystemFlags::debugNetwork,"[%s::%s Line: %d] DISCONNECTED SOCKET error while sending socket data, bytesSent = %d, error = %s\n",__FILE__,__FUNCTION__,__LINE__,bytesSent,getLastSocketErrorFormattedText(&iErr).c_str());
 	}
+	else {
+		MutexSafeWrapper safeMutex(dataSynchAccessorWrite,CODE_AT_LINE);
+		sentByteCount += bytesSent;
+	}
 
 	if(SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled) SystemFlags::OutputDebug(SystemFlags::debugNetwork,"In [%s::%s Line: %d] sock = %d, bytesSent = %d\n",__FILE__,__FUNCTION__,__LINE__,sock,bytesSent);
 
 	return static_cast<int>(bytesSent);
 }
 
+void Socket::assignSerial() {
+	MutexSafeWrapper safeMutex(&nextSerialSynchAccessor,CODE_AT_LINE);
+	// 0 is left for no socket
+	if(++nextSerial == 0) {
+		++nextSerial;
+	}
+	serial = nextSerial;
+}
+
+int64 Socket::getSentByteCount() {
+	MutexSafeWrapper safeMutex(dataSynchAccessorWrite,CODE_AT_LINE);
+	return sentByteCount;
+}
+
 int Socket::receive(void *data, int dataSize, bool tryReceiveUntilDataSizeMet) {
 	ssize_t bytesReceived = 0;
 
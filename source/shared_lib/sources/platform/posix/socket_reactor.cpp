@@ -0,0 +1,224 @@
+// ==============================================================
+//	This file is part of MegaGlest Shared Library (www.megaglest.org)
+//
+//	Copyright (C) 2013 MegaGlest team
+//
+//	You can redistribute this code and/or modify it under
+//	the terms of the GNU General Public License as published
+//	by the Free Software Foundation; either version 2 of the
+//	License, or (at your option) any later version
+// ==============================================================
+
+#include "socket_reactor.h"
+
+#include <algorithm>
+#include <cstring>
+#include "util.h"
+#include "leak_dumper.h"
+
+using namespace Shared::Util;
+
+#ifndef WIN32
+	#define INVALID_SOCKET  (PLATFORM_SOCKET)(~0)
+#endif
+
+namespace Shared { namespace Platform {
+
+// =====================================================
+//	class SocketReactor
+// =====================================================
+
+SocketReactor::SocketReactor(bool useEpoll) {
+	socketCount = 0;
+	usingEpoll = false;
+#ifdef MG_SOCKET_REACTOR_EPOLL
+	epollId = -1;
+	if(useEpoll == true) {
+		epollId = epoll_create(16);
+		if(epollId >= 0) {
+			usingEpoll = true;
+		}
+		else {
+			if(SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled) SystemFlags::OutputDebug(SystemFlags::debugNetwork,"In [%s::%s Line: %d] epoll not available, using select error = %s\n",__FILE__,__FUNCTION__,__LINE__,Socket::getLastSocketErrorFormattedText().c_str());
+		}
+	}
+#endif
+}
+
+SocketReactor::~SocketReactor() {
+	clear();
+#ifdef MG_SOCKET_REACTOR_EPOLL
+	if(epollId >= 0) {
+		close(epollId);
+		epollId = -1;
+	}
+#endif
+}
+
+void SocketReactor::setSocket(int key, PLATFORM_SOCKET socket) {
+	if(key < 0) {
+		return;
+	}
+	if(key >= (int)keySockets.size()) {
+		if(Socket::isSocketValid(&socket) == false) {
+			return;
+		}
+		keySockets.resize(key + 1, INVALID_SOCKET);
+	}
+
+	PLATFORM_SOCKET &current = keySockets[key];
+	if(current == socket) {
+		return;
+	}
+	if(Socket::isSocketValid(&current) == true) {
+		unregisterSocket(key, current);
+		current = INVALID_SOCKET;
+		socketCount--;
+	}
+	if(Socket::isSocketValid(&socket) == true) {
+		current = socket;
+		socketCount++;
+		registerSocket(key, socket);
+	}
+}
+
+void SocketReactor::setSocket(int key, PLATFORM_SOCKET socket, uint32 serial) {
+	if(key < 0) {
+		return;
+	}
+	if(key >= (int)keySerials.size()) {
+		keySerials.resize(key + 1, 0);
+	}
+	if(keySerials[key] != serial) {
+		removeSocket(key);
+		keySerials[key] = serial;
+	}
+	setSocket(key, socket);
+}
+
+void SocketReactor::removeSocket(int key) {
+	setSocket(key, INVALID_SOCKET);
+}
+
+PLATFORM_SOCKET SocketReactor::getSocket(int key) const {
+	if(key < 0 || key >= (int)keySockets.size()) {
+		return INVALID_SOCKET;
+	}
+	return keySockets[key];
+}
+
+void SocketReactor::clear() {
+	for(int key = 0; key < (int)keySockets.size(); ++key) {
+		removeSocket(key);
+	}
+	keySockets.clear();
+	keySerials.clear();
+}
+
+void SocketReactor::registerSocket(int key, PLATFORM_SOCKET socket) {
+#ifdef MG_SOCKET_REACTOR_EPOLL
+	if(usingEpoll == true) {
+		struct epoll_event event;
+		memset(&event, 0, sizeof(event));
+		event.events = EPOLLIN;
+		event.data.u32 = key;
+		if(epoll_ctl(epollId, EPOLL_CTL_ADD, socket, &event) != 0) {
+			// the descriptor number of a closed socket may have been reused
+			// while it was still registered
+			if(errno != EEXIST || epoll_ctl(epollId, EPOLL_CTL_MOD, socket, &event) != 0) {
+				if(SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled) SystemFlags::OutputDebug(SystemFlags::debugNetwork,"In [%s::%s Line: %d] ERROR registering socket = %d error = %s\n",__FILE__,__FUNCTION__,__LINE__,socket,Socket::getLastSocketErrorFormattedText().c_str());
+			}
+		}
+		epollEvents.resize(keySockets.size());
+	}
+#endif
+}
+
+void SocketReactor::unregisterSocket(int key, PLATFORM_SOCKET socket) {
+#ifdef MG_SOCKET_REACTOR_EPOLL
+	if(usingEpoll == true) {
+		// fails harmlessly when the socket was already closed, closing a
+		// socket removes it from the epoll set
+		struct epoll_event event;
+		memset(&event, 0, sizeof(event));
+		epoll_ctl(epollId, EPOLL_CTL_DEL, socket, &event);
+	}
+#endif
+}
+
+int SocketReactor::waitForReadable(vector<int> &readyKeys, int waitMicroseconds) {
+	readyKeys.clear();
+	if(socketCount <= 0) {
+		return 0;
+	}
+
+#ifdef MG_SOCKET_REACTOR_EPOLL
+	if(usingEpoll == true) {
+		return waitWithEpoll(readyKeys, waitMicroseconds);
+	}
+#endif
+	return waitWithSelect(readyKeys, waitMicroseconds);
+}
+
+#ifdef MG_SOCKET_REACTOR_EPOLL
+int SocketReactor::waitWithEpoll(vector<int> &readyKeys, int waitMicroseconds) {
+	int waitMilliseconds = (waitMicroseconds + 999) / 1000;
+	int retval = epoll_wait(epollId, &epollEvents[0], (int)epollEvents.size(), waitMilliseconds);
+	if(retval < 0) {
+		if(errno != EINTR) {
+			if(SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled) SystemFlags::OutputDebug(SystemFlags::debugNetwork,"In [%s::%s] Line: %d, ERROR WAITING FOR SOCKET DATA retval = %d error = %s\n",__FILE__,__FUNCTION__,__LINE__,retval,Socket::getLastSocketErrorFormattedText().c_str());
+			printf("In [%s::%s] Line: %d, ERROR WAITING FOR SOCKET DATA retval = %d error = %s\n",__FILE__,__FUNCTION__,__LINE__,retval,Socket::getLastSocketErrorFormattedText().c_str());
+		}
+		return 0;
+	}
+
+	for(int index = 0; index < retval; ++index) {
+		int key = (int)epollEvents[index].data.u32;
+		if(key < (int)keySockets.size() && Socket::isSocketValid(&keySockets[key]) == true) {
+			readyKeys.push_back(key);
+		}
+	}
+	// keep the keys in slot order like the select path
+	std::sort(readyKeys.begin(),readyKeys.end());
+	return (int)readyKeys.size();
+}
+#endif
+
+int SocketReactor::waitWithSelect(vector<int> &readyKeys, int waitMicroseconds) {
+	fd_set rfds;
+	FD_ZERO(&rfds);
+
+	PLATFORM_SOCKET imaxsocket = 0;
+	for(int key = 0; key < (int)keySockets.size(); ++key) {
+		PLATFORM_SOCKET socket = keySockets[key];
+		if(Socket::isSocketValid(&socket) == true) {
+			FD_SET(socket, &rfds);
+			imaxsocket = max(socket,imaxsocket);
+		}
+	}
+	if(imaxsocket <= 0) {
+		return 0;
+	}
+
+	struct timeval tv;
+	tv.tv_sec = waitMicroseconds / 1000000;
+	tv.tv_usec = waitMicroseconds % 1000000;
+
+	int retval = select((int)imaxsocket + 1, &rfds, NULL, NULL, &tv);
+	if(retval < 0) {
+		if(SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled) SystemFlags::OutputDebug(SystemFlags::debugNetwork,"In [%s::%s] Line: %d, ERROR SELECTING SOCKET DATA retval = %d error = %s\n",__FILE__,__FUNCTION__,__LINE__,retval,Socket::getLastSocketErrorFormattedText().c_str());
+		printf("In [%s::%s] Line: %d, ERROR SELECTING SOCKET DATA retval = %d error = %s\n",__FILE__,__FUNCTION__,__LINE__,retval,Socket::getLastSocketErrorFormattedText().c_str());
+		return 0;
+	}
+	else if(retval > 0) {
+		for(int key = 0; key < (int)keySockets.size(); ++key) {
+			PLATFORM_SOCKET socket = keySockets[key];
+			if(Socket::isSocketValid(&socket) == true && FD_ISSET(socket, &rfds)) {
+				readyKeys.push_back(key);
+			}
+		}
+	}
+	return (int)readyKeys.size();
+}
+
+}}//end namespace
@@ -778,6 +778,87 @@ int Trigger::waitTillSignalled(Mutex *mutex, int waitMilliseconds) {
 	return result;
 }
 
+// =====================================================
+//	class FrameBarrier
+// =====================================================
+
+FrameBarrier::FrameBarrier() {
+	this->mutex				= new Mutex(CODE_AT_LINE);
+	this->trigger			= new Trigger(this->mutex);
+	this->frameIndex		= -1;
+	this->participantCount	= 0;
+	this->arrivedCount		= 0;
+}
+
+FrameBarrier::~FrameBarrier() {
+	delete trigger;
+	trigger = NULL;
+
+	delete mutex;
+	mutex = NULL;
+}
+
+void FrameBarrier::beginFrame(int frameIndex, int participantCount) {
+	static string mutexOwnerId = CODE_AT_LINE;
+	MutexSafeWrapper safeMutex(mutex,mutexOwnerId);
+	this->frameIndex		= frameIndex;
+	this->participantCount	= participantCount;
+	this->arrivedCount		= 0;
+}
+
+void FrameBarrier::arrive(int frameIndex) {
+	static string mutexOwnerId = CODE_AT_LINE;
+	MutexSafeWrapper safeMutex(mutex,mutexOwnerId);
+	if(this->frameIndex != frameIndex) {
+		return;
+	}
+
+	this->arrivedCount++;
+	if(this->arrivedCount >= this->participantCount) {
+		trigger->signal(true);
+	}
+}
+
+bool FrameBarrier::waitForFrame(int frameIndex, int waitMilliseconds) {
+	Chrono chrono;
+	chrono.start();
+
+	static string mutexOwnerId = CODE_AT_LINE;
+	MutexSafeWrapper safeMutex(mutex,mutexOwnerId);
+	bool result = (this->frameIndex == frameIndex && this->arrivedCount >= this->participantCount);
+	for(;result == false;) {
+		int remainingMilliseconds = -1;
+		if(waitMilliseconds >= 0) {
+			remainingMilliseconds = waitMilliseconds - (int)chrono.getMillis();
+			if(remainingMilliseconds <= 0) {
+				break;
+			}
+		}
+
+		// releases the mutex while asleep, spurious wakeups just loop
+		trigger->waitTillSignalled(mutex,remainingMilliseconds);
+		result = (this->frameIndex == frameIndex && this->arrivedCount >= this->participantCount);
+	}
+
+	return result;
+}
+
+bool FrameBarrier::isFrameComplete(int frameIndex) {
+	static string mutexOwnerId = CODE_AT_LINE;
+	MutexSafeWrapper safeMutex(mutex,mutexOwnerId);
+	return (this->frameIndex == frameIndex && this->arrivedCount >= this->participantCount);
+}
+
+int FrameBarrier::getFrameIndex() {
+	static string mutexOwnerId = CODE_AT_LINE;
+	MutexSafeWrapper safeMutex(mutex,mutexOwnerId);
+	return this->frameIndex;
+}
+
+// =====================================================
+//	class MasterSlaveThreadController
+// =====================================================
+
 MasterSlaveThreadController::MasterSlaveThreadController() {
 	std::vector<SlaveThreadControllerInterface *> empty;
 	init(empty);
@@ -791,8 +872,8 @@ MasterSlaveThreadController::MasterSlaveThreadController(std::vector<SlaveThread
 
 void MasterSlaveThreadController::init(std::vector<SlaveThreadControllerInterface *> &newSlaveThreadList) {
 	this->mutex 				= new Mutex(CODE_AT_LINE);
-	this->slaveTriggerSem 		= new Semaphore(0);
-	this->slaveTriggerCounter 	= (int)newSlaveThreadList.size() + triggerBaseCount;
+	this->slaveBarrier 			= new FrameBarrier();
+	this->slaveFrameIndex 		= 0;
 	setSlaves(newSlaveThreadList);
 }
 
@@ -815,8 +896,8 @@ MasterSlaveThreadController::~MasterSlaveThreadController() {
 
 	clearSlaves();
 
-	delete slaveTriggerSem;
-	slaveTriggerSem = NULL;
+	delete slaveBarrier;
+	slaveBarrier = NULL;
 
 	if(debugMasterSlaveThreadController) printf("In [%s::%s Line: %d] mutex->getRefCount() = %d\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,mutex->getRefCount());
 
@@ -842,9 +923,12 @@ void MasterSlaveThreadController::setSlaves(std::vector<SlaveThreadControllerInt
 void MasterSlaveThreadController::signalSlaves(void *userdata) {
 	if(debugMasterSlaveThreadController) printf("In [%s::%s Line: %d]\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__);
 
-	slaveTriggerCounter = (int)this->slaveThreadList.size() + triggerBaseCount;
+	MutexSafeWrapper safeMutex(mutex);
+	slaveFrameIndex++;
+	slaveBarrier->beginFrame(slaveFrameIndex,(int)this->slaveThreadList.size());
+	safeMutex.ReleaseLock();
 
-	if(debugMasterSlaveThreadController) printf("In [%s::%s Line: %d]\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__);
+	if(debugMasterSlaveThreadController) printf("In [%s::%s Line: %d] slaveFrameIndex = %d\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,slaveFrameIndex);
 
 	if(this->slaveThreadList.empty() == false) {
 		for(unsigned int i = 0; i < this->slaveThreadList.size(); ++i) {
@@ -862,51 +946,27 @@ void MasterSlaveThreadController::triggerMaster(int waitMilliseconds) {
 	if(debugMasterSlaveThreadController) printf("In [%s::%s Line: %d]\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__);
 
 	MutexSafeWrapper safeMutex(mutex);
-	if(debugMasterSlaveThreadController) printf("In [%s::%s Line: %d] semVal = %u\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,slaveTriggerCounter);
-	//printf("In [%s::%s Line: %d] semVal = %u\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,slaveTriggerCounter);
-
-	slaveTriggerCounter--;
-	int newCount = slaveTriggerCounter;
-
-	if(debugMasterSlaveThreadController) printf("In [%s::%s Line: %d] slaveTriggerCounter = %u\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,slaveTriggerCounter);
-
+	int frameIndex = slaveFrameIndex;
 	safeMutex.ReleaseLock();
 
-	//printf("In [%s::%s Line: %d] semVal = %u\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,slaveTriggerCounter);
-
-	if(newCount <= triggerBaseCount) {
-		slaveTriggerSem->signal();
-	}
+	slaveBarrier->arrive(frameIndex);
 
-	if(debugMasterSlaveThreadController) printf("In [%s::%s Line: %d]\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__);
+	if(debugMasterSlaveThreadController) printf("In [%s::%s Line: %d] frameIndex = %d\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,frameIndex);
 }
 
 bool MasterSlaveThreadController::waitTillSlavesTrigger(int waitMilliseconds) {
 	bool result = true;
 
-	if(debugMasterSlaveThreadController) printf("In [%s::%s Line: %d] slaveTriggerCounter = %d\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,slaveTriggerCounter);
-
 	if(this->slaveThreadList.empty() == false) {
-		if(debugMasterSlaveThreadController) printf("In [%s::%s Line: %d] slaveTriggerCounter = %d\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,slaveTriggerCounter);
-
-		int slaveResult = slaveTriggerSem->waitTillSignalled(waitMilliseconds);
-
-		if(debugMasterSlaveThreadController) printf("In [%s::%s Line: %d] slaveTriggerCounter = %d slaveResult = %d\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,slaveTriggerCounter,slaveResult);
-
-		if(slaveResult != 0) {
-			if(debugMasterSlaveThreadController) printf("In [%s::%s Line: %d]\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__);
+		MutexSafeWrapper safeMutex(mutex);
+		int frameIndex = slaveFrameIndex;
+		safeMutex.ReleaseLock();
 
-			result = false;
-		}
-		else if(slaveResult == 0) {
-			if(debugMasterSlaveThreadController) printf("In [%s::%s Line: %d] slaveTriggerCounter = %d\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,slaveTriggerCounter);
+		result = slaveBarrier->waitForFrame(frameIndex,waitMilliseconds);
 
-			result = true;
-		}
+		if(debugMasterSlaveThreadController) printf("In [%s::%s Line: %d] frameIndex = %d result = %d\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,frameIndex,result);
 	}
 
-	if(debugMasterSlaveThreadController) printf("In [%s::%s Line: %d]\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__);
-
 	return result;
 }
 
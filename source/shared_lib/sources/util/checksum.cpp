@@ -25,6 +25,8 @@
 #include "platform_common.h"
 #include "conversion.h"
 #include "platform_util.h"
+#include "simple_threads.h"
+#include "file_crc_index.h"
 #include "leak_dumper.h"
 
 using namespace std;
@@ -39,6 +41,22 @@ namespace Shared{ namespace Util{
 
 Mutex Checksum::fileListCacheSynchAccessor;
 std::map<string,uint32> Checksum::fileListCache;
+int Checksum::fileSumThreadCount = -1;
+
+static FileCRCIndex fileSumIndex;
+
+// one pool serves every folder of a precache pass, callers take turns
+static Mutex fileSumPoolAccessor;
+static WorkerThreadPool *fileSumPool = NULL;
+static int fileSumPoolThreadCount = 0;
+
+// below this many uncached files starting worker threads costs more than
+// it saves
+static const int MIN_FILES_FOR_THREADED_FILE_SUMS = 8;
+// cacheFileSums runs once per folder and every save rewrites the whole
+// index, so new sums are collected until there are many or they get old
+static const uint32 FILE_SUM_INDEX_SAVE_PENDING = 4096;
+static const int FILE_SUM_INDEX_SAVE_SECONDS = 30;
 
 unsigned int crc_table[256] =
 {
@@ -76,11 +94,66 @@ unsigned int crc_table[256] =
 	0xb3667a2e, 0xc4614ab8, 0x5d681b02, 0x2a6f2b94, 0xb40bbe37, 0xc30c8ea1, 0x5a05df1b, 0x2d02ef8d
 };
 
+// crc_slice_table[0] is crc_table, crc_slice_table[k][i] is the crc of
+// byte i followed by k zero bytes so 8 bytes can be folded in at once
+static uint32 crc_slice_table[8][256];
+
+static bool initCRCSliceTable() {
+	for(unsigned int i = 0; i < 256; ++i) {
+		crc_slice_table[0][i] = crc_table[i];
+	}
+	for(unsigned int i = 0; i < 256; ++i) {
+		for(unsigned int slice = 1; slice < 8; ++slice) {
+			uint32 prev = crc_slice_table[slice - 1][i];
+			crc_slice_table[slice][i] = (prev >> 8) ^ crc_table[prev & 0xff];
+		}
+	}
+	return true;
+}
+static bool crcSliceTableInitialized = initCRCSliceTable();
+
+uint32 Checksum::crc32ByteTable(uint32 crc, const void *data, size_t size) {
+	const unsigned char *rVal = reinterpret_cast<const unsigned char *>(data);
+	crc = ~crc;
+	while (size--) {
+		crc = (crc >> 8) ^ crc_table[*rVal++ ^ (crc & 0xff)];
+	}
+	return ~crc;
+}
+
+uint32 Checksum::crc32SliceBy8(uint32 crc, const void *data, size_t size) {
+	const unsigned char *rVal = reinterpret_cast<const unsigned char *>(data);
+	crc = ~crc;
+	// bytes are assembled explicitly so the result does not depend on
+	// endianness or alignment
+	while (size >= 8) {
+		uint32 one = crc ^ ((uint32)rVal[0] | ((uint32)rVal[1] << 8) |
+				((uint32)rVal[2] << 16) | ((uint32)rVal[3] << 24));
+		uint32 two = (uint32)rVal[4] | ((uint32)rVal[5] << 8) |
+				((uint32)rVal[6] << 16) | ((uint32)rVal[7] << 24);
+		crc = crc_slice_table[7][one & 0xff] ^
+			  crc_slice_table[6][(one >> 8) & 0xff] ^
+			  crc_slice_table[5][(one >> 16) & 0xff] ^
+			  crc_slice_table[4][one >> 24] ^
+			  crc_slice_table[3][two & 0xff] ^
+			  crc_slice_table[2][(two >> 8) & 0xff] ^
+			  crc_slice_table[1][(two >> 16) & 0xff] ^
+			  crc_slice_table[0][two >> 24];
+		rVal += 8;
+		size -= 8;
+	}
+	while (size--) {
+		crc = (crc >> 8) ^ crc_table[*rVal++ ^ (crc & 0xff)];
+	}
+	return ~crc;
+}
+
 Checksum::Checksum() {
 	sum= 0;
 	r= 55665;
 	c1= 52845;
 	c2= 22719;
+	engine= ceSliceBy8;
 }
 
 uint32 Checksum::addByte(const char value) {
@@ -100,13 +173,12 @@ uint32 Checksum::addByte(const char value) {
 }
 
 uint32 Checksum::addBytes(const void *_data, size_t _size) {
-	const unsigned char *rVal = reinterpret_cast<const unsigned char *>(_data);
-	sum = ~sum;
-	while (_size--) {
-		sum = (sum >> 8) ^ crc_table[*rVal++ ^ (sum & 0xff)];
+	if(engine == ceSliceBy8) {
+		sum = crc32SliceBy8(sum, _data, _size);
+	}
+	else {
+		sum = crc32ByteTable(sum, _data, _size);
 	}
-	sum = ~sum;
-
 	return sum;
 }
 
@@ -163,8 +235,8 @@ uint32 Checksum::addInt64(const int64 &value) {
 }
 
 void Checksum::addString(const string &value) {
-	for(unsigned int i = 0; i < value.size(); ++i) {
-		addByte(value[i]);
+	if(value.empty() == false) {
+		addBytes(value.data(), value.size());
 	}
 }
 
@@ -310,6 +382,9 @@ bool Checksum::addFileToSum(const string &path) {
 		if(SystemFlags::getSystemSettingType(SystemFlags::debugSystem).enabled) SystemFlags::OutputDebug(SystemFlags::debugSystem,"In [%s::%s Line: %d] buf.size() = %d, path [%s], isXMLFile = %d\n",__FILE__,__FUNCTION__,__LINE__,buf.size(), path.c_str(),isXMLFile);
 
 		if(isXMLFile == true) {
+			// collect what survives the filter and sum it in one pass
+			std::vector<char> filtered;
+			filtered.reserve(buf.size());
 			bool inCommentTag=false;
 			for(std::size_t i = 0; i < buf.size(); ++i) {
 				// Ignore Spaces in XML files as they are
@@ -340,9 +415,11 @@ bool Checksum::addFileToSum(const string &path) {
 						continue;
 					}
 				//}
-				uint32 cipher = addByte(buf[i]);
-
-				if(SystemFlags::getSystemSettingType(SystemFlags::debugSystem).enabled) SystemFlags::OutputDebug(SystemFlags::debugSystem,"In [%s::%s Line: %d] %d / %d, cipher = %u\n",__FILE__,__FUNCTION__,__LINE__,i,buf.size(), cipher);
+				filtered.push_back(buf[i]);
+			}
+			if(filtered.empty() == false) {
+				uint32 cipher = addBytes(&filtered[0],filtered.size());
+				if(SystemFlags::getSystemSettingType(SystemFlags::debugSystem).enabled) SystemFlags::OutputDebug(SystemFlags::debugSystem,"In [%s::%s Line: %d] %d / %d, cipher = %u\n",__FILE__,__FUNCTION__,__LINE__,filtered.size(),buf.size(), cipher);
 			}
 		}
 		else {
@@ -362,11 +439,123 @@ bool Checksum::addFileToSum(const string &path) {
     return fileExists;
 }
 
+// =====================================================
+//	class ChecksumFileSumTask
+// =====================================================
+
+class ChecksumFileSumTask : public WorkerTaskCallbackInterface {
+protected:
+	const std::vector<string> &paths;
+	std::vector<uint32> &sums;
+
+public:
+	ChecksumFileSumTask(const std::vector<string> &paths, std::vector<uint32> &sums)
+		: paths(paths), sums(sums) {}
+
+	virtual void workerTask(int taskIndex, int workerIndex) {
+		sums[taskIndex] = Checksum::computeFileSum(paths[taskIndex]);
+	}
+};
+
+uint32 Checksum::computeFileSum(const string &path) {
+	FileCRCIndex::FileStamp stamp;
+	bool haveStamp = (fileSumIndex.isOpen() == true && FileCRCIndex::getFileStamp(path,stamp) == true);
+	uint32 value = 0;
+	if(haveStamp == true && fileSumIndex.findSum(path,stamp,value) == true) {
+		return value;
+	}
+
+	Checksum fileResult;
+	fileResult.addFileToSum(path);
+	value = fileResult.getSum();
+	if(haveStamp == true) {
+		fileSumIndex.setSum(path,stamp,value);
+	}
+	return value;
+}
+
+void Checksum::openFileSumIndex(const string &indexFile) {
+	fileSumIndex.open(indexFile);
+}
+
+void Checksum::saveFileSumIndex() {
+	fileSumIndex.save();
+}
+
+void Checksum::releaseFileSumThreads() {
+	MutexSafeWrapper safeMutex(&fileSumPoolAccessor,string(__FILE__) + "_" + intToStr(__LINE__));
+	delete fileSumPool;
+	fileSumPool = NULL;
+	fileSumPoolThreadCount = 0;
+}
+
+void Checksum::closeFileSumIndex() {
+	fileSumIndex.save();
+	fileSumIndex.close();
+}
+
+bool Checksum::isFileSumIndexOpen() {
+	return fileSumIndex.isOpen();
+}
+
+void Checksum::cacheFileSums(const std::vector<string> &paths) {
+	std::vector<string> uncachedPaths;
+	MutexSafeWrapper safeMutex(&Checksum::fileListCacheSynchAccessor,string(__FILE__) + "_" + intToStr(__LINE__));
+	for(unsigned int index = 0; index < paths.size(); ++index) {
+		if(Checksum::fileListCache.find(paths[index]) == Checksum::fileListCache.end()) {
+			uncachedPaths.push_back(paths[index]);
+		}
+	}
+	safeMutex.ReleaseLock();
+
+	if(uncachedPaths.empty() == true) {
+		return;
+	}
+
+	// Each file's CRC only depends on that file so they are hashed without
+	// holding the cache lock, the list sum adds them up in path order later
+	std::vector<uint32> sums(uncachedPaths.size(),0);
+	ChecksumFileSumTask task(uncachedPaths,sums);
+
+	int threadCount = (fileSumThreadCount >= 0 ? fileSumThreadCount : getCPUCoreCount() - 1);
+	if(threadCount > 0 && (int)uncachedPaths.size() >= MIN_FILES_FOR_THREADED_FILE_SUMS) {
+		// runTasks only wakes as many workers as there are tasks to share
+		MutexSafeWrapper safePoolMutex(&fileSumPoolAccessor,string(__FILE__) + "_" + intToStr(__LINE__));
+		if(fileSumPool == NULL || fileSumPoolThreadCount != threadCount) {
+			delete fileSumPool;
+			fileSumPool = new WorkerThreadPool(threadCount,"ChecksumFileSums");
+			fileSumPoolThreadCount = threadCount;
+		}
+		fileSumPool->runTasks(&task,(int)uncachedPaths.size());
+	}
+	else {
+		for(unsigned int index = 0; index < uncachedPaths.size(); ++index) {
+			task.workerTask(index,0);
+		}
+	}
+
+	safeMutex.Lock();
+	for(unsigned int index = 0; index < uncachedPaths.size(); ++index) {
+		Checksum::fileListCache[uncachedPaths[index]] = sums[index];
+	}
+	safeMutex.ReleaseLock();
+
+	fileSumIndex.saveIfDue(FILE_SUM_INDEX_SAVE_PENDING,FILE_SUM_INDEX_SAVE_SECONDS);
+}
+
 uint32 Checksum::getSum() {
 	//printf("Getting checksum for files [%d]\n",fileList.size());
 	if(fileList.size() > 0) {
 		if(SystemFlags::getSystemSettingType(SystemFlags::debugSystem).enabled) SystemFlags::OutputDebug(SystemFlags::debugSystem,"In [%s::%s Line: %d] fileList.size() = %d\n",__FILE__,__FUNCTION__,__LINE__,fileList.size());
 
+		std::vector<string> paths;
+		paths.reserve(fileList.size());
+		for(std::map<string,uint32>::iterator iterMap = fileList.begin();
+			iterMap != fileList.end(); ++iterMap) {
+			paths.push_back(iterMap->first);
+		}
+		cacheFileSums(paths);
+
 		Checksum newResult;
 
 		{
@@ -376,14 +565,8 @@ uint32 Checksum::getSum() {
 
 			MutexSafeWrapper safeMutexSocketDestructorFlag(&Checksum::fileListCacheSynchAccessor,string(__FILE__) + "_" + intToStr(__LINE__));
 			if(Checksum::fileListCache.find(iterMap->first) == Checksum::fileListCache.end()) {
-				Checksum fileResult;
-				//bool fileAddedOk = fileResult.addFileToSum(iterMap->first);
-				fileResult.addFileToSum(iterMap->first);
-				Checksum::fileListCache[iterMap->first] = fileResult.getSum();
-				//printf("fileAddedOk = %d for file [%s] CRC [%d]\n",fileAddedOk,iterMap->first.c_str(),Checksum::fileListCache[iterMap->first]);
-			}
-			else {
-				//printf("Getting checksum from CACHE for file [%s] CRC [%d]\n",iterMap->first.c_str(),Checksum::fileListCache[iterMap->first]);
+				// removed from the cache meanwhile
+				Checksum::fileListCache[iterMap->first] = computeFileSum(iterMap->first);
 			}
 			newResult.addSum(Checksum::fileListCache[iterMap->first]);
 		}
@@ -0,0 +1,455 @@
+// ==============================================================
+//	This file is part of MegaGlest Shared Library (www.megaglest.org)
+//
+//	Copyright (C) 2013 MegaGlest team
+//
+//	You can redistribute this code and/or modify it under
+//	the terms of the GNU General Public License as published
+//	by the Free Software Foundation; either version 2 of the
+//	License, or (at your option) any later version
+// ==============================================================
+
+#include "file_crc_index.h"
+
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <vector>
+#include <algorithm>
+#include <sys/stat.h>
+#include <fcntl.h>
+
+#ifdef WIN32
+  #include <windows.h>
+#else
+  #include <sys/mman.h>
+  #include <unistd.h>
+#endif
+
+#include "checksum.h"
+#include "conversion.h"
+#include "platform_common.h"
+#include "platform_util.h"
+#include "util.h"
+#include "leak_dumper.h"
+
+using namespace std;
+using namespace Shared::PlatformCommon;
+
+namespace Shared{ namespace Util{
+
+// The index is a local cache so it is stored in native byte order, a file
+// written on another architecture fails the byte order check and is ignored
+//
+// Bump FILE_CRC_INDEX_VERSION whenever the way Checksum sums a file changes
+// (for example the XML filtering) so old sums are not reused
+static const char FILE_CRC_INDEX_MAGIC[8]		= { 'M','G','C','R','C','I','D','X' };
+static const uint32 FILE_CRC_INDEX_BYTE_ORDER	= 0x01020304;
+static const uint32 FILE_CRC_INDEX_VERSION		= 1;
+
+struct FileCRCIndexHeader {
+	char magic[8];
+	uint32 byteOrder;
+	uint32 version;
+	uint32 entryCount;
+	uint32 stringsSize;
+};
+
+struct FileCRCIndexEntry {
+	uint32 pathHash;
+	uint32 pathOffset;
+	uint32 pathLength;
+	uint32 sum;
+	uint64 size;
+	int64 modifiedTime;
+	uint64 inode;
+};
+
+// A file changed again within the second it was stamped could keep the
+// same stamp, such sums are only remembered for the current run
+static const int64 FILE_CRC_INDEX_MIN_AGE_SECONDS = 2;
+
+static uint32 getPathHash(const string &path) {
+	return Checksum::crc32SliceBy8(0, path.data(), path.size());
+}
+
+struct FileCRCIndexRecord {
+	uint32 pathHash;
+	string path;
+	FileCRCIndex::FileStamp stamp;
+	uint32 sum;
+
+	bool operator<(const FileCRCIndexRecord &other) const {
+		if(pathHash != other.pathHash) {
+			return pathHash < other.pathHash;
+		}
+		return path < other.path;
+	}
+};
+
+// =====================================================
+//	class FileCRCIndex
+// =====================================================
+
+FileCRCIndex::FileCRCIndex() : mutex(CODE_AT_LINE) {
+	opened = false;
+	mappedData = NULL;
+	mappedSize = 0;
+#ifdef WIN32
+	fileHandle = NULL;
+	mappingHandle = NULL;
+#endif
+	entryCount = 0;
+	stringsSize = 0;
+	lastSaveTime = 0;
+}
+
+FileCRCIndex::~FileCRCIndex() {
+	close();
+}
+
+void FileCRCIndex::open(const string &indexFile) {
+	MutexSafeWrapper safeMutex(&mutex,string(__FILE__) + "_" + intToStr(__LINE__));
+	unmapIndexFile();
+	pending.clear();
+
+	this->indexFile = indexFile;
+	this->opened = true;
+	this->lastSaveTime = time(NULL);
+	mapIndexFile();
+
+	if(SystemFlags::getSystemSettingType(SystemFlags::debugSystem).enabled) SystemFlags::OutputDebug(SystemFlags::debugSystem,"In [%s::%s Line: %d] indexFile [%s] entryCount = %u\n",__FILE__,__FUNCTION__,__LINE__,indexFile.c_str(),entryCount);
+}
+
+void FileCRCIndex::close() {
+	MutexSafeWrapper safeMutex(&mutex,string(__FILE__) + "_" + intToStr(__LINE__));
+	unmapIndexFile();
+	pending.clear();
+	opened = false;
+	indexFile = "";
+}
+
+bool FileCRCIndex::isOpen() {
+	MutexSafeWrapper safeMutex(&mutex,string(__FILE__) + "_" + intToStr(__LINE__));
+	return opened;
+}
+
+bool FileCRCIndex::mapIndexFile() {
+	if(fileExists(indexFile) == false) {
+		return false;
+	}
+
+#ifdef WIN32
+	HANDLE file = CreateFileW(utf8_decode(indexFile).c_str(), GENERIC_READ,
+			FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if(file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+	LARGE_INTEGER fileSize;
+	if(GetFileSizeEx(file, &fileSize) == FALSE || fileSize.QuadPart <= 0) {
+		CloseHandle(file);
+		return false;
+	}
+	HANDLE mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if(mapping == NULL) {
+		CloseHandle(file);
+		return false;
+	}
+	const void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if(view == NULL) {
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+	fileHandle = file;
+	mappingHandle = mapping;
+	mappedData = static_cast<const unsigned char *>(view);
+	mappedSize = (size_t)fileSize.QuadPart;
+#else
+	int fd = ::open(indexFile.c_str(), O_RDONLY);
+	if(fd < 0) {
+		return false;
+	}
+	struct stat fileStat;
+	if(fstat(fd, &fileStat) != 0 || fileStat.st_size <= 0) {
+		::close(fd);
+		return false;
+	}
+	void *view = mmap(NULL, (size_t)fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	// the mapping stays valid after the descriptor is closed
+	::close(fd);
+	if(view == MAP_FAILED) {
+		return false;
+	}
+	mappedData = static_cast<const unsigned char *>(view);
+	mappedSize = (size_t)fileStat.st_size;
+#endif
+
+	FileCRCIndexHeader header;
+	bool valid = (mappedSize >= sizeof(header));
+	if(valid == true) {
+		memcpy(&header, mappedData, sizeof(header));
+		valid = (memcmp(header.magic, FILE_CRC_INDEX_MAGIC, sizeof(header.magic)) == 0 &&
+				 header.byteOrder == FILE_CRC_INDEX_BYTE_ORDER &&
+				 header.version == FILE_CRC_INDEX_VERSION &&
+				 (uint64)sizeof(header) + (uint64)header.entryCount * sizeof(FileCRCIndexEntry) +
+				 (uint64)header.stringsSize == (uint64)mappedSize);
+	}
+	if(valid == false) {
+		if(SystemFlags::getSystemSettingType(SystemFlags::debugSystem).enabled) SystemFlags::OutputDebug(SystemFlags::debugSystem,"In [%s::%s Line: %d] ignoring invalid index file [%s]\n",__FILE__,__FUNCTION__,__LINE__,indexFile.c_str());
+		unmapIndexFile();
+		return false;
+	}
+
+	entryCount = header.entryCount;
+	stringsSize = header.stringsSize;
+	return true;
+}
+
+void FileCRCIndex::unmapIndexFile() {
+	if(mappedData != NULL) {
+#ifdef WIN32
+		UnmapViewOfFile(mappedData);
+		CloseHandle((HANDLE)mappingHandle);
+		CloseHandle((HANDLE)fileHandle);
+		mappingHandle = NULL;
+		fileHandle = NULL;
+#else
+		munmap((void *)mappedData, mappedSize);
+#endif
+	}
+	mappedData = NULL;
+	mappedSize = 0;
+	entryCount = 0;
+	stringsSize = 0;
+}
+
+bool FileCRCIndex::getMappedEntry(uint32 index, string &path, FileStamp &stamp, uint32 &sum) const {
+	FileCRCIndexEntry entry;
+	memcpy(&entry, mappedData + sizeof(FileCRCIndexHeader) + index * sizeof(FileCRCIndexEntry), sizeof(entry));
+	if((uint64)entry.pathOffset + entry.pathLength > stringsSize) {
+		return false;
+	}
+	const char *strings = reinterpret_cast<const char *>(mappedData + sizeof(FileCRCIndexHeader) +
+			entryCount * sizeof(FileCRCIndexEntry));
+	path.assign(strings + entry.pathOffset, entry.pathLength);
+	stamp.size = entry.size;
+	stamp.modifiedTime = entry.modifiedTime;
+	stamp.inode = entry.inode;
+	sum = entry.sum;
+	return true;
+}
+
+int FileCRCIndex::findMappedEntry(const string &path, uint32 pathHash) const {
+	// entries are sorted by path hash, then path
+	const unsigned char *entries = mappedData + sizeof(FileCRCIndexHeader);
+	uint32 low = 0;
+	uint32 high = entryCount;
+	while(low < high) {
+		uint32 middle = low + (high - low) / 2;
+		uint32 middleHash = 0;
+		memcpy(&middleHash, entries + middle * sizeof(FileCRCIndexEntry), sizeof(middleHash));
+		if(middleHash < pathHash) {
+			low = middle + 1;
+		}
+		else {
+			high = middle;
+		}
+	}
+
+	for(uint32 index = low; index < entryCount; ++index) {
+		uint32 entryHash = 0;
+		memcpy(&entryHash, entries + index * sizeof(FileCRCIndexEntry), sizeof(entryHash));
+		if(entryHash != pathHash) {
+			break;
+		}
+		string entryPath;
+		FileStamp entryStamp;
+		uint32 entrySum = 0;
+		if(getMappedEntry(index, entryPath, entryStamp, entrySum) == true && entryPath == path) {
+			return (int)index;
+		}
+	}
+	return -1;
+}
+
+bool FileCRCIndex::getFileStamp(const string &path, FileStamp &stamp) {
+#ifdef WIN32
+	struct _stat64 fileStat;
+	if(_wstat64(utf8_decode(path).c_str(), &fileStat) != 0) {
+		return false;
+	}
+	// no inode numbers here, size and time have to do
+	stamp.inode = 0;
+#else
+	struct stat fileStat;
+	if(stat(path.c_str(), &fileStat) != 0) {
+		return false;
+	}
+	stamp.inode = (uint64)fileStat.st_ino;
+#endif
+	stamp.size = (uint64)fileStat.st_size;
+	stamp.modifiedTime = (int64)fileStat.st_mtime;
+	return true;
+}
+
+bool FileCRCIndex::findSum(const string &path, const FileStamp &stamp, uint32 &sum) {
+	MutexSafeWrapper safeMutex(&mutex,string(__FILE__) + "_" + intToStr(__LINE__));
+	if(opened == false) {
+		return false;
+	}
+
+	PendingMap::iterator iterFind = pending.find(path);
+	if(iterFind != pending.end()) {
+		if(iterFind->second.first == stamp) {
+			sum = iterFind->second.second;
+			return true;
+		}
+		return false;
+	}
+
+	if(mappedData != NULL) {
+		int index = findMappedEntry(path, getPathHash(path));
+		if(index >= 0) {
+			string entryPath;
+			FileStamp entryStamp;
+			uint32 entrySum = 0;
+			if(getMappedEntry(index, entryPath, entryStamp, entrySum) == true && entryStamp == stamp) {
+				sum = entrySum;
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+void FileCRCIndex::setSum(const string &path, const FileStamp &stamp, uint32 sum) {
+	if(stamp.modifiedTime + FILE_CRC_INDEX_MIN_AGE_SECONDS > (int64)time(NULL)) {
+		return;
+	}
+
+	MutexSafeWrapper safeMutex(&mutex,string(__FILE__) + "_" + intToStr(__LINE__));
+	if(opened == true) {
+		pending[path] = make_pair(stamp, sum);
+	}
+}
+
+bool FileCRCIndex::hasPendingSums() {
+	MutexSafeWrapper safeMutex(&mutex,string(__FILE__) + "_" + intToStr(__LINE__));
+	return (pending.empty() == false);
+}
+
+uint32 FileCRCIndex::getEntryCount() {
+	MutexSafeWrapper safeMutex(&mutex,string(__FILE__) + "_" + intToStr(__LINE__));
+	return entryCount;
+}
+
+bool FileCRCIndex::saveIfDue(uint32 pendingLimit, int seconds) {
+	MutexSafeWrapper safeMutex(&mutex,string(__FILE__) + "_" + intToStr(__LINE__));
+	bool due = (opened == true && pending.empty() == false &&
+				(pending.size() >= pendingLimit || difftime(time(NULL),lastSaveTime) >= seconds));
+	safeMutex.ReleaseLock();
+
+	return (due == true ? save() : false);
+}
+
+bool FileCRCIndex::save() {
+	MutexSafeWrapper safeMutex(&mutex,string(__FILE__) + "_" + intToStr(__LINE__));
+	if(opened == false || pending.empty() == true) {
+		return false;
+	}
+	lastSaveTime = time(NULL);
+
+	std::vector<FileCRCIndexRecord> records;
+	records.reserve(entryCount + pending.size());
+	for(uint32 index = 0; index < entryCount; ++index) {
+		FileCRCIndexRecord record;
+		if(getMappedEntry(index, record.path, record.stamp, record.sum) == false ||
+			pending.find(record.path) != pending.end()) {
+			continue;
+		}
+		// keep only entries that still describe the file on disk
+		FileStamp currentStamp;
+		if(getFileStamp(record.path, currentStamp) == false || (currentStamp == record.stamp) == false) {
+			continue;
+		}
+		record.pathHash = getPathHash(record.path);
+		records.push_back(record);
+	}
+	for(PendingMap::iterator iterMap = pending.begin(); iterMap != pending.end(); ++iterMap) {
+		FileCRCIndexRecord record;
+		record.pathHash = getPathHash(iterMap->first);
+		record.path = iterMap->first;
+		record.stamp = iterMap->second.first;
+		record.sum = iterMap->second.second;
+		records.push_back(record);
+	}
+	std::sort(records.begin(), records.end());
+
+	FileCRCIndexHeader header;
+	memcpy(header.magic, FILE_CRC_INDEX_MAGIC, sizeof(header.magic));
+	header.byteOrder = FILE_CRC_INDEX_BYTE_ORDER;
+	header.version = FILE_CRC_INDEX_VERSION;
+	header.entryCount = (uint32)records.size();
+	header.stringsSize = 0;
+
+	std::vector<FileCRCIndexEntry> entries(records.size());
+	string strings;
+	for(unsigned int index = 0; index < records.size(); ++index) {
+		FileCRCIndexEntry &entry = entries[index];
+		entry.pathHash = records[index].pathHash;
+		entry.pathOffset = (uint32)strings.size();
+		entry.pathLength = (uint32)records[index].path.size();
+		entry.sum = records[index].sum;
+		entry.size = records[index].stamp.size;
+		entry.modifiedTime = records[index].stamp.modifiedTime;
+		entry.inode = records[index].stamp.inode;
+		strings += records[index].path;
+	}
+	header.stringsSize = (uint32)strings.size();
+
+	// write beside the index and swap it in so readers never see half a
+	// file, the pid keeps processes sharing the cache folder apart
+#ifdef WIN32
+	string tempFile = indexFile + ".tmp." + intToStr((int)GetCurrentProcessId());
+#else
+	string tempFile = indexFile + ".tmp." + intToStr((int)getpid());
+#endif
+#ifdef WIN32
+	FILE *fp = _wfopen(utf8_decode(tempFile).c_str(), L"wb");
+#else
+	FILE *fp = fopen(tempFile.c_str(),"wb");
+#endif
+	if(fp == NULL) {
+		if(SystemFlags::getSystemSettingType(SystemFlags::debugSystem).enabled) SystemFlags::OutputDebug(SystemFlags::debugSystem,"In [%s::%s Line: %d] cannot write [%s]\n",__FILE__,__FUNCTION__,__LINE__,tempFile.c_str());
+		return false;
+	}
+	bool written = (fwrite(&header, sizeof(header), 1, fp) == 1);
+	if(written == true && entries.empty() == false) {
+		written = (fwrite(&entries[0], sizeof(FileCRCIndexEntry), entries.size(), fp) == entries.size());
+	}
+	if(written == true && strings.empty() == false) {
+		written = (fwrite(strings.data(), 1, strings.size(), fp) == strings.size());
+	}
+	fclose(fp);
+
+	if(written == false) {
+		removeFile(tempFile);
+		return false;
+	}
+
+	unmapIndexFile();
+#ifdef WIN32
+	removeFile(indexFile);
+#endif
+	bool result = renameFile(tempFile, indexFile);
+	if(result == true) {
+		pending.clear();
+	}
+	mapIndexFile();
+
+	if(SystemFlags::getSystemSettingType(SystemFlags::debugSystem).enabled) SystemFlags::OutputDebug(SystemFlags::debugSystem,"In [%s::%s Line: %d] indexFile [%s] entryCount = %u result = %d\n",__FILE__,__FUNCTION__,__LINE__,indexFile.c_str(),entryCount,result);
+	return result;
+}
+
+}}//end namespace
@@ -0,0 +1,232 @@
+// ==============================================================
+//	This file is part of MegaGlest Unit Tests (www.megaglest.org)
+//
+//	Copyright (C) 2013 MegaGlest team
+//
+//	You can redistribute this code and/or modify it under
+//	the terms of the GNU General Public License as published
+//	by the Free Software Foundation; either version 2 of the
+//	License, or (at your option) any later version
+// ==============================================================
+
+#include <cppunit/extensions/HelperMacros.h>
+#include "fow_texture.h"
+#include <map>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+using namespace Shared::Graphics;
+
+//
+// Square sight, lit in the middle and fading out to the border
+//
+class FowTestSight {
+public:
+	int x;
+	int y;
+	int radius;
+
+	FowTestSight() : x(0), y(0), radius(0) {}
+	FowTestSight(int x, int y, int radius) : x(x), y(y), radius(radius) {}
+
+	bool operator==(const FowTestSight &sight) const {
+		return (x == sight.x && y == sight.y && radius == sight.radius);
+	}
+	float getAlpha(int px, int py) const {
+		int dist = abs(px - x) + abs(py - y);
+		return (dist >= 2 * radius ? 0.2f : 1.0f - 0.4f * dist / radius);
+	}
+};
+
+//
+// The fog of war pixmaps of Minimap with sights drawn the way
+// World::computeFowIncremental draws them
+//
+class FowTestTexture {
+public:
+	static const int size = 32;
+	static const float exploredAlpha;
+
+	Pixmap2D *pixmap0;
+	Pixmap2D *pixmap1;
+	FowTextureReset reset;
+	std::map<int,FowTestSight> drawnSights;
+
+	FowTestTexture(bool incremental) {
+		float f = 0.f;
+		pixmap0 = new Pixmap2D(size, size, 1);
+		pixmap0->setPixels(&f, 1);
+		pixmap1 = new Pixmap2D(size, size, 1);
+		pixmap1->setPixels(&f, 1);
+		reset.setIncremental(incremental);
+	}
+	~FowTestTexture() {
+		delete pixmap0;
+		delete pixmap1;
+	}
+
+	void addChangedRegion(const FowTestSight &sight) {
+		reset.addChangedRegion(sight.x - sight.radius, sight.y - sight.radius, sight.x + sight.radius, sight.y + sight.radius);
+	}
+
+	void draw(const FowTestSight &sight) {
+		for(int px = sight.x - sight.radius; px <= sight.x + sight.radius; ++px) {
+			for(int py = sight.y - sight.radius; py <= sight.y + sight.radius; ++py) {
+				if(px >= 0 && py >= 0 && px < size && py < size &&
+					pixmap1->getPixelf(px, py) < sight.getAlpha(px, py)) {
+					pixmap1->setPixel(px, py, sight.getAlpha(px, py));
+				}
+			}
+		}
+	}
+
+	void tick(const std::map<int,FowTestSight> &sights) {
+		Pixmap2D *tmpPixmap = pixmap0;
+		pixmap0 = pixmap1;
+		pixmap1 = tmpPixmap;
+		reset.beginTick(pixmap0, pixmap1, FowTextureReset::rmFogOfWar, exploredAlpha);
+
+		std::map<int,bool> changed;
+		for(std::map<int,FowTestSight>::const_iterator iterMap = sights.begin();
+			iterMap != sights.end(); ++iterMap) {
+			std::map<int,FowTestSight>::iterator iterFind = drawnSights.find(iterMap->first);
+			if(iterFind == drawnSights.end() || (iterFind->second == iterMap->second) == false) {
+				if(iterFind != drawnSights.end()) {
+					addChangedRegion(iterFind->second);
+				}
+				addChangedRegion(iterMap->second);
+				changed[iterMap->first] = true;
+			}
+		}
+		for(std::map<int,FowTestSight>::const_iterator iterMap = drawnSights.begin();
+			iterMap != drawnSights.end(); ++iterMap) {
+			if(sights.find(iterMap->first) == sights.end()) {
+				addChangedRegion(iterMap->second);
+			}
+		}
+		drawnSights = sights;
+
+		reset.resetChangedRegions(pixmap0, pixmap1, FowTextureReset::rmFogOfWar, exploredAlpha);
+		for(std::map<int,FowTestSight>::const_iterator iterMap = sights.begin();
+			iterMap != sights.end(); ++iterMap) {
+			const FowTestSight &sight = iterMap->second;
+			if(changed.find(iterMap->first) != changed.end() ||
+				reset.needsRedraw(sight.x - sight.radius, sight.y - sight.radius, sight.x + sight.radius, sight.y + sight.radius) == true) {
+				draw(sight);
+			}
+		}
+	}
+
+	// the explored alpha as the one byte pixmap stores it
+	static float getStoredExploredAlpha() {
+		Pixmap2D pixmap(1, 1, 1);
+		pixmap.setPixel(0, 0, exploredAlpha);
+		return pixmap.getPixelf(0, 0);
+	}
+};
+
+const float FowTestTexture::exploredAlpha = 0.5f;
+
+//
+// Tests for the incremental fog of war texture reset
+//
+class FowTextureTest : public CppUnit::TestFixture {
+	// Register the suite of tests for this fixture
+	CPPUNIT_TEST_SUITE( FowTextureTest );
+
+	CPPUNIT_TEST( test_left_cells_fall_back_to_explored );
+	CPPUNIT_TEST( test_unchanged_sight_stays_lit_in_reset_region );
+	CPPUNIT_TEST( test_incremental_matches_full_reset );
+
+	CPPUNIT_TEST_SUITE_END();
+	// End of Fixture registration
+
+public:
+
+	void test_left_cells_fall_back_to_explored() {
+		FowTestTexture texture(true);
+		std::map<int,FowTestSight> sights;
+		sights[1] = FowTestSight(8, 8, 3);
+		for(int tick = 0; tick < 5; ++tick) {
+			texture.tick(sights);
+		}
+		CPPUNIT_ASSERT_EQUAL( 1.0f, texture.pixmap1->getPixelf(8, 8) );
+
+		// the unit walks away, every cell it lit is only explored from now on
+		FowTestSight oldSight = sights[1];
+		sights[1] = FowTestSight(24, 24, 3);
+		for(int tick = 0; tick < 4; ++tick) {
+			texture.tick(sights);
+			for(int px = 5; px <= 11; ++px) {
+				for(int py = 5; py <= 11; ++py) {
+					if(oldSight.getAlpha(px, py) > FowTestTexture::exploredAlpha) {
+						CPPUNIT_ASSERT_EQUAL( FowTestTexture::getStoredExploredAlpha(), texture.pixmap1->getPixelf(px, py) );
+					}
+				}
+			}
+			CPPUNIT_ASSERT_EQUAL( 1.0f, texture.pixmap1->getPixelf(24, 24) );
+		}
+
+		// the same once the unit dies
+		sights.clear();
+		for(int tick = 0; tick < 4; ++tick) {
+			texture.tick(sights);
+			CPPUNIT_ASSERT_EQUAL( FowTestTexture::getStoredExploredAlpha(), texture.pixmap1->getPixelf(24, 24) );
+		}
+	}
+
+	void test_unchanged_sight_stays_lit_in_reset_region() {
+		FowTestTexture texture(true);
+		std::map<int,FowTestSight> sights;
+		sights[1] = FowTestSight(16, 16, 3);
+		sights[2] = FowTestSight(4, 4, 2);
+		sights[3] = FowTestSight(28, 28, 2);
+		for(int tick = 0; tick < 5; ++tick) {
+			texture.tick(sights);
+		}
+
+		// the changed region of the two moving units spans the idle one
+		for(int tick = 0; tick < 6; ++tick) {
+			sights[2].x = 4 + tick % 2;
+			sights[3].y = 28 - tick % 2;
+			texture.tick(sights);
+			CPPUNIT_ASSERT_EQUAL( 1.0f, texture.pixmap1->getPixelf(16, 16) );
+		}
+	}
+
+	void test_incremental_matches_full_reset() {
+		FowTestTexture incremental(true);
+		FowTestTexture full(false);
+		std::map<int,FowTestSight> sights;
+		int nextId = 0;
+
+		srand(7);
+		for(int tick = 0; tick < 300; ++tick) {
+			for(std::map<int,FowTestSight>::iterator iterMap = sights.begin();
+				iterMap != sights.end();) {
+				int change = rand() % 10;
+				if(change == 0) {
+					sights.erase(iterMap++);
+					continue;
+				}
+				if(change < 4) {
+					iterMap->second.x = std::max(0, std::min(FowTestTexture::size - 1, iterMap->second.x + rand() % 5 - 2));
+					iterMap->second.y = std::max(0, std::min(FowTestTexture::size - 1, iterMap->second.y + rand() % 5 - 2));
+				}
+				++iterMap;
+			}
+			if(sights.empty() == true || rand() % 3 == 0) {
+				sights[nextId++] = FowTestSight(rand() % FowTestTexture::size, rand() % FowTestTexture::size, 1 + rand() % 3);
+			}
+
+			incremental.tick(sights);
+			full.tick(sights);
+			CPPUNIT_ASSERT( memcmp(incremental.pixmap1->getPixels(), full.pixmap1->getPixels(), full.pixmap1->getPixelByteCount()) == 0 );
+		}
+	}
+};
+
+// Test Suite Registrations
+CPPUNIT_TEST_SUITE_REGISTRATION( FowTextureTest );
+//
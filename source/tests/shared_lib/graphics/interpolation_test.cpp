@@ -0,0 +1,184 @@
+// ==============================================================
+//	This file is part of MegaGlest Unit Tests (www.megaglest.org)
+//
+//	Copyright (C) 2013 MegaGlest team
+//
+//	You can redistribute this code and/or modify it under
+//	the terms of the GNU General Public License as published
+//	by the Free Software Foundation; either version 2 of the
+//	License, or (at your option) any later version
+// ==============================================================
+
+#include <cppunit/extensions/HelperMacros.h>
+#include "interpolation.h"
+#include "model.h"
+#include "model_header.h"
+#include <vector>
+#include <cstdio>
+#include <cstring>
+
+using namespace Shared::Graphics;
+
+//
+// Tests for the key frame interpolation and the shared interpolation cache
+//
+class InterpolationTest : public CppUnit::TestFixture {
+	// Register the suite of tests for this fixture
+	CPPUNIT_TEST_SUITE( InterpolationTest );
+
+	CPPUNIT_TEST( test_lerp_matches_vec3f_lerp );
+	CPPUNIT_TEST( test_referenced_entry_survives_eviction );
+	CPPUNIT_TEST( test_purge_drops_only_unreferenced_owner_entries );
+	CPPUNIT_TEST( test_disabled_cache_uses_private_buffer );
+
+	CPPUNIT_TEST_SUITE_END();
+	// End of Fixture registration
+
+private:
+
+	static const uint32 vertexCount = 1001;
+	static const uint32 frameCount = 4;
+
+	static std::vector<Vec3f> makeFrames() {
+		std::vector<Vec3f> frames(vertexCount * frameCount);
+		uint32 seed = 7;
+		for(size_t i = 0; i < frames.size(); ++i) {
+			seed = seed * 1103515245 + 12345;
+			frames[i] = Vec3f((seed >> 8) % 10000 / 37.0f, -(float)((seed >> 4) % 999) / 7.0f, (seed % 77) * 0.013f);
+		}
+		return frames;
+	}
+
+	// a mesh as Mesh::load reads it from a g3d file, without textures
+	static void loadMesh(Mesh &mesh, const std::vector<Vec3f> &frames) {
+		MeshHeader meshHeader;
+		memset(&meshHeader, 0, sizeof(meshHeader));
+		meshHeader.frameCount = frameCount;
+		meshHeader.vertexCount = vertexCount;
+		meshHeader.opacity = 1.0f;
+
+		FILE *f = tmpfile();
+		CPPUNIT_ASSERT( f != NULL );
+		fwrite(&meshHeader, sizeof(meshHeader), 1, f);
+		fwrite(&frames[0], sizeof(Vec3f), frames.size(), f);
+		fwrite(&frames[0], sizeof(Vec3f), frames.size(), f);
+		rewind(f);
+		mesh.load(0, "", f, NULL, false);
+		fclose(f);
+	}
+
+	static bool sameBits(const Vec3f *a, const Vec3f *b, uint32 count) {
+		return memcmp(a, b, count * sizeof(Vec3f)) == 0;
+	}
+
+public:
+
+	void tearDown() {
+		InterpolationCache &cache = InterpolationCache::getInstance();
+		cache.clear();
+		cache.setLimits(32, 32);
+	}
+
+	void test_lerp_matches_vec3f_lerp() {
+		std::vector<Vec3f> frames = makeFrames();
+
+		// 4 floats at a time leaves a tail for every count not a multiple of 4
+		const uint32 counts[] = { 1, 2, 3, 5, 6, 7, 13, 1001 };
+		for(unsigned int index = 0; index < sizeof(counts) / sizeof(counts[0]); ++index) {
+			uint32 count = counts[index];
+			std::vector<Vec3f> result(count);
+			std::vector<Vec3f> expected(count);
+			InterpolationData::lerp(&frames[0], &frames[vertexCount], 0.3718f, &result[0], count);
+			for(uint32 i = 0; i < count; ++i) {
+				expected[i] = frames[i].lerp(0.3718f, frames[vertexCount + i]);
+			}
+			CPPUNIT_ASSERT( sameBits(&result[0], &expected[0], count) );
+		}
+	}
+
+	void test_referenced_entry_survives_eviction() {
+		std::vector<Vec3f> frames = makeFrames();
+		InterpolationCache &cache = InterpolationCache::getInstance();
+		cache.clear();
+		cache.setLimits(8, 1);
+
+		// the held entry is the least recently used one once the others come
+		InterpolationCacheEntry *held = cache.acquire(1, 0, &frames[0], vertexCount, 0, 1, 3);
+		std::vector<Vec3f> expected(held->getData(), held->getData() + vertexCount);
+		for(int index = 0; index < 200; ++index) {
+			InterpolationCacheEntry *entry = cache.acquire(2, 0, &frames[0], vertexCount, index % 3, index % 3 + 1, index % 9);
+			cache.release(entry);
+		}
+		CPPUNIT_ASSERT( cache.getUsedBytes() <= 1024 * 1024 + (int64)vertexCount * sizeof(Vec3f) );
+		CPPUNIT_ASSERT( sameBits(held->getData(), &expected[0], vertexCount) );
+
+		int64 hitCount = cache.getHitCount();
+		InterpolationCacheEntry *again = cache.acquire(1, 0, &frames[0], vertexCount, 0, 1, 3);
+		CPPUNIT_ASSERT( again == held );
+		CPPUNIT_ASSERT_EQUAL( hitCount + 1, cache.getHitCount() );
+		cache.release(again);
+		cache.release(held);
+	}
+
+	void test_purge_drops_only_unreferenced_owner_entries() {
+		std::vector<Vec3f> frames = makeFrames();
+		InterpolationCache &cache = InterpolationCache::getInstance();
+		cache.clear();
+		cache.setLimits(8, 32);
+		const int64 entryBytes = (int64)vertexCount * sizeof(Vec3f);
+
+		InterpolationCacheEntry *held = cache.acquire(1, 0, &frames[0], vertexCount, 0, 1, 2);
+		cache.release(cache.acquire(1, 0, &frames[0], vertexCount, 1, 2, 2));
+		cache.release(cache.acquire(2, 0, &frames[0], vertexCount, 1, 2, 2));
+		CPPUNIT_ASSERT_EQUAL( 3 * entryBytes, cache.getUsedBytes() );
+
+		cache.purge(1);
+		CPPUNIT_ASSERT_EQUAL( 2 * entryBytes, cache.getUsedBytes() );
+
+		// the other owner and the held entry are still cached, the dropped one is not
+		int64 hitCount = cache.getHitCount();
+		int64 missCount = cache.getMissCount();
+		InterpolationCacheEntry *other = cache.acquire(2, 0, &frames[0], vertexCount, 1, 2, 2);
+		InterpolationCacheEntry *heldAgain = cache.acquire(1, 0, &frames[0], vertexCount, 0, 1, 2);
+		InterpolationCacheEntry *dropped = cache.acquire(1, 0, &frames[0], vertexCount, 1, 2, 2);
+		CPPUNIT_ASSERT( heldAgain == held );
+		CPPUNIT_ASSERT_EQUAL( hitCount + 2, cache.getHitCount() );
+		CPPUNIT_ASSERT_EQUAL( missCount + 1, cache.getMissCount() );
+		cache.release(other);
+		cache.release(heldAgain);
+		cache.release(dropped);
+		cache.release(held);
+	}
+
+	void test_disabled_cache_uses_private_buffer() {
+		std::vector<Vec3f> frames = makeFrames();
+		InterpolationCache &cache = InterpolationCache::getInstance();
+		cache.clear();
+		cache.setLimits(0, 32);
+		CPPUNIT_ASSERT( cache.isEnabled() == false );
+
+		Mesh mesh;
+		loadMesh(mesh, frames);
+		InterpolationData interpolation(&mesh);
+		int64 missCount = cache.getMissCount();
+		interpolation.updateVertices(0.5f, false);
+
+		// no cache entry, the pose is lerped at the exact t into its own buffer
+		CPPUNIT_ASSERT_EQUAL( (int64)0, cache.getUsedBytes() );
+		CPPUNIT_ASSERT_EQUAL( missCount, cache.getMissCount() );
+		const Vec3f *vertices = interpolation.getVertices();
+		CPPUNIT_ASSERT( vertices != mesh.getVertices() );
+
+		// t 0.5 over 4 frames without cycling is half way from frame 1 to 2
+		float localT = 0.5f * (frameCount - 1) - 1;
+		std::vector<Vec3f> expected(vertexCount);
+		for(uint32 i = 0; i < vertexCount; ++i) {
+			expected[i] = frames[vertexCount + i].lerp(localT, frames[2 * vertexCount + i]);
+		}
+		CPPUNIT_ASSERT( sameBits(vertices, &expected[0], vertexCount) );
+	}
+};
+
+// Test Suite Registrations
+CPPUNIT_TEST_SUITE_REGISTRATION( InterpolationTest );
+//
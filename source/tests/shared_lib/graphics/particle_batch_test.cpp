@@ -0,0 +1,165 @@
+// ==============================================================
+//	This file is part of MegaGlest Unit Tests (www.megaglest.org)
+//
+//	Copyright (C) 2013 MegaGlest team
+//
+//	You can redistribute this code and/or modify it under
+//	the terms of the GNU General Public License as published
+//	by the Free Software Foundation; either version 2 of the
+//	License, or (at your option) any later version
+// ==============================================================
+
+#include <cppunit/extensions/HelperMacros.h>
+#include "particle_batch.h"
+#include "texture.h"
+
+using namespace Shared::Graphics;
+
+//
+// Texture without pixels, the batch only compares texture pointers
+//
+class BatchTestTexture : public Texture {
+public:
+	virtual void init(Filter filter, int maxAnisotropy) {}
+	virtual void end(bool deletePixelBuffer) {}
+	virtual string getPath() const { return ""; }
+	virtual void deletePixels() {}
+	virtual std::size_t getPixelByteCount() const { return 0; }
+	virtual uint32 getCRC() { return 0; }
+};
+
+//
+// Particle system with fixed particles, particle i sits at (base + i, 0, 0)
+//
+class BatchTestParticleSystem : public ParticleSystem {
+public:
+	BatchTestParticleSystem(int count, float base, Texture *texture, BlendMode blendMode) : ParticleSystem(count) {
+		setTexture(texture);
+		setBlendMode(blendMode);
+		for(int i = 0; i < count; ++i) {
+			Particle *particle = createParticle();
+			particle->pos = Vec3f(base + i, 0.0f, 0.0f);
+			particle->color = Vec4f(base, 0.5f, 0.25f, 1.0f);
+			particle->size = 2.0f;
+		}
+	}
+	virtual ParticleSystemType getParticleSystemType() const { return pst_All; }
+};
+
+//
+// Tests for the material batching of billboard particles
+//
+class ParticleBatchTest : public CppUnit::TestFixture {
+	// Register the suite of tests for this fixture
+	CPPUNIT_TEST_SUITE( ParticleBatchTest );
+
+	CPPUNIT_TEST( test_one_draw_per_material );
+	CPPUNIT_TEST( test_order_inside_material );
+	CPPUNIT_TEST( test_billboard_corners );
+	CPPUNIT_TEST( test_empty_systems_are_skipped );
+
+	CPPUNIT_TEST_SUITE_END();
+	// End of Fixture registration
+
+public:
+
+	void test_one_draw_per_material() {
+		BatchTestTexture textureA;
+		BatchTestTexture textureB;
+		BatchTestParticleSystem system1(3, 100.0f, &textureA, ParticleSystem::bmOne);
+		BatchTestParticleSystem system2(2, 200.0f, &textureB, ParticleSystem::bmOne);
+		BatchTestParticleSystem system3(4, 300.0f, &textureA, ParticleSystem::bmOne);
+		BatchTestParticleSystem system4(1, 400.0f, &textureA, ParticleSystem::bmOneMinusAlpha);
+		BatchTestParticleSystem system5(5, 500.0f, &textureB, ParticleSystem::bmOne);
+
+		ParticleBatch batch;
+		batch.addSystem(&system1);
+		batch.addSystem(&system2);
+		batch.addSystem(&system3);
+		batch.addSystem(&system4);
+		batch.addSystem(&system5);
+		batch.build(Vec3f(1.0f, 0.0f, 0.0f), Vec3f(0.0f, 1.0f, 0.0f));
+
+		const std::vector<ParticleBatchDraw> &draws = batch.getDraws();
+		CPPUNIT_ASSERT_EQUAL( 5, batch.getSystemCount() );
+		CPPUNIT_ASSERT_EQUAL( 3, (int)draws.size() );
+		CPPUNIT_ASSERT_EQUAL( (15 * 4), (int)batch.getVertices().size() );
+
+		// materials in the order they first appeared, ranges back to back
+		CPPUNIT_ASSERT( draws[0].texture == &textureA && draws[0].blendMode == ParticleSystem::bmOne );
+		CPPUNIT_ASSERT( draws[1].texture == &textureB && draws[1].blendMode == ParticleSystem::bmOne );
+		CPPUNIT_ASSERT( draws[2].texture == &textureA && draws[2].blendMode == ParticleSystem::bmOneMinusAlpha );
+		CPPUNIT_ASSERT_EQUAL( 0, draws[0].firstVertex );
+		CPPUNIT_ASSERT_EQUAL( (3 + 4) * 4, draws[0].vertexCount );
+		CPPUNIT_ASSERT_EQUAL( (3 + 4) * 4, draws[1].firstVertex );
+		CPPUNIT_ASSERT_EQUAL( (2 + 5) * 4, draws[1].vertexCount );
+		CPPUNIT_ASSERT_EQUAL( (3 + 4 + 2 + 5) * 4, draws[2].firstVertex );
+		CPPUNIT_ASSERT_EQUAL( 1 * 4, draws[2].vertexCount );
+	}
+
+	void test_order_inside_material() {
+		BatchTestTexture texture;
+		BatchTestParticleSystem system1(2, 100.0f, &texture, ParticleSystem::bmOne);
+		BatchTestParticleSystem system2(1, 200.0f, NULL, ParticleSystem::bmOne);
+		BatchTestParticleSystem system3(2, 300.0f, &texture, ParticleSystem::bmOne);
+
+		ParticleBatch batch;
+		batch.addSystem(&system1);
+		batch.addSystem(&system2);
+		batch.addSystem(&system3);
+		batch.build(Vec3f(1.0f, 0.0f, 0.0f), Vec3f(0.0f, 1.0f, 0.0f));
+
+		// every quad carries the base of its system in the red channel
+		const std::vector<ParticleVertex> &vertices = batch.getVertices();
+		const float expected[] = { 100.0f, 100.0f, 300.0f, 300.0f, 200.0f };
+		for(int quad = 0; quad < 5; ++quad) {
+			for(int corner = 0; corner < 4; ++corner) {
+				CPPUNIT_ASSERT_EQUAL( expected[quad], vertices[quad * 4 + corner].color.x );
+			}
+		}
+		// particles keep their order too, the second quad is particle 101
+		CPPUNIT_ASSERT_EQUAL( 100.0f, vertices[4].pos.x );
+		CPPUNIT_ASSERT_EQUAL( 102.0f, vertices[4 + 2].pos.x );
+	}
+
+	void test_billboard_corners() {
+		BatchTestTexture texture;
+		BatchTestParticleSystem system(1, 10.0f, &texture, ParticleSystem::bmOne);
+
+		ParticleBatch batch;
+		batch.addSystem(&system);
+		batch.build(Vec3f(1.0f, 0.0f, 0.0f), Vec3f(0.0f, 1.0f, 0.0f));
+
+		// size 2 gives a unit half extent, corners as ParticleRendererGl
+		const std::vector<ParticleVertex> &vertices = batch.getVertices();
+		CPPUNIT_ASSERT( vertices[0].pos == Vec3f(9.0f, 1.0f, 0.0f) );
+		CPPUNIT_ASSERT( vertices[1].pos == Vec3f(9.0f, -1.0f, 0.0f) );
+		CPPUNIT_ASSERT( vertices[2].pos == Vec3f(11.0f, -1.0f, 0.0f) );
+		CPPUNIT_ASSERT( vertices[3].pos == Vec3f(11.0f, 1.0f, 0.0f) );
+
+		CPPUNIT_ASSERT( vertices[0].texCoord == Vec2f(0.0f, 1.0f) );
+		CPPUNIT_ASSERT( vertices[1].texCoord == Vec2f(0.0f, 0.0f) );
+		CPPUNIT_ASSERT( vertices[2].texCoord == Vec2f(1.0f, 0.0f) );
+		CPPUNIT_ASSERT( vertices[3].texCoord == Vec2f(1.0f, 1.0f) );
+	}
+
+	void test_empty_systems_are_skipped() {
+		BatchTestTexture texture;
+		BatchTestParticleSystem empty(0, 0.0f, &texture, ParticleSystem::bmOne);
+
+		ParticleBatch batch;
+		batch.addSystem(&empty);
+		batch.build(Vec3f(1.0f, 0.0f, 0.0f), Vec3f(0.0f, 1.0f, 0.0f));
+
+		CPPUNIT_ASSERT( batch.isEmpty() );
+		CPPUNIT_ASSERT( batch.getDraws().empty() );
+		CPPUNIT_ASSERT( batch.getVertices().empty() );
+
+		batch.clear();
+		CPPUNIT_ASSERT_EQUAL( 0, batch.getSystemCount() );
+	}
+};
+
+// Test Suite Registrations
+CPPUNIT_TEST_SUITE_REGISTRATION( ParticleBatchTest );
+//
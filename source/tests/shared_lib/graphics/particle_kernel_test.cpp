@@ -0,0 +1,243 @@
+// ==============================================================
+//	This file is part of MegaGlest Unit Tests (www.megaglest.org)
+//
+//	Copyright (C) 2013 MegaGlest team
+//
+//	You can redistribute this code and/or modify it under
+//	the terms of the GNU General Public License as published
+//	by the Free Software Foundation; either version 2 of the
+//	License, or (at your option) any later version
+// ==============================================================
+
+#include <cppunit/extensions/HelperMacros.h>
+#include "particle_kernel.h"
+#include "particle.h"
+#include <vector>
+#include <cstring>
+
+using namespace Shared::Graphics;
+
+//
+// Tests for the structure of arrays particle integrators
+//
+class ParticleKernelTest : public CppUnit::TestFixture {
+	// Register the suite of tests for this fixture
+	CPPUNIT_TEST_SUITE( ParticleKernelTest );
+
+	CPPUNIT_TEST( test_store_load_round_trip );
+	CPPUNIT_TEST( test_engines_match );
+	CPPUNIT_TEST( test_fire_matches_update_particle );
+	CPPUNIT_TEST( test_unit_matches_update_particle );
+	CPPUNIT_TEST( test_remove_keeps_alive_particles_in_front );
+
+	CPPUNIT_TEST_SUITE_END();
+	// End of Fixture registration
+
+private:
+
+	static float randomValue(uint32 &seed, float range) {
+		seed = seed * 1103515245 + 12345;
+		return ((int)((seed >> 8) % 200001) - 100000) / 100000.0f * range;
+	}
+
+	static Particle makeParticle(uint32 &seed) {
+		Particle particle;
+		particle.pos = Vec3f(randomValue(seed, 500.0f), randomValue(seed, 50.0f), randomValue(seed, 500.0f));
+		particle.lastPos = Vec3f(randomValue(seed, 500.0f), randomValue(seed, 50.0f), randomValue(seed, 500.0f));
+		particle.speed = Vec3f(randomValue(seed, 0.3f), randomValue(seed, 0.3f), randomValue(seed, 0.3f));
+		particle.accel = Vec3f(randomValue(seed, 0.01f), randomValue(seed, 0.01f), randomValue(seed, 0.01f));
+		particle.color = Vec4f(randomValue(seed, 1.0f), randomValue(seed, 1.0f), randomValue(seed, 1.0f), randomValue(seed, 1.0f));
+		particle.size = randomValue(seed, 2.0f);
+		particle.energy = 1 + (int)((seed >> 8) % 300);
+		return particle;
+	}
+
+	static void fillArrays(ParticleArrays &arrays, int count) {
+		uint32 seed = 4711;
+		arrays.resize(count);
+		for(int i = 0; i < count; ++i) {
+			arrays.store(i, makeParticle(seed));
+		}
+	}
+
+	static bool sameBits(float a, float b) {
+		return memcmp(&a, &b, sizeof(float)) == 0;
+	}
+
+	static bool sameParticle(const Particle &a, const Particle &b) {
+		return sameBits(a.pos.x, b.pos.x) && sameBits(a.pos.y, b.pos.y) && sameBits(a.pos.z, b.pos.z) &&
+			   sameBits(a.lastPos.x, b.lastPos.x) && sameBits(a.lastPos.y, b.lastPos.y) && sameBits(a.lastPos.z, b.lastPos.z) &&
+			   sameBits(a.speed.x, b.speed.x) && sameBits(a.speed.y, b.speed.y) && sameBits(a.speed.z, b.speed.z) &&
+			   sameBits(a.color.x, b.color.x) && sameBits(a.color.y, b.color.y) &&
+			   sameBits(a.color.z, b.color.z) && sameBits(a.color.w, b.color.w) &&
+			   sameBits(a.size, b.size) && a.energy == b.energy;
+	}
+
+	static bool sameArrays(const ParticleArrays &a, const ParticleArrays &b, int count) {
+		for(int i = 0; i < count; ++i) {
+			Particle particleA;
+			Particle particleB;
+			a.load(i, particleA);
+			b.load(i, particleB);
+			if(sameParticle(particleA, particleB) == false) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	static UnitParticleParams makeUnitParams(int alternations, bool fixed, bool decrementEnergy) {
+		UnitParticleParams params;
+		params.maxParticleEnergy = 250;
+		params.alternations = alternations;
+		params.color = Vec4f(0.9f, 0.4f, 0.2f, 0.8f);
+		params.colorNoEnergy = Vec4f(0.1f, 0.2f, 0.3f, 0.0f);
+		params.particleSize = 0.6f;
+		params.sizeNoEnergy = 1.3f;
+		params.fixed = fixed;
+		params.fixedAddition = Vec3f(0.013f, -0.02f, 0.0071f);
+		params.isDaylightAffected = (fixed == false);
+		params.lightColor = Vec3f(0.7f, 0.8f, 0.9f);
+		params.decrementEnergy = decrementEnergy;
+		return params;
+	}
+
+public:
+
+	void test_store_load_round_trip() {
+		uint32 seed = 1;
+		Particle particle = makeParticle(seed);
+
+		ParticleArrays arrays;
+		arrays.resize(3);
+		arrays.store(2, particle);
+		arrays.move(2, 0);
+
+		Particle loaded;
+		arrays.load(0, loaded);
+		CPPUNIT_ASSERT( sameParticle(particle, loaded) );
+		CPPUNIT_ASSERT( arrays.getPos(0) == particle.pos );
+		CPPUNIT_ASSERT( arrays.getColor(0) == particle.color );
+	}
+
+	void test_engines_match() {
+		if(ParticleKernel::isEngineAvailable(pkeSSE2) == false) {
+			return;
+		}
+		// odd count so the vector loops leave a scalar tail
+		const int count = 1003;
+		ParticleKernelEngine oldEngine = ParticleKernel::getEngine();
+
+		for(int kind = 0; kind < 5; ++kind) {
+			ParticleArrays vectorArrays;
+			fillArrays(vectorArrays, count);
+			ParticleArrays scalarArrays = vectorArrays;
+
+			UnitParticleParams vectorParams = makeUnitParams(kind == 3 ? 3 : 0, kind == 3, kind != 4);
+			UnitParticleParams scalarParams = vectorParams;
+
+			for(int frame = 0; frame < 200; ++frame) {
+				ParticleKernel::setEngine(pkeSSE2);
+				if(kind == 0) ParticleKernel::integrateLinear(vectorArrays, count);
+				else if(kind == 1) ParticleKernel::integrateFire(vectorArrays, count);
+				else ParticleKernel::integrateUnit(vectorArrays, count, vectorParams);
+
+				ParticleKernel::setEngine(pkeScalar);
+				if(kind == 0) ParticleKernel::integrateLinear(scalarArrays, count);
+				else if(kind == 1) ParticleKernel::integrateFire(scalarArrays, count);
+				else ParticleKernel::integrateUnit(scalarArrays, count, scalarParams);
+			}
+			CPPUNIT_ASSERT( sameArrays(vectorArrays, scalarArrays, count) );
+			CPPUNIT_ASSERT_EQUAL( scalarParams.energyUp, vectorParams.energyUp );
+		}
+		ParticleKernel::setEngine(oldEngine);
+	}
+
+	void test_fire_matches_update_particle() {
+		const int count = 37;
+		ParticleArrays arrays;
+		fillArrays(arrays, count);
+
+		std::vector<Particle> particles(count);
+		for(int i = 0; i < count; ++i) {
+			arrays.load(i, particles[i]);
+		}
+
+		FireParticleSystem system(count);
+		for(int frame = 0; frame < 50; ++frame) {
+			ParticleKernel::integrateFire(arrays, count);
+			for(int i = 0; i < count; ++i) {
+				system.updateParticle(&particles[i]);
+			}
+		}
+		for(int i = 0; i < count; ++i) {
+			Particle loaded;
+			arrays.load(i, loaded);
+			CPPUNIT_ASSERT( sameParticle(particles[i], loaded) );
+		}
+	}
+
+	void test_unit_matches_update_particle() {
+		const int count = 37;
+		ParticleArrays arrays;
+		fillArrays(arrays, count);
+
+		std::vector<Particle> particles(count);
+		for(int i = 0; i < count; ++i) {
+			arrays.load(i, particles[i]);
+		}
+
+		UnitParticleSystem system(count);
+		system.setMaxParticleEnergy(250);
+		system.setColor(Vec4f(0.9f, 0.4f, 0.2f, 0.8f));
+		system.setColorNoEnergy(Vec4f(0.1f, 0.2f, 0.3f, 0.0f));
+		system.setParticleSize(0.6f);
+		system.setSizeNoEnergy(1.3f);
+
+		UnitParticleParams params = makeUnitParams(0, false, true);
+		params.isDaylightAffected = false;
+
+		for(int frame = 0; frame < 50; ++frame) {
+			ParticleKernel::integrateUnit(arrays, count, params);
+			for(int i = 0; i < count; ++i) {
+				system.updateParticle(&particles[i]);
+			}
+		}
+		for(int i = 0; i < count; ++i) {
+			Particle loaded;
+			arrays.load(i, loaded);
+			CPPUNIT_ASSERT( sameParticle(particles[i], loaded) );
+		}
+	}
+
+	void test_remove_keeps_alive_particles_in_front() {
+		const int count = 10;
+		ParticleArrays arrays;
+		fillArrays(arrays, count);
+		for(int i = 0; i < count; ++i) {
+			arrays.energy[i] = (i % 3 == 0 ? 0 : i);
+			arrays.posY[i] = (i % 2 == 0 ? -1.0f : 1.0f);
+		}
+
+		ParticleArrays belowGround = arrays;
+
+		int alive = ParticleKernel::removeExhausted(arrays, count);
+		CPPUNIT_ASSERT_EQUAL( 6, alive );
+		int energySum = 0;
+		for(int i = 0; i < alive; ++i) {
+			CPPUNIT_ASSERT( arrays.energy[i] > 0 );
+			energySum += arrays.energy[i];
+		}
+		CPPUNIT_ASSERT_EQUAL( 1 + 2 + 4 + 5 + 7 + 8, energySum );
+
+		alive = ParticleKernel::removeBelowGround(belowGround, count);
+		CPPUNIT_ASSERT_EQUAL( 5, alive );
+		for(int i = 0; i < alive; ++i) {
+			CPPUNIT_ASSERT( belowGround.posY[i] >= 0.0f );
+		}
+	}
+};
+
+// Test Suite Registrations
+CPPUNIT_TEST_SUITE_REGISTRATION( ParticleKernelTest );
+//
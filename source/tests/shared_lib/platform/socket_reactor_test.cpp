@@ -0,0 +1,90 @@
+// ==============================================================
+//	This file is part of MegaGlest Unit Tests (www.megaglest.org)
+//
+//	Copyright (C) 2013 MegaGlest team
+//
+//	You can redistribute this code and/or modify it under
+//	the terms of the GNU General Public License as published
+//	by the Free Software Foundation; either version 2 of the
+//	License, or (at your option) any later version
+// ==============================================================
+
+#include <cppunit/extensions/HelperMacros.h>
+#include "socket_reactor.h"
+#include <new>
+
+#ifndef WIN32
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+using namespace Shared::Platform;
+
+#ifndef WIN32
+
+//
+// Tests for the socket reactor registrations of reconnecting slots
+//
+class SocketReactorTest : public CppUnit::TestFixture {
+	// Register the suite of tests for this fixture
+	CPPUNIT_TEST_SUITE( SocketReactorTest );
+
+	CPPUNIT_TEST( test_reconnect_with_reused_socket_address );
+
+	CPPUNIT_TEST_SUITE_END();
+	// End of Fixture registration
+
+private:
+
+	static Socket * newConnectedSocket(void *storage, int &peer) {
+		int fds[2];
+		CPPUNIT_ASSERT( socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0 );
+		peer = fds[1];
+		return new (storage) Socket(fds[0]);
+	}
+
+public:
+
+	void test_reconnect_with_reused_socket_address() {
+		// slot threads keep one Socket pointer per slot, a reconnect may get
+		// its Socket at the address of the closed one
+		union {
+			char data[sizeof(Socket)];
+			double align;
+		} storage;
+		SocketReactor reactor(true);
+		std::vector<int> readyKeys;
+
+		int peer = -1;
+		Socket *first = newConnectedSocket(storage.data, peer);
+		PLATFORM_SOCKET firstId = first->getSocketId();
+		uint32 firstSerial = first->getSerial();
+		reactor.setSocket(0, firstId, firstSerial);
+		CPPUNIT_ASSERT_EQUAL( 0, reactor.waitForReadable(readyKeys, 0) );
+
+		// closing drops the descriptor from the epoll set
+		first->~Socket();
+		close(peer);
+
+		Socket *second = newConnectedSocket(storage.data, peer);
+		CPPUNIT_ASSERT( second == first );
+		CPPUNIT_ASSERT( second->getSerial() != firstSerial );
+		CPPUNIT_ASSERT_EQUAL( firstId, second->getSocketId() );
+		reactor.setSocket(0, second->getSocketId(), second->getSerial());
+
+		char data = 1;
+		CPPUNIT_ASSERT( write(peer, &data, 1) == 1 );
+		CPPUNIT_ASSERT_EQUAL( 1, reactor.waitForReadable(readyKeys, 1000000) );
+		CPPUNIT_ASSERT_EQUAL( 0, readyKeys[0] );
+
+		reactor.clear();
+		second->~Socket();
+		close(peer);
+	}
+};
+
+// Test Suite Registrations
+CPPUNIT_TEST_SUITE_REGISTRATION( SocketReactorTest );
+
+#endif
+//
@@ -0,0 +1,104 @@
+// ==============================================================
+//	This file is part of MegaGlest Unit Tests (www.megaglest.org)
+//
+//	Copyright (C) 2013 MegaGlest team
+//
+//	You can redistribute this code and/or modify it under
+//	the terms of the GNU General Public License as published
+//	by the Free Software Foundation; either version 2 of the
+//	License, or (at your option) any later version
+// ==============================================================
+
+#include <cppunit/extensions/HelperMacros.h>
+#include "checksum.h"
+#include <vector>
+#include <cstring>
+
+using namespace Shared::Util;
+
+//
+// Tests for the Checksum CRC32 kernels
+//
+class ChecksumTest : public CppUnit::TestFixture {
+	// Register the suite of tests for this fixture
+	CPPUNIT_TEST_SUITE( ChecksumTest );
+
+	CPPUNIT_TEST( test_known_crc32_value );
+	CPPUNIT_TEST( test_slice_by_8_matches_byte_table );
+	CPPUNIT_TEST( test_add_methods_match_for_both_engines );
+
+	CPPUNIT_TEST_SUITE_END();
+	// End of Fixture registration
+
+private:
+
+	static std::vector<unsigned char> makeData(size_t size) {
+		std::vector<unsigned char> data(size);
+		uint32 seed = 12345;
+		for(size_t i = 0; i < size; ++i) {
+			seed = seed * 1103515245 + 12345;
+			data[i] = (unsigned char)(seed >> 16);
+		}
+		return data;
+	}
+
+	static uint32 sumWithEngine(ChecksumEngine engine, const string &text,
+								int32 intValue, uint32 uintValue, int64 int64Value) {
+		Checksum checksum;
+		checksum.setEngine(engine);
+		checksum.addString(text);
+		checksum.addInt(intValue);
+		checksum.addUInt(uintValue);
+		checksum.addInt64(int64Value);
+		checksum.addByte('x');
+		return checksum.getSum();
+	}
+
+public:
+
+	void test_known_crc32_value() {
+		const char *text = "123456789";
+		CPPUNIT_ASSERT_EQUAL( (uint32)0xCBF43926, Checksum::crc32ByteTable(0, text, strlen(text)) );
+		CPPUNIT_ASSERT_EQUAL( (uint32)0xCBF43926, Checksum::crc32SliceBy8(0, text, strlen(text)) );
+	}
+
+	void test_slice_by_8_matches_byte_table() {
+		std::vector<unsigned char> data = makeData(4096 + 16);
+
+		// every length up to a few blocks from every alignment
+		for(size_t offset = 0; offset < 8; ++offset) {
+			for(size_t size = 0; size < 100; ++size) {
+				CPPUNIT_ASSERT_EQUAL( Checksum::crc32ByteTable(0, &data[offset], size),
+									  Checksum::crc32SliceBy8(0, &data[offset], size) );
+			}
+		}
+
+		// continuing a running sum must also match
+		uint32 byteSum = Checksum::crc32ByteTable(0, &data[0], 13);
+		byteSum = Checksum::crc32ByteTable(byteSum, &data[13], 4096 - 13);
+		uint32 sliceSum = Checksum::crc32SliceBy8(0, &data[0], 13);
+		sliceSum = Checksum::crc32SliceBy8(sliceSum, &data[13], 4096 - 13);
+		CPPUNIT_ASSERT_EQUAL( byteSum, sliceSum );
+		CPPUNIT_ASSERT_EQUAL( Checksum::crc32ByteTable(0, &data[0], 4096), sliceSum );
+	}
+
+	void test_add_methods_match_for_both_engines() {
+		string text = "megaglest/techs/megapack/factions/tech/units/swordman/swordman.xml";
+		CPPUNIT_ASSERT_EQUAL( sumWithEngine(ceByteTable, text, -1234567, 0xDEADBEEF, -9876543210LL),
+							  sumWithEngine(ceSliceBy8, text, -1234567, 0xDEADBEEF, -9876543210LL) );
+
+		// addBytes must give the same sum as feeding the bytes one at a time
+		std::vector<unsigned char> data = makeData(1000);
+		Checksum byteWise;
+		for(size_t i = 0; i < data.size(); ++i) {
+			byteWise.addByte((char)data[i]);
+		}
+		Checksum blockWise;
+		blockWise.addBytes(&data[0], data.size());
+		CPPUNIT_ASSERT_EQUAL( byteWise.getSum(), blockWise.getSum() );
+	}
+};
+
+// Test Suite Registrations
+CPPUNIT_TEST_SUITE_REGISTRATION( ChecksumTest );
+//
@@ -0,0 +1,100 @@
+// ==============================================================
+//	This file is part of MegaGlest Unit Tests (www.megaglest.org)
+//
+//	Copyright (C) 2013 MegaGlest team
+//
+//	You can redistribute this code and/or modify it under
+//	the terms of the GNU General Public License as published
+//	by the Free Software Foundation; either version 2 of the
+//	License, or (at your option) any later version
+// ==============================================================
+
+#include <cppunit/extensions/HelperMacros.h>
+#include "spsc_queue.h"
+#include <vector>
+
+using namespace Shared::Util;
+
+//
+// Tests for the single producer / single consumer queue
+//
+class SPSCQueueTest : public CppUnit::TestFixture {
+	// Register the suite of tests for this fixture
+	CPPUNIT_TEST_SUITE( SPSCQueueTest );
+
+	CPPUNIT_TEST( test_capacity_rounds_up );
+	CPPUNIT_TEST( test_pop_keeps_push_order );
+	CPPUNIT_TEST( test_overflow_keeps_push_order );
+	CPPUNIT_TEST( test_discard_drops_queued_items );
+
+	CPPUNIT_TEST_SUITE_END();
+	// End of Fixture registration
+
+public:
+
+	void test_capacity_rounds_up() {
+		SPSCQueue<int> queue(5);
+		CPPUNIT_ASSERT_EQUAL( (uint32)8, queue.getCapacity() );
+		CPPUNIT_ASSERT_EQUAL( true, queue.empty() );
+	}
+
+	void test_pop_keeps_push_order() {
+		SPSCQueue<int> queue(4);
+		std::vector<int> items;
+
+		// wrap around the ring a few times
+		for(int round = 0; round < 5; ++round) {
+			for(int value = 0; value < 3; ++value) {
+				queue.push(round * 10 + value);
+			}
+			CPPUNIT_ASSERT_EQUAL( false, queue.empty() );
+
+			items.clear();
+			queue.popAll(items);
+			CPPUNIT_ASSERT_EQUAL( (size_t)3, items.size() );
+			for(int value = 0; value < 3; ++value) {
+				CPPUNIT_ASSERT_EQUAL( round * 10 + value, items[value] );
+			}
+			CPPUNIT_ASSERT_EQUAL( true, queue.empty() );
+		}
+	}
+
+	void test_overflow_keeps_push_order() {
+		SPSCQueue<int> queue(4);
+		for(int value = 0; value < 10; ++value) {
+			queue.push(value);
+		}
+
+		std::vector<int> items;
+		queue.popAll(items);
+		CPPUNIT_ASSERT_EQUAL( (size_t)10, items.size() );
+		for(int value = 0; value < 10; ++value) {
+			CPPUNIT_ASSERT_EQUAL( value, items[value] );
+		}
+
+		// the ring is used again once the overflow is drained
+		queue.push(42);
+		items.clear();
+		queue.popAll(items);
+		CPPUNIT_ASSERT_EQUAL( (size_t)1, items.size() );
+		CPPUNIT_ASSERT_EQUAL( 42, items[0] );
+	}
+
+	void test_discard_drops_queued_items() {
+		SPSCQueue<int> queue(4);
+		for(int value = 0; value < 6; ++value) {
+			queue.push(value);
+		}
+		queue.discardAll();
+		queue.push(7);
+
+		std::vector<int> items;
+		queue.popAll(items);
+		CPPUNIT_ASSERT_EQUAL( (size_t)1, items.size() );
+		CPPUNIT_ASSERT_EQUAL( 7, items[0] );
+	}
+};
+
+// Test Suite Registrations
+CPPUNIT_TEST_SUITE_REGISTRATION( SPSCQueueTest );
+//